@@ -0,0 +1,539 @@
+/* track fixed celestial coordinates, ie, J2000 RA and Dec, from the station location.
+ *
+ * The station is described in $HOME/.g5500_station.txt, one "name = value" per line:
+ *
+ *    lat = 37.29                 geodetic latitude, degs +N
+ *    lng = -122.03               longitude, degs +E
+ *    elev = 100                  height above sea level, m
+ *    temp = 10                   air temperature, degs C
+ *    pressure = 1001.3           air pressure, hPa, 0 for no refraction
+ *
+ * The J2000 position is first reduced to the apparent place of date by precession (IAU 1976), nutation (the
+ * largest terms of IAU 1980, good to 0.5") and annual aberration including the Earth's orbital eccentricity.
+ * That changes only slowly so it is recomputed once a minute. Each control tick then only rotates it to the
+ * local horizon with the apparent sidereal time and adds refraction, which costs a microsecond or two. Time is
+ * taken as UTC for UT1 and a fixed offset for TT, each good to a second. The result is within a few arcsecs,
+ * far finer than the mount can point. Refraction uses the optical formula; radio refraction near the horizon
+ * is somewhat larger and depends on humidity, so set pressure to 0 and allow for it if it matters.
+ *
+ * The target is followed by the control thread itself, see g5500_direct_track(), until another motion command
+ * or until it moves out of range of the mount such as by setting below the horizon.
+ *
+ * Web commands:
+ *
+ *    station                                         show the station location
+ *    station?lat=y&lng=x[&elev=m&temp=c&pressure=p]  set and save the station location
+ *    track_radec?ra=h&dec=d                          track J2000 RA in hours and Dec in degs
+ *    get_track                                       RA Dec being tracked and their az el now, else none
+ *    pointing_add?body=sun                           record a pointing sighting of the Sun, see g5500_direct.c
+ *    pointing_add?ra=h&dec=d                         record a pointing sighting of J2000 RA Dec
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#include "g5500_sa.h"
+#include "celestial.h"
+
+
+// basename of station file in $HOME
+static const char station_file_name[] = ".g5500_station.txt";
+
+
+// handy conversions
+#define PI              3.14159265358979323846
+#define D2R             (PI/180)
+#define AS2R            (D2R/3600)
+#define H2R             (PI/12)
+
+
+// time
+#define UNIX_JD0        2440587.5               // JD of unix epoch
+#define J2000           2451545.0               // JD of epoch J2000.0
+#define TT_UTC          69.184                  // TT - UTC, secs, 32.184 + 37 leap seconds since 2017
+#define APP_REFRESH     60.0                    // secs between apparent place updates
+
+
+// location of the station
+typedef struct {
+    double lat, lng;                            // degs +N +E
+    double elev;                                // m above sea level
+    double temp;                                // degs C
+    double pressure;                            // hPa, 0 for no refraction
+} Station;
+
+static Station station;
+static int station_ok;                          // set once lat and lng are known
+static char *station_path;
+
+
+// the object being tracked.
+// N.B. once tracking, used only by trackFunc() in the control thread
+typedef struct {
+    double ra, dec;                             // J2000, rads
+    Station stn;                                // station when tracking started
+    double t_app;                               // unix time of apparent place, 0 to recompute
+    double ra_app, dec_app;                     // apparent place of date, rads
+    double eqeq;                                // equation of the equinoxes, rads
+} Track;
+
+static Track track;
+
+
+/* return x in range [0,2PI)
+ */
+static double range2PI (double x)
+{
+        x = fmod (x, 2*PI);
+        if (x < 0)
+            x += 2*PI;
+        return (x);
+}
+
+/* rotate v[] about axis 0 x, 1 y or 2 z by angle a in the sense of a rotation of the coordinate frame.
+ */
+static void rotate (double v[3], int axis, double a)
+{
+        int i = (axis + 1) % 3, j = (axis + 2) % 3;
+        double c = cos(a), s = sin(a);
+        double vi = c*v[i] + s*v[j];
+        double vj = -s*v[i] + c*v[j];
+        v[i] = vi;
+        v[j] = vj;
+}
+
+/* return julian centuries of TT since J2000 at the given unix time
+ */
+static double centuriesTT (double t)
+{
+        return (((t + TT_UTC)/86400 + UNIX_JD0 - J2000) / 36525);
+}
+
+/* find the mean obliquity of the ecliptic and the nutation in longitude and obliquity at T centuries TT since
+ * J2000, all in rads.
+ */
+static void nutation (double T, double *eps0, double *dpsi, double *deps)
+{
+        double L  = (280.4665 + 36000.7698*T) * D2R;            // mean longitude of Sun
+        double Lm = (218.3165 + 481267.8813*T) * D2R;           // mean longitude of Moon
+        double Om = (125.04452 - 1934.136261*T) * D2R;          // longitude of Moon's ascending node
+        *eps0 = (84381.448 - 46.8150*T - 0.00059*T*T + 0.001813*T*T*T) * AS2R;
+        *dpsi = (-17.20*sin(Om) - 1.32*sin(2*L) - 0.23*sin(2*Lm) + 0.21*sin(2*Om)) * AS2R;
+        *deps = (9.20*cos(Om) + 0.57*cos(2*L) + 0.10*cos(2*Lm) - 0.09*cos(2*Om)) * AS2R;
+}
+
+/* return the true geometric longitude of the Sun at T centuries TT since J2000, rads
+ */
+static double sunLongitude (double T)
+{
+        double L0 = 280.46646 + 36000.76983*T;                  // Sun mean longitude
+        double M = (357.52911 + 35999.05029*T) * D2R;           // Sun mean anomaly
+        double C = (1.914602 - 0.004817*T)*sin(M) + (0.019993 - 0.000101*T)*sin(2*M) + 0.000289*sin(3*M);
+        return ((L0 + C) * D2R);
+}
+
+/* find the apparent place of date ra_app and dec_app of the J2000 position ra and dec at the given unix time,
+ * and the equation of the equinoxes for converting mean to apparent sidereal time. All angles in rads.
+ */
+static void apparentPlace (double t, double ra, double dec, double *ra_app, double *dec_app, double *eqeq)
+{
+        double T = centuriesTT (t);
+
+        // unit vector of J2000 position
+        double v[3] = { cos(dec)*cos(ra), cos(dec)*sin(ra), sin(dec) };
+
+        // precession to mean equator and equinox of date
+        double zeta  = (2306.2181*T + 0.30188*T*T + 0.017998*T*T*T) * AS2R;
+        double z     = (2306.2181*T + 1.09468*T*T + 0.018203*T*T*T) * AS2R;
+        double theta = (2004.3109*T - 0.42665*T*T - 0.041833*T*T*T) * AS2R;
+        rotate (v, 2, -zeta);
+        rotate (v, 1, theta);
+        rotate (v, 2, -z);
+
+        // mean obliquity and nutation in longitude and obliquity
+        double eps0, dpsi, deps;
+        nutation (T, &eps0, &dpsi, &deps);
+        double eps = eps0 + deps;
+
+        // annual aberration: add the Earth's velocity/c, found from the Sun's true longitude and the orbit
+        double lsun = sunLongitude (T);
+        double e = 0.016708634 - 0.000042037*T;                 // eccentricity of Earth orbit
+        double pi = (102.93735 + 1.71946*T) * D2R;              // longitude of perihelion
+        double kappa = 20.49552 * AS2R;                         // constant of aberration
+        double b[3] = { kappa*(sin(lsun) - e*sin(pi)), -kappa*(cos(lsun) - e*cos(pi)), 0 };
+        rotate (b, 0, -eps0);                                   // ecliptic to equatorial
+        double n = 0;
+        for (int i = 0; i < 3; i++) {
+            v[i] += b[i];
+            n += v[i]*v[i];
+        }
+        n = sqrt(n);
+        for (int i = 0; i < 3; i++)
+            v[i] /= n;
+
+        // nutation to true equator and equinox of date
+        rotate (v, 0, eps0);
+        rotate (v, 2, -dpsi);
+        rotate (v, 0, -eps);
+
+        *ra_app = range2PI (atan2 (v[1], v[0]));
+        *dec_app = asin (v[2]);
+        *eqeq = dpsi*cos(eps);
+}
+
+/* return Greenwich mean sidereal time at the given unix time, rads.
+ * UT1 is taken as UTC.
+ */
+static double gmst (double t)
+{
+        double d = t/86400 + UNIX_JD0 - J2000;
+        double T = d/36525;
+        double deg = 280.46061837 + 360.98564736629*d + 0.000387933*T*T - T*T*T/38710000;
+        return (range2PI (deg*D2R));
+}
+
+/* return Greenwich mean sidereal time at the given unix time, rads, for other modules
+ */
+double celSiderealTime (double t)
+{
+        return (gmst (t));
+}
+
+/* return the increase in elevation due to refraction of an object whose true elevation is alt, both degs.
+ */
+static double refraction (double alt, const Station *sp)
+{
+        if (sp->pressure <= 0 || alt < -1)
+            return (0);
+        double r = 1.02 / tan ((alt + 10.3/(alt + 5.11)) * D2R);        // arcmins at 1010 hPa and 10 C
+        return (r * (sp->pressure/1010) * (283/(273 + sp->temp)) / 60);
+}
+
+/* find the az and el, degs, of an object at the given apparent place from the given station.
+ */
+static void horizon (double t, const Station *sp, double ra_app, double dec_app, double eqeq,
+                float *az, float *el)
+{
+        double lat = sp->lat * D2R;
+        double H = gmst (t) + eqeq + sp->lng*D2R - ra_app;
+
+        double east = -cos(dec_app)*sin(H);
+        double north = sin(dec_app)*cos(lat) - cos(dec_app)*cos(H)*sin(lat);
+        double up = sin(dec_app)*sin(lat) + cos(dec_app)*cos(H)*cos(lat);
+
+        double alt = asin (up) / D2R;
+        *az = range2PI (atan2 (east, north)) / D2R;
+        *el = alt + refraction (alt, sp);
+}
+
+/* return the default air pressure at the given height above sea level, m
+ */
+static double standardPressure (double elev)
+{
+        return (1013.25*exp(-elev/8434));
+}
+
+/* find the az and el, degs, at unix time t of the object at J2000 ra, hours, and dec, degs, from the station.
+ */
+void celAzEl (double t, double ra, double dec, float *az, float *el)
+{
+        double ra_app, dec_app, eqeq;
+        apparentPlace (t, ra*H2R, dec*D2R, &ra_app, &dec_app, &eqeq);
+        horizon (t, &station, ra_app, dec_app, eqeq, az, el);
+}
+
+/* find the az and el, degs, of the Sun at unix time t from the station.
+ * the apparent longitude allows for aberration and nutation; parallax, under 9", is ignored.
+ */
+void celSunAzEl (double t, float *az, float *el)
+{
+        double T = centuriesTT (t);
+        double eps0, dpsi, deps;
+        nutation (T, &eps0, &dpsi, &deps);
+        double eps = eps0 + deps;
+        double lambda = sunLongitude (T) + dpsi - 20.4898*AS2R;
+
+        double ra = range2PI (atan2 (cos(eps)*sin(lambda), cos(lambda)));
+        double dec = asin (sin(eps)*sin(lambda));
+        horizon (t, &station, ra, dec, dpsi*cos(eps), az, el);
+}
+
+/* G5500TrackFunc called by the control thread each tick while tracking
+ */
+static int trackFunc (double t, float *az, float *el, void *arg)
+{
+        Track *tp = (Track *) arg;
+
+        if (fabs (t - tp->t_app) > APP_REFRESH) {
+            apparentPlace (t, tp->ra, tp->dec, &tp->ra_app, &tp->dec_app, &tp->eqeq);
+            tp->t_app = t;
+        }
+        horizon (t, &tp->stn, tp->ra_app, tp->dec_app, tp->eqeq, az, el);
+
+        return (0);
+}
+
+/* start tracking J2000 ra, hours, and dec, degs.
+ * return RIG_OK or a negative RIG_* error code with brief excuse in ynot[].
+ */
+int celTrackRADec (double ra, double dec, char ynot[])
+{
+        if (ra < 0 || ra >= 24 || dec < -90 || dec > 90) {
+            sprintf (ynot, "RA must be 0 .. 24 hours and Dec -90 .. 90 degs");
+            return (-RIG_EINVAL);
+        }
+        if (!station_ok) {
+            sprintf (ynot, "station location is not set");
+            return (-RIG_ECONF);
+        }
+
+        // check it is up now for a better excuse than the driver can give
+        struct timespec ts;
+        clock_gettime (CLOCK_REALTIME, &ts);
+        float az, el;
+        celAzEl (ts.tv_sec + ts.tv_nsec*1e-9, ra, dec, &az, &el);
+        if (el < 0) {
+            sprintf (ynot, "RA %g Dec %g is below the horizon now", ra, dec);
+            return (-RIG_EINVAL);
+        }
+
+        // insure trackFunc is not using track while it changes
+        g5500_direct_track (NULL, NULL);
+
+        track.ra = ra*H2R;
+        track.dec = dec*D2R;
+        track.stn = station;
+        track.t_app = 0;
+
+        int err = g5500_direct_track (trackFunc, &track);
+        if (err != RIG_OK)
+            sprintf (ynot, "can not track %g %g from here now, code %d", ra, dec, err);
+        else
+            rig_debug (RIG_DEBUG_VERBOSE, "celestial: tracking RA %g Dec %g\n", ra, dec);
+        return (err);
+}
+
+/* if tracking return 1 with the J2000 ra, hours, and dec, degs, else return 0.
+ */
+int celGetTrack (double *ra, double *dec)
+{
+        if (!g5500_direct_tracking())
+            return (0);
+        *ra = track.ra/H2R;
+        *dec = track.dec/D2R;
+        return (1);
+}
+
+/* if the station location is set return 0 with its geodetic lat and lng, degs +N +E, and elev, m, else -1.
+ */
+int celStation (double *lat, double *lng, double *elev)
+{
+        if (!station_ok)
+            return (-1);
+        *lat = station.lat;
+        *lng = station.lng;
+        *elev = station.elev;
+        return (0);
+}
+
+/* write the station to station_path
+ */
+static void saveStation (void)
+{
+        FILE *fp = fopen (station_path, "w");
+        if (!fp) {
+            rig_debug (RIG_DEBUG_ERR, "%s: %s\n", station_path, strerror(errno));
+            return;
+        }
+
+        fprintf (fp, "lat = %.6f\n", station.lat);
+        fprintf (fp, "lng = %.6f\n", station.lng);
+        fprintf (fp, "elev = %g\n", station.elev);
+        fprintf (fp, "temp = %g\n", station.temp);
+        fprintf (fp, "pressure = %g\n", station.pressure);
+
+        fclose (fp);
+}
+
+/* read station_path, if any.
+ */
+static void loadStation (void)
+{
+        FILE *fp = fopen (station_path, "r");
+        if (!fp)
+            return;
+
+        char buf[100], name[20];
+        double value;
+        int n_latlng = 0;
+
+        while (fgets (buf, sizeof(buf), fp)) {
+            if (buf[0] == '#' || sscanf (buf, " %19[a-z] = %lf", name, &value) != 2)
+                continue;
+            if (strcmp (name, "lat") == 0) {
+                station.lat = value;
+                n_latlng++;
+            } else if (strcmp (name, "lng") == 0) {
+                station.lng = value;
+                n_latlng++;
+            } else if (strcmp (name, "elev") == 0) {
+                station.elev = value;
+            } else if (strcmp (name, "temp") == 0) {
+                station.temp = value;
+            } else if (strcmp (name, "pressure") == 0) {
+                station.pressure = value;
+            } else {
+                rig_debug (RIG_DEBUG_WARN, "%s: ignoring %s", station_path, buf);
+            }
+        }
+
+        fclose (fp);
+
+        station_ok = n_latlng == 2;
+        rig_debug (RIG_DEBUG_VERBOSE, "celestial: station %g %g from %s\n", station.lat, station.lng, station_path);
+}
+
+/* initialize the station from its file.
+ * return 0 if ok else -1
+ */
+int celInit (void)
+{
+        const char *home = getenv ("HOME");
+        if (!home)
+            home = ".";
+        station_path = (char *) malloc (strlen(home) + strlen(station_file_name) + 2);
+        if (!station_path) {
+            rig_debug (RIG_DEBUG_ERR, "celestial: no memory\n");
+            return (-1);
+        }
+        sprintf (station_path, "%s/%s", home, station_file_name);
+
+        station.temp = 10;
+        station.pressure = standardPressure (0);
+        loadStation();
+        return (0);
+}
+
+/* perform one of the celestial web commands, cmd is the full command including any query.
+ */
+void celWebCommand (FILE *fp, char *cmd)
+{
+        char *query = strchr (cmd, '?');
+        char ynot[100];
+        char val[30];
+
+        if (query)
+            *query++ = '\0';
+
+        if (strcmp (cmd, "station") == 0 && !query) {
+
+            if (!station_ok)
+                fprintf (fp, "err: station location is not set\n");
+            else
+                fprintf (fp, "lat=%.6f\nlng=%.6f\nelev=%g\ntemp=%g\npressure=%g\n",
+                                station.lat, station.lng, station.elev, station.temp, station.pressure);
+
+        } else if (strcmp (cmd, "station") == 0) {
+
+            // start with current, any given replaces
+            Station s = station;
+            int n_latlng = 0;
+            if (queryArg (query, "lat", val, sizeof(val)) == 0) {
+                s.lat = atof (val);
+                n_latlng++;
+            }
+            if (queryArg (query, "lng", val, sizeof(val)) == 0) {
+                s.lng = atof (val);
+                n_latlng++;
+            }
+            if (queryArg (query, "elev", val, sizeof(val)) == 0) {
+                s.elev = atof (val);
+                s.pressure = standardPressure (s.elev);
+            }
+            if (queryArg (query, "temp", val, sizeof(val)) == 0)
+                s.temp = atof (val);
+            if (queryArg (query, "pressure", val, sizeof(val)) == 0)
+                s.pressure = atof (val);
+
+            if (!station_ok && n_latlng < 2) {
+                fprintf (fp, "err: station requires lat and lng\n");
+            } else if (s.lat < -90 || s.lat > 90 || s.lng < -180 || s.lng > 360 || s.pressure < 0
+                                || s.temp < -80 || s.temp > 60) {
+                fprintf (fp, "err: station lat, lng, temp or pressure is out of range\n");
+            } else {
+                // carry on tracking from the new location
+                double ra, dec;
+                int tracking = celGetTrack (&ra, &dec);
+                station = s;
+                station_ok = 1;
+                saveStation();
+                if (tracking && celTrackRADec (ra, dec, ynot) != RIG_OK)
+                    fprintf (fp, "err: %s\n", ynot);
+                else
+                    fprintf (fp, "ok\n");
+            }
+
+        } else if (strcmp (cmd, "track_radec") == 0) {
+
+            char dec[30];
+            if (queryArg (query, "ra", val, sizeof(val)) < 0 || queryArg (query, "dec", dec, sizeof(dec)) < 0)
+                fprintf (fp, "err: track_radec requires ra and dec\n");
+            else if (celTrackRADec (atof (val), atof (dec), ynot) != RIG_OK)
+                fprintf (fp, "err: %s\n", ynot);
+            else
+                fprintf (fp, "ok\n");
+
+        } else if (strcmp (cmd, "get_track") == 0) {
+
+            double ra, dec;
+            if (celGetTrack (&ra, &dec)) {
+                struct timespec ts;
+                clock_gettime (CLOCK_REALTIME, &ts);
+                float az, el;
+                celAzEl (ts.tv_sec + ts.tv_nsec*1e-9, ra, dec, &az, &el);
+                fprintf (fp, "%.6f %.5f %.2f %.2f\n", ra, dec, az, el);
+            } else {
+                fprintf (fp, "none\n");
+            }
+
+        } else if (strcmp (cmd, "pointing_add") == 0) {
+
+            // the mount is peaked on this object now, find where it truly is
+            struct timespec ts;
+            clock_gettime (CLOCK_REALTIME, &ts);
+            double t = ts.tv_sec + ts.tv_nsec*1e-9;
+            float az, el;
+            char dec[30];
+            if (!station_ok) {
+                fprintf (fp, "err: station location is not set\n");
+                return;
+            }
+            if (queryArg (query, "body", val, sizeof(val)) == 0 && strcmp (val, "sun") == 0) {
+                celSunAzEl (t, &az, &el);
+            } else if (queryArg (query, "ra", val, sizeof(val)) == 0 && queryArg (query, "dec", dec, sizeof(dec)) == 0) {
+                celAzEl (t, atof (val), atof (dec), &az, &el);
+            } else {
+                fprintf (fp, "err: pointing_add requires body=sun or ra and dec\n");
+                return;
+            }
+
+            if (el < 0) {
+                fprintf (fp, "err: object is below the horizon\n");
+                return;
+            }
+
+            snprintf (val, sizeof(val), "%.4f,%.4f", az, el);
+            if (rotSetConf ("pointing_add", val, ynot, sizeof(ynot)) != RIG_OK)
+                fprintf (fp, "err: %s\n", ynot);
+            else
+                fprintf (fp, "ok %s\n", val);
+
+        } else {
+
+            fprintf (fp, "err: unrecognized command\n");
+        }
+}
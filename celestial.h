@@ -0,0 +1,15 @@
+#ifndef _CELESTIAL_H
+#define _CELESTIAL_H
+
+#include <stdio.h>
+
+extern int celInit (void);
+extern int celStation (double *lat, double *lng, double *elev);
+extern double celSiderealTime (double t);
+extern void celAzEl (double t, double ra, double dec, float *az, float *el);
+extern void celSunAzEl (double t, float *az, float *el);
+extern int celTrackRADec (double ra, double dec, char ynot[]);
+extern int celGetTrack (double *ra, double *dec);
+extern void celWebCommand (FILE *fp, char *cmd);
+
+#endif // _CELESTIAL_H
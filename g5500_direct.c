@@ -28,6 +28,105 @@
  * 3 = az + el to 180. Mode 1 is always automatically engaged by default when built on any system that does
  * not self-identify as a RPi (see isapi.h).
  *
+ * Gear backlash means the same target ADC corresponds to slightly different pointing depending on the
+ * direction from which the axis arrived. The az_approach and el_approach configuration parameters select
+ * whether each axis may finish its move from either side (0), always finish moving cw/up (1) or always
+ * finish moving ccw/down (2). When a move would otherwise end from the wrong side, the axis first overshoots
+ * its target by the backlash plus twice the deadband then returns. The backlash of each axis is measured at
+ * the end of the calibration sequence as the motion lost following a reversal away from the max limits, less
+ * the motor start latency, and is stored in the calibration file along with the speed of each axis measured
+ * during the max sweep.
+ *
+ * The stand-alone build can predict how long each axis will take to reach its target from its current
+ * position, allowing for control loop polling, motor start latency, coast and any approach overshoot leg.
+ * The speed of each axis is taken from calibration if known, else from the nominal G5500 specification.
+ *
+ * The control loop timing, deadbands, stopped detection count and minimum power ADC are also configuration
+ * parameters so a mount may be tuned without rebuilding. New values are adopted by the control thread at the
+ * start of its next tick. Setting save_conf=1 writes all parameters except simulator to
+ * $HOME/.hamlib_g5500_conf.txt, which is read back the next time the driver is initialized.
+ *
+ * Setting autotune=1 runs a calibration-like sequence that finds these values for the mount at hand. After
+ * measuring the ADC noise at rest, it drives both axes through a script of short and long steps in each
+ * direction, timing the start of motion, the speed and the coast after the relay opens. From these it derives
+ * each axis deadband and stop lead, ie, how far short of its goal the axis is stopped so it coasts to rest on
+ * it, and the motion start period. The results take effect at once, are saved as if by save_conf=1 and a
+ * report is written to $HOME/.hamlib_g5500_tune.txt. The sequence takes about half a minute and requires
+ * a prior calibration. Any motion command is refused as busy until it completes; stop aborts it.
+ *
+ * A supervisor thread checks that the control thread keeps to its schedule. Each time the control thread is
+ * about to sleep it publishes a heartbeat with the time by which it will beat again. If it is ever more than
+ * watchdog_ms late, for example hung in an I2C transaction, the supervisor itself forces all relays idle,
+ * counts the miss, records how long after the deadline the relays were idle, and sets an error which is
+ * reported and cleared like any other. Setting hw_watchdog=1 also has the supervisor feed /dev/watchdog while
+ * the control thread is healthy and stop feeding it while not, so the system is reset by the hardware if
+ * the control thread never recovers. Separately, a position older than one polling period plus stale_ms is
+ * considered stale and get_pos returns an error rather than the old position.
+ *
+ * The control thread also estimates the speed of each axis from successive positions. Setting extrapolate=1
+ * makes get_pos return the position extrapolated from the latest sample to the time of the request, rather
+ * than where the mount was when last read, which may be up to one polling period earlier. The stand-alone
+ * extended get_pos reply also includes the sample time, its age and the axis velocities.
+ *
+ * Either axis may instead be read from a magnetic absolute encoder on the mast, an AS5600 or AS5048B on the
+ * same I2C bus, named by the az_encoder and el_encoder configuration parameters. Calibration aligns each
+ * encoder with the mount from its counts at the two limits and saves that in the calibration file. The pot
+ * is still read every tick and decides which turn of the 450 degree azimuth the encoder is on, after which
+ * the count is unwrapped from read to read. While so locked, positions come from the encoder, which is also
+ * read every encoder_period usecs between ticks so an axis is stopped as soon as it reaches its goal. An
+ * encoder that fails to read, reports a bad magnet, jumps or strays too far from the pot is abandoned for the
+ * pot until it reads well again. A newly configured encoder is not used until the next calibration.
+ *
+ * Elevation may also be improved by an MPU-6050 accelerometer and gyro on the boom, named by the el_imu
+ * configuration parameter. Calibration aligns its angle of gravity with the mount and learns which way its
+ * gyro turns. A Kalman filter of el, el rate and gyro bias then fuses the pot, the accelerometer angle while
+ * the boom reads 1 g and the gyro rate, so el reads finer and steadier than the pot alone and, with the IMU
+ * also read between ticks like an encoder, an el move stops closer to its goal. An el encoder takes
+ * precedence when locked. An IMU that fails to read or whose angle or filter strays is abandoned for the pot
+ * until it reads well again.
+ *
+ * Each motor has a duty rating, so the control thread keeps a thermal model of each, heated by its relay
+ * on-time and each start and cooling exponentially, scaled so continuous running from cold reaches the limit
+ * after motor_run secs and running motor_duty percent of the time settles at it. A motor at the limit is
+ * rested, its target waiting, until it cools to DUTY_RESUME. Before that, from DUTY_WARN, a warning is logged.
+ * A park is never held back otherwise, it may be stowing the antenna for safety. When warmer than
+ * DUTY_BATCH, tracking corrections are batched into fewer longer moves so the tracking engine keeps the target
+ * with fewer starts. The heat of each motor and how many secs of running it has left are in the status.
+ * motor_duty is 0 by default, which turns all this off, because a rotctld client sees a rested move only as
+ * a stalled get_pos; set it to the rating, such as 25 for a G-5500, where the motors need protecting.
+ *
+ * The stand-alone build can also follow a moving target such as a celestial object. A function supplied by
+ * the daemon is called at the start of each control tick to move the targets to where the object is now, so
+ * tracking is as smooth as the control loop allows with no client in the loop. Any other motion command ends it.
+ *
+ * All positions seen by clients are sky positions. An optional pointing model corrects for the mount's
+ * azimuth and elevation zero offsets, tilt of the azimuth axis and lack of perpendicularity, with coefficients
+ * set directly or fit by least squares from sightings of known objects, each added with pointing_add while the
+ * mount is peaked on the object. The model is folded into two correction grids, one each way, so the control
+ * loop converts positions with a bilinear lookup rather than evaluating the model. It is saved in
+ * $HOME/.hamlib_g5500_pointing.txt.
+ *
+ * The stand-alone daemon can hand the mount over to a new process without stopping it. The control loop is
+ * frozen between ticks with the relays idle, a snapshot of its complete state is passed to the new process,
+ * which restores it before starting its own threads and resumes any motion toward the targets.
+ *
+ * On a board with a single core, the stand-alone daemon may instead run the control loop from its own event
+ * loop, see g5500_direct_set_reactor(). Each tick is then driven by a timer, the ADC conversions are started
+ * and collected on successive timer events rather than waited for, and the g5500_thread_* functions run in
+ * the main thread, which takes the place of the control thread. The supervisor thread remains.
+ *
+ * Only one process can own the GPIO and I2C hardware. When the stand-alone g5500pi daemon is already running,
+ * the hamlib backend instead attaches to it through its local UNIX socket, G5500_DAEMON_SOCKET or as given
+ * by the G5500_SOCKET environment variable, and forwards every API call to it. Any number of hamlib
+ * applications may then share the mount with the daemon web page and its other clients, provided they run as
+ * the daemon's user or in its group. If no daemon is listening when the backend is initialized, it owns the
+ * hardware directly as always.
+ *
+ * Other programs such as weather or power monitors may use the same I2C bus if they access it through piI2C.c,
+ * built as libpiI2C.a, which arbitrates each transaction between processes. The rotator goes first and waits
+ * at most the length of the transaction in progress, up to I2C_URGENT_WAIT_MS. How often and how long it had
+ * to wait, and for which process, is in the status.
+ *
  *
  *************************************************************************************************************
  *
@@ -53,11 +152,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <stdint.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <time.h>
 #include <math.h>
 #include <pthread.h>
+#include <sys/timerfd.h>
 
 
 // use normal hamlib includes unless building stand-alone
@@ -79,6 +181,20 @@
 #include "piGPIO.h"
 #include "piI2C.h"
 #include "piADS1015.h"
+#include "piEncoder.h"
+#include "piIMU.h"
+
+
+/* mount model used when simulating
+ */
+#include "g5500_sim.h"
+
+
+/* client library used to attach to a running g5500pi daemon
+ */
+#if !defined(STANDALONE_G5500)
+#include "g5500client.h"
+#endif
 
 
 
@@ -96,9 +212,7 @@
 #define ADC_CHANNEL_EL          1               // ADS1015 channel for el
 #define ADC_CHANNEL_POK         2               // ADS1015 channel for power ok
 #define ADC_I2C_ADDR            0x48            // bus addr after r/w bit shift
-#define ADC_MIN_POK             1000            // minimum ADC when power ok
-#define ADC_AZ_DEADBAND         50              // even with this big valuge, the error seems to be less than 1 deg
-#define ADC_EL_DEADBAND         50              // 
+#define ADC_MOVE_NOISE          32              // min ADC change considered real motion, 2 LSB after shift
 
 
 /* RPi GPIO output pins, BCM numbering, active-hi.
@@ -120,6 +234,8 @@
 #define G5500_RIG_ERR_GPIO      (-RIG_BUSERROR)
 #define G5500_RIG_ERR_INTERNAL  (-RIG_EINTERNAL)
 #define G5500_RIG_ERR_BADARGS   (-RIG_EINVAL)
+#define G5500_RIG_ERR_WATCHDOG  (-RIG_ETIMEOUT)
+#define G5500_RIG_ERR_STALE     (-RIG_EIO)
 
 
 /* handy pseudonyms for digital line states
@@ -133,6 +249,26 @@
 static const char g5500_cal_file_name[] = ".hamlib_g5500_cal.txt";
 
 
+/* basename of file in which configuration parameters are stored by the save_conf parameter
+ */
+static const char g5500_conf_file_name[] = ".hamlib_g5500_conf.txt";
+
+
+/* basename of file to which the autotune sequence writes its report
+ */
+static const char g5500_tune_file_name[] = ".hamlib_g5500_tune.txt";
+
+
+/* basename of file in which the pointing model and its reference sightings are stored
+ */
+static const char g5500_pointing_file_name[] = ".hamlib_g5500_pointing.txt";
+
+
+/* basename of file from which the simulator reads how the mount responds, as written by g5500fit
+ */
+static const char g5500_sim_file_name[] = ".hamlib_g5500_sim.txt";
+
+
 /* max physical travel ranges, in degrees.
  */
 #define AZ_MOUNT_MIN            0.0
@@ -149,14 +285,140 @@ static float el_mount_max = EL_MOUNT_MAX;             // might change depending
 #define EL_MOUNT_PARK           0.0
 
 
+/* motion model used for predicting arrival times when not measured.
+ * nominal speeds are from the G5500 specification, 58 secs for 360 az and 67 secs for 180 el.
+ */
+#define AZ_NOMINAL_SPEED        6.2             // degs/sec
+#define EL_NOMINAL_SPEED        2.7             // degs/sec
+#define MOTOR_START_LATENCY     0.3             // secs from relay closing until axis is moving
+#define MOTOR_COAST_TIME        0.2             // secs from relay opening until axis is at rest
+
+
+/* room for any configuration parameter value including its EOS, assumed of every get_conf val
+ */
+#define G5500_CONF_LEN          64
+
+
 /* tokens for our configuration parameters
  * N.B. 0 triggers a bug which sets its value from any undefined parameter
  */
 enum {
     TOK_SIMULATOR = 1,          // avoid 0
+    TOK_AZ_APPROACH,
+    TOK_EL_APPROACH,
+    TOK_THREAD_PERIOD,
+    TOK_MOTION_START_PERIOD,
+    TOK_AZ_DEADBAND,
+    TOK_EL_DEADBAND,
+    TOK_N_EQUAL_STOPPED,
+    TOK_MIN_POK,
+    TOK_SAVE_CONF,
+    TOK_AZ_STOP_LEAD,
+    TOK_EL_STOP_LEAD,
+    TOK_AUTOTUNE,
+    TOK_WATCHDOG_MS,
+    TOK_STALE_MS,
+    TOK_HW_WATCHDOG,
+    TOK_EXTRAPOLATE,
+    TOK_POINTING_MODEL,
+    TOK_POINTING_ADD,
+    TOK_POINTING_FIT,
+    TOK_POINTING_CLEAR,
+    TOK_AZ_ENCODER,
+    TOK_EL_ENCODER,
+    TOK_ENCODER_PERIOD,
+    TOK_EL_IMU,
+    TOK_MOTOR_DUTY,
+    TOK_MOTOR_RUN,
 };
 
 
+/* control loop tuning, each settable as a configuration parameter within the given range.
+ * the control thread works from g5500_tuning which it refreshes from g5500_tuning_next only at the start of
+ * each tick, so a change never takes effect part way through a tick. Changes made while g5500_tuning_hold is
+ * set are deferred until it is cleared so they all take effect on the same tick. g5500_tuning is replaced
+ * under g5500_tuning_lock too, within a tick, so other threads read it only through g5500_get_tuning() or
+ * while holding g5500_tick_lock.
+ */
+typedef struct {
+    int thread_period;                  // control thread polling period, usecs
+    int motion_start_period;            // time allowed for axes to start moving during calibration, usecs
+    int az_deadband;                    // az ADC error considered on target
+    int el_deadband;                    // el ADC error considered on target
+    int n_equal_stopped;                // number of equal consecutive ADC readings considered stopped
+    int min_pok;                        // minimum ADC when power ok
+    int az_stop_lead;                   // az ADC short of goal at which to stop to allow for coasting
+    int el_stop_lead;                   // el ADC short of goal at which to stop to allow for coasting
+} G5500Tuning;
+
+// N.B. even with the big deadbands, the error seems to be less than 1 deg
+#define G5500_TUNING_DEFAULTS {         \
+    .thread_period = 200000,            \
+    .motion_start_period = 1000000,     \
+    .az_deadband = 50,                  \
+    .el_deadband = 50,                  \
+    .n_equal_stopped = 4,               \
+    .min_pok = 1000,                    \
+    .az_stop_lead = 0,                  \
+    .el_stop_lead = 0,                  \
+}
+static G5500Tuning g5500_tuning = G5500_TUNING_DEFAULTS;        // in effect, changed only by control thread
+static G5500Tuning g5500_tuning_next = G5500_TUNING_DEFAULTS;   // takes effect on next tick
+static pthread_mutex_t g5500_tuning_lock = PTHREAD_MUTEX_INITIALIZER;   // guards g5500_tuning_next
+static int g5500_tuning_hold;                                   // defer g5500_tuning_next while set, guarded too
+
+#define THREAD_PERIOD_MIN       20000
+#define THREAD_PERIOD_MAX       2000000
+#define MOTION_START_MIN        0
+#define MOTION_START_MAX        5000000
+#define DEADBAND_MIN            1
+#define DEADBAND_MAX            1000
+#define N_EQUAL_STOPPED_MIN     2
+#define N_EQUAL_STOPPED_MAX     50
+#define MIN_POK_MIN             0
+#define MIN_POK_MAX             32767
+#define STOP_LEAD_MIN           0
+#define STOP_LEAD_MAX           1000
+
+#define THREAD_PERIOD           (g5500_tuning.thread_period)
+#define MOTION_START_PERIOD     (g5500_tuning.motion_start_period)
+#define ADC_AZ_DEADBAND         (g5500_tuning.az_deadband)
+#define ADC_EL_DEADBAND         (g5500_tuning.el_deadband)
+#define N_EQUAL_STOPPED         (g5500_tuning.n_equal_stopped)
+#define ADC_MIN_POK             (g5500_tuning.min_pok)
+#define AZ_STOP_LEAD            (g5500_tuning.az_stop_lead)
+#define EL_STOP_LEAD            (g5500_tuning.el_stop_lead)
+
+
+/* set the tuning parameter *ip, a member of g5500_tuning_next or another int guarded by g5500_tuning_lock,
+ * from val if it lies within [min,max].
+ */
+static int g5500_set_tuning (int *ip, const char *val, int min, int max)
+{
+    char *end;
+    long tmp = strtol (val, &end, 10);
+    if (end == val || tmp < min || tmp > max)
+        return G5500_RIG_ERR_BADARGS;
+
+    pthread_mutex_lock (&g5500_tuning_lock);
+    *ip = (int) tmp;
+    pthread_mutex_unlock (&g5500_tuning_lock);
+
+    return G5500_RIG_OK;
+}
+
+/* return the tuning parameter *ip, a member of g5500_tuning_next or another int guarded by g5500_tuning_lock
+ */
+static int g5500_get_tuning (const int *ip)
+{
+    pthread_mutex_lock (&g5500_tuning_lock);
+    int tmp = *ip;
+    pthread_mutex_unlock (&g5500_tuning_lock);
+
+    return (tmp);
+}
+
+
 /* calibration constants and whether they are valid
  */
 static uint16_t ADC_az_min, ADC_az_max;
@@ -164,6 +426,126 @@ static uint16_t ADC_el_min, ADC_el_max;
 static int ADC_cal_ok = 0;
 
 
+/* backlash and speed of each axis measured during calibration, if known.
+ * backlash is in ADC counts, speed is in ADC counts per second, 0 if unknown.
+ */
+static uint16_t ADC_az_backlash, ADC_el_backlash;
+static float ADC_az_speed, ADC_el_speed;
+
+
+/* an optional magnetic absolute encoder on each axis, read in place of the pot once it is aligned with the
+ * mount by calibration and its turn is resolved from the pot, see g5500_thread_encoder_position().
+ * Configuration is changed only while holding g5500_tick_lock, everything else only by the control thread.
+ */
+typedef struct {
+    EncoderType type;                   // ENC_NONE if not fitted
+    uint8_t addr;                       // I2C bus address
+    int sign;                           // 1 if counts increase cw/up, -1 if ccw/down, 0 until aligned
+    float offset;                       // mount degs from the min limit at raw count 0, modulo 360
+    int have;                           // set when count is valid
+    uint16_t raw;                       // latest raw count
+    double t;                           // time of raw
+    int32_t count;                      // raw counts unwrapped from wherever have was set
+    int32_t shown;                      // count after hysteresis
+    int32_t cal_min;                    // count at the min limit during calibration
+    int locked;                         // set while positions come from the encoder
+    double base;                        // mount degs from the min limit at count 0 while locked
+    int n_faults;                       // times it has been abandoned for the pot
+} G5500Encoder;
+static G5500Encoder enc_az, enc_el;
+static int g5500_encoder_period = 2000; // usecs between encoder reads between ticks, 0 for once per tick
+#define ENC_PERIOD_MIN          500     // shortest encoder period used, usecs
+#define ENC_HYSTERESIS          1       // count changes ignored, so an axis at rest reads steady
+#define ENC_MAX_SPEED           30.0    // degs/sec beyond which a change between reads is a fault
+#define ENC_MAX_STEP            2.0     // degs change allowed between reads regardless of time
+#define ENC_MAX_DISAGREE        20.0    // degs from the pot beyond which the encoder is a fault
+#define ENC_MAX_SPAN_ERR        0.1     // fraction by which the calibration sweep may differ from the span
+
+
+/* an optional accelerometer and gyro on the el boom, fused with the el pot by a Kalman filter once it is
+ * aligned with the mount by calibration, see g5500_thread_imu_position(). The filter state is the el, its
+ * rate and the gyro bias. Configuration is changed only while holding g5500_tick_lock, everything else only
+ * by the control thread.
+ */
+#define IMU_N_STATE             3
+typedef struct {
+    IMUType type;                       // IMU_NONE if not fitted
+    uint8_t addr;                       // I2C bus address
+    char axis;                          // sensor axis parallel to the el axis
+    int sign;                           // 1 if the sensor angle increases upward, -1 if downward, 0 until aligned
+    float zero;                         // sensor angle at the min limit, degs
+    int gyro_sign;                      // 1 or -1 to turn the sensor rate into el rate, 0 if unusable
+    int have;                           // set while the sensor is initialized and reading well
+    double t;                           // time of the latest reading
+    double angle;                       // latest sensor angle, unwrapped from wherever have was set, degs
+    double gyro;                        // latest sensor rate, degs/sec
+    int steady;                         // set if the latest reading was of 1 g, so its angle is usable
+    double cal_min;                     // angle at the min limit during calibration
+    double cal_gyro;                    // rate at the min limit during calibration
+    double cal_sum;                     // integral of rate less cal_gyro since then, degs
+    int cal_ok;                         // set while the cal_ values are valid
+    int locked;                         // set while positions come from the filter
+    double x[IMU_N_STATE];              // el degs from the min limit, el rate degs/sec, gyro bias degs/sec
+    double P[IMU_N_STATE][IMU_N_STATE]; // covariance of x
+    double t_x;                         // time of x
+    int n_rejects;                      // consecutive sensor angles rejected by the filter
+    double shown;                       // x[0] after hysteresis
+    int n_faults;                       // times it has been abandoned for the pot
+} G5500IMU;
+static G5500IMU imu_el;
+#define IMU_POT_SIGMA           2.0     // el pot error, degs, mostly its nonlinearity
+#define IMU_ANGLE_SIGMA         0.3     // sensor angle noise, degs
+#define IMU_GYRO_SIGMA          0.1     // sensor rate noise, degs/sec
+#define IMU_BIAS_SIGMA          2.0     // initial gyro bias uncertainty, degs/sec
+#define IMU_BIAS_DRIFT          0.01    // gyro bias random walk, degs/sec/sqrt(sec)
+#define IMU_ACCEL_SIGMA         10.0    // el acceleration allowed for by the filter, degs/sec^2
+#define IMU_MAX_G_ERR           0.1     // angles are not used while the sensor reads this far from 1 g
+#define IMU_GATE                5.0     // sigmas at which a sensor angle is rejected by the filter
+#define IMU_MAX_REJECTS         10      // consecutive rejections at which the sensor is a fault
+#define IMU_HYSTERESIS          0.05    // el degs changes ignored, so an axis at rest reads steady
+#define IMU_MAX_DISAGREE        20.0    // degs from the pot beyond which the sensor is a fault
+#define IMU_MAX_SPAN_ERR        0.1     // fraction by which the calibration sweep may differ from the span
+#define IMU_MAX_GYRO_ERR        0.2     // fraction by which the integrated rate may differ from the sweep
+
+
+/* a thermal model of each motor driven by its relay on-time, see g5500_thread_duty().
+ * heat is 0 when cold and 1 at the rated limit, at which the axis is rested until it cools to DUTY_RESUME.
+ * changed only by the control thread.
+ */
+typedef struct {
+    float heat;                         // 0 cold .. 1 at the rated limit
+    int on;                             // set if the relay was on at the previous update
+    int warned;                         // set from DUTY_WARN until cooled to DUTY_RESUME
+    int cooling;                        // set while rested by a forced cool-down
+    int n_starts;                       // relay starts
+    float run_secs;                     // total relay on-time
+    int n_cooldowns;                    // forced cool-downs
+} G5500Duty;
+static G5500Duty duty_az, duty_el;
+static double duty_t;                   // time of the latest update, 0 before the first
+static int g5500_motor_duty = 0;        // rated duty cycle, percent, 0 for no limit
+static int g5500_motor_run = 300;       // rated continuous run from cold, secs
+#define MOTOR_RUN_MIN           10
+#define MOTOR_RUN_MAX           3600
+#define DUTY_START_SECS         1.0     // extra heating of each start, as secs of running
+#define DUTY_WARN               0.8     // heat at which a cool-down is warned of
+#define DUTY_RESUME             0.6     // heat to which a forced cool-down waits
+#define DUTY_BATCH              0.5     // heat above which tracking corrections are batched
+#define DUTY_BATCH_MAX          2.0     // tracking error allowed to build up when at the limit, degs
+
+
+/* approach direction policies, ie, the direction in which each axis must be moving when it arrives at its
+ * target. finishing every move from the same side takes up the gear backlash the same way every time.
+ */
+typedef enum {
+    APPROACH_ANY,                       // stop from whichever side we happen to arrive
+    APPROACH_INCREASING,                // always finish moving cw or up
+    APPROACH_DECREASING,                // always finish moving ccw or down
+} ApproachType;
+static volatile ApproachType az_approach;
+static volatile ApproachType el_approach;
+
+
 
 /* simulator parameters
  */
@@ -174,10 +556,10 @@ typedef enum {
     SIM_EL180
 } SimType;
 static volatile SimType g5500_sim_mode; // whether and how to simulate
-#define AZ_SIM_SPEED            10      // degs/sec
-#define EL_SIM_SPEED            5       // degs/sec
 #define AZ_SIM_MAX_ADC          2000    // simulated ADC value when at max az, not critical
 #define EL_SIM_MAX_ADC          2000    // simulated ADC value when at max el, not critical
+static G5500SimProfile sim_profile;     // how the simulated mount responds
+static G5500SimAxis sim_az, sim_el;     // simulated axes, moved only by the control thread
 
 
 
@@ -192,6 +574,10 @@ static volatile int AZ_cmd_cw;          // set while commanding a cw az rotation
 static volatile int AZ_cmd_ccw;         // set while commanding a ccw az rotation
 static volatile int EL_cmd_up;          // set while commanding an upward el rotation
 static volatile int EL_cmd_down;        // set while commanding a downward el rotation
+static volatile uint16_t ADC_az_via;    // az overshoot point on the way to ADC_az_target
+static volatile uint16_t ADC_el_via;    // el overshoot point on the way to ADC_el_target
+static volatile int AZ_via_active;      // set while seeking ADC_az_via before ADC_az_target
+static volatile int EL_via_active;      // set while seeking ADC_el_via before ADC_el_target
 
 
 /* these variables are used to detect motion. an active axis is considered stopped if N_STOPPED ADC
@@ -202,7 +588,6 @@ static volatile uint16_t ADC_az_prev;   // previous ADC_az_now
 static volatile uint16_t ADC_el_prev;   // previous ADC_el_now
 static volatile int ADC_az_n_equal;     // number of consecutive ADC_az_now that are equal
 static volatile int ADC_el_n_equal;     // number of consecutive ADC_el_now that are equal
-#define N_EQUAL_STOPPED 4               // number of equal consecutive ADC readings considered stopped
 
 
 /* handy derived states
@@ -216,11 +601,49 @@ static volatile int ADC_el_n_equal;     // number of consecutive ADC_el_now that
 #define EL_isat_down_lim()      (ADC_cal_ok && ADC_el_now < ADC_el_min + ADC_EL_DEADBAND)
 #define EL_isat_up_lim()        (ADC_cal_ok && ADC_el_max < ADC_el_now + ADC_EL_DEADBAND)
 #define AZ_is_wrapped()         (ADC_cal_ok && g5500_ADC_to_az(ADC_az_now) >= AZ_MOUNT_WRAP)
+#define AZ_overshoot()          (ADC_az_backlash + 2*ADC_AZ_DEADBAND)
+#define EL_overshoot()          (ADC_el_backlash + 2*ADC_EL_DEADBAND)
 
 
 /* forward declation
  */
 static void g5500_sim_mode_set (int type);
+static void g5500_save_conf_file (void);
+static void g5500_read_conf_file (void);
+#if defined(STANDALONE_G5500)
+static void g5500_apply_snapshot (void);
+#endif
+
+
+/* when attached to a running g5500pi daemon, each API call is forwarded to it and returns its result.
+ * the daemon itself of course always owns the mount.
+ */
+#if defined(STANDALONE_G5500)
+#define G5500_DAEMON_FORWARD(call)
+#else
+static G5500Client *g5500_daemon;       // set when attached to a daemon
+static int g5500_daemon_attach (void);
+static int g5500_daemon_set_conf (token_t token, const char *val);
+static int g5500_daemon_get_conf (token_t token, char *val, size_t val_len);
+static const char *g5500_daemon_get_info (void);
+#define G5500_DAEMON_FORWARD(call)      do { if (g5500_daemon) return (call); } while (0)
+#endif
+
+
+/* in the stand-alone build the control thread may follow a moving target supplied by g5500_direct_track().
+ * any other motion command ends it, waiting for the current tick so the target is not then moved again.
+ */
+#if defined(STANDALONE_G5500)
+static volatile G5500TrackFunc g5500_track_fn;  // called each tick for the current target, NULL if none
+static void *g5500_track_arg;                   // passed to g5500_track_fn
+#define G5500_TRACK_END()               do {                                            \
+                                            pthread_mutex_lock (&g5500_tick_lock);      \
+                                            g5500_track_fn = NULL;                      \
+                                            pthread_mutex_unlock (&g5500_tick_lock);    \
+                                        } while (0)
+#else
+#define G5500_TRACK_END()               do { } while (0)
+#endif
 
 
 
@@ -326,26 +749,95 @@ static float g5500_ADC_to_el (uint16_t adc)
  ***********************************************************************************************************/
 
 
-/* return full path to file containing calibration parameters,
+/* return full path to the given file in $HOME, built on first call and retained in *pathp,
  * or return NULL if can not be established.
  */
-static const char* g5500_get_cal_filename()
+static const char* g5500_home_path (const char *basename, char **pathp)
 {
     // set up path if first call
-    static char *home, *path;
-    if (!home)
-        home = getenv ("HOME");
-    if (!home)
-        return (NULL);
-    if (!path) {
-        path = (char *) malloc (strlen(home) + strlen(g5500_cal_file_name) + 2);  // +1 for '/', +1 for '\0'
-        if (!path)
+    if (!*pathp) {
+        const char *home = getenv ("HOME");
+        if (!home)
             return (NULL);
-        sprintf (path, "%s/%s", home, g5500_cal_file_name);
+        *pathp = (char *) malloc (strlen(home) + strlen(basename) + 2);  // +1 for '/', +1 for '\0'
+        if (!*pathp)
+            return (NULL);
+        sprintf (*pathp, "%s/%s", home, basename);
     }
 
     // return path
-    return (path);
+    return (*pathp);
+}
+
+/* return full path to file containing calibration parameters,
+ * or return NULL if can not be established.
+ */
+static const char* g5500_get_cal_filename()
+{
+    static char *path;
+    return (g5500_home_path (g5500_cal_file_name, &path));
+}
+
+/* save the alignment of the given encoder to fp as name = spec sign offset, if it has been aligned.
+ */
+static void g5500_save_encoder_cal (FILE *fp, const char *name, const G5500Encoder *ep)
+{
+    char spec[16];
+    if (ep->type == ENC_NONE || ep->sign == 0)
+        return;
+    encoderFormat (ep->type, ep->addr, spec);
+    fprintf (fp, "%s = %s %d %.4f\n", name, spec, ep->sign, ep->offset);
+}
+
+/* adopt the encoder alignment in buf if it is for name and matches the encoder now configured
+ */
+static void g5500_read_encoder_cal (const char *buf, const char *name, G5500Encoder *ep)
+{
+    char fmt[32], spec[16], mine[16];
+    int sign;
+    float offset;
+    sprintf (fmt, "%s = %%15s %%d %%f", name);
+    if (sscanf (buf, fmt, spec, &sign, &offset) != 3 || (sign != 1 && sign != -1))
+        return;
+    encoderFormat (ep->type, ep->addr, mine);
+    if (ep->type == ENC_NONE || strcmp (spec, mine) != 0) {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: ignoring alignment of %s encoder %s\n", __func__, name, spec);
+        return;
+    }
+    ep->offset = offset;
+    ep->sign = sign;
+}
+
+/* save the alignment of the given IMU to fp as name = spec sign zero gyro_sign, if it has been aligned.
+ */
+static void g5500_save_imu_cal (FILE *fp, const char *name, const G5500IMU *ip)
+{
+    char spec[20];
+    if (ip->type == IMU_NONE || ip->sign == 0)
+        return;
+    imuFormat (ip->type, ip->addr, ip->axis, spec);
+    fprintf (fp, "%s = %s %d %.4f %d\n", name, spec, ip->sign, ip->zero, ip->gyro_sign);
+}
+
+/* adopt the IMU alignment in buf if it is for name and matches the IMU now configured
+ */
+static void g5500_read_imu_cal (const char *buf, const char *name, G5500IMU *ip)
+{
+    char fmt[32], spec[20], mine[20];
+    int sign, gyro_sign;
+    float zero;
+    sprintf (fmt, "%s = %%19s %%d %%f %%d", name);
+    if (sscanf (buf, fmt, spec, &sign, &zero, &gyro_sign) != 4 || (sign != 1 && sign != -1)
+                    || gyro_sign < -1 || gyro_sign > 1)
+        return;
+    imuFormat (ip->type, ip->addr, ip->axis, mine);
+    if (ip->type == IMU_NONE || strcmp (spec, mine) != 0) {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: ignoring alignment of %s IMU %s\n", __func__, name, spec);
+        return;
+    }
+    ip->zero = zero;
+    ip->sign = sign;
+    ip->gyro_sign = gyro_sign;
 }
 
 /* save the calibration constants to file.
@@ -363,6 +855,13 @@ static void g5500_save_cal_file()
     fprintf (fp, "ADC_az_max = %d\n", ADC_az_max);
     fprintf (fp, "ADC_el_min = %d\n", ADC_el_min);
     fprintf (fp, "ADC_el_max = %d\n", ADC_el_max);
+    fprintf (fp, "ADC_az_backlash = %d\n", ADC_az_backlash);
+    fprintf (fp, "ADC_el_backlash = %d\n", ADC_el_backlash);
+    fprintf (fp, "ADC_az_speed = %.1f\n", ADC_az_speed);
+    fprintf (fp, "ADC_el_speed = %.1f\n", ADC_el_speed);
+    g5500_save_encoder_cal (fp, "ENC_az", &enc_az);
+    g5500_save_encoder_cal (fp, "ENC_el", &enc_el);
+    g5500_save_imu_cal (fp, "IMU_el", &imu_el);
     
     fclose(fp);
 
@@ -379,6 +878,7 @@ static int g5500_read_cal_file()
     FILE *fp;
     char buf[1024];
     int tmp;
+    float ftmp;
     int az_min_ok = 0;
     int az_max_ok = 0;
     int el_min_ok = 0;
@@ -416,6 +916,19 @@ static int g5500_read_cal_file()
             ADC_el_max = (uint16_t) tmp;
             el_max_ok = 1;
         }
+
+        // these are optional, files from older versions will not have them
+        if (sscanf (buf, "ADC_az_backlash = %d", &tmp) == 1)
+            ADC_az_backlash = (uint16_t) tmp;
+        if (sscanf (buf, "ADC_el_backlash = %d", &tmp) == 1)
+            ADC_el_backlash = (uint16_t) tmp;
+        if (sscanf (buf, "ADC_az_speed = %f", &ftmp) == 1)
+            ADC_az_speed = ftmp;
+        if (sscanf (buf, "ADC_el_speed = %f", &ftmp) == 1)
+            ADC_el_speed = ftmp;
+        g5500_read_encoder_cal (buf, "ENC_az", &enc_az);
+        g5500_read_encoder_cal (buf, "ENC_el", &enc_el);
+        g5500_read_imu_cal (buf, "IMU_el", &imu_el);
     }
 
     // finished with file
@@ -431,8 +944,9 @@ static int g5500_read_cal_file()
     if (ADC_el_max < ADC_el_min+1000)
         return (-1);
 
-    rig_debug(RIG_DEBUG_TRACE, "%s found AZ %u %u EL %u %u\n", __func__,
-                ADC_az_min, ADC_az_max, ADC_el_min, ADC_el_max);
+    rig_debug(RIG_DEBUG_TRACE, "%s found AZ %u %u EL %u %u backlash %u %u speed %g %g\n", __func__,
+                ADC_az_min, ADC_az_max, ADC_el_min, ADC_el_max, ADC_az_backlash, ADC_el_backlash,
+                ADC_az_speed, ADC_el_speed);
 
     // ok!
     ADC_cal_ok = 1;
@@ -440,10 +954,6 @@ static int g5500_read_cal_file()
     return (0);
 
 }
-
-
-
-
 /***********************************************************************************************************
  *
  *
@@ -463,104 +973,627 @@ typedef enum {
     CTS_CAL_START,                      // start the calibration sequence
     CTS_CAL_SEEK_MINS,                  // moving to az and el min limits
     CTS_CAL_SEEK_MAXS,                  // moving to az and el max limits
+    CTS_CAL_BACKLASH,                   // reversing away from max limits to measure backlash
+    CTS_TUNE_START,                     // start the autotune sequence
+    CTS_TUNE_NOISE,                     // measuring ADC noise at rest
+    CTS_TUNE_STEP,                      // running one step of the autotune script
     CTS_ERR_ADC,                        // ADC err
     CTS_ERR_NOPOWER,                    // no power
     CTS_ERR_STUCK,                      // not moving but should be
+    CTS_ERR_WATCHDOG,                   // control thread missed its heartbeat deadline
 } G5500ControlThreadState;
 
 static volatile G5500ControlThreadState g5500_thread_state = CTS_STOP;
 
 
-/* control thread's polling and motion commence periods, microseconds
+/* control thread supervision, see g5500_supervisor_thread().
+ * the parameters are set with g5500_set_tuning() but are used directly by the supervisor, not the control
+ * thread, because they must work even when the control thread does not.
+ */
+#define SUPERVISOR_PERIOD       50000           // supervisor polling period, usecs
+#define WATCHDOG_MS_MIN         100
+#define WATCHDOG_MS_MAX         60000
+#define STALE_MS_MIN            0
+#define STALE_MS_MAX            60000
+static const char g5500_hw_watchdog_dev[] = "/dev/watchdog";
+
+static int g5500_watchdog_ms = 1000;            // control thread lateness considered a miss, ms
+static int g5500_stale_ms = 1000;               // position age beyond one period considered stale, ms
+static int g5500_hw_watchdog;                   // set to also feed g5500_hw_watchdog_dev
+static volatile double g5500_heartbeat_due;     // time by which the control thread will beat again, 0 until first
+static volatile int g5500_wd_misses;            // number of heartbeat deadlines missed
+static volatile float g5500_wd_response;        // secs from the latest missed deadline until relays were idle
+static volatile float g5500_wd_response_max;    // largest g5500_wd_response
+static int g5500_hw_watchdog_fd = -1;           // g5500_hw_watchdog_dev when open
+
+
+/* the control thread holds g5500_tick_lock while working on each tick and releases it only while sleeping,
+ * so another thread may freeze the control loop between ticks by holding it and setting g5500_frozen.
  */
-#define THREAD_PERIOD           200000
-#define MOTION_START_PERIOD     1000000
+static pthread_mutex_t g5500_tick_lock = PTHREAD_MUTEX_INITIALIZER;
+static volatile int g5500_frozen;               // set while the control loop is deliberately held
+static int g5500_restored;                      // set when state was restored from another process
 
 
-/* capture &rot->rot_state for use by control thread
+/* the latest position sample with its time and the estimated speed of each axis, for extrapolating the
+ * position between samples. Written only by the control thread, guarded so a reader sees a consistent set.
  */
-static struct rot_state *my_rot_state;
+typedef struct {
+    double t;                           // time of sample, 0 until first
+    uint16_t az, el;                    // ADC readings
+    float az_speed, el_speed;           // ADC counts/sec, positive cw/up, 0 when at rest
+} ADCSample;
+static ADCSample ADC_sample;
+static pthread_mutex_t ADC_sample_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g5500_extrapolate;           // set to extrapolate positions to the time of each request
+#define SPEED_SMOOTHING         0.5     // weight of each new sample in the speed estimates
+#define EXTRAPOLATE_MAX_PERIODS 2       // max polling periods by which a sample is extrapolated
+
+
+/* max time to wait for motion after reversal during calibration, secs.
+ * N.B. control thread's polling and motion commence periods are in g5500_tuning
+ */
+#define CAL_BACKLASH_TIMEOUT    5.0
+
 
+/* timing and positions used to measure axis speeds and backlash during calibration.
+ * N.B. to be used only by g5500_control_thread()
+ */
+static double cal_t_start;              // time the current calibration step started
+static double cal_az_t_stuck;           // time az was first found stuck at max, 0 until then
+static double cal_el_t_stuck;           // time el was first found stuck at max, 0 until then
+static int cal_az_done;                 // set when az backlash measurement is complete
+static int cal_el_done;                 // set when el backlash measurement is complete
 
 
-/* handy low-level rotation commands which also update the shadow state variables for use by main thread.
- * N.B. to be called only by g5500_control_thread()
+/* autotune script. each step drives both axes at once for the given time, in the given direction unless
+ * there is not enough room before the limit in which case the other. short steps show start latency and
+ * coast, long steps also show speed.
  */
-static void g5500_thread_az_stop()
+typedef struct {
+    float secs;                         // relay closed time
+    int dir;                            // preferred direction, 1 cw/up, -1 ccw/down
+} TuneStep;
+static const TuneStep tune_script[] = {
+    { 0.5,  1 },
+    { 0.5, -1 },
+    { 1.0,  1 },
+    { 1.0, -1 },
+    { 4.0,  1 },
+    { 4.0, -1 },
+};
+#define N_TUNE_STEPS            ((int)(sizeof(tune_script)/sizeof(tune_script[0])))
+#define TUNE_REST_SECS          1.0             // time allowed to come to rest before measuring noise
+#define TUNE_NOISE_SECS         3.0             // time spent measuring noise at rest
+#define TUNE_STEP_TIMEOUT       10.0            // max secs for any one step including coast
+#define TUNE_MIN_SPEED_SECS     1.0             // min secs of motion for a step to measure speed
+
+
+/* autotune measurements of one axis.
+ * N.B. to be used only by g5500_control_thread()
+ */
+typedef struct {
+    // noise
+    uint16_t noise_min, noise_max;      // extremes while at rest
+    // current step
+    int dir;                            // direction of current step
+    int moving;                         // set while relay is closed
+    int done;                           // set when at rest after relay opened
+    uint16_t adc_on;                    // ADC when relay closed
+    uint16_t adc_moved;                 // ADC when motion first detected
+    uint16_t adc_off;                   // ADC when relay opened
+    uint16_t adc_prev;                  // previous ADC while coasting
+    double t_moved;                     // time motion first detected, 0 until then
+    double t_off;                       // time relay opened
+    int n_equal;                        // consecutive readings within noise while coasting
+    // results of each step
+    float detect[N_TUNE_STEPS];         // secs from relay closed until motion detected, -1 if never
+    float detect_travel[N_TUNE_STEPS];  // ADC travelled when motion detected
+    float speed[N_TUNE_STEPS];          // ADC/sec while relay closed, 0 if step too short
+    float coast[N_TUNE_STEPS];          // ADC travelled after relay opened
+    float travel[N_TUNE_STEPS];         // total ADC travelled
+} TuneAxis;
+static TuneAxis tune_az, tune_el;       // measurements for each axis
+static int tune_step;                   // index into tune_script[]
+static double tune_t_start;             // time current phase or step started
+
+
+
+
+/***********************************************************************************************************
+ *
+ *
+ * pointing model
+ *
+ *
+ ***********************************************************************************************************/
+
+
+/* the pointing model corrects for small mechanical errors of the mount. The terms are the usual ones for an
+ * alt-az mount, each in degs:
+ *
+ *   IA    az index error, ie, north offset
+ *   IE    el index error, ie, el zero offset
+ *   AN    az axis tilt towards north, ie, mast tilt
+ *   AW    az axis tilt towards west
+ *   NPAE  non-perpendicularity of the az and el axes
+ *
+ * which give the mount position for a sky position as
+ *
+ *   Am = A + IA + AN sin(A) tan(E) - AW cos(A) tan(E) + NPAE tan(E)
+ *   Em = E + IE + AN cos(A) + AW sin(A)
+ *
+ * The terms are found by least squares from reference sightings, each the mount position while peaked on an
+ * object at a known sky position such as the sun. Since the terms couple the axes and the inverse has no
+ * closed form, the model is not evaluated per conversion but folded into two grids of corrections covering
+ * the full range of the mount, one by sky position and one by mount position, each built once whenever the
+ * model changes. A conversion then costs one bilinear interpolation.
+ */
+typedef struct {
+    float ia, ie, an, aw, npae;
+} G5500PointingModel;
+#define PM_N_TERMS              5
+#define PM_MAX_TERM             5               // max magnitude of any term, degs
+#define PM_MAX_SIGHTINGS        100             // max reference sightings retained
+#define PM_MIN_SIGHTINGS        3               // min sightings to fit all terms
+#define PM_MIN_COS              0.087           // cos(85) limits tan(E) terms near the zenith
+#define PM_GRID_STEP            5               // degs between grid points on each axis
+#define PM_GRID_N_AZ            91              // (AZ_MOUNT_MAX-AZ_MOUNT_MIN)/PM_GRID_STEP + 1
+#define PM_GRID_N_EL            37              // (EL_MOUNT_MAX-EL_MOUNT_MIN)/PM_GRID_STEP + 1
+
+typedef struct {
+    float az_m, el_m;                   // mount position, degs
+    float az, el;                       // sky position, degs
+} G5500Sighting;
+
+typedef struct {
+    float daz[PM_GRID_N_EL][PM_GRID_N_AZ];      // add to az on one side to get the other
+    float del[PM_GRID_N_EL][PM_GRID_N_AZ];      // add to el on one side to get the other
+} G5500PointingGrid;
+
+static G5500PointingModel pm_model;             // current model
+static int pm_active;                           // set when pm_model is not all zero
+static G5500PointingGrid pm_sky_grid;           // by sky position, corrections to mount
+static G5500PointingGrid pm_mount_grid;         // by mount position, corrections to sky
+static G5500Sighting pm_sightings[PM_MAX_SIGHTINGS];
+static int pm_n_sightings;
+static float pm_rms_before, pm_rms_after;       // rms sighting errors, degs, as of the last fit
+
+
+/* find the mount minus sky corrections of model mp at sky position az el, degs.
+ */
+static void g5500_pm_eval (const G5500PointingModel *mp, double az, double el, double *daz, double *del)
 {
-    if (g5500_sim_mode == SIM_OFF) {
-        piGPIOsetHiLo (PIN_AZ_CW, PIN_IDLE);
-        piGPIOsetHiLo (PIN_AZ_CCW, PIN_IDLE);
+    double a = az * M_PI/180;
+    double e = el * M_PI/180;
+    double c = cos(e);
+    if (fabs(c) < PM_MIN_COS)
+        c = c < 0 ? -PM_MIN_COS : PM_MIN_COS;
+    double t = sin(e)/c;
+
+    *daz = mp->ia + mp->an*sin(a)*t - mp->aw*cos(a)*t + mp->npae*t;
+    *del = mp->ie + mp->an*cos(a) + mp->aw*sin(a);
+}
+
+/* fill the grids for model mp.
+ * the sky grid holds the model directly. The mount grid holds its inverse, found at each mount position
+ * by iterating for the sky position that maps there, which converges at once because the terms are small.
+ */
+static void g5500_pm_build_grids (const G5500PointingModel *mp, G5500PointingGrid *skyp, G5500PointingGrid *mountp)
+{
+    for (int i = 0; i < PM_GRID_N_EL; i++) {
+        double el = EL_MOUNT_MIN + i*PM_GRID_STEP;
+        for (int j = 0; j < PM_GRID_N_AZ; j++) {
+            double az = AZ_MOUNT_MIN + j*PM_GRID_STEP;
+            double daz, del;
+
+            g5500_pm_eval (mp, az, el, &daz, &del);
+            skyp->daz[i][j] = daz;
+            skyp->del[i][j] = del;
+
+            double az_s = az, el_s = el;
+            for (int k = 0; k < 4; k++) {
+                g5500_pm_eval (mp, az_s, el_s, &daz, &del);
+                az_s = az - daz;
+                el_s = el - del;
+            }
+            mountp->daz[i][j] = az_s - az;
+            mountp->del[i][j] = el_s - el;
+        }
     }
+}
 
-    AZ_cmd_cw = 0;
-    AZ_cmd_ccw = 0;
+/* bilinear interpolation of the corrections in gp at az el, degs.
+ */
+static void g5500_pm_lookup (const G5500PointingGrid *gp, float az, float el, float *daz, float *del)
+{
+    float x = (az - AZ_MOUNT_MIN) / PM_GRID_STEP;
+    float y = (el - EL_MOUNT_MIN) / PM_GRID_STEP;
+    if (x < 0) x = 0;
+    if (x > PM_GRID_N_AZ - 1) x = PM_GRID_N_AZ - 1;
+    if (y < 0) y = 0;
+    if (y > PM_GRID_N_EL - 1) y = PM_GRID_N_EL - 1;
+    int j = x < PM_GRID_N_AZ - 1 ? (int)x : PM_GRID_N_AZ - 2;
+    int i = y < PM_GRID_N_EL - 1 ? (int)y : PM_GRID_N_EL - 2;
+    float fx = x - j;
+    float fy = y - i;
+
+    *daz = (1-fy)*((1-fx)*gp->daz[i][j] + fx*gp->daz[i][j+1]) + fy*((1-fx)*gp->daz[i+1][j] + fx*gp->daz[i+1][j+1]);
+    *del = (1-fy)*((1-fx)*gp->del[i][j] + fx*gp->del[i][j+1]) + fy*((1-fx)*gp->del[i+1][j] + fx*gp->del[i+1][j+1]);
 }
-static void g5500_thread_el_stop()
+
+/* return whether every term of model mp is finite and within PM_MAX_TERM degs
+ */
+static int g5500_pm_model_ok (const G5500PointingModel *mp)
 {
-    if (g5500_sim_mode == SIM_OFF) {
-        piGPIOsetHiLo (PIN_EL_UP, PIN_IDLE);
-        piGPIOsetHiLo (PIN_EL_DOWN, PIN_IDLE);
-    }
+    const float t[PM_N_TERMS] = {mp->ia, mp->ie, mp->an, mp->aw, mp->npae};
+    for (int i = 0; i < PM_N_TERMS; i++)
+        if (!(fabsf (t[i]) <= PM_MAX_TERM))
+            return (0);
+    return (1);
+}
 
-    EL_cmd_up = 0;
-    EL_cmd_down = 0;
+/* adopt model mp and rebuild the grids.
+ * the new grids are built aside then swapped in between control ticks.
+ */
+static void g5500_pm_set_model (const G5500PointingModel *mp)
+{
+    static G5500PointingGrid sky, mount;
+    g5500_pm_build_grids (mp, &sky, &mount);
+
+    pthread_mutex_lock (&g5500_tick_lock);
+    pm_model = *mp;
+    pm_active = mp->ia != 0 || mp->ie != 0 || mp->an != 0 || mp->aw != 0 || mp->npae != 0;
+    pm_sky_grid = sky;
+    pm_mount_grid = mount;
+    pthread_mutex_unlock (&g5500_tick_lock);
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s IA %g IE %g AN %g AW %g NPAE %g\n", __func__,
+                mp->ia, mp->ie, mp->an, mp->aw, mp->npae);
 }
-static void g5500_thread_rotate_cw()
+
+/* convert sky az and el, degs, to az and el ADC counts, applying any pointing model.
+ * N.B. only valid when ADC_cal_ok
+ */
+static void g5500_sky_to_ADC (float az, float el, uint16_t *az_adc, uint16_t *el_adc)
 {
-    if (g5500_sim_mode == SIM_OFF) {
-        piGPIOsetHiLo (PIN_AZ_CCW, PIN_IDLE);
-        piGPIOsetHiLo (PIN_AZ_CW, PIN_ACTIVE);
+    if (pm_active) {
+        float daz, del;
+        g5500_pm_lookup (&pm_sky_grid, az, el, &daz, &del);
+        az += daz;
+        el += del;
     }
+    *az_adc = g5500_az_to_ADC (az);
+    *el_adc = g5500_el_to_ADC (el);
+}
 
-    AZ_cmd_ccw = 0;
-    AZ_cmd_cw = 1;
+/* convert az and el ADC counts to sky az and el, degs, applying any pointing model.
+ * N.B. only valid when ADC_cal_ok
+ */
+static void g5500_ADC_to_sky (uint16_t az_adc, uint16_t el_adc, float *az, float *el)
+{
+    *az = g5500_ADC_to_az (az_adc);
+    *el = g5500_ADC_to_el (el_adc);
+    if (pm_active) {
+        float daz, del;
+        g5500_pm_lookup (&pm_mount_grid, *az, *el, &daz, &del);
+        *az += daz;
+        *el += del;
+    }
 }
-static void g5500_thread_rotate_ccw()
+
+/* fit the model terms to the sightings by least squares. az residuals are weighted by cos(el) so both axes
+ * count by their error on the sky. A slight ridge keeps terms that the sightings can not distinguish, such as
+ * IA and NPAE when all are at one el, at zero rather than letting them grow without bound.
+ * return 0 with model in *mp and rms errors before and after, degs, else -1 if too few sightings or the fit
+ * has a term beyond PM_MAX_TERM.
+ */
+static int g5500_pm_fit (G5500PointingModel *mp, float *rms_before, float *rms_after)
 {
-    if (g5500_sim_mode == SIM_OFF) {
-        piGPIOsetHiLo (PIN_AZ_CW, PIN_IDLE);
-        piGPIOsetHiLo (PIN_AZ_CCW, PIN_ACTIVE);
+    if (pm_n_sightings < PM_MIN_SIGHTINGS)
+        return (-1);
+
+    // accumulate normal equations
+    double N[PM_N_TERMS][PM_N_TERMS+1];
+    memset (N, 0, sizeof(N));
+    double ss = 0;
+    for (int k = 0; k < pm_n_sightings; k++) {
+        const G5500Sighting *sp = &pm_sightings[k];
+        double a = sp->az * M_PI/180;
+        double e = sp->el * M_PI/180;
+        double c = cos(e);
+        if (fabs(c) < PM_MIN_COS)
+            c = c < 0 ? -PM_MIN_COS : PM_MIN_COS;
+        double t = sin(e)/c;
+        double w = fabs(c);
+        double daz = remainder (sp->az_m - sp->az, 360);
+        double del = sp->el_m - sp->el;
+
+        double rows[2][PM_N_TERMS+1] = {
+            { w, 0, w*sin(a)*t, -w*cos(a)*t, w*t, w*daz },
+            { 0, 1, cos(a), sin(a), 0, del },
+        };
+        for (int r = 0; r < 2; r++) {
+            for (int i = 0; i < PM_N_TERMS; i++)
+                for (int j = 0; j <= PM_N_TERMS; j++)
+                    N[i][j] += rows[r][i] * rows[r][j];
+            ss += rows[r][PM_N_TERMS] * rows[r][PM_N_TERMS];
+        }
+    }
+    for (int i = 0; i < PM_N_TERMS; i++)
+        N[i][i] += 1e-6 * pm_n_sightings;
+
+    // solve by gaussian elimination with partial pivoting
+    for (int i = 0; i < PM_N_TERMS; i++) {
+        int best = i;
+        for (int r = i+1; r < PM_N_TERMS; r++)
+            if (fabs(N[r][i]) > fabs(N[best][i]))
+                best = r;
+        for (int j = 0; j <= PM_N_TERMS; j++) {
+            double tmp = N[i][j];
+            N[i][j] = N[best][j];
+            N[best][j] = tmp;
+        }
+        for (int r = 0; r < PM_N_TERMS; r++) {
+            if (r == i)
+                continue;
+            double f = N[r][i] / N[i][i];
+            for (int j = i; j <= PM_N_TERMS; j++)
+                N[r][j] -= f * N[i][j];
+        }
     }
+    double x[PM_N_TERMS];
+    for (int i = 0; i < PM_N_TERMS; i++)
+        x[i] = N[i][PM_N_TERMS] / N[i][i];
+    mp->ia = x[0];
+    mp->ie = x[1];
+    mp->an = x[2];
+    mp->aw = x[3];
+    mp->npae = x[4];
+    if (!g5500_pm_model_ok (mp))
+        return (-1);
 
-    AZ_cmd_cw = 0;
-    AZ_cmd_ccw = 1;
+    // residuals of the new model
+    double ss_after = 0;
+    for (int k = 0; k < pm_n_sightings; k++) {
+        const G5500Sighting *sp = &pm_sightings[k];
+        double daz, del;
+        g5500_pm_eval (mp, sp->az, sp->el, &daz, &del);
+        double w = cos (sp->el * M_PI/180);
+        double raz = w * (remainder (sp->az_m - sp->az, 360) - daz);
+        double rel = sp->el_m - sp->el - del;
+        ss_after += raz*raz + rel*rel;
+    }
+
+    *rms_before = sqrt (ss/pm_n_sightings);
+    *rms_after = sqrt (ss_after/pm_n_sightings);
+    return (0);
 }
-static void g5500_thread_rotate_down()
+
+/* return full path to file containing the pointing model and sightings,
+ * or return NULL if can not be established.
+ */
+static const char* g5500_get_pointing_filename()
 {
-    if (g5500_sim_mode == SIM_OFF) {
-        piGPIOsetHiLo (PIN_EL_UP, PIN_IDLE);
-        piGPIOsetHiLo (PIN_EL_DOWN, PIN_ACTIVE);
-    }
+    static char *path;
+    return (g5500_home_path (g5500_pointing_file_name, &path));
+}
 
-    EL_cmd_up = 0;
-    EL_cmd_down = 1;
+/* set sim_profile to the ideal mount, then from the simulator profile file if there is one.
+ */
+static void g5500_read_sim_file()
+{
+    static char *path;
+    const char *filename = g5500_home_path (g5500_sim_file_name, &path);
+
+    g5500SimDefaultProfile (&sim_profile);
+    if (!filename || access (filename, R_OK) < 0)
+        return;
+
+    char ynot[1024];
+    if (g5500SimReadProfile (filename, &sim_profile, ynot) < 0) {
+        rig_debug(RIG_DEBUG_ERR, "%s: %s, using an ideal mount\n", __func__, ynot);
+        g5500SimDefaultProfile (&sim_profile);
+    } else {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s found %s\n", __func__, filename);
+    }
 }
-static void g5500_thread_rotate_up()
+
+/* save the pointing model and all sightings to file.
+ */
+static void g5500_save_pointing_file()
 {
-    if (g5500_sim_mode == SIM_OFF) {
-        piGPIOsetHiLo (PIN_EL_DOWN, PIN_IDLE);
-        piGPIOsetHiLo (PIN_EL_UP, PIN_ACTIVE);
+    const char *filename = g5500_get_pointing_filename();
+    if (!filename)
+        return;
+    FILE *fp = fopen (filename, "w");
+    if (!fp)
+        return;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s saving %s\n", __func__, filename);
+
+    fprintf (fp, "# IA IE AN AW NPAE, degs\n");
+    fprintf (fp, "model = %.5f %.5f %.5f %.5f %.5f\n",
+                pm_model.ia, pm_model.ie, pm_model.an, pm_model.aw, pm_model.npae);
+    fprintf (fp, "# mount az el, sky az el, degs\n");
+    for (int i = 0; i < pm_n_sightings; i++) {
+        const G5500Sighting *sp = &pm_sightings[i];
+        fprintf (fp, "sighting = %.3f %.3f %.3f %.3f\n", sp->az_m, sp->el_m, sp->az, sp->el);
     }
 
-    EL_cmd_down = 0;
-    EL_cmd_up = 1;
+    fclose (fp);
 }
 
-/* called by the control thread to capture the current mount status in the rot_state.has_status member.
- * this allows \dump_caps to show useful info about axis direction, limits etc.
- * N.B. we must use a pointer captured by g5500_direct_rot_init() which we must assume will never
- *      change. This hack would be unnecessary if \dump_caps was a proper callback like the other API calls.
- * N.B. to be called only by g5500_control_thread()
+/* read the pointing model and sightings from file, if any, and adopt the model.
  */
-static void g5500_thread_capture_state ()
+static void g5500_read_pointing_file()
 {
-    // at least check the pointer isn't null -- we can only assume it's still correct
-    if (!my_rot_state)
+    const char *filename = g5500_get_pointing_filename();
+    if (!filename)
+        return;
+    FILE *fp = fopen (filename, "r");
+    if (!fp)
         return;
 
-    // zero flags then add as required
-    my_rot_state->has_status = 0;
+    rig_debug(RIG_DEBUG_VERBOSE, "%s found %s\n", __func__, filename);
+
+    G5500PointingModel m;
+    memset (&m, 0, sizeof(m));
+    char buf[200];
+    G5500Sighting s;
+    pm_n_sightings = 0;
+    while (fgets (buf, sizeof(buf), fp) != NULL) {
+        if (sscanf (buf, "model = %f %f %f %f %f", &m.ia, &m.ie, &m.an, &m.aw, &m.npae) == PM_N_TERMS)
+            continue;
+        if (sscanf (buf, "sighting = %f %f %f %f", &s.az_m, &s.el_m, &s.az, &s.el) == 4
+                                && isfinite (s.az_m) && isfinite (s.el_m) && isfinite (s.az) && isfinite (s.el)
+                                && pm_n_sightings < PM_MAX_SIGHTINGS)
+            pm_sightings[pm_n_sightings++] = s;
+    }
+
+    fclose (fp);
+
+    if (!g5500_pm_model_ok (&m)) {
+        rig_debug(RIG_DEBUG_ERR, "%s: %s: ignoring model with a term beyond %d degs\n", __func__, filename,
+                                PM_MAX_TERM);
+        memset (&m, 0, sizeof(m));
+    }
+
+    g5500_pm_set_model (&m);
+}
+
+/* record a sighting of an object at the given sky position, "az,el" in degs, at the current mount position.
+ * return G5500_RIG_OK or G5500_RIG_ERR_BADARGS
+ */
+static int g5500_pm_add_sighting (const char *val)
+{
+    G5500Sighting s;
+    if (!ADC_cal_ok || sscanf (val, "%f,%f", &s.az, &s.el) != 2 || !(s.az >= 0 && s.az < AZ_MOUNT_WRAP)
+                        || !(s.el >= EL_MOUNT_MIN && s.el <= EL_MOUNT_MAX) || pm_n_sightings == PM_MAX_SIGHTINGS)
+        return (G5500_RIG_ERR_BADARGS);
+
+    s.az_m = g5500_ADC_to_az (ADC_az_now);
+    s.el_m = g5500_ADC_to_el (ADC_el_now);
+    pm_sightings[pm_n_sightings++] = s;
+    g5500_save_pointing_file();
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s %d: mount %g %g sky %g %g\n", __func__, pm_n_sightings,
+                s.az_m, s.el_m, s.az, s.el);
+
+    return (G5500_RIG_OK);
+}
+
+
+
+
+
+
+/* capture &rot->rot_state for use by control thread
+ */
+static struct rot_state *my_rot_state;
+
+
+
+/* return a monotonic time in seconds, suitable for measuring intervals
+ */
+static double g5500_now()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + ts.tv_nsec*1e-9);
+}
+
+
+/* handy low-level rotation commands which also update the shadow state variables for use by main thread.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_az_stop()
+{
+    if (g5500_sim_mode == SIM_OFF) {
+        piGPIOsetHiLo (PIN_AZ_CW, PIN_IDLE);
+        piGPIOsetHiLo (PIN_AZ_CCW, PIN_IDLE);
+    } else {
+        g5500SimCommand (&sim_az, 0, g5500_now());
+    }
+
+    AZ_cmd_cw = 0;
+    AZ_cmd_ccw = 0;
+}
+static void g5500_thread_el_stop()
+{
+    if (g5500_sim_mode == SIM_OFF) {
+        piGPIOsetHiLo (PIN_EL_UP, PIN_IDLE);
+        piGPIOsetHiLo (PIN_EL_DOWN, PIN_IDLE);
+    } else {
+        g5500SimCommand (&sim_el, 0, g5500_now());
+    }
+
+    EL_cmd_up = 0;
+    EL_cmd_down = 0;
+}
+static void g5500_thread_rotate_cw()
+{
+    if (g5500_sim_mode == SIM_OFF) {
+        piGPIOsetHiLo (PIN_AZ_CCW, PIN_IDLE);
+        piGPIOsetHiLo (PIN_AZ_CW, PIN_ACTIVE);
+    } else {
+        g5500SimCommand (&sim_az, 1, g5500_now());
+    }
+
+    AZ_cmd_ccw = 0;
+    AZ_cmd_cw = 1;
+}
+static void g5500_thread_rotate_ccw()
+{
+    if (g5500_sim_mode == SIM_OFF) {
+        piGPIOsetHiLo (PIN_AZ_CW, PIN_IDLE);
+        piGPIOsetHiLo (PIN_AZ_CCW, PIN_ACTIVE);
+    } else {
+        g5500SimCommand (&sim_az, -1, g5500_now());
+    }
+
+    AZ_cmd_cw = 0;
+    AZ_cmd_ccw = 1;
+}
+static void g5500_thread_rotate_down()
+{
+    if (g5500_sim_mode == SIM_OFF) {
+        piGPIOsetHiLo (PIN_EL_UP, PIN_IDLE);
+        piGPIOsetHiLo (PIN_EL_DOWN, PIN_ACTIVE);
+    } else {
+        g5500SimCommand (&sim_el, -1, g5500_now());
+    }
+
+    EL_cmd_up = 0;
+    EL_cmd_down = 1;
+}
+static void g5500_thread_rotate_up()
+{
+    if (g5500_sim_mode == SIM_OFF) {
+        piGPIOsetHiLo (PIN_EL_DOWN, PIN_IDLE);
+        piGPIOsetHiLo (PIN_EL_UP, PIN_ACTIVE);
+    } else {
+        g5500SimCommand (&sim_el, 1, g5500_now());
+    }
+
+    EL_cmd_down = 0;
+    EL_cmd_up = 1;
+}
+
+/* called by the control thread to capture the current mount status in the rot_state.has_status member.
+ * this allows \dump_caps to show useful info about axis direction, limits etc.
+ * N.B. we must use a pointer captured by g5500_direct_rot_init() which we must assume will never
+ *      change. This hack would be unnecessary if \dump_caps was a proper callback like the other API calls.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_capture_state ()
+{
+    // at least check the pointer isn't null -- we can only assume it's still correct
+    if (!my_rot_state)
+        return;
+
+    // zero flags then add as required
+    my_rot_state->has_status = 0;
 
     if (AZ_cmd_cw)
         my_rot_state->has_status |= ROT_STATUS_MOVING_AZ | ROT_STATUS_MOVING_RIGHT;
@@ -588,318 +1621,1756 @@ static void g5500_thread_capture_state ()
     case CTS_CAL_START:
     case CTS_CAL_SEEK_MINS:
     case CTS_CAL_SEEK_MAXS:
+    case CTS_CAL_BACKLASH:
+    case CTS_TUNE_START:
+    case CTS_TUNE_NOISE:
+    case CTS_TUNE_STEP:
         my_rot_state->has_status |= ROT_STATUS_BUSY;
         break;
     case CTS_ERR_ADC:
     case CTS_ERR_NOPOWER:
     case CTS_ERR_STUCK:
+    case CTS_ERR_WATCHDOG:
         break;          // really wish there was an error flag for has_state
     }
 }
 
-/* called by thread to read the current position of each axis into ADC_az_now and ADC_el_now.
- * when simulating, just update at polling rate
+/* return a new speed estimate, ADC/sec, from the previous estimate and a change from adc0 to adc1 in dt secs.
+ * changes within the noise are ignored unless the axis is driven, so an axis at rest has speed 0.
+ */
+static float g5500_speed_estimate (float speed, int adc0, int adc1, double dt, int driven)
+{
+    int d = adc1 - adc0;
+    if (!driven && abs(d) <= ADC_MOVE_NOISE)
+        return (0);
+    return (speed + SPEED_SMOOTHING * (d/dt - speed));
+}
+
+/* record the fresh position and update the speed estimates.
  * N.B. to be called only by g5500_control_thread()
  */
-static void g5500_thread_read_axis_positions()
+static void g5500_thread_record_sample()
 {
-    if (g5500_sim_mode == SIM_OFF) {
+    double now = g5500_now();
+
+    pthread_mutex_lock (&ADC_sample_lock);
+    double dt = now - ADC_sample.t;
+    if (ADC_sample.t > 0 && dt > 0) {
+        ADC_sample.az_speed = g5500_speed_estimate (ADC_sample.az_speed, ADC_sample.az, ADC_az_now, dt,
+                                    AZ_cmd_active());
+        ADC_sample.el_speed = g5500_speed_estimate (ADC_sample.el_speed, ADC_sample.el, ADC_el_now, dt,
+                                    EL_cmd_active());
+    }
+    ADC_sample.t = now;
+    ADC_sample.az = ADC_az_now;
+    ADC_sample.el = ADC_el_now;
+    pthread_mutex_unlock (&ADC_sample_lock);
+}
 
-        // read real ADC -- important enough that we report errors regardless of rig_debug
+/* called by thread at the start of each tick to adopt any new tuning parameters.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_update_tuning()
+{
+    pthread_mutex_lock (&g5500_tuning_lock);
+    if (!g5500_tuning_hold)
+        g5500_tuning = g5500_tuning_next;
+    pthread_mutex_unlock (&g5500_tuning_lock);
+}
 
-        char ynot[1024];
-        uint16_t adc;           // can't pass address of volatile
+/* stop az if it is being driven and has reached its goal, short by the stop lead to allow for coasting.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_az_arrive()
+{
+    uint16_t az_goal = AZ_via_active ? ADC_az_via : ADC_az_target;
+    if ((AZ_cmd_ccw && ADC_az_now <= az_goal + AZ_STOP_LEAD) || (AZ_cmd_cw && ADC_az_now + AZ_STOP_LEAD >= az_goal)) {
+        g5500_thread_az_stop();
+        AZ_via_active = 0;
+    }
+}
 
-        // check power first
-        if (readADC_SingleEnded (ADC_I2C_ADDR, ADC_CHANNEL_POK, &adc, ynot) < 0) {
-            fprintf (stderr, "Power ADC read error: %s\n", ynot);
-            g5500_thread_state = CTS_ERR_ADC;
-            return;
-        }
-        if (adc < ADC_MIN_POK) {
-            fprintf (stderr, "G5500 power off\n");
-            g5500_thread_state = CTS_ERR_NOPOWER;
-            return;
-        }
+/* stop el if it is being driven and has reached its goal, short by the stop lead to allow for coasting.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_el_arrive()
+{
+    uint16_t el_goal = EL_via_active ? ADC_el_via : ADC_el_target;
+    if ((EL_cmd_down && ADC_el_now <= el_goal + EL_STOP_LEAD) || (EL_cmd_up && ADC_el_now + EL_STOP_LEAD >= el_goal)) {
+        g5500_thread_el_stop();
+        EL_via_active = 0;
+    }
+}
 
-        // read az and el
-        if (readADC_SingleEnded (ADC_I2C_ADDR, ADC_CHANNEL_AZ, &adc, ynot) < 0) {
-            fprintf (stderr, "AZ ADC read error: %s\n", ynot);
-            g5500_thread_state = CTS_ERR_ADC;
-            return;
-        } else {
-            ADC_az_now = adc;
-        }
+/* give up on the encoder of the named axis for the given reason so positions come from the pot until the
+ * encoder reads well again and is re-locked.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_encoder_fault (G5500Encoder *ep, const char *name, const char *why)
+{
+    if (ep->have)
+        rig_debug(RIG_DEBUG_ERR, "%s encoder: %s, using pot\n", name, why);
+    if (ep->locked)
+        ep->n_faults++;
+    ep->have = 0;
+    ep->locked = 0;
+    ep->cal_min = INT32_MIN;
+}
 
-        if (readADC_SingleEnded (ADC_I2C_ADDR, ADC_CHANNEL_EL, &adc, ynot) < 0) {
-            fprintf (stderr, "EL ADC read error: %s\n", ynot);
-            g5500_thread_state = CTS_ERR_ADC;
-            return;
-        } else {
-            ADC_el_now = adc;
+/* read the encoder of the named axis and unwrap its count, checking the magnet too if check.
+ * return 0 if ok, else -1 after giving up on it.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static int g5500_thread_encoder_read (G5500Encoder *ep, const char *name, int check)
+{
+    char ynot[1024];
+    uint16_t raw;
+    double now = g5500_now();
+
+    if (encoderRead (ep->type, ep->addr, check, &raw, ynot) < 0) {
+        g5500_thread_encoder_fault (ep, name, ynot);
+        return (-1);
+    }
+
+    int32_t turn = 1 << encoderBits (ep->type);
+    if (!ep->have) {
+        // count from here
+        ep->count = ep->shown = raw;
+        ep->have = 1;
+    } else {
+        // take the shorter way round, which must be within the fastest the mount can move
+        int32_t d = (int32_t)raw - ep->raw;
+        if (d > turn/2)
+            d -= turn;
+        else if (d <= -turn/2)
+            d += turn;
+        double degs = d * 360.0 / turn;
+        if (fabs (degs) > ENC_MAX_STEP + ENC_MAX_SPEED * (now - ep->t)) {
+            sprintf (ynot, "jumped %.1f degs in %.3f secs", degs, now - ep->t);
+            g5500_thread_encoder_fault (ep, name, ynot);
+            return (-1);
         }
+        ep->count += d;
+        if (abs (ep->count - ep->shown) > ENC_HYSTERESIS)
+            ep->shown = ep->count;
+    }
+
+    ep->raw = raw;
+    ep->t = now;
+    return (0);
+}
+
+/* return the mount position of a locked encoder, degs from the min limit
+ */
+static double g5500_encoder_deg (const G5500Encoder *ep)
+{
+    return (ep->base + ep->sign * ep->shown * 360.0 / (1 << encoderBits (ep->type)));
+}
+
+/* convert deg from the min limit to ADC units given the ADC limits and the degs between them.
+ * unlike g5500_az_to_ADC() this rounds and is not confined to the limits.
+ */
+static uint16_t g5500_deg_to_ADC (double deg, uint16_t min, uint16_t max, float span)
+{
+    double adc = floor (min + deg * (max - min) / span + 0.5);
+    return (adc < 0 ? 0 : (adc > UINT16_MAX ? UINT16_MAX : (uint16_t) adc));
+}
+
+/* return the position of the named axis in ADC units, from its encoder if locked else the pot reading.
+ * min and max are the calibrated pot ADC limits and span the degs between them.
+ * an aligned encoder is locked when its turn can be resolved from the pot, and abandoned for the pot if it
+ * fails or ever disagrees with the pot by more than ENC_MAX_DISAGREE.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static uint16_t g5500_thread_encoder_position (G5500Encoder *ep, const char *name, uint16_t pot, uint16_t min,
+uint16_t max, float span)
+{
+    if (ep->type == ENC_NONE || g5500_thread_encoder_read (ep, name, 1) < 0)
+        return (pot);
+    if (!ADC_cal_ok || ep->sign == 0 || max <= min)
+        return (pot);
+
+    double dpc = 360.0 / (1 << encoderBits (ep->type));
+    double pot_deg = (pot - min) * span / (max - min);
+
+    if (!ep->locked) {
+        // the pot decides which turn we are on
+        double deg = fmod (ep->offset + ep->sign * ep->raw * dpc, 360);
+        if (deg < 0)
+            deg += 360;
+        deg += 360 * floor ((pot_deg - deg) / 360 + 0.5);
+        if (fabs (deg - pot_deg) > ENC_MAX_DISAGREE)
+            return (pot);
+        ep->base = deg - ep->sign * ep->count * dpc;
+        ep->locked = 1;
+        rig_debug(RIG_DEBUG_VERBOSE, "%s encoder: locked at %.2f degs, pot %.2f\n", name, deg, pot_deg);
+    }
+
+    double deg = g5500_encoder_deg (ep);
+    if (fabs (deg - pot_deg) > ENC_MAX_DISAGREE) {
+        char ynot[100];
+        sprintf (ynot, "reads %.1f degs but pot %.1f", deg, pot_deg);
+        g5500_thread_encoder_fault (ep, name, ynot);
+        return (pot);
+    }
+
+    return (g5500_deg_to_ADC (deg, min, max, span));
+}
+
+/* align the encoder of the named axis with the mount at the end of the calibration sweep, now at the max limit
+ * having started from the min limit at count cal_min, span degs away.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_encoder_align (G5500Encoder *ep, const char *name, float span)
+{
+    if (ep->type == ENC_NONE || !ep->have || ep->cal_min == INT32_MIN)
+        return;
+
+    int32_t turn = 1 << encoderBits (ep->type);
+    double sweep = (ep->count - ep->cal_min) * 360.0 / turn;
+    if (fabs (fabs (sweep) - span) > ENC_MAX_SPAN_ERR * span) {
+        rig_debug(RIG_DEBUG_ERR, "%s encoder: calibration sweep was %.1f degs but the axis has %.1f, not using it\n",
+                    name, fabs (sweep), span);
+        return;
+    }
+
+    // the min limit is mount 0
+    ep->sign = sweep > 0 ? 1 : -1;
+    int32_t raw_min = ((ep->cal_min % turn) + turn) % turn;
+    ep->offset = fmod (720 - ep->sign * raw_min * 360.0 / turn, 360);
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s encoder: aligned, sign %d offset %.3f degs\n", name, ep->sign, ep->offset);
+}
+
+/* give up on the IMU for the given reason so positions come from the pot until the IMU reads well again and
+ * the filter is restarted.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_imu_fault (G5500IMU *ip, const char *why)
+{
+    if (ip->have)
+        rig_debug(RIG_DEBUG_ERR, "el IMU: %s, using pot\n", why);
+    if (ip->locked)
+        ip->n_faults++;
+    ip->have = 0;
+    ip->locked = 0;
+    ip->cal_ok = 0;
+}
+
+/* read the IMU, waking it first if it has not been read well since it was configured or gave a fault.
+ * the sensor angle is unwrapped and the rate integrated for calibration.
+ * return 0 if ok, else -1 after giving up on it.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static int g5500_thread_imu_read (G5500IMU *ip)
+{
+    char ynot[1024];
+    float acc[3], gyro[3];
+
+    if ((!ip->have && imuInit (ip->type, ip->addr, ynot) < 0) || imuRead (ip->type, ip->addr, acc, gyro, ynot) < 0) {
+        g5500_thread_imu_fault (ip, ynot);
+        return (-1);
+    }
 
+    // angle of gravity in the plane normal to the axis
+    double now = g5500_now();
+    int a = ip->axis - 'x';
+    double angle = atan2 (acc[(a+1)%3], acc[(a+2)%3]) * 180 / M_PI;
+    double g = sqrt (acc[0]*acc[0] + acc[1]*acc[1] + acc[2]*acc[2]);
+    if (!ip->have) {
+        ip->angle = angle;
+        ip->have = 1;
     } else {
+        ip->angle += remainder (angle - ip->angle, 360);
+        if (ip->cal_ok)
+            ip->cal_sum += (gyro[a] - ip->cal_gyro) * (now - ip->t);
+    }
+    ip->gyro = gyro[a];
+    ip->steady = fabs (g - 1) < IMU_MAX_G_ERR;
+    ip->t = now;
+    return (0);
+}
+
+/* return the mount el of an aligned IMU from its latest angle, degs from the min limit
+ */
+static double g5500_imu_deg (const G5500IMU *ip)
+{
+    return (remainder (ip->sign * (ip->angle - ip->zero) - 90, 360) + 90);
+}
+
+/* advance the IMU filter state to time t, allowing for any acceleration and gyro bias drift meanwhile
+ */
+static void g5500_imu_predict (G5500IMU *ip, double t)
+{
+    double dt = t - ip->t_x;
+    if (dt <= 0)
+        return;
+
+    // x = F x, P = F P F' + Q with F = [1 dt 0; 0 1 0; 0 0 1]
+    ip->x[0] += ip->x[1] * dt;
+    for (int j = 0; j < IMU_N_STATE; j++)
+        ip->P[0][j] += dt * ip->P[1][j];
+    for (int i = 0; i < IMU_N_STATE; i++)
+        ip->P[i][0] += dt * ip->P[i][1];
+
+    double qa = IMU_ACCEL_SIGMA * IMU_ACCEL_SIGMA;
+    ip->P[0][0] += qa * dt*dt*dt*dt / 4;
+    ip->P[0][1] += qa * dt*dt*dt / 2;
+    ip->P[1][0] += qa * dt*dt*dt / 2;
+    ip->P[1][1] += qa * dt*dt;
+    ip->P[2][2] += IMU_BIAS_DRIFT * IMU_BIAS_DRIFT * dt;
+    ip->t_x = t;
+}
+
+/* update the IMU filter with measurement z = h x of the given sigma.
+ * if gate > 0 the measurement is rejected if it is more than gate sigmas from what the filter expects.
+ * return 0 if used, else -1
+ */
+static int g5500_imu_update (G5500IMU *ip, const double h[IMU_N_STATE], double z, double sigma, double gate)
+{
+    double ph[IMU_N_STATE];             // P h'
+    double y = z, s = sigma * sigma;
+    for (int i = 0; i < IMU_N_STATE; i++) {
+        ph[i] = 0;
+        for (int j = 0; j < IMU_N_STATE; j++)
+            ph[i] += ip->P[i][j] * h[j];
+        y -= h[i] * ip->x[i];
+    }
+    for (int i = 0; i < IMU_N_STATE; i++)
+        s += h[i] * ph[i];
+    if (gate > 0 && fabs (y) > gate * sqrt (s))
+        return (-1);
 
-        // pretend to move depending on the commanded motion state
+    // K = P h' / s, x += K y, P -= K h P, using symmetry of P for h P
+    for (int i = 0; i < IMU_N_STATE; i++) {
+        ip->x[i] += ph[i] * y / s;
+        for (int j = 0; j < IMU_N_STATE; j++)
+            ip->P[i][j] -= ph[i] * ph[j] / s;
+    }
+    return (0);
+}
 
-        // ADC change per period
-        #define AZ_SIM_ADC_PER_PRD      (AZ_SIM_SPEED*ADC_az_max/AZ_MOUNT_MAX*THREAD_PERIOD/1000000)
-        #define EL_SIM_ADC_PER_PRD      (EL_SIM_SPEED*ADC_el_max/el_mount_max*THREAD_PERIOD/1000000)
+/* fold the latest IMU reading into the filter, and the pot too at pot_deg if pot.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_imu_fuse (G5500IMU *ip, int pot, double pot_deg)
+{
+    static const double h_angle[IMU_N_STATE] = {1, 0, 0};
+    static const double h_rate[IMU_N_STATE] = {0, 1, 1};
 
-        // update az
+    g5500_imu_predict (ip, ip->t);
 
-        if (AZ_cmd_cw) {
-            ADC_az_now += AZ_SIM_ADC_PER_PRD;
-            if (ADC_az_now > ADC_az_max)
-                ADC_az_now = ADC_az_max;
-        } else if (AZ_cmd_ccw) {
-            if (ADC_az_now >= AZ_SIM_ADC_PER_PRD)
-                ADC_az_now -= AZ_SIM_ADC_PER_PRD;
-            else
-                ADC_az_now = 0;
+    // the angle only means anything while the boom is not accelerating much
+    if (ip->steady) {
+        if (g5500_imu_update (ip, h_angle, g5500_imu_deg (ip), IMU_ANGLE_SIGMA, IMU_GATE) == 0)
+            ip->n_rejects = 0;
+        else if (++ip->n_rejects >= IMU_MAX_REJECTS) {
+            g5500_thread_imu_fault (ip, "angle keeps disagreeing with filter");
+            return;
         }
+    }
+    if (ip->gyro_sign != 0)
+        g5500_imu_update (ip, h_rate, ip->gyro_sign * ip->gyro, IMU_GYRO_SIGMA, 0);
+    if (pot)
+        g5500_imu_update (ip, h_angle, pot_deg, IMU_POT_SIGMA, 0);
+
+    if (fabs (ip->x[0] - ip->shown) > IMU_HYSTERESIS)
+        ip->shown = ip->x[0];
+}
+
+/* return the el position in ADC units, from the filter fusing the IMU and the pot if locked else adc, which
+ * is either the pot reading or the el encoder position.
+ * min and max are the calibrated pot ADC limits and span the degs between them.
+ * an aligned IMU starts the filter when its angle agrees with the pot, and is abandoned for the pot if it
+ * fails or the filter ever disagrees with the pot by more than IMU_MAX_DISAGREE.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static uint16_t g5500_thread_imu_position (G5500IMU *ip, uint16_t pot, uint16_t adc, uint16_t min, uint16_t max,
+float span)
+{
+    if (ip->type == IMU_NONE || g5500_thread_imu_read (ip) < 0)
+        return (adc);
+    if (!ADC_cal_ok || ip->sign == 0 || max <= min)
+        return (adc);
+
+    double pot_deg = (pot - min) * span / (max - min);
+
+    if (!ip->locked) {
+        // start from the sensor angle at rest, bias unknown
+        double deg = g5500_imu_deg (ip);
+        if (!ip->steady || fabs (deg - pot_deg) > IMU_MAX_DISAGREE)
+            return (adc);
+        memset (ip->P, 0, sizeof(ip->P));
+        ip->x[0] = ip->shown = deg;
+        ip->x[1] = ip->x[2] = 0;
+        ip->P[0][0] = IMU_ANGLE_SIGMA * IMU_ANGLE_SIGMA;
+        ip->P[1][1] = IMU_GYRO_SIGMA * IMU_GYRO_SIGMA;
+        ip->P[2][2] = IMU_BIAS_SIGMA * IMU_BIAS_SIGMA;
+        ip->t_x = ip->t;
+        ip->n_rejects = 0;
+        ip->locked = 1;
+        rig_debug(RIG_DEBUG_VERBOSE, "el IMU: locked at %.2f degs, pot %.2f\n", deg, pot_deg);
+    } else {
+        g5500_thread_imu_fuse (ip, 1, pot_deg);
+        if (!ip->locked)
+            return (adc);
+    }
+
+    if (fabs (ip->x[0] - pot_deg) > IMU_MAX_DISAGREE) {
+        char ynot[100];
+        sprintf (ynot, "filter reads %.1f degs but pot %.1f", ip->x[0], pot_deg);
+        g5500_thread_imu_fault (ip, ynot);
+        return (adc);
+    }
+
+    return (g5500_deg_to_ADC (ip->shown, min, max, span));
+}
+
+/* align the IMU with the mount at the end of the calibration sweep, now at the max limit having started
+ * from the min limit at angle cal_min, span degs away.
+ * the gyro is used too if its rate over the sweep, less its rate at rest at the min limit, agrees.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_imu_align (G5500IMU *ip, float span)
+{
+    if (ip->type == IMU_NONE || !ip->have || !ip->cal_ok)
+        return;
+
+    double sweep = ip->angle - ip->cal_min;
+    if (fabs (fabs (sweep) - span) > IMU_MAX_SPAN_ERR * span) {
+        rig_debug(RIG_DEBUG_ERR, "el IMU: calibration sweep was %.1f degs but the axis has %.1f, not using it\n",
+                    fabs (sweep), span);
+        return;
+    }
+
+    // the min limit is mount 0
+    ip->sign = sweep > 0 ? 1 : -1;
+    ip->zero = remainder (ip->cal_min, 360);
+    ip->gyro_sign = fabs (fabs (ip->cal_sum) - fabs (sweep)) <= IMU_MAX_GYRO_ERR * fabs (sweep)
+                    ? (ip->cal_sum > 0 ? 1 : -1) : 0;
+    if (ip->gyro_sign == 0)
+        rig_debug(RIG_DEBUG_ERR, "el IMU: gyro swept %.1f degs but the angle %.1f, not using gyro\n",
+                    fabs (ip->cal_sum), fabs (sweep));
+
+    rig_debug(RIG_DEBUG_VERBOSE, "el IMU: aligned, sign %d zero %.3f degs gyro sign %d\n", ip->sign, ip->zero,
+                    ip->gyro_sign);
+}
+
+/* read any locked encoders and the el IMU between ticks, so each axis is stopped the moment it reaches its
+ * goal rather than at the next tick.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_poll_sensors()
+{
+    if (enc_az.locked && g5500_thread_encoder_read (&enc_az, "az", 0) == 0) {
+        ADC_az_now = g5500_deg_to_ADC (g5500_encoder_deg (&enc_az), ADC_az_min, ADC_az_max,
+                                    AZ_MOUNT_MAX - AZ_MOUNT_MIN);
+        if (g5500_thread_state == CTS_RUN)
+            g5500_thread_az_arrive();
+    }
+    if (enc_el.locked && g5500_thread_encoder_read (&enc_el, "el", 0) == 0) {
+        ADC_el_now = g5500_deg_to_ADC (g5500_encoder_deg (&enc_el), ADC_el_min, ADC_el_max,
+                                    el_mount_max - EL_MOUNT_MIN);
+        if (g5500_thread_state == CTS_RUN)
+            g5500_thread_el_arrive();
+    } else if (!enc_el.locked && imu_el.locked && g5500_thread_imu_read (&imu_el) == 0) {
+        g5500_thread_imu_fuse (&imu_el, 0, 0);
+        if (imu_el.locked) {
+            ADC_el_now = g5500_deg_to_ADC (imu_el.shown, ADC_el_min, ADC_el_max, el_mount_max - EL_MOUNT_MIN);
+            if (g5500_thread_state == CTS_RUN)
+                g5500_thread_el_arrive();
+        }
+    }
+}
+
+/* the ADC channels read each tick, in order, see g5500_thread_use_adc()
+ */
+static const uint16_t g5500_adc_channels[] = { ADC_CHANNEL_POK, ADC_CHANNEL_AZ, ADC_CHANNEL_EL };
+#define N_ADC_CHANNELS          ((int)(sizeof(g5500_adc_channels)/sizeof(g5500_adc_channels[0])))
+
+/* act on reading adc from g5500_adc_channels[i], or the error err with excuse in ynot[] -- important enough
+ * that we report errors regardless of rig_debug.
+ * return 0 to carry on reading the next channel, -1 if the state is now an error and the tick has no fresh
+ * positions.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static int g5500_thread_use_adc (int i, int err, uint16_t adc, const char *ynot)
+{
+    switch (i) {
+
+    case 0:
+        // check power first
+        if (err < 0) {
+            fprintf (stderr, "Power ADC read error: %s\n", ynot);
+            g5500_thread_state = CTS_ERR_ADC;
+            return (-1);
+        }
+        if (adc < ADC_MIN_POK) {
+            fprintf (stderr, "G5500 power off\n");
+            g5500_thread_state = CTS_ERR_NOPOWER;
+            return (-1);
+        }
+        break;
+
+    case 1:
+        if (err < 0) {
+            fprintf (stderr, "AZ ADC read error: %s\n", ynot);
+            g5500_thread_state = CTS_ERR_ADC;
+            return (-1);
+        }
+        ADC_az_now = g5500_thread_encoder_position (&enc_az, "az", adc, ADC_az_min, ADC_az_max,
+                                AZ_MOUNT_MAX - AZ_MOUNT_MIN);
+        break;
+
+    case 2:
+        if (err < 0) {
+            fprintf (stderr, "EL ADC read error: %s\n", ynot);
+            g5500_thread_state = CTS_ERR_ADC;
+            return (-1);
+        }
+        ADC_el_now = g5500_thread_encoder_position (&enc_el, "el", adc, ADC_el_min, ADC_el_max,
+                                el_mount_max - EL_MOUNT_MIN);
+        if (!enc_el.locked)
+            ADC_el_now = g5500_thread_imu_position (&imu_el, adc, ADC_el_now, ADC_el_min, ADC_el_max,
+                                el_mount_max - EL_MOUNT_MIN);
+        break;
+    }
+
+    return (0);
+}
+
+/* called by thread to read the current position of each axis into ADC_az_now and ADC_el_now.
+ * when simulating, read the mount model instead
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_read_axis_positions()
+{
+    if (g5500_sim_mode == SIM_OFF) {
+
+        // read real ADC, waiting for each conversion
+        char ynot[1024];
+        for (int i = 0; i < N_ADC_CHANNELS; i++) {
+            uint16_t adc = 0;           // can't pass address of volatile
+            int err = readADC_SingleEnded (ADC_I2C_ADDR, g5500_adc_channels[i], &adc, ynot);
+            if (g5500_thread_use_adc (i, err, adc, ynot) < 0)
+                return;
+        }
+
+    } else {
+
+        // where the model says the axes have moved in response to the commanded motions so far,
+        // el too although might not be being used
+
+        double now = g5500_now();
+        ADC_az_now = g5500SimRead (&sim_az, now, 1);
+        ADC_el_now = g5500SimRead (&sim_el, now, 1);
+    }
+
+    // fresh
+    g5500_thread_record_sample();
+}
+
+
+/* drive the given axis in the given direction, or stop if 0.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_tune_drive (TuneAxis *tp, int dir)
+{
+    if (tp == &tune_az) {
+        if (dir > 0)
+            g5500_thread_rotate_cw();
+        else if (dir < 0)
+            g5500_thread_rotate_ccw();
+        else
+            g5500_thread_az_stop();
+    } else {
+        if (dir > 0)
+            g5500_thread_rotate_up();
+        else if (dir < 0)
+            g5500_thread_rotate_down();
+        else
+            g5500_thread_el_stop();
+    }
+}
+
+/* begin autotune step tune_step on one axis.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_tune_start_axis (TuneAxis *tp, uint16_t now, uint16_t min, uint16_t max, float speed)
+{
+    const TuneStep *sp = &tune_script[tune_step];
+
+    // reverse if the step might reach the limit, allowing half again for latency and coast
+    int room = speed > 0 ? 1.5 * sp->secs * speed : (max - min) / 4;
+    tp->dir = sp->dir;
+    if (tp->dir > 0 && now + room > max)
+        tp->dir = -1;
+    else if (tp->dir < 0 && now < min + room)
+        tp->dir = 1;
+
+    tp->moving = 1;
+    tp->done = 0;
+    tp->adc_on = now;
+    tp->adc_prev = now;
+    tp->t_moved = 0;
+    tp->n_equal = 0;
+    g5500_thread_tune_drive (tp, tp->dir);
+}
+
+/* begin autotune step tune_step on both axes.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_tune_start_step()
+{
+    rig_debug(RIG_DEBUG_VERBOSE, "%s step %d: %g secs\n", __func__, tune_step, tune_script[tune_step].secs);
+
+    tune_t_start = g5500_now();
+    g5500_thread_tune_start_axis (&tune_az, ADC_az_now, ADC_az_min, ADC_az_max, ADC_az_speed);
+    g5500_thread_tune_start_axis (&tune_el, ADC_el_now, ADC_el_min, ADC_el_max, ADC_el_speed);
+
+    // no el to tune
+    if (g5500_sim_mode == SIM_AZONLY) {
+        g5500_thread_el_stop();
+        tune_el.moving = 0;
+        tune_el.done = 1;
+        tune_el.detect[tune_step] = -1;
+    }
+}
+
+/* monitor the current autotune step on one axis, recording its results when complete.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_tune_run_axis (TuneAxis *tp, uint16_t now)
+{
+    int noise = tp->noise_max - tp->noise_min;
+    double t = g5500_now();
+
+    if (tp->done)
+        return;
+
+    // note first real motion, ie, clearly beyond the noise but as early as possible to time the start
+    if (!tp->t_moved && abs ((int)now - (int)tp->adc_on) > noise + ADC_MOVE_NOISE/2) {
+        tp->t_moved = t;
+        tp->adc_moved = now;
+    }
+
+    if (tp->moving) {
+
+        // open relay when step time is up
+        if (t - tune_t_start >= tune_script[tune_step].secs) {
+            g5500_thread_tune_drive (tp, 0);
+            tp->moving = 0;
+            tp->adc_off = now;
+            tp->t_off = t;
+        }
+
+    } else {
+
+        // coasting until consecutive readings stay within the noise
+        if (abs ((int)now - (int)tp->adc_prev) <= noise)
+            tp->n_equal++;
+        else
+            tp->n_equal = 0;
+        tp->adc_prev = now;
+
+        if (tp->n_equal >= N_EQUAL_STOPPED || t - tune_t_start > TUNE_STEP_TIMEOUT) {
+            // at rest, record results
+            int moved = tp->t_moved != 0;
+            tp->detect[tune_step] = moved ? tp->t_moved - tune_t_start : -1;
+            tp->detect_travel[tune_step] = moved ? abs ((int)tp->adc_moved - (int)tp->adc_on) : 0;
+            tp->speed[tune_step] = moved && tp->t_off - tp->t_moved >= TUNE_MIN_SPEED_SECS
+                                    ? abs ((int)tp->adc_off - (int)tp->adc_moved) / (tp->t_off - tp->t_moved) : 0;
+            tp->coast[tune_step] = abs ((int)now - (int)tp->adc_off);
+            tp->travel[tune_step] = abs ((int)now - (int)tp->adc_on);
+            tp->done = 1;
+        }
+    }
+}
+
+/* results derived from the autotune measurements of one axis
+ */
+typedef struct {
+    int noise;                          // peak-to-peak ADC at rest
+    float speed;                        // mean ADC/sec
+    float latency;                      // mean secs from relay closed until moving
+    float coast;                        // mean ADC travelled after relay opened
+    float min_pulse;                    // secs of relay closure needed to move one deadband
+    int deadband;                       // recommended deadband
+    int stop_lead;                      // recommended stop lead
+    int ok;                             // set if the axis moved on every step
+} TuneResult;
+
+/* derive settings for one axis from its autotune measurements.
+ * by stopping stop_lead short of the goal the axis comes to rest within half a polling period of motion
+ * of the goal, so the deadband need only cover that plus the noise and ADC resolution to avoid hunting.
+ */
+static void g5500_tune_derive (const TuneAxis *tp, TuneResult *rp)
+{
+    float period = THREAD_PERIOD/1e6;
+    float speed_sum = 0, coast_sum = 0, latency_sum = 0;
+    int n_speed = 0, n_moved = 0;
+
+    memset (rp, 0, sizeof(*rp));
+    rp->noise = tp->noise_max - tp->noise_min;
+
+    for (int i = 0; i < N_TUNE_STEPS; i++) {
+        if (tp->speed[i] > 0) {
+            speed_sum += tp->speed[i];
+            n_speed++;
+        }
+        if (tp->detect[i] >= 0) {
+            coast_sum += tp->coast[i];
+            n_moved++;
+        }
+    }
+    if (n_speed == 0 || n_moved < N_TUNE_STEPS)
+        return;
+    rp->speed = speed_sum / n_speed;
+    rp->coast = coast_sum / n_moved;
+
+    // latency is the detection time less the time spent travelling until detected
+    for (int i = 0; i < N_TUNE_STEPS; i++) {
+        float l = tp->detect[i] - tp->detect_travel[i] / rp->speed;
+        latency_sum += l > 0 ? l : 0;
+    }
+    rp->latency = latency_sum / N_TUNE_STEPS;
+
+    rp->stop_lead = (int) (rp->coast + rp->speed * period / 2 + 0.5);
+    rp->deadband = (int) ceilf (rp->speed * period / 2 + 2 * rp->noise + ADC_MOVE_NOISE);
+    if (rp->stop_lead > STOP_LEAD_MAX)
+        rp->stop_lead = STOP_LEAD_MAX;
+    if (rp->deadband < DEADBAND_MIN)
+        rp->deadband = DEADBAND_MIN;
+    if (rp->deadband > DEADBAND_MAX)
+        rp->deadband = DEADBAND_MAX;
+    rp->min_pulse = rp->latency + rp->deadband / rp->speed;
+    rp->ok = 1;
+}
+
+/* write the measurements and results of one axis to the autotune report
+ */
+static void g5500_tune_report_axis (FILE *fp, const char *name, const TuneAxis *tp, const TuneResult *rp)
+{
+    fprintf (fp, "\n%s steps:\n", name);
+    fprintf (fp, "  %5s %4s %8s %8s %8s %8s\n", "secs", "dir", "detect", "speed", "coast", "travel");
+    for (int i = 0; i < N_TUNE_STEPS; i++)
+        fprintf (fp, "  %5.1f %4d %8.2f %8.1f %8.0f %8.0f\n", tune_script[i].secs, tune_script[i].dir,
+                        tp->detect[i], tp->speed[i], tp->coast[i], tp->travel[i]);
+
+    fprintf (fp, "%s results:\n", name);
+    if (!rp->ok) {
+        fprintf (fp, "  axis did not move on every step, settings unchanged\n");
+        return;
+    }
+    fprintf (fp, "  noise        = %d ADC peak-to-peak\n", rp->noise);
+    fprintf (fp, "  speed        = %.1f ADC/sec\n", rp->speed);
+    fprintf (fp, "  latency      = %.2f secs\n", rp->latency);
+    fprintf (fp, "  coast        = %.1f ADC\n", rp->coast);
+    fprintf (fp, "  min pulse    = %.2f secs\n", rp->min_pulse);
+    fprintf (fp, "  deadband     = %d ADC\n", rp->deadband);
+    fprintf (fp, "  stop_lead    = %d ADC\n", rp->stop_lead);
+}
+
+/* derive, apply and persist new settings from the autotune measurements, and write a report.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_tune_finish()
+{
+    TuneResult az, el;
+    g5500_tune_derive (&tune_az, &az);
+    g5500_tune_derive (&tune_el, &el);
+
+    // allow twice the slowest start before expecting motion during calibration
+    float latency = az.latency > el.latency ? az.latency : el.latency;
+    int motion_start = (int) (2e6 * latency);
+    if (motion_start < THREAD_PERIOD)
+        motion_start = THREAD_PERIOD;
+    if (motion_start > MOTION_START_MAX)
+        motion_start = MOTION_START_MAX;
+
+    // apply on the next tick
+    pthread_mutex_lock (&g5500_tuning_lock);
+    if (az.ok) {
+        g5500_tuning_next.az_deadband = az.deadband;
+        g5500_tuning_next.az_stop_lead = az.stop_lead;
+    }
+    if (el.ok) {
+        g5500_tuning_next.el_deadband = el.deadband;
+        g5500_tuning_next.el_stop_lead = el.stop_lead;
+    }
+    if (az.ok || el.ok)
+        g5500_tuning_next.motion_start_period = motion_start;
+    pthread_mutex_unlock (&g5500_tuning_lock);
+
+    // measured speeds also improve arrival predictions
+    if (az.ok)
+        ADC_az_speed = az.speed;
+    if (el.ok)
+        ADC_el_speed = el.speed;
+
+    // persist
+    if (az.ok || el.ok) {
+        g5500_save_conf_file();
+        if (g5500_sim_mode == SIM_OFF)
+            g5500_save_cal_file();
+    }
+
+    // report
+    static char *path;
+    const char *filename = g5500_home_path (g5500_tune_file_name, &path);
+    FILE *fp = filename ? fopen (filename, "w") : NULL;
+    if (fp) {
+        time_t t = time (NULL);
+        fprintf (fp, "G5500 autotune report %s", ctime (&t));
+        fprintf (fp, "thread_period = %d usecs\n", THREAD_PERIOD);
+        g5500_tune_report_axis (fp, "Az", &tune_az, &az);
+        g5500_tune_report_axis (fp, "El", &tune_el, &el);
+        fprintf (fp, "\nmotion_start_period = %d usecs\n", (az.ok || el.ok) ? motion_start : MOTION_START_PERIOD);
+        fclose (fp);
+        rig_debug(RIG_DEBUG_VERBOSE, "%s wrote %s\n", __func__, filename);
+    }
+}
+
+#if defined(STANDALONE_G5500)
+
+/* ring of recent positions, one per control thread tick, oldest overwritten first
+ */
+static G5500HistPoint g5500_history[G5500_HISTORY_LEN];
+static int g5500_history_head;          // index of next point to write
+static int g5500_history_n;             // number of valid points
+static pthread_mutex_t g5500_history_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* flight recorder: ring of the raw ADC values and relay commands of every control thread tick, oldest
+ * overwritten first, from which g5500fit fits the simulator's mount profile
+ */
+static G5500TraceRec g5500_trace[G5500_TRACE_LEN];
+static int g5500_trace_head;            // index of next record to write
+static int g5500_trace_n;               // number of valid records
+static pthread_mutex_t g5500_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* add this tick to the flight recorder, once the relays are set.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_record_trace()
+{
+    G5500TraceRec tr;
+    pthread_mutex_lock (&ADC_sample_lock);
+    tr.t = ADC_sample.t;
+    pthread_mutex_unlock (&ADC_sample_lock);
+    tr.t_relay = g5500_now();
+    tr.az = ADC_az_now;
+    tr.el = ADC_el_now;
+    tr.relays = (AZ_cmd_cw ? G5500_TRACE_CW : 0) | (AZ_cmd_ccw ? G5500_TRACE_CCW : 0)
+                        | (EL_cmd_up ? G5500_TRACE_UP : 0) | (EL_cmd_down ? G5500_TRACE_DOWN : 0);
+
+    pthread_mutex_lock (&g5500_trace_lock);
+    g5500_trace[g5500_trace_head] = tr;
+    g5500_trace_head = (g5500_trace_head + 1) % G5500_TRACE_LEN;
+    if (g5500_trace_n < G5500_TRACE_LEN)
+        g5500_trace_n++;
+    pthread_mutex_unlock (&g5500_trace_lock);
+}
+
+/* add the current position and target to the history ring.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_record_history()
+{
+    if (!ADC_cal_ok)
+        return;
+
+    struct timespec ts;
+    clock_gettime (CLOCK_REALTIME, &ts);
+
+    G5500HistPoint hp;
+    hp.t = ts.tv_sec + ts.tv_nsec*1e-9;
+    g5500_ADC_to_sky (ADC_az_now, ADC_el_now, &hp.az, &hp.el);
+    g5500_ADC_to_sky (ADC_az_target, ADC_el_target, &hp.az_target, &hp.el_target);
+
+    pthread_mutex_lock (&g5500_history_lock);
+    g5500_history[g5500_history_head] = hp;
+    g5500_history_head = (g5500_history_head + 1) % G5500_HISTORY_LEN;
+    if (g5500_history_n < G5500_HISTORY_LEN)
+        g5500_history_n++;
+    pthread_mutex_unlock (&g5500_history_lock);
+}
+
+/* given az in [0,360), return it or az+360 whichever is in range and closer to az_ref.
+ * this lets the mount follow a target across north without unwinding.
+ */
+static float g5500_nearer_turn (float az, float az_ref)
+{
+    if (az + 360 <= AZ_MOUNT_MAX && fabsf (az + 360 - az_ref) < fabsf (az - az_ref))
+        az += 360;
+    return (az);
+}
+
+/* while tracking, move the targets to where g5500_track_fn says they should be now.
+ * tracking ends if the function fails, its position is out of range or the thread is no longer running.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_track()
+{
+    G5500TrackFunc fn = g5500_track_fn;
+    if (!fn)
+        return;
+    if (g5500_thread_state != CTS_RUN) {
+        g5500_track_fn = NULL;
+        return;
+    }
+
+    struct timespec ts;
+    clock_gettime (CLOCK_REALTIME, &ts);
+
+    float az, el;
+    if ((*fn) (ts.tv_sec + ts.tv_nsec*1e-9, &az, &el, g5500_track_arg) < 0
+                        || az < AZ_MOUNT_MIN || az >= AZ_MOUNT_WRAP || el < EL_MOUNT_MIN || el > el_mount_max) {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: target is no longer reachable, holding last position\n", __func__);
+        g5500_track_fn = NULL;
+        return;
+    }
+
+    uint16_t az_target, el_target;
+    g5500_sky_to_ADC (g5500_nearer_turn (az, g5500_ADC_to_az (ADC_az_target)), el, &az_target, &el_target);
+    ADC_az_target = az_target;
+    ADC_el_target = el_target;
+}
+
+#endif // STANDALONE_G5500
+
+/* return the time constant of the motor model, secs, with the heat of continuous running in *kp,
+ * or 0 if there is no duty limit.
+ */
+static double g5500_duty_model (double *kp)
+{
+    int duty = g5500_get_tuning (&g5500_motor_duty);
+    if (duty <= 0 || duty >= 100)
+        return (0);
+
+    // from cold, continuous running reaches heat 1 after motor_run secs
+    double d = duty / 100.0;
+    *kp = 1 / d;
+    return (g5500_get_tuning (&g5500_motor_run) / -log (1 - d));
+}
+
+/* return secs of continuous running the motor of dp has left before it must rest, -1 if no limit
+ */
+static float g5500_duty_run_left (const G5500Duty *dp, double tau, double k)
+{
+    if (tau <= 0)
+        return (-1);
+    if (dp->heat >= 1)
+        return (0);
+    return (tau * log ((k - dp->heat) / (k - 1)));
+}
+
+/* update the model of the named motor for the dt secs since the last update, with its relay on if on.
+ * changes are logged unless name is NULL.
+ */
+static void g5500_duty_update (G5500Duty *dp, const char *name, int on, double dt, double tau, double k)
+{
+    if (on) {
+        dp->run_secs += dt;
+        if (!dp->on) {
+            dp->n_starts++;
+            if (tau > 0)
+                dp->heat += k * DUTY_START_SECS / tau;
+        }
+    }
+    dp->on = on;
+
+    if (tau <= 0) {
+        dp->heat = 0;
+        dp->warned = 0;
+        dp->cooling = 0;
+        return;
+    }
+
+    // heat approaches k while running, 0 while resting
+    double decay = exp (-dt / tau);
+    dp->heat = dp->heat * decay + (on ? k * (1 - decay) : 0);
+
+    if (dp->heat >= DUTY_WARN && !dp->warned) {
+        if (name)
+            rig_debug(RIG_DEBUG_ERR, "%s motor at %.0f%% of its duty limit, %.0f secs of running left before it rests\n",
+                        name, 100 * dp->heat, g5500_duty_run_left (dp, tau, k));
+        dp->warned = 1;
+    }
+    if (dp->heat >= 1 && !dp->cooling) {
+        if (name)
+            rig_debug(RIG_DEBUG_ERR, "%s motor at its duty limit, resting it to cool\n", name);
+        dp->cooling = 1;
+        dp->n_cooldowns++;
+    } else if (dp->cooling && dp->heat <= DUTY_RESUME) {
+        if (name)
+            rig_debug(RIG_DEBUG_ERR, "%s motor has cooled, resuming\n", name);
+        dp->cooling = 0;
+    }
+    if (dp->heat <= DUTY_RESUME)
+        dp->warned = 0;
+}
+
+/* update the model of each motor for how long its relay has been on since the previous tick.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_duty()
+{
+    double now = g5500_now();
+    double dt = duty_t > 0 ? now - duty_t : 0;
+    duty_t = now;
+
+    double k = 1;
+    double tau = g5500_duty_model (&k);
+    g5500_duty_update (&duty_az, "az", AZ_cmd_active(), dt, tau, k);
+    g5500_duty_update (&duty_el, "el", EL_cmd_active(), dt, tau, k);
+}
+
+#if defined(STANDALONE_G5500)
+/* return how far beyond its deadband, in ADC, a tracking axis whose motor is as warm as dp may fall behind
+ * before a move starts. min and max are the ADC limits and span the degs between them.
+ */
+static int g5500_duty_band (const G5500Duty *dp, uint16_t min, uint16_t max, float span)
+{
+    if (dp->heat > DUTY_BATCH && max > min)
+        return ((int) (DUTY_BATCH_MAX * fmin (1, (dp->heat - DUTY_BATCH) / (1 - DUTY_BATCH)) * (max - min) / span));
+    return (0);
+}
+#endif
+
+/* return how much beyond its deadband, in ADC, an axis must be from its goal before a move starts.
+ * while tracking, corrections are batched into fewer longer moves as the motor warms so it takes fewer
+ * starts to follow the target. min and max are the ADC limits and span the degs between them.
+ */
+static int g5500_duty_batch (const G5500Duty *dp, uint16_t min, uint16_t max, float span)
+{
+#if defined(STANDALONE_G5500)
+    if (g5500_track_fn)
+        return (g5500_duty_band (dp, min, max, span));
+#else
+    (void) dp;
+    (void) min;
+    (void) max;
+    (void) span;
+#endif
+    return (0);
+}
+
+/* publish a heartbeat then sleep for the given period, reading any locked encoders every encoder period.
+ * the supervisor expects the next heartbeat within usecs, plus the time for one tick of work.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static void g5500_thread_sleep (int usecs)
+{
+    double wake = g5500_now() + usecs/1e6;
+    g5500_heartbeat_due = wake;
+
+    // read any locked encoders and IMU meanwhile
+    int period = g5500_get_tuning (&g5500_encoder_period);
+    if (period > 0 && period < ENC_PERIOD_MIN)
+        period = ENC_PERIOD_MIN;
+    if (period == 0 || period >= usecs || (!enc_az.locked && !enc_el.locked && !imu_el.locked)) {
+        pthread_mutex_unlock (&g5500_tick_lock);
+        usleep (usecs);
+        pthread_mutex_lock (&g5500_tick_lock);
+        return;
+    }
+
+    for (;;) {
+        pthread_mutex_unlock (&g5500_tick_lock);
+        double left = wake - g5500_now();
+        if (left > 0)
+            usleep (left*1e6 < period ? (useconds_t)(left*1e6) : (useconds_t)period);
+        pthread_mutex_lock (&g5500_tick_lock);
+        if (g5500_now() >= wake)
+            break;
+        g5500_thread_poll_sensors();
+    }
+}
+
+/* the work of each control tick once fresh positions have been read, doing whatever is required by
+ * g5500_thread_state.
+ * return usecs until the next tick.
+ * N.B. to be called only by g5500_control_thread()
+ */
+static int g5500_thread_tick()
+{
+    int usecs = THREAD_PERIOD;
+
+    // account for motor heating since the last tick
+    g5500_thread_duty();
+
+    // update stopped detection metrics
+    if (AZ_cmd_active() && ADC_az_now == ADC_az_prev) {
+        // cap at N_EQUAL_STOPPED to avoid overflow if idle for long periods
+        if (ADC_az_n_equal < N_EQUAL_STOPPED)
+            ADC_az_n_equal++;
+    } else {
+        ADC_az_n_equal = 0;
+    }
+    if (EL_cmd_active() && ADC_el_now == ADC_el_prev) {
+        // cap at N_EQUAL_STOPPED to avoid overflow if idle for long periods
+        if (ADC_el_n_equal < N_EQUAL_STOPPED)
+            ADC_el_n_equal++;
+    } else {
+        ADC_el_n_equal = 0;
+    }
+
+
+    // retain ADC values for next loop
+    ADC_az_prev = ADC_az_now;
+    ADC_el_prev = ADC_el_now;
+
+
+    // publish status
+    g5500_thread_capture_state();
+#if defined(STANDALONE_G5500)
+    g5500_thread_record_history();
+#endif
+
+    rig_debug(RIG_DEBUG_TRACE, "%s state %d AZ n= %d %4u -> %4u %6.1f %s  EL n= %d %4u -> %4u %6.1f %s\n",
+            __func__, g5500_thread_state,
+            ADC_az_n_equal, ADC_az_now, ADC_az_target, g5500_ADC_to_az (ADC_az_now),
+                AZ_cmd_cw ? " CW " : (AZ_cmd_ccw ? " CCW" : "STOP"),
+            ADC_el_n_equal, ADC_el_now, ADC_el_target, g5500_ADC_to_el (ADC_el_now),
+                EL_cmd_up ? " UP " : (EL_cmd_down ? "DOWN" : "STOP"));
+
+
+    // follow any moving target
+#if defined(STANDALONE_G5500)
+    g5500_thread_track();
+#endif
+
+    // what we do next depends on our state
+    switch (g5500_thread_state) {
+
+    case CTS_STOP:
+
+        // insure no commanded motions
+
+        g5500_thread_az_stop();
+        g5500_thread_el_stop();
+
+        break;
+
+    case CTS_RUN:
+
+        // seek target
+
+        if (AZ_is_stuck()) {
+
+            // stop and report stuck az axis
+            g5500_thread_az_stop();
+            g5500_thread_state = CTS_ERR_STUCK;
+
+        } else if (duty_az.cooling) {
+
+            // rest the motor, the target waits
+            g5500_thread_az_stop();
+
+        } else {
+
+            // seek az target, by way of the overshoot point if required by az_approach.
+            // stop short by the stop lead to allow for coasting.
+            uint16_t az_goal = AZ_via_active ? ADC_az_via : ADC_az_target;
+            int az_band = ADC_AZ_DEADBAND + g5500_duty_batch (&duty_az, ADC_az_min, ADC_az_max,
+                                AZ_MOUNT_MAX - AZ_MOUNT_MIN);
+            if (AZ_cmd_active()) {
+                g5500_thread_az_arrive();
+            } else if (ADC_az_now > az_goal + az_band) {
+                if (!AZ_via_active && az_approach == APPROACH_INCREASING) {
+                    // go beyond the target so the final leg is cw
+                    ADC_az_via = ADC_az_target > ADC_az_min + AZ_overshoot()
+                                    ? ADC_az_target - AZ_overshoot() : ADC_az_min;
+                    AZ_via_active = 1;
+                }
+                g5500_thread_rotate_ccw();
+            } else if (ADC_az_now + az_band < az_goal) {
+                if (!AZ_via_active && az_approach == APPROACH_DECREASING) {
+                    // go beyond the target so the final leg is ccw
+                    ADC_az_via = ADC_az_target + AZ_overshoot() < ADC_az_max
+                                    ? ADC_az_target + AZ_overshoot() : ADC_az_max;
+                    AZ_via_active = 1;
+                }
+                g5500_thread_rotate_cw();
+            } else {
+                g5500_thread_az_stop();
+                AZ_via_active = 0;
+            }
+
+        }
+
+        if (EL_is_stuck()) {
+
+            // stop and report stuck el axis
+            g5500_thread_el_stop();
+            g5500_thread_state = CTS_ERR_STUCK;
+
+        } else if (duty_el.cooling) {
+
+            // rest the motor, the target waits
+            g5500_thread_el_stop();
+
+        } else {
+
+            // seek el target, by way of the overshoot point if required by el_approach.
+            // stop short by the stop lead to allow for coasting.
+            uint16_t el_goal = EL_via_active ? ADC_el_via : ADC_el_target;
+            int el_band = ADC_EL_DEADBAND + g5500_duty_batch (&duty_el, ADC_el_min, ADC_el_max,
+                                el_mount_max - EL_MOUNT_MIN);
+            if (EL_cmd_active()) {
+                g5500_thread_el_arrive();
+            } else if (ADC_el_now > el_goal + el_band) {
+                if (!EL_via_active && el_approach == APPROACH_INCREASING) {
+                    // go beyond the target so the final leg is up
+                    ADC_el_via = ADC_el_target > ADC_el_min + EL_overshoot()
+                                    ? ADC_el_target - EL_overshoot() : ADC_el_min;
+                    EL_via_active = 1;
+                }
+                g5500_thread_rotate_down();
+            } else if (ADC_el_now + el_band < el_goal) {
+                if (!EL_via_active && el_approach == APPROACH_DECREASING) {
+                    // go beyond the target so the final leg is down
+                    ADC_el_via = ADC_el_target + EL_overshoot() < ADC_el_max
+                                    ? ADC_el_target + EL_overshoot() : ADC_el_max;
+                    EL_via_active = 1;
+                }
+                g5500_thread_rotate_up();
+            } else {
+                g5500_thread_el_stop();
+                EL_via_active = 0;
+            }
+
+        }
+
+        break;
+
+    case CTS_CAL_START:
+
+        // start the calibration sequence by moving to axis minima
+
+        rig_debug(RIG_DEBUG_VERBOSE, "%s seeking mins\n", __func__);
+
+        // encoders and IMU are aligned afresh by the sweep, until then use the pots
+        enc_az.sign = enc_el.sign = imu_el.sign = 0;
+        enc_az.locked = enc_el.locked = imu_el.locked = 0;
+
+        g5500_thread_rotate_ccw();
+        g5500_thread_rotate_down();
+        g5500_thread_state = CTS_CAL_SEEK_MINS;
+
+        // give axes time to start moving to avoid false detection of finding min
+        usecs += MOTION_START_PERIOD;
+
+        break;
+
+    case CTS_CAL_SEEK_MINS:
+
+        // found axis minima when both stop moving, presumably because of limits
+
+        rig_debug(RIG_DEBUG_TRACE, "%s seeking mins ADC az %u el %u\n", __func__, ADC_az_now, ADC_el_now);
+
+        if (AZ_is_stuck() && EL_is_stuck()) {
+
+            // record ADC at minima, and encoder counts to align them at the maxima
+            ADC_az_min = ADC_az_now;
+            ADC_el_min = ADC_el_now;
+            enc_az.cal_min = enc_az.have ? enc_az.count : INT32_MIN;
+            enc_el.cal_min = enc_el.have ? enc_el.count : INT32_MIN;
+            imu_el.cal_min = imu_el.angle;
+            imu_el.cal_gyro = imu_el.gyro;
+            imu_el.cal_sum = 0;
+            imu_el.cal_ok = imu_el.have;
+
+            // proceed to both maxima, timing each sweep to measure axis speeds
+            g5500_thread_rotate_cw();
+            g5500_thread_rotate_up();
+            g5500_thread_state = CTS_CAL_SEEK_MAXS;
+            cal_t_start = g5500_now();
+            cal_az_t_stuck = 0;
+            cal_el_t_stuck = 0;
+
+            rig_debug(RIG_DEBUG_VERBOSE, "%s seeking maxs\n", __func__);
+
+            // give axes time to start moving to avoid false detection of finding max
+            usecs += MOTION_START_PERIOD;
+        }
+
+        break;
+
+    case CTS_CAL_SEEK_MAXS:
+
+        // found axis maxima when both stop moving, presumably because of limits
+
+        rig_debug(RIG_DEBUG_TRACE, "%s seeking maxs ADC az %u el %u\n", __func__, ADC_az_now, ADC_el_now);
+
+        // note when each axis arrives, allowing for the readings needed to declare it stuck
+        if (AZ_is_stuck() && cal_az_t_stuck == 0)
+            cal_az_t_stuck = g5500_now() - N_EQUAL_STOPPED*THREAD_PERIOD/1e6;
+        if (EL_is_stuck() && cal_el_t_stuck == 0)
+            cal_el_t_stuck = g5500_now() - N_EQUAL_STOPPED*THREAD_PERIOD/1e6;
+
+        if (AZ_is_stuck() && EL_is_stuck()) {
+
+            // record ADC at maxima and align the encoders
+            ADC_az_max = ADC_az_now;
+            ADC_el_max = ADC_el_now;
+            g5500_thread_encoder_align (&enc_az, "az", AZ_MOUNT_MAX - AZ_MOUNT_MIN);
+            g5500_thread_encoder_align (&enc_el, "el", el_mount_max - EL_MOUNT_MIN);
+            g5500_thread_imu_align (&imu_el, el_mount_max - EL_MOUNT_MIN);
+
+            // record sweep speeds
+            ADC_az_speed = cal_az_t_stuck > cal_t_start
+                            ? (ADC_az_max - ADC_az_min) / (cal_az_t_stuck - cal_t_start) : 0;
+            ADC_el_speed = cal_el_t_stuck > cal_t_start
+                            ? (ADC_el_max - ADC_el_min) / (cal_el_t_stuck - cal_t_start) : 0;
+
+            // reverse both axes to measure backlash
+            ADC_az_backlash = 0;
+            ADC_el_backlash = 0;
+            g5500_thread_rotate_ccw();
+            g5500_thread_rotate_down();
+            g5500_thread_state = CTS_CAL_BACKLASH;
+            cal_t_start = g5500_now();
+            cal_az_done = 0;
+            cal_el_done = 0;
+
+            rig_debug(RIG_DEBUG_VERBOSE, "%s measuring backlash, speeds %g %g ADC/s\n", __func__,
+                            ADC_az_speed, ADC_el_speed);
+        }
+
+        break;
+
+    case CTS_CAL_BACKLASH:
+
+        // the time until the ADC first moves after reversing covers the relay and motor starting as well
+        // as the gear slack. backlash is the slack alone, ie, that time less the start latency, times the
+        // sweep speed, less the distance already travelled by the time we notice.
+
+        if (!cal_az_done && ADC_az_now + ADC_MOVE_NOISE < ADC_az_max) {
+            double latency = g5500_sim_mode == SIM_OFF ? MOTOR_START_LATENCY : sim_profile.az.latency;
+            float lost = (g5500_now() - cal_t_start - latency) * ADC_az_speed - (ADC_az_max - ADC_az_now);
+            ADC_az_backlash = lost > 0 ? (uint16_t) lost : 0;
+            g5500_thread_az_stop();
+            cal_az_done = 1;
+        }
+        if (!cal_el_done && ADC_el_now + ADC_MOVE_NOISE < ADC_el_max) {
+            double latency = g5500_sim_mode == SIM_OFF ? MOTOR_START_LATENCY : sim_profile.el.latency;
+            float lost = (g5500_now() - cal_t_start - latency) * ADC_el_speed - (ADC_el_max - ADC_el_now);
+            ADC_el_backlash = lost > 0 ? (uint16_t) lost : 0;
+            g5500_thread_el_stop();
+            cal_el_done = 1;
+        }
+
+        if ((cal_az_done && cal_el_done) || g5500_now() - cal_t_start > CAL_BACKLASH_TIMEOUT) {
+
+            rig_debug(RIG_DEBUG_VERBOSE, "%s backlash az %u el %u ADC\n", __func__,
+                            ADC_az_backlash, ADC_el_backlash);
+
+            // save new config values
+            g5500_save_cal_file();
+
+            // stop
+            g5500_thread_az_stop();
+            g5500_thread_el_stop();
+            g5500_thread_state = CTS_STOP;
+        }
+
+        break;
+
+    case CTS_TUNE_START:
+
+        // start the autotune sequence by stopping then measuring noise at rest
+
+        rig_debug(RIG_DEBUG_VERBOSE, "%s autotune starting\n", __func__);
+
+        g5500_thread_az_stop();
+        g5500_thread_el_stop();
+        memset (&tune_az, 0, sizeof(tune_az));
+        memset (&tune_el, 0, sizeof(tune_el));
+        tune_az.noise_min = tune_el.noise_min = UINT16_MAX;
+        tune_t_start = g5500_now();
+        g5500_thread_state = CTS_TUNE_NOISE;
+
+        break;
+
+    case CTS_TUNE_NOISE:
+
+        // record the ADC extremes once at rest
+
+        if (g5500_now() - tune_t_start > TUNE_REST_SECS) {
+            if (ADC_az_now < tune_az.noise_min)
+                tune_az.noise_min = ADC_az_now;
+            if (ADC_az_now > tune_az.noise_max)
+                tune_az.noise_max = ADC_az_now;
+            if (ADC_el_now < tune_el.noise_min)
+                tune_el.noise_min = ADC_el_now;
+            if (ADC_el_now > tune_el.noise_max)
+                tune_el.noise_max = ADC_el_now;
+        }
+
+        if (g5500_now() - tune_t_start > TUNE_REST_SECS + TUNE_NOISE_SECS) {
+            rig_debug(RIG_DEBUG_VERBOSE, "%s autotune noise az %d el %d\n", __func__,
+                            tune_az.noise_max - tune_az.noise_min, tune_el.noise_max - tune_el.noise_min);
+            tune_step = 0;
+            g5500_thread_tune_start_step();
+            g5500_thread_state = CTS_TUNE_STEP;
+        }
+
+        break;
+
+    case CTS_TUNE_STEP:
+
+        // run each step of the script in turn until all are done
+
+        g5500_thread_tune_run_axis (&tune_az, ADC_az_now);
+        g5500_thread_tune_run_axis (&tune_el, ADC_el_now);
+
+        if (tune_az.done && tune_el.done) {
+            if (++tune_step < N_TUNE_STEPS) {
+                g5500_thread_tune_start_step();
+            } else {
+                g5500_thread_tune_finish();
+                g5500_thread_az_stop();
+                g5500_thread_el_stop();
+                g5500_thread_state = CTS_STOP;
+            }
+        }
+
+        break;
+
+    case CTS_ERR_ADC:
+    case CTS_ERR_NOPOWER:
+    case CTS_ERR_STUCK:
+    case CTS_ERR_WATCHDOG:
+
+        // error state, insure no commanded motions
+
+        g5500_thread_az_stop();
+        g5500_thread_el_stop();
+
+        break;
+
+    }
+
+#if defined(STANDALONE_G5500)
+    g5500_thread_record_trace();
+#endif
 
-        // update el, although might not be being used
-
-        if (EL_cmd_up) {
-            ADC_el_now += EL_SIM_ADC_PER_PRD;
-            if (ADC_el_now > ADC_el_max)
-                ADC_el_now = ADC_el_max;
-        } else if (EL_cmd_down) {
-            if (ADC_el_now >= EL_SIM_ADC_PER_PRD)
-                ADC_el_now -= EL_SIM_ADC_PER_PRD;
-            else
-                ADC_el_now = 0;
-        }
-    }
+    return (usecs);
 }
 
-
 /* this function is the separate control thread.
- * it loops forever doing whatever is required by g5500_thread_state.
+ * it loops forever reading positions then running each tick.
   */
 static void *g5500_control_thread (void *unused)
 {
     (void) unused;
 
-    // initially stop
-    g5500_thread_state = CTS_STOP;
-    g5500_thread_az_stop();
-    g5500_thread_el_stop();
+    // released only while sleeping
+    pthread_mutex_lock (&g5500_tick_lock);
+
+    // initially stop, unless carrying on from another process
+    if (!g5500_restored) {
+        g5500_thread_state = CTS_STOP;
+        g5500_thread_az_stop();
+        g5500_thread_el_stop();
+    }
 
     // forever
     for(;;) {
 
+        // adopt any new tuning
+        g5500_thread_update_tuning();
+
         // read fresh positions
         g5500_thread_read_axis_positions();
 
+        // then act on them until the next tick
+        g5500_thread_sleep (g5500_thread_tick());
+    }
 
-        // update stopped detection metrics
-        if (AZ_cmd_active() && ADC_az_now == ADC_az_prev) {
-            // cap at N_EQUAL_STOPPED to avoid overflow if idle for long periods
-            if (ADC_az_n_equal < N_EQUAL_STOPPED)
-                ADC_az_n_equal++;
-        } else {
-            ADC_az_n_equal = 0;
-        }
-        if (EL_cmd_active() && ADC_el_now == ADC_el_prev) {
-            // cap at N_EQUAL_STOPPED to avoid overflow if idle for long periods
-            if (ADC_el_n_equal < N_EQUAL_STOPPED)
-                ADC_el_n_equal++;
-        } else {
-            ADC_el_n_equal = 0;
-        }
-
-
-        // retain ADC values for next loop
-        ADC_az_prev = ADC_az_now;
-        ADC_el_prev = ADC_el_now;
-
-
-        // publish status
-        g5500_thread_capture_state();
-
-        rig_debug(RIG_DEBUG_TRACE, "%s state %d AZ n= %d %4u -> %4u %6.1f %s  EL n= %d %4u -> %4u %6.1f %s\n",
-                __func__, g5500_thread_state,
-                ADC_az_n_equal, ADC_az_now, ADC_az_target, g5500_ADC_to_az (ADC_az_now),
-                    AZ_cmd_cw ? " CW " : (AZ_cmd_ccw ? " CCW" : "STOP"),
-                ADC_el_n_equal, ADC_el_now, ADC_el_target, g5500_ADC_to_el (ADC_el_now),
-                    EL_cmd_up ? " UP " : (EL_cmd_down ? "DOWN" : "STOP"));
-
-
-        // what we do next depends on our state
-        switch (g5500_thread_state) {
-
-        case CTS_STOP:
-
-            // insure no commanded motions
-
-            g5500_thread_az_stop();
-            g5500_thread_el_stop();
+    // lint
+    return (NULL);
 
-            break;
+}
 
-        case CTS_RUN:
+#if defined(STANDALONE_G5500)
 
-            // seek target
+/* single threaded reactor mode, see g5500_direct_set_reactor(): the main thread runs the same ticks as
+ * g5500_control_thread() from a timerfd in its own event loop. Each ADC conversion is started then collected
+ * on a later event rather than slept on, and locked encoders and the IMU are polled on the events between
+ * ticks, so the main thread is never held up by more than one short I2C transfer.
+ */
+static int g5500_reactor;                       // set to run ticks from the main thread
+static int g5500_reactor_fd = -1;               // CLOCK_MONOTONIC timerfd for the next event
+static int g5500_reactor_adc = -1;              // g5500_adc_channels[] converting, -1 between acquisitions
+static double g5500_reactor_wake;               // time of the next tick
 
-            if (AZ_is_stuck()) {
+/* arm g5500_reactor_fd to expire at monotonic time t.
+ */
+static void g5500_reactor_arm (double t)
+{
+    struct itimerspec its;
+    memset (&its, 0, sizeof(its));
+    its.it_value.tv_sec = (time_t) t;
+    its.it_value.tv_nsec = (long) ((t - its.it_value.tv_sec) * 1e9);
+    if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+        its.it_value.tv_nsec = 1;       // all zero would disarm
+
+    if (timerfd_settime (g5500_reactor_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0)
+        rig_debug(RIG_DEBUG_ERR, "%s: timerfd_settime(): %s\n", __func__, strerror(errno));
+}
 
-                // stop and report stuck az axis
-                g5500_thread_az_stop();
-                g5500_thread_state = CTS_ERR_STUCK;
+/* start converting ADC channel i of g5500_adc_channels[].
+ * return 0 if started, -1 if the state is now an error.
+ * N.B. to be called only by g5500_reactor_event()
+ */
+static int g5500_reactor_start_adc (int i)
+{
+    char ynot[1024];
+    int err = startADC_SingleEnded (ADC_I2C_ADDR, g5500_adc_channels[i], ynot);
+    if (err < 0)
+        return (g5500_thread_use_adc (i, err, 0, ynot));
+    g5500_reactor_adc = i;
+    return (0);
+}
 
+/* perform whatever is due when g5500_reactor_fd expires then arm it for the next event.
+ * this is one pass of the g5500_control_thread() loop spread over several calls.
+ * N.B. to be called only by g5500_direct_reactor_run(), holding g5500_tick_lock
+ */
+static void g5500_reactor_event()
+{
+    double now = g5500_now();
+    int tick = 0;
+
+    if (g5500_reactor_adc >= 0) {
+
+        // collect the conversion started by the previous event, then start the next channel
+        int i = g5500_reactor_adc;
+        g5500_reactor_adc = -1;
+        if (g5500_sim_mode != SIM_OFF) {
+            // simulator engaged meanwhile
+            g5500_thread_read_axis_positions();
+            tick = 1;
+        } else {
+            char ynot[1024];
+            uint16_t adc = 0;           // can't pass address of volatile
+            int err = finishADC_SingleEnded (ADC_I2C_ADDR, &adc, ynot);
+            if (g5500_thread_use_adc (i, err, adc, ynot) < 0) {
+                tick = 1;
+            } else if (++i < N_ADC_CHANNELS) {
+                if (g5500_reactor_start_adc (i) < 0)
+                    tick = 1;
             } else {
-
-                // seek az target
-                if (AZ_cmd_ccw) {
-                    if (ADC_az_now <= ADC_az_target)
-                        g5500_thread_az_stop();
-                } else if (AZ_cmd_cw) {
-                    if (ADC_az_now >= ADC_az_target)
-                        g5500_thread_az_stop();
-                } else if (ADC_az_now > ADC_az_target + ADC_AZ_DEADBAND) {
-                    g5500_thread_rotate_ccw();
-                } else if (ADC_az_now + ADC_AZ_DEADBAND < ADC_az_target) {
-                    g5500_thread_rotate_cw();
-                } else {
-                    g5500_thread_az_stop();
-                }
-
+                // fresh
+                g5500_thread_record_sample();
+                tick = 1;
             }
+        }
 
-            if (EL_is_stuck()) {
-
-                // stop and report stuck el axis
-                g5500_thread_el_stop();
-                g5500_thread_state = CTS_ERR_STUCK;
+    } else if (now >= g5500_reactor_wake) {
 
-            } else {
+        // adopt any new tuning then read fresh positions
+        g5500_thread_update_tuning();
+        if (g5500_sim_mode != SIM_OFF) {
+            g5500_thread_read_axis_positions();
+            tick = 1;
+        } else if (g5500_reactor_start_adc (0) < 0)
+            tick = 1;
 
-                // seek el target
-                if (EL_cmd_down) {
-                    if (ADC_el_now <= ADC_el_target)
-                        g5500_thread_el_stop();
-                } else if (EL_cmd_up) {
-                    if (ADC_el_now >= ADC_el_target)
-                        g5500_thread_el_stop();
-                } else if (ADC_el_now > ADC_el_target + ADC_EL_DEADBAND) {
-                    g5500_thread_rotate_down();
-                } else if (ADC_el_now + ADC_EL_DEADBAND < ADC_el_target) {
-                    g5500_thread_rotate_up();
-                } else {
-                    g5500_thread_el_stop();
-                }
+    } else {
 
-            }
+        // between ticks
+        g5500_thread_poll_sensors();
+    }
 
-            break;
+    if (tick) {
+        // act on the positions, with the same heartbeat as g5500_thread_sleep()
+        int usecs = g5500_thread_tick();
+        now = g5500_now();
+        g5500_reactor_wake = now + usecs/1e6;
+        g5500_heartbeat_due = g5500_reactor_wake;
+    }
 
-        case CTS_CAL_START:
+    // next event
+    double t = g5500_reactor_wake;
+    if (g5500_reactor_adc >= 0) {
+        t = now + ADC_SINGLE_ENDED_US/1e6;
+    } else if (enc_az.locked || enc_el.locked || imu_el.locked) {
+        int period = g5500_get_tuning (&g5500_encoder_period);
+        if (period > 0 && period < ENC_PERIOD_MIN)
+            period = ENC_PERIOD_MIN;
+        if (period > 0 && now + period/1e6 < t)
+            t = now + period/1e6;
+    }
+    g5500_reactor_arm (t);
+}
 
-            // start the calibration sequence by moving to axis minima
+/* called by the main thread instead of starting g5500_control_thread() in reactor mode.
+ * return 0 if ok else -1
+ */
+static int g5500_reactor_create()
+{
+    g5500_reactor_fd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (g5500_reactor_fd < 0) {
+        rig_debug(RIG_DEBUG_ERR, "%s: timerfd_create(): %s\n", __func__, strerror(errno));
+        return (-1);
+    }
 
-            rig_debug(RIG_DEBUG_VERBOSE, "%s seeking mins\n", __func__);
+    // initially stop, unless carrying on from another process
+    pthread_mutex_lock (&g5500_tick_lock);
+    if (!g5500_restored) {
+        g5500_thread_state = CTS_STOP;
+        g5500_thread_az_stop();
+        g5500_thread_el_stop();
+    }
+    g5500_reactor_wake = g5500_now();
+    g5500_reactor_arm (g5500_reactor_wake);
+    pthread_mutex_unlock (&g5500_tick_lock);
 
-            g5500_thread_rotate_ccw();
-            g5500_thread_rotate_down();
-            g5500_thread_state = CTS_CAL_SEEK_MINS;
+    return (0);
+}
 
-            // give axes time to start moving to avoid false detection of finding min
-            usleep (MOTION_START_PERIOD);
+#endif // STANDALONE_G5500
 
-            break;
 
-        case CTS_CAL_SEEK_MINS:
 
-            // found axis minima when both stop moving, presumably because of limits
+
+/***********************************************************************************************************
+ *
+ *
+ * hamlib API helper functions
+ *
+ *
+ ***********************************************************************************************************/
 
-            rig_debug(RIG_DEBUG_TRACE, "%s seeking mins ADC az %u el %u\n", __func__, ADC_az_now, ADC_el_now);
 
-            if (AZ_is_stuck() && EL_is_stuck()) {
+/* force all relays idle on behalf of a hung control thread.
+ * N.B. this is the only GPIO access permitted outside the control thread. It is safe because each pin is
+ *      changed with a single register write and the control thread will stop them again anyway when it
+ *      resumes and finds CTS_ERR_WATCHDOG.
+ * N.B. to be called only by g5500_supervisor_thread()
+ */
+static void g5500_supervisor_all_idle()
+{
+    if (g5500_sim_mode == SIM_OFF) {
+        piGPIOsetHiLo (PIN_AZ_CW, PIN_IDLE);
+        piGPIOsetHiLo (PIN_AZ_CCW, PIN_IDLE);
+        piGPIOsetHiLo (PIN_EL_UP, PIN_IDLE);
+        piGPIOsetHiLo (PIN_EL_DOWN, PIN_IDLE);
+    }
 
-                // record ADC at minima
-                ADC_az_min = ADC_az_now;
-                ADC_el_min = ADC_el_now;
+    AZ_cmd_cw = 0;
+    AZ_cmd_ccw = 0;
+    EL_cmd_up = 0;
+    EL_cmd_down = 0;
+}
 
-                // proceed to both maxima
-                g5500_thread_rotate_cw();
-                g5500_thread_rotate_up();
-                g5500_thread_state = CTS_CAL_SEEK_MAXS;
+/* open, feed or close the hardware watchdog as required.
+ * N.B. to be called only by g5500_supervisor_thread()
+ */
+static void g5500_supervisor_hw_watchdog (int healthy)
+{
+    int *fdp = &g5500_hw_watchdog_fd;
 
-                rig_debug(RIG_DEBUG_VERBOSE, "%s seeking maxs\n", __func__);
+    if (g5500_get_tuning (&g5500_hw_watchdog)) {
 
-                // give axes time to start moving to avoid false detection of finding max
-                usleep (MOTION_START_PERIOD);
+        // open if not already, turning the option off again if impossible
+        if (*fdp < 0) {
+            *fdp = open (g5500_hw_watchdog_dev, O_WRONLY);
+            if (*fdp < 0) {
+                fprintf (stderr, "G5500 can not open %s: %s\n", g5500_hw_watchdog_dev, strerror(errno));
+                g5500_set_tuning (&g5500_hw_watchdog, "0", 0, 1);
+                return;
             }
+            rig_debug(RIG_DEBUG_VERBOSE, "%s: opened %s\n", __func__, g5500_hw_watchdog_dev);
+        }
 
-            break;
-
-        case CTS_CAL_SEEK_MAXS:
-
-            // found axis maxima when both stop moving, presumably because of limits
+        // any write feeds it, so withholding them lets it reset the system if the control thread is hung
+        if (healthy && write (*fdp, "\0", 1) != 1)
+            rig_debug(RIG_DEBUG_ERR, "%s: %s: %s\n", __func__, g5500_hw_watchdog_dev, strerror(errno));
 
-            rig_debug(RIG_DEBUG_TRACE, "%s seeking maxs ADC az %u el %u\n", __func__, ADC_az_now, ADC_el_now);
+    } else if (*fdp >= 0) {
 
-            if (AZ_is_stuck() && EL_is_stuck()) {
+        // writing V before closing disarms it
+        if (write (*fdp, "V", 1) != 1)
+            rig_debug(RIG_DEBUG_ERR, "%s: %s: %s\n", __func__, g5500_hw_watchdog_dev, strerror(errno));
+        close (*fdp);
+        *fdp = -1;
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: closed %s\n", __func__, g5500_hw_watchdog_dev);
+    }
+}
 
-                // record ADC at maxima
-                ADC_az_max = ADC_az_now;
-                ADC_el_max = ADC_el_now;
+/* this function is the separate supervisor thread.
+ * it checks the control thread heartbeat every SUPERVISOR_PERIOD and takes over safety if it is late.
+ * the response time to a hung control thread is thus at most watchdog_ms plus SUPERVISOR_PERIOD.
+ */
+static void *g5500_supervisor_thread (void *unused)
+{
+    (void) unused;
 
-                // save new config values
-                g5500_save_cal_file();
+    int tripped = 0;                    // set while the control thread is late
 
-                // stop
-                g5500_thread_az_stop();
-                g5500_thread_el_stop();
-                g5500_thread_state = CTS_STOP;
-            }
+    // forever
+    for(;;) {
 
-            break;
+        // check heartbeat, if there has been one yet
+        double due = g5500_heartbeat_due;
+        double deadline = due + g5500_get_tuning (&g5500_watchdog_ms)/1e3;
+        double now = g5500_now();
+        int late = !g5500_frozen && due > 0 && now > deadline;
 
-        case CTS_ERR_ADC:
-        case CTS_ERR_NOPOWER:
-        case CTS_ERR_STUCK:
+        if (late) {
 
-            // error state, insure no commanded motions
+            // insure idle even if the error was cleared while still late
+            if (!tripped || g5500_thread_state != CTS_ERR_WATCHDOG) {
+                g5500_supervisor_all_idle();
+                g5500_thread_state = CTS_ERR_WATCHDOG;
+            }
 
-            g5500_thread_az_stop();
-            g5500_thread_el_stop();
+            // count and time each new miss
+            if (!tripped) {
+                tripped = 1;
+                g5500_wd_misses++;
+                g5500_wd_response = g5500_now() - deadline;
+                if (g5500_wd_response > g5500_wd_response_max)
+                    g5500_wd_response_max = g5500_wd_response;
+                fprintf (stderr, "G5500 control loop %.3f secs late, relays idle %.3f secs after deadline\n",
+                                    now - due, g5500_wd_response);
+            }
 
-            break;
+        } else if (tripped) {
 
+            // leave the error for the main thread to clear as usual
+            tripped = 0;
+            fprintf (stderr, "G5500 control loop resumed\n");
         }
 
-        // poll delay
-        usleep (THREAD_PERIOD);
+        g5500_supervisor_hw_watchdog (!late);
+
+        usleep (SUPERVISOR_PERIOD);
     }
 
     // lint
     return (NULL);
-
 }
 
-
-
-
-/***********************************************************************************************************
- *
- *
- * hamlib API helper functions
- *
- *
- ***********************************************************************************************************/
-
-
-/* called by the main thread to create and start the g5500 monitor/control thread running.
+/* called by the main thread to create and start the g5500 monitor/control and supervisor threads running,
+ * or in reactor mode the timer in place of the control thread.
  * return 0 if ok else -1
  */
 static int g5500_thread_create()
 {
     pthread_t tid;
-    return (pthread_create (&tid, NULL, g5500_control_thread, NULL) == 0 ? 0 : -1);
+#if defined(STANDALONE_G5500)
+    if (g5500_reactor ? g5500_reactor_create() < 0 : pthread_create (&tid, NULL, g5500_control_thread, NULL) != 0)
+        return (-1);
+#else
+    if (pthread_create (&tid, NULL, g5500_control_thread, NULL) != 0)
+        return (-1);
+#endif
+    return (pthread_create (&tid, NULL, g5500_supervisor_thread, NULL) == 0 ? 0 : -1);
 }
 
 
@@ -920,53 +3391,398 @@ static void g5500_tell_thread_start_calibration()
     case CTS_CAL_START:
     case CTS_CAL_SEEK_MINS:
     case CTS_CAL_SEEK_MAXS:
+    case CTS_CAL_BACKLASH:
         // just let calibration continue
         break;
 
+    case CTS_TUNE_START:
+    case CTS_TUNE_NOISE:
+    case CTS_TUNE_STEP:
+        // already calibrated
+        break;
+
     case CTS_ERR_ADC:
     case CTS_ERR_NOPOWER:
     case CTS_ERR_STUCK:
+    case CTS_ERR_WATCHDOG:
         // don't try anything
         break;
     }
 }
 
-/* called by the main thread to tell controller thread to stop all motion
+/* called by the main thread to tell controller thread to stop all motion
+ */
+static void g5500_tell_thread_all_stop()
+{
+    g5500_thread_state = CTS_STOP;
+}
+
+/* return whether the autotune sequence is in progress
+ */
+static int g5500_is_tuning()
+{
+    return (g5500_thread_state == CTS_TUNE_START || g5500_thread_state == CTS_TUNE_NOISE
+                || g5500_thread_state == CTS_TUNE_STEP);
+}
+
+
+/* check for any g5500_thread_state errors.
+ * return different RIG_ values to at least differentiate them, albeit without any true meaning.
+ * return G5500_RIG_OK if all ok.
+ */
+static int g5500_check_thread_error()
+{
+    // check thread states, use a switch to get a compiler warning in case the CTS_ enum ever changes
+    switch (g5500_thread_state) {
+    case CTS_STOP:
+    case CTS_RUN:
+    case CTS_CAL_START:
+    case CTS_CAL_SEEK_MINS:
+    case CTS_CAL_SEEK_MAXS:
+    case CTS_CAL_BACKLASH:
+    case CTS_TUNE_START:
+    case CTS_TUNE_NOISE:
+    case CTS_TUNE_STEP:
+        // these are fine
+        break;
+    case CTS_ERR_ADC:
+        return G5500_RIG_ERR_ADC;
+    case CTS_ERR_NOPOWER:
+        return G5500_RIG_ERR_NOPOWER;
+    case CTS_ERR_STUCK:
+        return G5500_RIG_ERR_STUCK;
+    case CTS_ERR_WATCHDOG:
+        return G5500_RIG_ERR_WATCHDOG;
+    }
+
+    // ok!
+    return G5500_RIG_OK;
+}
+
+/* return a copy of the latest position sample
+ */
+static ADCSample g5500_get_sample()
+{
+    pthread_mutex_lock (&ADC_sample_lock);
+    ADCSample s = ADC_sample;
+    pthread_mutex_unlock (&ADC_sample_lock);
+
+    return (s);
+}
+
+/* return the age of the current position, secs, or 0 if no position has yet been read.
+ */
+static float g5500_sample_age()
+{
+    ADCSample s = g5500_get_sample();
+    return (s.t > 0 ? g5500_now() - s.t : 0);
+}
+
+/* return adc moved at speed for dt secs, limited to [min,max]
+ */
+static uint16_t g5500_extrapolate_ADC (uint16_t adc, float speed, double dt, uint16_t min, uint16_t max)
+{
+    double x = adc + speed*dt;
+    if (x < min)
+        return (min);
+    if (x > max)
+        return (max);
+    return ((uint16_t) floor (x + 0.5));
+}
+
+/* find the current position from the latest sample, extrapolated to now if enabled.
+ * also return the time of the sample and the axis velocities, in degs/sec, if the pointers are not NULL.
+ * N.B. only valid when ADC_cal_ok
+ */
+static void g5500_sample_position (float *az, float *el, double *tp, float *az_vel, float *el_vel)
+{
+    ADCSample s = g5500_get_sample();
+    uint16_t az_adc = s.az;
+    uint16_t el_adc = s.el;
+
+    if (g5500_get_tuning (&g5500_extrapolate) && s.t > 0) {
+        double dt = g5500_now() - s.t;
+        double max_dt = EXTRAPOLATE_MAX_PERIODS * g5500_get_tuning (&g5500_tuning.thread_period)/1e6;
+        if (dt > max_dt)
+            dt = max_dt;
+        az_adc = g5500_extrapolate_ADC (az_adc, s.az_speed, dt, ADC_az_min, ADC_az_max);
+        el_adc = g5500_extrapolate_ADC (el_adc, s.el_speed, dt, ADC_el_min, ADC_el_max);
+    }
+
+    g5500_ADC_to_sky (az_adc, el_adc, az, el);
+
+    if (tp)
+        *tp = s.t;
+    if (az_vel)
+        *az_vel = ADC_az_max > ADC_az_min
+                        ? s.az_speed * (AZ_MOUNT_MAX - AZ_MOUNT_MIN) / (ADC_az_max - ADC_az_min) : 0;
+    if (el_vel)
+        *el_vel = ADC_el_max > ADC_el_min && g5500_sim_mode != SIM_AZONLY
+                        ? s.el_speed * (el_mount_max - EL_MOUNT_MIN) / (ADC_el_max - ADC_el_min) : 0;
+}
+
+/* return G5500_RIG_ERR_STALE if the current position is older than one polling period plus stale_ms,
+ * else G5500_RIG_OK.
+ */
+static int g5500_check_stale()
+{
+    double period = g5500_get_tuning (&g5500_tuning.thread_period)/1e6;
+    if (g5500_sample_age() > period + g5500_get_tuning (&g5500_stale_ms)/1e3)
+        return G5500_RIG_ERR_STALE;
+    return G5500_RIG_OK;
+}
+
+#if defined(STANDALONE_G5500)
+
+/* return the name of the current control thread state
+ */
+static const char *g5500_thread_state_name()
+{
+    // use a switch so compiler will warn if later change the number of state values
+    switch (g5500_thread_state) {
+    case CTS_STOP:              return ("Stopped");
+    case CTS_RUN:               return ("Running");
+    case CTS_CAL_START:         return ("Calibration starting");
+    case CTS_CAL_SEEK_MINS:     return ("Calibration seeking minima");
+    case CTS_CAL_SEEK_MAXS:     return ("Calibration seeking maxima");
+    case CTS_CAL_BACKLASH:      return ("Calibration measuring backlash");
+    case CTS_TUNE_START:        return ("Autotune starting");
+    case CTS_TUNE_NOISE:        return ("Autotune measuring noise");
+    case CTS_TUNE_STEP:         return ("Autotune stepping");
+    case CTS_ERR_ADC:           return ("ADC error");
+    case CTS_ERR_NOPOWER:       return ("No power");
+    case CTS_ERR_STUCK:         return ("Stuck");
+    case CTS_ERR_WATCHDOG:      return ("Control loop hung");
+    }
+    return ("Unknown");
+}
+
+
+/* everything needed to predict the motion of one axis, all positions in ADC counts
+ */
+typedef struct {
+    int now, target;                    // current and target position
+    int dir;                            // commanded direction: -1 ccw/down, 0 stopped, 1 cw/up
+    int via;                            // overshoot point in progress, or -1 if none
+    int deadband;                       // controller deadband
+    int overshoot;                      // approach overshoot distance
+    int min, max;                       // calibrated limits
+    ApproachType approach;              // approach policy
+    float speed;                        // counts per second
+    float latency;                      // secs from relay closing until moving
+    float coast;                        // secs from relay opening until at rest
+} G5500AxisModel;
+
+
+/* predict the secs until an axis reaches its target, and the secs until it is at rest in *settle.
+ * the control thread acts on a new situation at its next poll, on average half a period away, and takes a
+ * full period after stopping before it starts the return leg of an overshoot.
+ */
+static float g5500_predict_axis (const G5500AxisModel *mp, float *settle)
+{
+    float period = THREAD_PERIOD/1e6;
+    float latency = mp->latency;
+    float coast = mp->coast;
+    int pos = mp->now;
+    int via = mp->via;
+    float t = 0;
+
+    // can't predict without a speed
+    if (mp->speed <= 0) {
+        *settle = 0;
+        return (0);
+    }
+
+    if (mp->dir != 0) {
+
+        // finish the current leg if still heading for it
+        int goal = via >= 0 ? via : mp->target;
+        if ((goal - pos) * mp->dir > 0) {
+            t += abs(goal - pos) / mp->speed;
+            pos = goal;
+            if (via < 0) {
+                *settle = t + period/2 + coast;
+                return (t);
+            }
+            via = -1;
+        } else {
+            // moving away from a new target, must stop first
+            via = -1;
+        }
+
+        // stopped at the next poll, considered afresh at the one after
+        t += 1.5*period;
+
+    } else {
+
+        // already there?
+        if (abs(mp->target - pos) <= mp->deadband) {
+            *settle = 0;
+            return (0);
+        }
+
+        // start at next poll
+        t += period/2;
+    }
+
+    // add an overshoot leg if approaching from the wrong side
+    if (mp->approach == APPROACH_INCREASING && pos > mp->target + mp->deadband)
+        via = mp->target > mp->min + mp->overshoot ? mp->target - mp->overshoot : mp->min;
+    else if (mp->approach == APPROACH_DECREASING && pos + mp->deadband < mp->target)
+        via = mp->target + mp->overshoot < mp->max ? mp->target + mp->overshoot : mp->max;
+    if (via >= 0) {
+        t += latency + abs(via - pos) / mp->speed + 1.5*period;
+        pos = via;
+    }
+
+    // final leg
+    t += latency + abs(mp->target - pos) / mp->speed;
+    *settle = t + period/2 + coast;
+    return (t);
+}
+
+
+/* predict the secs until each axis reaches its target and until both are at rest.
+ * all 0 unless running.
+ */
+static void g5500_predict_eta (float *az_eta, float *el_eta, float *settle)
+{
+    G5500AxisModel az, el;
+    float az_settle, el_settle;
+
+    if (g5500_thread_state != CTS_RUN || !ADC_cal_ok) {
+        *az_eta = *el_eta = *settle = 0;
+        return;
+    }
+
+    az.now = ADC_az_now;
+    az.target = ADC_az_target;
+    az.dir = AZ_cmd_cw ? 1 : (AZ_cmd_ccw ? -1 : 0);
+    az.via = AZ_via_active ? ADC_az_via : -1;
+    az.deadband = ADC_AZ_DEADBAND;
+    az.overshoot = AZ_overshoot();
+    az.min = ADC_az_min;
+    az.max = ADC_az_max;
+    az.approach = az_approach;
+    az.speed = ADC_az_speed > 0 ? ADC_az_speed
+                : AZ_NOMINAL_SPEED * (ADC_az_max - ADC_az_min) / (AZ_MOUNT_MAX - AZ_MOUNT_MIN);
+    az.latency = g5500_sim_mode == SIM_OFF ? MOTOR_START_LATENCY : sim_profile.az.latency;
+    az.coast = g5500_sim_mode == SIM_OFF ? MOTOR_COAST_TIME : sim_profile.az.coast;
+
+    el.now = ADC_el_now;
+    el.target = ADC_el_target;
+    el.dir = EL_cmd_up ? 1 : (EL_cmd_down ? -1 : 0);
+    el.via = EL_via_active ? ADC_el_via : -1;
+    el.deadband = ADC_EL_DEADBAND;
+    el.overshoot = EL_overshoot();
+    el.min = ADC_el_min;
+    el.max = ADC_el_max;
+    el.approach = el_approach;
+    el.speed = ADC_el_speed > 0 ? ADC_el_speed
+                : EL_NOMINAL_SPEED * (ADC_el_max - ADC_el_min) / (el_mount_max - EL_MOUNT_MIN);
+    el.latency = g5500_sim_mode == SIM_OFF ? MOTOR_START_LATENCY : sim_profile.el.latency;
+    el.coast = g5500_sim_mode == SIM_OFF ? MOTOR_COAST_TIME : sim_profile.el.coast;
+
+    *az_eta = g5500_predict_axis (&az, &az_settle);
+    *el_eta = g5500_predict_axis (&el, &el_settle);
+    *settle = az_settle > el_settle ? az_settle : el_settle;
+}
+
+
+#define PRESIM_MAX_SECS         7200    // longest window that may be pre-simulated
+
+
+/* one axis of the mount in a pass pre-simulation, see g5500_direct_presim(), all positions in ADC counts
+ */
+typedef struct {
+    G5500SimAxis sim;                   // private model of the axis
+    int now, target, via;               // current, target and overshoot positions
+    int via_active;                     // set while seeking via before target
+    int cmd;                            // commanded direction: -1 ccw/down, 0 stopped, 1 cw/up
+    int min, max;                       // calibrated limits
+    float span;                         // degs from min to max
+    int deadband, stop_lead, overshoot; // controller tuning
+    ApproachType approach;              // approach policy
+    G5500Duty duty;                     // motor heat
+} G5500PresimAxis;
+
+
+/* choose the relay of a pre-simulated axis for its position now as the control thread would in CTS_RUN.
+ * tracking is set when following a G5500TrackFunc, which batches corrections as the motor warms.
+ * N.B. keep in step with g5500_control_thread()
+ */
+static void g5500_presim_seek (G5500PresimAxis *ap, int tracking)
+{
+    // rest the motor, the target waits
+    if (ap->duty.cooling) {
+        ap->cmd = 0;
+        return;
+    }
+
+    int goal = ap->via_active ? ap->via : ap->target;
+    int band = ap->deadband + (tracking ? g5500_duty_band (&ap->duty, ap->min, ap->max, ap->span) : 0);
+    if (ap->cmd != 0) {
+        if ((ap->cmd < 0 && ap->now <= goal + ap->stop_lead) || (ap->cmd > 0 && ap->now + ap->stop_lead >= goal)) {
+            ap->cmd = 0;
+            ap->via_active = 0;
+        }
+    } else if (ap->now > goal + band) {
+        if (!ap->via_active && ap->approach == APPROACH_INCREASING) {
+            ap->via = ap->target > ap->min + ap->overshoot ? ap->target - ap->overshoot : ap->min;
+            ap->via_active = 1;
+        }
+        ap->cmd = -1;
+    } else if (ap->now + band < goal) {
+        if (!ap->via_active && ap->approach == APPROACH_DECREASING) {
+            ap->via = ap->target + ap->overshoot < ap->max ? ap->target + ap->overshoot : ap->max;
+            ap->via_active = 1;
+        }
+        ap->cmd = 1;
+    } else {
+        ap->cmd = 0;
+        ap->via_active = 0;
+    }
+}
+
+/* fill *pp with how the mount responds: the live model when simulating, else the profile fitted to the
+ * real mount by g5500fit if there is one, else the calibrated speeds and nominal motor timing.
  */
-static void g5500_tell_thread_all_stop()
+static void g5500_presim_profile (G5500SimProfile *pp)
 {
-    g5500_thread_state = CTS_STOP;
-}
+    if (g5500_sim_mode != SIM_OFF) {
+        pthread_mutex_lock (&g5500_tick_lock);
+        *pp = sim_profile;
+        pthread_mutex_unlock (&g5500_tick_lock);
+        return;
+    }
 
+    static char *path;
+    const char *filename = g5500_home_path (g5500_sim_file_name, &path);
+    char ynot[1024];
+    if (filename && access (filename, R_OK) == 0 && g5500SimReadProfile (filename, pp, ynot) == 0)
+        return;
 
-/* check for any g5500_thread_state errors.
- * return different RIG_ values to at least differentiate them, albeit without any true meaning.
- * return G5500_RIG_OK if all ok.
+    memset (pp, 0, sizeof(*pp));
+    pp->az.speed_up = pp->az.speed_down = ADC_az_speed > 0 && ADC_az_max > ADC_az_min
+                ? ADC_az_speed * (AZ_MOUNT_MAX - AZ_MOUNT_MIN) / (ADC_az_max - ADC_az_min) : AZ_NOMINAL_SPEED;
+    pp->el.speed_up = pp->el.speed_down = ADC_el_speed > 0 && ADC_el_max > ADC_el_min
+                ? ADC_el_speed * (el_mount_max - EL_MOUNT_MIN) / (ADC_el_max - ADC_el_min) : EL_NOMINAL_SPEED;
+    pp->az.latency = pp->el.latency = MOTOR_START_LATENCY;
+    pp->az.coast = pp->el.coast = MOTOR_COAST_TIME;
+}
+
+/* return the angle between two sky positions, degs
  */
-static int g5500_check_thread_error()
+static float g5500_sky_sep (float az0, float el0, float az1, float el1)
 {
-    // check thread states, use a switch to get a compiler warning in case the CTS_ enum ever changes
-    switch (g5500_thread_state) {
-    case CTS_STOP:
-    case CTS_RUN:
-    case CTS_CAL_START:
-    case CTS_CAL_SEEK_MINS:
-    case CTS_CAL_SEEK_MAXS:
-        // these are fine
-        break;
-    case CTS_ERR_ADC:
-        return G5500_RIG_ERR_ADC;
-    case CTS_ERR_NOPOWER:
-        return G5500_RIG_ERR_NOPOWER;
-    case CTS_ERR_STUCK:
-        return G5500_RIG_ERR_STUCK;
-        break;
-    }
-
-    // ok!
-    return G5500_RIG_OK;
+    double c = sin (el0*M_PI/180) * sin (el1*M_PI/180)
+                + cos (el0*M_PI/180) * cos (el1*M_PI/180) * cos ((az1 - az0)*M_PI/180);
+    return (acos (c > 1 ? 1 : (c < -1 ? -1 : c)) * 180 / M_PI);
 }
 
+#endif // STANDALONE_G5500
+
+
 /* called by hamlib API functions that require calibration.
  */
 static int g5500_cal_ready()
@@ -979,6 +3795,10 @@ static int g5500_cal_ready()
         return err;
     }
 
+    // don't interrupt autotune
+    if (g5500_is_tuning())
+        return G5500_RIG_CALIBRATING;
+
     // cal ok if already set or can be set from a valid file
     if (ADC_cal_ok || g5500_read_cal_file() == 0) {
         return G5500_RIG_OK;
@@ -991,6 +3811,20 @@ static int g5500_cal_ready()
     return G5500_RIG_CALIBRATING;
 }
 
+/* called by the main thread to start the autotune sequence, which requires calibration.
+ */
+static int g5500_tell_thread_start_autotune()
+{
+    rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
+
+    int err = g5500_cal_ready();
+    if (err != G5500_RIG_OK)
+        return err;
+
+    g5500_thread_state = CTS_TUNE_START;
+    return G5500_RIG_OK;
+}
+
 
 
 /***********************************************************************************************************
@@ -1016,6 +3850,18 @@ static int g5500_direct_rot_init (ROT *rot)
     }
     my_rot_state = &rot->state;
 
+    #if !defined(STANDALONE_G5500)
+
+        // share the mount with a running daemon if there is one
+        switch (g5500_daemon_attach()) {
+        case 0:
+            return G5500_RIG_OK;
+        case -2:
+            return G5500_RIG_ERR_GPIO;
+        }
+
+    #endif
+
     #if defined(ISA_PI)
 
         rig_debug(RIG_DEBUG_VERBOSE, "RPi %s called\n", __func__);
@@ -1035,6 +3881,9 @@ static int g5500_direct_rot_init (ROT *rot)
             return G5500_RIG_ERR_ADC;
         }
 
+        // the bus may be shared with other processes but control must not wait on them
+        piI2CSetUrgent (1);
+
     #else
 
         rig_debug(RIG_DEBUG_VERBOSE, "!RPi %s called\n", __func__);
@@ -1044,6 +3893,17 @@ static int g5500_direct_rot_init (ROT *rot)
 
     #endif
 
+    // restore any pointing model and saved configuration parameters
+    g5500_read_pointing_file();
+    g5500_read_conf_file();
+
+    #if defined(STANDALONE_G5500)
+
+        // carry on from another process if it left us its state
+        g5500_apply_snapshot();
+
+    #endif
+
     // start control thread
     if (g5500_thread_create() < 0)
         return G5500_RIG_ERR_INTERNAL;
@@ -1064,6 +3924,10 @@ static int g5500_direct_set_position (ROT *rot, azimuth_t azimuth, elevation_t e
     // not used
     (void) rot;
 
+    G5500_DAEMON_FORWARD (g5500ClientSetPos (g5500_daemon, azimuth, elevation));
+
+    G5500_TRACK_END();
+
     // require or start cal
     int err = g5500_cal_ready();
     if (err != G5500_RIG_OK)
@@ -1083,13 +3947,37 @@ static int g5500_direct_set_position (ROT *rot, azimuth_t azimuth, elevation_t e
 
 
     // update control thread targets and go
-    ADC_az_target = g5500_az_to_ADC (azimuth);
-    ADC_el_target = g5500_el_to_ADC (elevation);
+    uint16_t az_target, el_target;
+    g5500_sky_to_ADC (azimuth, elevation, &az_target, &el_target);
+    ADC_az_target = az_target;
+    ADC_el_target = el_target;
+    AZ_via_active = 0;
+    EL_via_active = 0;
     g5500_thread_state = CTS_RUN;
 
     return G5500_RIG_OK;
 }
 
+/* check whether a current position is available.
+ * return G5500_RIG_OK if so, else the reason why not.
+ */
+static int g5500_position_ready()
+{
+    // check for pending thread errors
+    int err = g5500_check_thread_error();
+    if (err != G5500_RIG_OK)
+        return err;
+
+    // require or start cal
+    err = g5500_cal_ready();
+    if (err != G5500_RIG_OK)
+        return err;
+
+    // never report an old position as current
+    return (g5500_check_stale());
+}
+
+
 /*
  * Get position
  */
@@ -1100,23 +3988,17 @@ static int g5500_direct_get_position (ROT *rot, azimuth_t *azimuth, elevation_t
     // not used
     (void) rot;
 
-    // check for pending thread errors
-    int err = g5500_check_thread_error();
-    if (err != G5500_RIG_OK)
-    {
-        return err;
-    }
+    G5500_DAEMON_FORWARD (g5500ClientGetPos (g5500_daemon, azimuth, elevation));
 
-    // require or start cal
-    err = g5500_cal_ready();
+    // check we have a position to report
+    int err = g5500_position_ready();
     if (err != G5500_RIG_OK)
     {
         return err;
     }
 
     // return current values
-    *azimuth = g5500_ADC_to_az (ADC_az_now);
-    *elevation = g5500_ADC_to_el (ADC_el_now);
+    g5500_sample_position (azimuth, elevation, NULL, NULL, NULL);
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s returns %g, %g\n", __func__, *azimuth, *elevation);
 
@@ -1136,10 +4018,57 @@ static const char *g5500_direct_get_info(ROT *rot)
     // not used
     (void) rot;
 
+    G5500_DAEMON_FORWARD (g5500_daemon_get_info());
+
     return ("Yaesu G5500 on RPi");
 }
 
 
+/* configure the encoder *ep from the spec in val.
+ * a different encoder must be aligned by a new calibration before it is used.
+ */
+static int g5500_set_encoder (G5500Encoder *ep, const char *val)
+{
+    EncoderType type;
+    uint8_t addr;
+    if (encoderParse (val, &type, &addr) < 0)
+        return G5500_RIG_ERR_BADARGS;
+    if (type == ep->type && addr == ep->addr)
+        return G5500_RIG_OK;
+
+    pthread_mutex_lock (&g5500_tick_lock);
+    memset (ep, 0, sizeof(*ep));
+    ep->type = type;
+    ep->addr = addr;
+    ep->cal_min = INT32_MIN;
+    pthread_mutex_unlock (&g5500_tick_lock);
+
+    return G5500_RIG_OK;
+}
+
+/* configure the IMU *ip from the spec in val.
+ * a different IMU must be aligned by a new calibration before it is used.
+ */
+static int g5500_set_imu (G5500IMU *ip, const char *val)
+{
+    IMUType type;
+    uint8_t addr;
+    char axis;
+    if (imuParse (val, &type, &addr, &axis) < 0)
+        return G5500_RIG_ERR_BADARGS;
+    if (type == ip->type && addr == ip->addr && axis == ip->axis)
+        return G5500_RIG_OK;
+
+    pthread_mutex_lock (&g5500_tick_lock);
+    memset (ip, 0, sizeof(*ip));
+    ip->type = type;
+    ip->addr = addr;
+    ip->axis = axis;
+    pthread_mutex_unlock (&g5500_tick_lock);
+
+    return G5500_RIG_OK;
+}
+
 /* 
  * Set a g5500_direct configuration parameter
  */
@@ -1150,6 +4079,8 @@ static int g5500_direct_set_conf (ROT *rot, token_t token, const char *val)
     // not used
     (void) rot;
 
+    G5500_DAEMON_FORWARD (g5500_daemon_set_conf (token, val));
+
     int tmp;
 
     switch (token) {
@@ -1160,6 +4091,128 @@ static int g5500_direct_set_conf (ROT *rot, token_t token, const char *val)
         g5500_sim_mode_set (tmp);
         break;
 
+    case TOK_AZ_APPROACH:
+        // set az approach direction policy
+        tmp = atoi (val);
+        if (tmp < APPROACH_ANY || tmp > APPROACH_DECREASING)
+            return G5500_RIG_ERR_BADARGS;
+        az_approach = (ApproachType) tmp;
+        break;
+
+    case TOK_EL_APPROACH:
+        // set el approach direction policy
+        tmp = atoi (val);
+        if (tmp < APPROACH_ANY || tmp > APPROACH_DECREASING)
+            return G5500_RIG_ERR_BADARGS;
+        el_approach = (ApproachType) tmp;
+        break;
+
+    case TOK_THREAD_PERIOD:
+        return g5500_set_tuning (&g5500_tuning_next.thread_period, val, THREAD_PERIOD_MIN, THREAD_PERIOD_MAX);
+
+    case TOK_MOTION_START_PERIOD:
+        return g5500_set_tuning (&g5500_tuning_next.motion_start_period, val, MOTION_START_MIN, MOTION_START_MAX);
+
+    case TOK_AZ_DEADBAND:
+        return g5500_set_tuning (&g5500_tuning_next.az_deadband, val, DEADBAND_MIN, DEADBAND_MAX);
+
+    case TOK_EL_DEADBAND:
+        return g5500_set_tuning (&g5500_tuning_next.el_deadband, val, DEADBAND_MIN, DEADBAND_MAX);
+
+    case TOK_N_EQUAL_STOPPED:
+        return g5500_set_tuning (&g5500_tuning_next.n_equal_stopped, val, N_EQUAL_STOPPED_MIN, N_EQUAL_STOPPED_MAX);
+
+    case TOK_MIN_POK:
+        return g5500_set_tuning (&g5500_tuning_next.min_pok, val, MIN_POK_MIN, MIN_POK_MAX);
+
+    case TOK_AZ_STOP_LEAD:
+        return g5500_set_tuning (&g5500_tuning_next.az_stop_lead, val, STOP_LEAD_MIN, STOP_LEAD_MAX);
+
+    case TOK_EL_STOP_LEAD:
+        return g5500_set_tuning (&g5500_tuning_next.el_stop_lead, val, STOP_LEAD_MIN, STOP_LEAD_MAX);
+
+    case TOK_AUTOTUNE:
+        // 1 starts the autotune sequence, 0 aborts it
+        if (atoi (val) == 0) {
+            if (g5500_is_tuning())
+                g5500_tell_thread_all_stop();
+            break;
+        }
+        return g5500_tell_thread_start_autotune();
+
+    case TOK_WATCHDOG_MS:
+        return g5500_set_tuning (&g5500_watchdog_ms, val, WATCHDOG_MS_MIN, WATCHDOG_MS_MAX);
+
+    case TOK_STALE_MS:
+        return g5500_set_tuning (&g5500_stale_ms, val, STALE_MS_MIN, STALE_MS_MAX);
+
+    case TOK_HW_WATCHDOG:
+        return g5500_set_tuning (&g5500_hw_watchdog, val, 0, 1);
+
+    case TOK_EXTRAPOLATE:
+        return g5500_set_tuning (&g5500_extrapolate, val, 0, 1);
+
+    case TOK_AZ_ENCODER:
+        return g5500_set_encoder (&enc_az, val);
+
+    case TOK_EL_ENCODER:
+        return g5500_set_encoder (&enc_el, val);
+
+    case TOK_ENCODER_PERIOD:
+        return g5500_set_tuning (&g5500_encoder_period, val, 0, THREAD_PERIOD_MAX);
+
+    case TOK_EL_IMU:
+        return g5500_set_imu (&imu_el, val);
+
+    case TOK_MOTOR_DUTY:
+        return g5500_set_tuning (&g5500_motor_duty, val, 0, 100);
+
+    case TOK_MOTOR_RUN:
+        return g5500_set_tuning (&g5500_motor_run, val, MOTOR_RUN_MIN, MOTOR_RUN_MAX);
+
+    case TOK_POINTING_MODEL: {
+        // set all terms at once
+        G5500PointingModel m;
+        if (sscanf (val, "%f,%f,%f,%f,%f", &m.ia, &m.ie, &m.an, &m.aw, &m.npae) != PM_N_TERMS
+                                || !g5500_pm_model_ok (&m))
+            return G5500_RIG_ERR_BADARGS;
+        g5500_pm_set_model (&m);
+        g5500_save_pointing_file();
+        break;
+        }
+
+    case TOK_POINTING_ADD:
+        // record a sighting of a known az,el at the current mount position
+        return g5500_pm_add_sighting (val);
+
+    case TOK_POINTING_FIT: {
+        // any non-zero value fits the model to the sightings and adopts it
+        G5500PointingModel m;
+        if (atoi (val) == 0)
+            break;
+        if (g5500_pm_fit (&m, &pm_rms_before, &pm_rms_after) < 0)
+            return G5500_RIG_ERR_BADARGS;
+        g5500_pm_set_model (&m);
+        g5500_save_pointing_file();
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: fit %d sightings, rms %g -> %g degs\n", __func__,
+                    pm_n_sightings, pm_rms_before, pm_rms_after);
+        break;
+        }
+
+    case TOK_POINTING_CLEAR:
+        // any non-zero value discards all sightings, the model remains
+        if (atoi (val) != 0) {
+            pm_n_sightings = 0;
+            g5500_save_pointing_file();
+        }
+        break;
+
+    case TOK_SAVE_CONF:
+        // any non-zero value saves all persistent parameters
+        if (atoi (val) != 0)
+            g5500_save_conf_file();
+        break;
+
     default:
         return G5500_RIG_ERR_BADARGS;
     }
@@ -1178,12 +4231,119 @@ static int g5500_direct_get_conf (ROT *rot, token_t token, char *val)
     // not used
     (void) rot;
 
+    G5500_DAEMON_FORWARD (g5500_daemon_get_conf (token, val, G5500_CONF_LEN));
+
     switch (token) {
 
     case TOK_SIMULATOR:
         sprintf (val, "%d", (int)g5500_sim_mode);
         break;
 
+    case TOK_AZ_APPROACH:
+        sprintf (val, "%d", (int)az_approach);
+        break;
+
+    case TOK_EL_APPROACH:
+        sprintf (val, "%d", (int)el_approach);
+        break;
+
+    case TOK_THREAD_PERIOD:
+        sprintf (val, "%d", g5500_get_tuning (&g5500_tuning_next.thread_period));
+        break;
+
+    case TOK_MOTION_START_PERIOD:
+        sprintf (val, "%d", g5500_get_tuning (&g5500_tuning_next.motion_start_period));
+        break;
+
+    case TOK_AZ_DEADBAND:
+        sprintf (val, "%d", g5500_get_tuning (&g5500_tuning_next.az_deadband));
+        break;
+
+    case TOK_EL_DEADBAND:
+        sprintf (val, "%d", g5500_get_tuning (&g5500_tuning_next.el_deadband));
+        break;
+
+    case TOK_N_EQUAL_STOPPED:
+        sprintf (val, "%d", g5500_get_tuning (&g5500_tuning_next.n_equal_stopped));
+        break;
+
+    case TOK_MIN_POK:
+        sprintf (val, "%d", g5500_get_tuning (&g5500_tuning_next.min_pok));
+        break;
+
+    case TOK_AZ_STOP_LEAD:
+        sprintf (val, "%d", g5500_get_tuning (&g5500_tuning_next.az_stop_lead));
+        break;
+
+    case TOK_EL_STOP_LEAD:
+        sprintf (val, "%d", g5500_get_tuning (&g5500_tuning_next.el_stop_lead));
+        break;
+
+    case TOK_AUTOTUNE:
+        sprintf (val, "%d", g5500_is_tuning());
+        break;
+
+    case TOK_WATCHDOG_MS:
+        sprintf (val, "%d", g5500_get_tuning (&g5500_watchdog_ms));
+        break;
+
+    case TOK_STALE_MS:
+        sprintf (val, "%d", g5500_get_tuning (&g5500_stale_ms));
+        break;
+
+    case TOK_HW_WATCHDOG:
+        sprintf (val, "%d", g5500_get_tuning (&g5500_hw_watchdog));
+        break;
+
+    case TOK_EXTRAPOLATE:
+        sprintf (val, "%d", g5500_get_tuning (&g5500_extrapolate));
+        break;
+
+    case TOK_AZ_ENCODER:
+        encoderFormat (enc_az.type, enc_az.addr, val);
+        break;
+
+    case TOK_EL_ENCODER:
+        encoderFormat (enc_el.type, enc_el.addr, val);
+        break;
+
+    case TOK_ENCODER_PERIOD:
+        sprintf (val, "%d", g5500_get_tuning (&g5500_encoder_period));
+        break;
+
+    case TOK_EL_IMU:
+        imuFormat (imu_el.type, imu_el.addr, imu_el.axis, val);
+        break;
+
+    case TOK_MOTOR_DUTY:
+        sprintf (val, "%d", g5500_get_tuning (&g5500_motor_duty));
+        break;
+
+    case TOK_MOTOR_RUN:
+        sprintf (val, "%d", g5500_get_tuning (&g5500_motor_run));
+        break;
+
+    case TOK_POINTING_MODEL:
+        snprintf (val, G5500_CONF_LEN, "%.5f,%.5f,%.5f,%.5f,%.5f", pm_model.ia, pm_model.ie, pm_model.an,
+                                pm_model.aw, pm_model.npae);
+        break;
+
+    case TOK_POINTING_ADD:
+        sprintf (val, "%d", pm_n_sightings);
+        break;
+
+    case TOK_POINTING_FIT:
+        snprintf (val, G5500_CONF_LEN, "%.4f,%.4f", pm_rms_before, pm_rms_after);
+        break;
+
+    case TOK_POINTING_CLEAR:
+        strcpy (val, "0");
+        break;
+
+    case TOK_SAVE_CONF:
+        strcpy (val, "0");
+        break;
+
     default:
         return G5500_RIG_ERR_BADARGS;
     }
@@ -1207,6 +4367,10 @@ static int g5500_direct_move (ROT *rot, int direction, int speed)
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s (%d, %d) called\n", __func__, direction, speed);
 
+    G5500_DAEMON_FORWARD (g5500ClientMove (g5500_daemon, direction, speed));
+
+    G5500_TRACK_END();
+
     // get ADC calibration values or start the cal procedure
     int err = g5500_cal_ready();
     if (err != G5500_RIG_OK)
@@ -1218,21 +4382,25 @@ static int g5500_direct_move (ROT *rot, int direction, int speed)
     {
     case ROT_MOVE_UP:       /* Elevation increase */
         ADC_el_target = ADC_el_max;
+        EL_via_active = 0;
         g5500_thread_state = CTS_RUN;
         break;
 
     case ROT_MOVE_DOWN:     /* Elevation decrease */
         ADC_el_target = ADC_el_min;
+        EL_via_active = 0;
         g5500_thread_state = CTS_RUN;
         break;
 
     case ROT_MOVE_LEFT:     /* Azimuth decrease */
         ADC_az_target = ADC_az_min;
+        AZ_via_active = 0;
         g5500_thread_state = CTS_RUN;
         break;
 
     case ROT_MOVE_RIGHT:    /* Azimuth increase */
         ADC_az_target = ADC_az_max;
+        AZ_via_active = 0;
         g5500_thread_state = CTS_RUN;
         break;
 
@@ -1256,6 +4424,10 @@ static int g5500_direct_park (ROT *rot)
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
+    G5500_DAEMON_FORWARD (g5500ClientPark (g5500_daemon));
+
+    G5500_TRACK_END();
+
     // get ADC calibration values or start the cal procedure
     int err = g5500_cal_ready();
     if (err != G5500_RIG_OK)
@@ -1265,6 +4437,8 @@ static int g5500_direct_park (ROT *rot)
 
     ADC_az_target = g5500_az_to_ADC (AZ_MOUNT_PARK);
     ADC_el_target = g5500_el_to_ADC (EL_MOUNT_PARK);
+    AZ_via_active = 0;
+    EL_via_active = 0;
     g5500_thread_state = CTS_RUN;
 
     return G5500_RIG_OK;
@@ -1283,6 +4457,10 @@ static int g5500_direct_stop(ROT *rot)
     // not used
     (void) rot;
 
+    G5500_DAEMON_FORWARD (g5500ClientStop (g5500_daemon));
+
+    G5500_TRACK_END();
+
     // inform thread
     g5500_tell_thread_all_stop();
 
@@ -1296,8 +4474,112 @@ static int g5500_direct_stop(ROT *rot)
 static const struct confparams g5500_direct_conf_params[] =
 {
     {
-        TOK_SIMULATOR, "simulator", "Simulate mount", "Simulate mount",
-        NULL, RIG_CONF_NUMERIC, { .n.min = 0, .n.max = 3, .n.step = 1 }
+        TOK_SIMULATOR, "simulator", "Simulate mount", "Simulate mount",
+        NULL, RIG_CONF_NUMERIC, { .n.min = 0, .n.max = 3, .n.step = 1 }
+    },
+    {
+        TOK_AZ_APPROACH, "az_approach", "Az approach", "Final az direction: 0 any, 1 cw, 2 ccw",
+        "0", RIG_CONF_NUMERIC, { .n.min = 0, .n.max = 2, .n.step = 1 }
+    },
+    {
+        TOK_EL_APPROACH, "el_approach", "El approach", "Final el direction: 0 any, 1 up, 2 down",
+        "0", RIG_CONF_NUMERIC, { .n.min = 0, .n.max = 2, .n.step = 1 }
+    },
+    {
+        TOK_THREAD_PERIOD, "thread_period", "Control period", "Control loop polling period, usecs",
+        "200000", RIG_CONF_NUMERIC, { .n.min = THREAD_PERIOD_MIN, .n.max = THREAD_PERIOD_MAX, .n.step = 1000 }
+    },
+    {
+        TOK_MOTION_START_PERIOD, "motion_start_period", "Motion start", "Time allowed for axes to start moving, usecs",
+        "1000000", RIG_CONF_NUMERIC, { .n.min = MOTION_START_MIN, .n.max = MOTION_START_MAX, .n.step = 1000 }
+    },
+    {
+        TOK_AZ_DEADBAND, "az_deadband", "Az deadband", "Az ADC error considered on target",
+        "50", RIG_CONF_NUMERIC, { .n.min = DEADBAND_MIN, .n.max = DEADBAND_MAX, .n.step = 1 }
+    },
+    {
+        TOK_EL_DEADBAND, "el_deadband", "El deadband", "El ADC error considered on target",
+        "50", RIG_CONF_NUMERIC, { .n.min = DEADBAND_MIN, .n.max = DEADBAND_MAX, .n.step = 1 }
+    },
+    {
+        TOK_N_EQUAL_STOPPED, "n_equal_stopped", "Stopped count", "Equal consecutive ADC readings considered stopped",
+        "4", RIG_CONF_NUMERIC, { .n.min = N_EQUAL_STOPPED_MIN, .n.max = N_EQUAL_STOPPED_MAX, .n.step = 1 }
+    },
+    {
+        TOK_MIN_POK, "min_pok", "Min power ADC", "Minimum power ADC when power ok",
+        "1000", RIG_CONF_NUMERIC, { .n.min = MIN_POK_MIN, .n.max = MIN_POK_MAX, .n.step = 1 }
+    },
+    {
+        TOK_AZ_STOP_LEAD, "az_stop_lead", "Az stop lead", "Az ADC short of goal at which to stop to allow for coast",
+        "0", RIG_CONF_NUMERIC, { .n.min = STOP_LEAD_MIN, .n.max = STOP_LEAD_MAX, .n.step = 1 }
+    },
+    {
+        TOK_EL_STOP_LEAD, "el_stop_lead", "El stop lead", "El ADC short of goal at which to stop to allow for coast",
+        "0", RIG_CONF_NUMERIC, { .n.min = STOP_LEAD_MIN, .n.max = STOP_LEAD_MAX, .n.step = 1 }
+    },
+    {
+        TOK_AUTOTUNE, "autotune", "Autotune", "Set 1 to measure the mount and derive deadbands and stop leads",
+        "0", RIG_CONF_NUMERIC, { .n.min = 0, .n.max = 1, .n.step = 1 }
+    },
+    {
+        TOK_WATCHDOG_MS, "watchdog_ms", "Watchdog", "Control loop lateness at which relays are forced idle, ms",
+        "1000", RIG_CONF_NUMERIC, { .n.min = WATCHDOG_MS_MIN, .n.max = WATCHDOG_MS_MAX, .n.step = 1 }
+    },
+    {
+        TOK_STALE_MS, "stale_ms", "Stale", "Position age beyond one control period considered stale, ms",
+        "1000", RIG_CONF_NUMERIC, { .n.min = STALE_MS_MIN, .n.max = STALE_MS_MAX, .n.step = 1 }
+    },
+    {
+        TOK_HW_WATCHDOG, "hw_watchdog", "HW watchdog", "Set 1 to feed /dev/watchdog while the control loop runs",
+        "0", RIG_CONF_NUMERIC, { .n.min = 0, .n.max = 1, .n.step = 1 }
+    },
+    {
+        TOK_EXTRAPOLATE, "extrapolate", "Extrapolate", "Set 1 to extrapolate positions to the time of each request",
+        "0", RIG_CONF_NUMERIC, { .n.min = 0, .n.max = 1, .n.step = 1 }
+    },
+    {
+        TOK_AZ_ENCODER, "az_encoder", "Az encoder", "Az absolute encoder: none, as5600 or as5048[,0x40 .. 0x43]",
+        "none", RIG_CONF_STRING,
+    },
+    {
+        TOK_EL_ENCODER, "el_encoder", "El encoder", "El absolute encoder: none, as5600 or as5048[,0x40 .. 0x43]",
+        "none", RIG_CONF_STRING,
+    },
+    {
+        TOK_ENCODER_PERIOD, "encoder_period", "Encoder period", "Encoder polling period between ticks, usecs, 0 none",
+        "2000", RIG_CONF_NUMERIC, { .n.min = 0, .n.max = THREAD_PERIOD_MAX, .n.step = 100 }
+    },
+    {
+        TOK_EL_IMU, "el_imu", "El IMU", "El accelerometer and gyro: none or mpu6050[,0x68|0x69[,x|y|z]]",
+        "none", RIG_CONF_STRING,
+    },
+    {
+        TOK_MOTOR_DUTY, "motor_duty", "Motor duty", "Rated motor duty cycle, percent, 0 for no limit",
+        "0", RIG_CONF_NUMERIC, { .n.min = 0, .n.max = 100, .n.step = 1 }
+    },
+    {
+        TOK_MOTOR_RUN, "motor_run", "Motor run", "Rated continuous motor run from cold, secs",
+        "300", RIG_CONF_NUMERIC, { .n.min = MOTOR_RUN_MIN, .n.max = MOTOR_RUN_MAX, .n.step = 1 }
+    },
+    {
+        TOK_POINTING_MODEL, "pointing_model", "Pointing model", "IA,IE,AN,AW,NPAE pointing terms, each within 5 degs",
+        "0,0,0,0,0", RIG_CONF_STRING,
+    },
+    {
+        TOK_POINTING_ADD, "pointing_add", "Add sighting", "Set az,el of the object the mount is now peaked on",
+        "", RIG_CONF_STRING,
+    },
+    {
+        TOK_POINTING_FIT, "pointing_fit", "Fit pointing", "Set 1 to fit the pointing model to the sightings",
+        "0", RIG_CONF_NUMERIC, { .n.min = 0, .n.max = 1, .n.step = 1 }
+    },
+    {
+        TOK_POINTING_CLEAR, "pointing_clear", "Clear sightings", "Set 1 to discard all pointing sightings",
+        "0", RIG_CONF_NUMERIC, { .n.min = 0, .n.max = 1, .n.step = 1 }
+    },
+    {
+        TOK_SAVE_CONF, "save_conf", "Save config", "Set 1 to save parameters to $HOME/.hamlib_g5500_conf.txt",
+        "0", RIG_CONF_NUMERIC, { .n.min = 0, .n.max = 1, .n.step = 1 }
     },
     { RIG_CONF_END, NULL, }
 };
@@ -1365,6 +4647,8 @@ static void g5500_sim_mode_set (int type)
     case SIM_OFF: 
         g5500_sim_mode = SIM_OFF;
         el_mount_max = g5500_direct_caps.max_el = EL_MOUNT_MAX;
+        ADC_az_speed = 0;
+        ADC_el_speed = 0;
         ADC_cal_ok = 0;         // force read of cal file
         break;
 
@@ -1376,6 +4660,8 @@ static void g5500_sim_mode_set (int type)
         ADC_az_max = AZ_SIM_MAX_ADC;
         ADC_el_min = 0;
         ADC_el_max = EL_SIM_MAX_ADC;
+        ADC_az_backlash = 0;
+        ADC_el_backlash = 0;
         ADC_cal_ok = 1;
         break;
 
@@ -1386,6 +4672,8 @@ static void g5500_sim_mode_set (int type)
         ADC_az_max = AZ_SIM_MAX_ADC;
         ADC_el_min = 0;
         ADC_el_max = EL_SIM_MAX_ADC/2;
+        ADC_az_backlash = 0;
+        ADC_el_backlash = 0;
         ADC_cal_ok = 1;
         break;
 
@@ -1396,6 +4684,8 @@ static void g5500_sim_mode_set (int type)
         ADC_az_max = AZ_SIM_MAX_ADC;
         ADC_el_min = 0;
         ADC_el_max = EL_SIM_MAX_ADC;
+        ADC_az_backlash = 0;
+        ADC_el_backlash = 0;
         ADC_cal_ok = 1;
         break;
     }
@@ -1412,4 +4702,944 @@ static void g5500_sim_mode_set (int type)
     ADC_el_now = 0;
     ADC_el_target = 0;
     ADC_el_n_equal = 0;
+    AZ_via_active = 0;
+    EL_via_active = 0;
+
+    // start the model at rest at the ADC minimums
+    if (g5500_sim_mode != SIM_OFF) {
+        g5500_read_sim_file();
+        pthread_mutex_lock (&g5500_tick_lock);
+        g5500SimAxisInit (&sim_az, &sim_profile.az, ADC_az_min, ADC_az_max, AZ_MOUNT_MAX - AZ_MOUNT_MIN, 0,
+                                g5500_now());
+        g5500SimAxisInit (&sim_el, &sim_profile.el, ADC_el_min, ADC_el_max, el_mount_max - EL_MOUNT_MIN, 0,
+                                g5500_now());
+        pthread_mutex_unlock (&g5500_tick_lock);
+        ADC_az_speed = (sim_profile.az.speed_up + sim_profile.az.speed_down) / 2
+                                * (ADC_az_max - ADC_az_min) / (AZ_MOUNT_MAX - AZ_MOUNT_MIN);
+        ADC_el_speed = (sim_profile.el.speed_up + sim_profile.el.speed_down) / 2
+                                * (ADC_el_max - ADC_el_min) / (el_mount_max - EL_MOUNT_MIN);
+    }
+}
+
+
+/* return full path to file containing saved configuration parameters,
+ * or return NULL if can not be established.
+ */
+static const char* g5500_get_conf_filename()
+{
+    static char *path;
+    return (g5500_home_path (g5500_conf_file_name, &path));
+}
+
+/* return whether the given token is saved in the configuration file.
+ * the simulator is a property of the session, not the mount, and autotune and save_conf are actions.
+ * the pointing model and its sightings are kept in their own file.
+ */
+static int g5500_conf_is_persistent (token_t token)
+{
+    return (token != TOK_SIMULATOR && token != TOK_AUTOTUNE && token != TOK_SAVE_CONF
+                && token != TOK_POINTING_MODEL && token != TOK_POINTING_ADD && token != TOK_POINTING_FIT
+                && token != TOK_POINTING_CLEAR);
+}
+
+/* save all persistent configuration parameters to file, one "name = value" per line.
+ * down here in order to access g5500_direct_conf_params
+ */
+static void g5500_save_conf_file()
+{
+    const char *filename = g5500_get_conf_filename();
+    if (!filename)
+        return;
+    FILE *fp = fopen (filename, "w");
+    if (!fp)
+        return;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s saving %s\n", __func__, filename);
+
+    for (const struct confparams *cp = g5500_direct_conf_params; cp->token != RIG_CONF_END; cp++) {
+        char val[G5500_CONF_LEN];
+        if (g5500_conf_is_persistent (cp->token) && g5500_direct_get_conf (NULL, cp->token, val) == G5500_RIG_OK)
+            fprintf (fp, "%s = %s\n", cp->name, val);
+    }
+
+    fclose (fp);
+}
+
+/* restore any configuration parameters saved in file.
+ * unknown names and out of range values are ignored so older or hand-edited files do no harm.
+ */
+static void g5500_read_conf_file()
+{
+    const char *filename = g5500_get_conf_filename();
+    if (!filename)
+        return;
+    FILE *fp = fopen (filename, "r");
+    if (!fp)
+        return;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s found %s\n", __func__, filename);
+
+    char buf[1024], name[64], val[64];
+    while (fgets (buf, sizeof(buf), fp) != NULL) {
+        if (sscanf (buf, "%63s = %63s", name, val) != 2)
+            continue;
+        for (const struct confparams *cp = g5500_direct_conf_params; cp->token != RIG_CONF_END; cp++) {
+            if (strcmp (cp->name, name) == 0 && g5500_conf_is_persistent (cp->token)) {
+                if (g5500_direct_set_conf (NULL, cp->token, val) != G5500_RIG_OK)
+                    rig_debug(RIG_DEBUG_ERR, "%s: ignoring %s = %s\n", __func__, name, val);
+                break;
+            }
+        }
+    }
+
+    fclose (fp);
+}
+
+
+
+#if !defined(STANDALONE_G5500)
+
+/***********************************************************************************************************
+ *
+ *
+ * forwarding to a running g5500pi daemon
+ *
+ *
+ ***********************************************************************************************************/
+
+
+/* connect to the daemon if one is listening on its UNIX socket.
+ * return 0 if now attached, -1 to use the hardware directly, or -2 if a daemon owns the hardware but we
+ * are not permitted to use its socket.
+ */
+static int g5500_daemon_attach()
+{
+    const char *path = getenv ("G5500_SOCKET");
+    if (!path || !path[0])
+        path = G5500_DAEMON_SOCKET;
+
+    // not an error if there is no daemon
+    if (access (path, F_OK) < 0)
+        return (-1);
+
+    // the socket is only open to the daemon's user and group, anyone else must not fight it for the hardware
+    if (access (path, R_OK|W_OK) < 0) {
+        rig_debug(RIG_DEBUG_ERR, "%s: %s: %s, run as the g5500pi user or in its group\n", __func__, path,
+                                                                strerror(errno));
+        return (-2);
+    }
+
+    char ynot[1024];
+    g5500_daemon = g5500ClientOpen (path, 0, ynot);
+    if (!g5500_daemon) {
+        rig_debug(RIG_DEBUG_ERR, "%s: %s, using hardware directly\n", __func__, ynot);
+        return (-1);
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: attached to daemon at %s\n", __func__, path);
+    return (0);
+}
+
+/* return the name of the given conf token, or NULL if unknown.
+ */
+static const char *g5500_daemon_conf_name (token_t token)
+{
+    for (const struct confparams *cp = g5500_direct_conf_params; cp->token != RIG_CONF_END; cp++)
+        if (cp->token == token)
+            return (cp->name);
+    return (NULL);
+}
+
+/* forward set_conf to the daemon
+ */
+static int g5500_daemon_set_conf (token_t token, const char *val)
+{
+    const char *name = g5500_daemon_conf_name (token);
+    if (!name)
+        return G5500_RIG_ERR_BADARGS;
+
+    // the value must reach the daemon whole and as one word, else it would set something else or, with a
+    // newline, send another command
+    char cmd[128];
+    G5500Reply r;
+    if (!*val || strlen (val) >= G5500_CONF_LEN || strpbrk (val, " \t\r\n")
+                        || snprintf (cmd, sizeof(cmd), "set_conf %s %s", name, val) >= (int)sizeof(cmd))
+        return G5500_RIG_ERR_BADARGS;
+    return (g5500ClientCommand (g5500_daemon, cmd, &r));
+}
+
+/* forward get_conf to the daemon, with room for val_len bytes in val including the EOS.
+ */
+static int g5500_daemon_get_conf (token_t token, char *val, size_t val_len)
+{
+    const char *name = g5500_daemon_conf_name (token);
+    if (!name)
+        return G5500_RIG_ERR_BADARGS;
+
+    char cmd[128];
+    G5500Reply r;
+    snprintf (cmd, sizeof(cmd), "get_conf %s", name);
+    int err = g5500ClientCommand (g5500_daemon, cmd, &r);
+    if (err != G5500_RIG_OK)
+        return (err);
+
+    // value is everything following "Value: " up to the next field
+    const char *vp = strstr (r.line, "Value: ");
+    if (!vp)
+        return G5500_RIG_ERR_INTERNAL;
+    vp += 7;
+    size_t n = strcspn (vp, ";");
+    if (n == 0 || n >= val_len)
+        return G5500_RIG_ERR_INTERNAL;
+    memcpy (val, vp, n);
+    val[n] = '\0';
+
+    return G5500_RIG_OK;
+}
+
+/* forward get_info to the daemon.
+ * N.B. returned string is only valid until the next call.
+ */
+static const char *g5500_daemon_get_info()
+{
+    static char info[128];
+
+    if (g5500ClientGetInfo (g5500_daemon, info, sizeof(info)) != G5500CLIENT_OK)
+        return ("Yaesu G5500 via g5500pi, not responding");
+    return (info);
+}
+
+#endif // !STANDALONE_G5500
+
+
+
+#if defined(STANDALONE_G5500)
+
+/***********************************************************************************************************
+ *
+ *
+ * extensions to the hamlib API available only when building stand-alone
+ *
+ *
+ ***********************************************************************************************************/
+
+
+/* follow a moving target: fn is called by the control thread at the start of each tick with the current unix
+ * time and sets the az and el at which the mount should then be pointing. The first position is checked as if
+ * by set_position. Tracking continues until fn returns < 0, its position is out of range or any other motion
+ * command. fn must be quick and must not call back into this driver. Passing fn NULL ends tracking and
+ * guarantees fn is no longer in use on return.
+ * return G5500_RIG_OK or the reason tracking could not start.
+ */
+int g5500_direct_track (G5500TrackFunc fn, void *arg)
+{
+    rig_debug(RIG_DEBUG_VERBOSE, "%s (%s) called\n", __func__, fn ? "start" : "end");
+
+    // wait for any current call to finish
+    pthread_mutex_lock (&g5500_tick_lock);
+    g5500_track_fn = NULL;
+    pthread_mutex_unlock (&g5500_tick_lock);
+    if (!fn)
+        return (G5500_RIG_OK);
+
+    // move to the first position as usual
+    struct timespec ts;
+    clock_gettime (CLOCK_REALTIME, &ts);
+    float az, el;
+    if ((*fn) (ts.tv_sec + ts.tv_nsec*1e-9, &az, &el, arg) < 0 || az >= AZ_MOUNT_WRAP)
+        return (G5500_RIG_ERR_BADARGS);
+    if (ADC_cal_ok)
+        az = g5500_nearer_turn (az, g5500_ADC_to_az (ADC_az_now));
+    int err = g5500_direct_set_position (NULL, az, el);
+    if (err != G5500_RIG_OK)
+        return (err);
+
+    // then follow from the next tick on
+    pthread_mutex_lock (&g5500_tick_lock);
+    g5500_track_arg = arg;
+    g5500_track_fn = fn;
+    pthread_mutex_unlock (&g5500_tick_lock);
+
+    return (G5500_RIG_OK);
+}
+
+/* return whether a target set with g5500_direct_track() is still being followed
+ */
+int g5500_direct_tracking()
+{
+    return (g5500_track_fn != NULL);
+}
+
+/* fill *sp with a snapshot of the current state.
+ * return G5500_RIG_OK, else any pending error which is also reported in sp->err.
+ */
+int g5500_direct_get_status (G5500Status *sp)
+{
+    memset (sp, 0, sizeof(*sp));
+
+    sp->state = g5500_thread_state_name();
+    sp->err = g5500_check_thread_error();
+
+    g5500_ADC_to_sky (ADC_az_now, ADC_el_now, &sp->az, &sp->el);
+    g5500_ADC_to_sky (ADC_az_target, ADC_el_target, &sp->az_target, &sp->el_target);
+    sp->az_dir = AZ_cmd_cw ? 1 : (AZ_cmd_ccw ? -1 : 0);
+    sp->el_dir = EL_cmd_up ? 1 : (EL_cmd_down ? -1 : 0);
+
+    // the prediction uses the tuning, so between ticks
+    pthread_mutex_lock (&g5500_tick_lock);
+    g5500_predict_eta (&sp->az_eta, &sp->el_eta, &sp->settle);
+    pthread_mutex_unlock (&g5500_tick_lock);
+
+    sp->age = g5500_sample_age();
+    sp->stale = g5500_check_stale() != G5500_RIG_OK;
+    if (sp->err == G5500_RIG_OK && sp->stale)
+        sp->err = G5500_RIG_ERR_STALE;
+    sp->wd_misses = g5500_wd_misses;
+    sp->wd_response = g5500_wd_response;
+    sp->wd_response_max = g5500_wd_response_max;
+    sp->az_source = enc_az.locked ? "encoder" : "pot";
+    sp->el_source = enc_el.locked ? "encoder" : (imu_el.locked ? "imu" : "pot");
+    sp->enc_faults = enc_az.n_faults + enc_el.n_faults;
+    sp->imu_faults = imu_el.n_faults;
+
+    double k = 1;
+    double tau = g5500_duty_model (&k);
+    sp->az_heat = duty_az.heat;
+    sp->el_heat = duty_el.heat;
+    sp->az_run_left = g5500_duty_run_left (&duty_az, tau, k);
+    sp->el_run_left = g5500_duty_run_left (&duty_el, tau, k);
+    sp->az_cooling = duty_az.cooling;
+    sp->el_cooling = duty_el.cooling;
+    sp->cooldowns = duty_az.n_cooldowns + duty_el.n_cooldowns;
+    sp->az_speed = ADC_az_speed > 0 && ADC_az_max > ADC_az_min
+                ? ADC_az_speed * (AZ_MOUNT_MAX - AZ_MOUNT_MIN) / (ADC_az_max - ADC_az_min) : AZ_NOMINAL_SPEED;
+    sp->el_speed = ADC_el_speed > 0 && ADC_el_max > ADC_el_min
+                ? ADC_el_speed * (el_mount_max - EL_MOUNT_MIN) / (ADC_el_max - ADC_el_min) : EL_NOMINAL_SPEED;
+
+    PiI2CStats ours, others;
+    piI2CGetStats (&ours, &others);
+    sp->i2c_xfers = ours.n_xfers;
+    sp->i2c_waits = ours.n_waits;
+    sp->i2c_timeouts = ours.n_timeouts;
+    sp->i2c_wait_max = ours.wait_max;
+    sp->i2c_wait_pid = ours.wait_max_pid;
+    sp->i2c_others = others.n_xfers;
+
+    return (sp->err);
+}
+
+/* fill *pp with the current position and details of the sample on which it is based.
+ * return G5500_RIG_OK, else the same error as g5500_direct_get_position().
+ */
+int g5500_direct_get_position_ex (G5500Position *pp)
+{
+    memset (pp, 0, sizeof(*pp));
+
+    int err = g5500_position_ready();
+    if (err != G5500_RIG_OK)
+        return (err);
+
+    double t;
+    g5500_sample_position (&pp->az, &pp->el, &t, &pp->az_vel, &pp->el_vel);
+
+    // convert sample time to unix time
+    struct timespec ts;
+    clock_gettime (CLOCK_REALTIME, &ts);
+    double now = g5500_now();
+    pp->age = now - t;
+    pp->t = ts.tv_sec + ts.tv_nsec*1e-9 - pp->age;
+    pp->extrapolated = g5500_get_tuning (&g5500_extrapolate);
+
+    return (G5500_RIG_OK);
+}
+
+/* copy the history points later than since, oldest first, to pts[], at most the latest max_pts.
+ * return number of points copied.
+ */
+int g5500_direct_get_history (double since, G5500HistPoint *pts, int max_pts)
+{
+    pthread_mutex_lock (&g5500_history_lock);
+
+    // search back from the newest for the first point not after since
+    int n = 0;
+    while (n < g5500_history_n && n < max_pts) {
+        int i = (g5500_history_head - 1 - n + G5500_HISTORY_LEN) % G5500_HISTORY_LEN;
+        if (g5500_history[i].t <= since)
+            break;
+        n++;
+    }
+
+    // copy those n, oldest first
+    for (int j = 0; j < n; j++)
+        pts[j] = g5500_history[(g5500_history_head - n + j + G5500_HISTORY_LEN) % G5500_HISTORY_LEN];
+
+    pthread_mutex_unlock (&g5500_history_lock);
+
+    return (n);
+}
+
+/* copy the flight recorder to recs[], oldest first, at most the latest max_recs, and the calibration needed
+ * to interpret it to *cp.
+ * return number of records copied.
+ */
+int g5500_direct_get_trace (G5500TraceRec *recs, int max_recs, G5500TraceCal *cp)
+{
+    memset (cp, 0, sizeof(*cp));
+    cp->sim_mode = g5500_sim_mode;
+    cp->cal_ok = ADC_cal_ok;
+    cp->az_min = ADC_az_min;
+    cp->az_max = ADC_az_max;
+    cp->el_min = ADC_el_min;
+    cp->el_max = ADC_el_max;
+    cp->az_span = AZ_MOUNT_MAX - AZ_MOUNT_MIN;
+    cp->el_span = el_mount_max - EL_MOUNT_MIN;
+    cp->period = g5500_get_tuning (&g5500_tuning.thread_period);
+
+    pthread_mutex_lock (&g5500_trace_lock);
+    int n = g5500_trace_n < max_recs ? g5500_trace_n : max_recs;
+    for (int j = 0; j < n; j++)
+        recs[j] = g5500_trace[(g5500_trace_head - n + j + G5500_TRACE_LEN) % G5500_TRACE_LEN];
+    pthread_mutex_unlock (&g5500_trace_lock);
+
+    return (n);
+}
+
+/* predict how well the mount would follow fn, which gives the sky position at each unix time as for
+ * g5500_direct_track(), from t0 to t1 starting from where it is now. if stepped, fn instead gives a series of
+ * positions each of which is a goto when it changes, as the schedule runs a track file. pointing errors are
+ * gathered from when the mount first comes within tol degs of the target, while the target is at or above
+ * mask degs el, using where the model truly points rather than where its pots say.
+ * the control law is run against a private model of the mount on a virtual clock, so a whole pass takes
+ * a fraction of a second and the live control loop, which is held only while its settings are copied, carries
+ * on undisturbed. motors start at their heat now, cooled at rest until t0.
+ * return G5500_RIG_OK with results in *rp, G5500_RIG_ERR_BADARGS if the window is empty or longer than
+ * PRESIM_MAX_SECS, else G5500_RIG_CALIBRATING if the mount is not calibrated.
+ */
+int g5500_direct_presim (G5500TrackFunc fn, void *arg, int stepped, double t0, double t1, float mask, float tol,
+G5500Presim *rp)
+{
+    memset (rp, 0, sizeof(*rp));
+    rp->acquire = -1;
+
+    if (t1 <= t0 || t1 - t0 > PRESIM_MAX_SECS || tol <= 0)
+        return (G5500_RIG_ERR_BADARGS);
+    if (!ADC_cal_ok || g5500_is_tuning() || g5500_thread_state == CTS_CAL_START
+                || g5500_thread_state == CTS_CAL_SEEK_MINS || g5500_thread_state == CTS_CAL_SEEK_MAXS
+                || g5500_thread_state == CTS_CAL_BACKLASH)
+        return (G5500_RIG_CALIBRATING);
+
+    double wall0 = g5500_now();
+    G5500SimProfile prof;
+    g5500_presim_profile (&prof);
+    rp->az_speed = (prof.az.speed_up + prof.az.speed_down) / 2;
+    rp->el_speed = (prof.el.speed_up + prof.el.speed_down) / 2;
+
+    // copy everything the control law uses
+    G5500PresimAxis az, el;
+    memset (&az, 0, sizeof(az));
+    memset (&el, 0, sizeof(el));
+    pthread_mutex_lock (&g5500_tick_lock);
+    double dt = THREAD_PERIOD/1e6;
+    float el_max = el_mount_max;
+    az.now = ADC_az_now;
+    az.min = ADC_az_min;
+    az.max = ADC_az_max;
+    az.span = AZ_MOUNT_MAX - AZ_MOUNT_MIN;
+    az.deadband = ADC_AZ_DEADBAND;
+    az.stop_lead = AZ_STOP_LEAD;
+    az.overshoot = AZ_overshoot();
+    az.approach = az_approach;
+    az.duty = duty_az;
+    el.now = ADC_el_now;
+    el.min = ADC_el_min;
+    el.max = ADC_el_max;
+    el.span = el_max - EL_MOUNT_MIN;
+    el.deadband = ADC_EL_DEADBAND;
+    el.stop_lead = EL_STOP_LEAD;
+    el.overshoot = EL_overshoot();
+    el.approach = el_approach;
+    el.duty = duty_el;
+    pthread_mutex_unlock (&g5500_tick_lock);
+
+    if (az.max <= az.min || el.max <= el.min)
+        return (G5500_RIG_CALIBRATING);
+
+    // motors start at rest, cooling until t0
+    double k = 1;
+    double tau = g5500_duty_model (&k);
+    struct timespec ts;
+    clock_gettime (CLOCK_REALTIME, &ts);
+    double now = ts.tv_sec + ts.tv_nsec*1e-9;
+    g5500_duty_update (&az.duty, NULL, 0, t0 > now ? t0 - now : 0, tau, k);
+    g5500_duty_update (&el.duty, NULL, 0, t0 > now ? t0 - now : 0, tau, k);
+    int starts0 = az.duty.n_starts + el.duty.n_starts;
+    int cooldowns0 = az.duty.n_cooldowns + el.duty.n_cooldowns;
+
+    g5500SimAxisInit (&az.sim, &prof.az, az.min, az.max, az.span, (az.now - az.min) * az.span / (az.max - az.min), t0);
+    g5500SimAxisInit (&el.sim, &prof.el, el.min, el.max, el.span, (el.now - el.min) * el.span / (el.max - el.min), t0);
+
+    int tracking = 0, ended = 0, unwinding = 0, n_err = 0, n_on = 0, have_prev = 0;
+    long n_lost = 0, n_unwind = 0, n_keyhole = 0, n_masked = 0;     // ticks, each the dt up to it
+    double t_start = t0, t_prev = t0, sum2 = 0;
+    float prev_az = 0, prev_el = 0, goto_az = -1, goto_el = -1;
+
+    for (long i = 0; t0 + i*dt <= t1; i++) {
+        double t = t0 + i*dt;
+
+        // read positions and account for motor heating since the last tick
+        az.now = g5500SimRead (&az.sim, t, 1);
+        el.now = g5500SimRead (&el.sim, t, 1);
+        g5500_duty_update (&az.duty, NULL, az.cmd != 0, i > 0 ? dt : 0, tau, k);
+        g5500_duty_update (&el.duty, NULL, el.cmd != 0, i > 0 ? dt : 0, tau, k);
+
+        // where the target is now and how fast it is moving
+        float taz = 0, tel = 0, az_rate = 0, el_rate = 0;
+        int ok = (*fn) (t, &taz, &tel, arg) == 0;
+        if (ok && have_prev && (taz != prev_az || tel != prev_el)) {
+            az_rate = fabsf (remainderf (taz - prev_az, 360)) / (t - t_prev);
+            el_rate = fabsf (tel - prev_el) / (t - t_prev);
+        }
+        if (ok && (!have_prev || taz != prev_az || tel != prev_el)) {
+            prev_az = taz;
+            prev_el = tel;
+            t_prev = t;
+        }
+        have_prev = ok;
+        int reachable = ok && taz >= AZ_MOUNT_MIN && taz < (stepped ? AZ_MOUNT_MAX : AZ_MOUNT_WRAP)
+                                && tel >= EL_MOUNT_MIN && tel <= el_max;
+
+        // move the targets as g5500_thread_track() or the schedule would
+        float mount_az = -1;
+        if (stepped) {
+            if (ok && (!tracking || taz != goto_az || tel != goto_el)) {
+                goto_az = taz;
+                goto_el = tel;
+                if (reachable) {
+                    mount_az = taz;
+                    az.via_active = el.via_active = 0;
+                }
+                if (!tracking)
+                    t_start = t;
+                tracking = 1;
+            }
+        } else if (!tracking) {
+            if (reachable) {
+                mount_az = g5500_nearer_turn (taz, g5500_ADC_to_az (az.now));
+                az.via_active = el.via_active = 0;
+                t_start = t;
+                tracking = 1;
+            }
+        } else if (!ended) {
+            if (reachable) {
+                mount_az = g5500_nearer_turn (taz, g5500_ADC_to_az (az.target));
+            } else {
+                rp->tracked = t - t_start;
+                ended = 1;
+            }
+        }
+        if (mount_az >= 0) {
+            if (i > 0 && fabsf (mount_az - g5500_ADC_to_az (az.target)) > 180) {
+                rp->unwinds++;
+                unwinding = 1;
+            }
+            uint16_t az_target, el_target;
+            g5500_sky_to_ADC (mount_az, tel, &az_target, &el_target);
+            az.target = az_target;
+            el.target = el_target;
+        }
+
+        // seek and drive the model
+        if (tracking) {
+            g5500_presim_seek (&az, !stepped && !ended);
+            g5500_presim_seek (&el, !stepped && !ended);
+        }
+        g5500SimCommand (&az.sim, az.cmd, t);
+        g5500SimCommand (&el.sim, el.cmd, t);
+
+        // gather pointing errors of the true position from first acquiring the target, while it is clear of
+        // the mask
+        if (ok && tel >= mask) {
+            uint16_t az_true = g5500_deg_to_ADC (az.sim.x, az.min, az.max, az.span);
+            uint16_t el_true = g5500_deg_to_ADC (el.sim.x, el.min, el.max, el.span);
+            float saz, sel;
+            g5500_ADC_to_sky (az_true, el_true, &saz, &sel);
+            float err = g5500_sky_sep (saz, sel, taz, tel);
+            if (err <= tol && rp->acquire < 0)
+                rp->acquire = t - t0;
+            if (rp->acquire >= 0) {
+                sum2 += err*err;
+                if (err > rp->max_err)
+                    rp->max_err = err;
+                n_err++;
+                if (err <= tol) {
+                    n_on++;
+                    unwinding = 0;
+                } else if (i > 0) {
+                    n_lost++;
+                    if (unwinding)
+                        n_unwind++;
+                }
+            }
+            if (tel > rp->max_el)
+                rp->max_el = tel;
+            if (az_rate > rp->peak_az_rate)
+                rp->peak_az_rate = az_rate;
+            if (el_rate > rp->peak_el_rate)
+                rp->peak_el_rate = el_rate;
+            if (az_rate > rp->az_speed && i > 0)
+                n_keyhole++;
+        } else if (i > 0) {
+            n_masked++;
+        }
+    }
+
+    // durations from tick counts, summing dt in a float drifts by secs over a long pass
+    rp->lost = n_lost * dt;
+    rp->unwind_secs = n_unwind * dt;
+    rp->keyhole = n_keyhole * dt;
+    rp->masked = n_masked * dt;
+
+    rp->completed = rp->acquire >= 0 && rp->lost == 0;
+    if (tracking && !ended)
+        rp->tracked = t1 - t_start;
+    if (n_err > 0) {
+        rp->rms_err = sqrt (sum2 / n_err);
+        rp->on_target = 100.0 * n_on / n_err;
+    }
+    rp->starts = az.duty.n_starts + el.duty.n_starts - starts0;
+    rp->cooldowns = az.duty.n_cooldowns + el.duty.n_cooldowns - cooldowns0;
+    rp->az_heat = az.duty.heat;
+    rp->el_heat = el.duty.heat;
+    rp->wall = g5500_now() - wall0;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s %.0f secs in %.3f: rms %.2f max %.2f degs, %.0f%% on target, %d unwinds\n",
+                __func__, t1 - t0, rp->wall, rp->rms_err, rp->max_err, rp->on_target, rp->unwinds);
+
+    return (G5500_RIG_OK);
+}
+
+/* while hold is set, tuning parameter changes are collected but not used by the control thread.
+ * clearing hold lets all changes made since take effect together on the next tick.
+ */
+void g5500_direct_hold_conf (int hold)
+{
+    pthread_mutex_lock (&g5500_tuning_lock);
+    g5500_tuning_hold = hold;
+    pthread_mutex_unlock (&g5500_tuning_lock);
+}
+
+/* everything the control and supervisor threads need to carry on exactly where another process left off,
+ * followed by g5500_history_n G5500HistPoint, oldest first.
+ * N.B. bump G5500_SNAPSHOT_MAGIC whenever this changes, snapshots are only exchanged between equal magic.
+ */
+#define G5500_SNAPSHOT_MAGIC    0x47355308
+typedef struct {
+    uint32_t magic;                     // G5500_SNAPSHOT_MAGIC
+    int sim_mode;                       // g5500_sim_mode
+    G5500SimAxis sim_az, sim_el;        // simulated axes
+    int thread_state;                   // g5500_thread_state
+    // motion
+    uint16_t az_now, el_now, az_target, el_target, az_via, el_via, az_prev, el_prev;
+    int az_via_active, el_via_active;
+    int az_cw, az_ccw, el_up, el_down;
+    int az_n_equal, el_n_equal;
+    ADCSample sample;
+    // calibration
+    int cal_ok;
+    uint16_t az_min, az_max, el_min, el_max, az_backlash, el_backlash;
+    float az_speed, el_speed;
+    // configuration
+    int az_approach, el_approach;
+    G5500Tuning tuning;
+    int watchdog_ms, stale_ms, hw_watchdog, extrapolate;
+    // encoders
+    G5500Encoder enc_az, enc_el;
+    int encoder_period;
+    G5500IMU imu_el;
+    // motor duty
+    G5500Duty duty_az, duty_el;
+    double duty_t;
+    int motor_duty, motor_run;
+    // supervision
+    int wd_misses;
+    float wd_response, wd_response_max;
+    // history
+    int n_history;
+} G5500Snapshot;
+
+static G5500Snapshot *g5500_snapshot;   // pending from g5500_direct_restore(), followed by history
+
+/* freeze the control loop between ticks so its state may be captured with g5500_direct_snapshot().
+ * the relays are idled first because the supervisor does not act while frozen, which may be for several
+ * seconds if the new instance is slow to start; the control loop restarts any motion toward the targets.
+ * return 0 if frozen, -1 if calibrating or tuning because those can not be resumed part way through.
+ * N.B. motion commands would not take effect until g5500_direct_thaw()
+ */
+int g5500_direct_freeze()
+{
+    pthread_mutex_lock (&g5500_tick_lock);
+
+    switch (g5500_thread_state) {
+    case CTS_STOP:
+    case CTS_RUN:
+    case CTS_ERR_ADC:
+    case CTS_ERR_NOPOWER:
+    case CTS_ERR_STUCK:
+    case CTS_ERR_WATCHDOG:
+        break;
+    case CTS_CAL_START:
+    case CTS_CAL_SEEK_MINS:
+    case CTS_CAL_SEEK_MAXS:
+    case CTS_CAL_BACKLASH:
+    case CTS_TUNE_START:
+    case CTS_TUNE_NOISE:
+    case CTS_TUNE_STEP:
+        pthread_mutex_unlock (&g5500_tick_lock);
+        return (-1);
+    }
+
+    // holding the tick lock we stand in for the control thread
+    g5500_thread_az_stop();
+    g5500_thread_el_stop();
+
+    g5500_frozen = 1;
+    return (0);
+}
+
+/* resume the control loop after g5500_direct_freeze(), such as if a handoff failed.
+ */
+void g5500_direct_thaw()
+{
+    // don't let the supervisor count the freeze as a miss
+    g5500_heartbeat_due = g5500_now() + THREAD_PERIOD/1e6;
+    g5500_frozen = 0;
+    pthread_mutex_unlock (&g5500_tick_lock);
+}
+
+/* return the largest number of bytes g5500_direct_snapshot() may require
+ */
+size_t g5500_direct_snapshot_size()
+{
+    return (sizeof(G5500Snapshot) + G5500_HISTORY_LEN*sizeof(G5500HistPoint));
+}
+
+/* capture the complete state in buf[len], which must be at least g5500_direct_snapshot_size().
+ * also return the hardware watchdog fd, if open, which must be passed along with it, else -1.
+ * return number of bytes used.
+ * N.B. the control loop must be frozen with g5500_direct_freeze()
+ */
+size_t g5500_direct_snapshot (void *buf, size_t len, int *hw_fdp)
+{
+    if (len < g5500_direct_snapshot_size())
+        return (0);
+
+    G5500Snapshot *sp = (G5500Snapshot *) buf;
+    memset (sp, 0, sizeof(*sp));
+
+    sp->magic = G5500_SNAPSHOT_MAGIC;
+    sp->sim_mode = g5500_sim_mode;
+    sp->sim_az = sim_az;
+    sp->sim_el = sim_el;
+    sp->thread_state = g5500_thread_state;
+
+    sp->az_now = ADC_az_now;
+    sp->el_now = ADC_el_now;
+    sp->az_target = ADC_az_target;
+    sp->el_target = ADC_el_target;
+    sp->az_via = ADC_az_via;
+    sp->el_via = ADC_el_via;
+    sp->az_prev = ADC_az_prev;
+    sp->el_prev = ADC_el_prev;
+    sp->az_via_active = AZ_via_active;
+    sp->el_via_active = EL_via_active;
+    sp->az_cw = AZ_cmd_cw;
+    sp->az_ccw = AZ_cmd_ccw;
+    sp->el_up = EL_cmd_up;
+    sp->el_down = EL_cmd_down;
+    sp->az_n_equal = ADC_az_n_equal;
+    sp->el_n_equal = ADC_el_n_equal;
+    sp->sample = g5500_get_sample();
+
+    sp->cal_ok = ADC_cal_ok;
+    sp->az_min = ADC_az_min;
+    sp->az_max = ADC_az_max;
+    sp->el_min = ADC_el_min;
+    sp->el_max = ADC_el_max;
+    sp->az_backlash = ADC_az_backlash;
+    sp->el_backlash = ADC_el_backlash;
+    sp->az_speed = ADC_az_speed;
+    sp->el_speed = ADC_el_speed;
+
+    sp->az_approach = az_approach;
+    sp->el_approach = el_approach;
+    pthread_mutex_lock (&g5500_tuning_lock);
+    sp->tuning = g5500_tuning_next;
+    sp->watchdog_ms = g5500_watchdog_ms;
+    sp->stale_ms = g5500_stale_ms;
+    sp->hw_watchdog = g5500_hw_watchdog;
+    sp->extrapolate = g5500_extrapolate;
+    sp->encoder_period = g5500_encoder_period;
+    pthread_mutex_unlock (&g5500_tuning_lock);
+    sp->enc_az = enc_az;
+    sp->enc_el = enc_el;
+    sp->imu_el = imu_el;
+    sp->duty_az = duty_az;
+    sp->duty_el = duty_el;
+    sp->duty_t = duty_t;
+    sp->motor_duty = g5500_motor_duty;
+    sp->motor_run = g5500_motor_run;
+
+    sp->wd_misses = g5500_wd_misses;
+    sp->wd_response = g5500_wd_response;
+    sp->wd_response_max = g5500_wd_response_max;
+
+    sp->n_history = g5500_direct_get_history (0, (G5500HistPoint *)(sp + 1), G5500_HISTORY_LEN);
+
+    *hw_fdp = g5500_hw_watchdog_fd;
+
+    return (sizeof(*sp) + sp->n_history * sizeof(G5500HistPoint));
+}
+
+/* arrange for the next rot_init to carry on from the snapshot in buf[len] made by g5500_direct_snapshot() in
+ * another process, along with its hardware watchdog fd or -1.
+ * return 0 if the snapshot is usable, else -1 with excuse in ynot[].
+ */
+int g5500_direct_restore (const void *buf, size_t len, int hw_fd, char ynot[])
+{
+    const G5500Snapshot *sp = (const G5500Snapshot *) buf;
+
+    if (len < sizeof(*sp) || sp->magic != G5500_SNAPSHOT_MAGIC) {
+        strcpy (ynot, "snapshot is from an incompatible version");
+        return (-1);
+    }
+    if (sp->n_history < 0 || sp->n_history > G5500_HISTORY_LEN
+                            || len != sizeof(*sp) + sp->n_history * sizeof(G5500HistPoint)) {
+        strcpy (ynot, "snapshot is corrupt");
+        return (-1);
+    }
+
+    g5500_snapshot = (G5500Snapshot *) malloc (len);
+    if (!g5500_snapshot) {
+        strcpy (ynot, "no memory for snapshot");
+        return (-1);
+    }
+    memcpy (g5500_snapshot, buf, len);
+    g5500_hw_watchdog_fd = hw_fd;
+
+    return (0);
+}
+
+/* adopt any pending snapshot. called by rot_init before the threads are created.
+ */
+static void g5500_apply_snapshot()
+{
+    G5500Snapshot *sp = g5500_snapshot;
+    if (!sp)
+        return;
+
+    // first because it resets much of the state
+    g5500_sim_mode_set (sp->sim_mode);
+    if (g5500_sim_mode != SIM_OFF) {
+        sim_az = sp->sim_az;
+        sim_el = sp->sim_el;
+    }
+
+    ADC_az_now = sp->az_now;
+    ADC_el_now = sp->el_now;
+    ADC_az_target = sp->az_target;
+    ADC_el_target = sp->el_target;
+    ADC_az_via = sp->az_via;
+    ADC_el_via = sp->el_via;
+    ADC_az_prev = sp->az_prev;
+    ADC_el_prev = sp->el_prev;
+    AZ_via_active = sp->az_via_active;
+    EL_via_active = sp->el_via_active;
+    AZ_cmd_cw = sp->az_cw;
+    AZ_cmd_ccw = sp->az_ccw;
+    EL_cmd_up = sp->el_up;
+    EL_cmd_down = sp->el_down;
+    ADC_az_n_equal = sp->az_n_equal;
+    ADC_el_n_equal = sp->el_n_equal;
+    ADC_sample = sp->sample;
+
+    ADC_cal_ok = sp->cal_ok;
+    ADC_az_min = sp->az_min;
+    ADC_az_max = sp->az_max;
+    ADC_el_min = sp->el_min;
+    ADC_el_max = sp->el_max;
+    ADC_az_backlash = sp->az_backlash;
+    ADC_el_backlash = sp->el_backlash;
+    ADC_az_speed = sp->az_speed;
+    ADC_el_speed = sp->el_speed;
+
+    az_approach = (ApproachType) sp->az_approach;
+    el_approach = (ApproachType) sp->el_approach;
+    g5500_tuning = g5500_tuning_next = sp->tuning;
+    g5500_watchdog_ms = sp->watchdog_ms;
+    g5500_stale_ms = sp->stale_ms;
+    g5500_hw_watchdog = sp->hw_watchdog;
+    g5500_extrapolate = sp->extrapolate;
+    g5500_encoder_period = sp->encoder_period;
+    enc_az = sp->enc_az;
+    enc_el = sp->enc_el;
+    imu_el = sp->imu_el;
+    duty_az = sp->duty_az;
+    duty_el = sp->duty_el;
+    duty_t = sp->duty_t;
+    g5500_motor_duty = sp->motor_duty;
+    g5500_motor_run = sp->motor_run;
+
+    g5500_wd_misses = sp->wd_misses;
+    g5500_wd_response = sp->wd_response;
+    g5500_wd_response_max = sp->wd_response_max;
+
+    const G5500HistPoint *hp = (const G5500HistPoint *)(sp + 1);
+    memcpy (g5500_history, hp, sp->n_history * sizeof(G5500HistPoint));
+    g5500_history_n = sp->n_history;
+    g5500_history_head = sp->n_history % G5500_HISTORY_LEN;
+
+    // last so g5500_sim_mode_set can not undo it
+    g5500_thread_state = (G5500ControlThreadState) sp->thread_state;
+    g5500_heartbeat_due = g5500_now() + THREAD_PERIOD/1e6;
+    g5500_restored = 1;
+
+    free (g5500_snapshot);
+    g5500_snapshot = NULL;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: carrying on in state %s\n", __func__, g5500_thread_state_name());
 }
+
+/* run the control loop from the caller's event loop rather than a thread of its own, for boards with a single
+ * core where the context switches of the control thread cost more than its work. Must be called before
+ * rot_init. The caller must then call g5500_direct_reactor_run() whenever g5500_direct_reactor_fd() is
+ * readable. The supervisor thread still watches the ticks so a stalled event loop still idles the relays.
+ */
+void g5500_direct_set_reactor (int on)
+{
+    g5500_reactor = on;
+}
+
+/* return the descriptor which becomes readable when g5500_direct_reactor_run() is due, -1 unless in reactor
+ * mode.
+ */
+int g5500_direct_reactor_fd()
+{
+    return (g5500_reactor_fd);
+}
+
+/* perform whatever part of the control loop is due, see g5500_direct_set_reactor().
+ */
+void g5500_direct_reactor_run()
+{
+    uint64_t n_exp;
+
+    // consume the expiration, nothing to do if it was spurious
+    if (read (g5500_reactor_fd, &n_exp, sizeof(n_exp)) < 0)
+        return;
+
+    pthread_mutex_lock (&g5500_tick_lock);
+    g5500_reactor_event();
+    pthread_mutex_unlock (&g5500_tick_lock);
+}
+
+#endif // STANDALONE_G5500
@@ -10,6 +10,12 @@
  *    +\stop
  *    +\get_info
  *    +\dump_caps
+ *    +\get_eta          (not in hamlib: secs until az and el reach target, and until both at rest)
+ *    +\track_radec      (not in hamlib: follow J2000 RA hours and Dec degs, see celestial.c)
+ *    +\get_track        (not in hamlib: RA and Dec being tracked)
+ *    +\check_pass       (not in hamlib: predict how well a pass would be followed, see presim.c)
+ *    +\set_conf
+ *    +\get_conf
  *
  * we support the following REST web commands or direct without leading /:
  *
@@ -21,7 +27,39 @@
  *    /stop
  *    /get_info
  *    /dump_caps
+ *    /get_eta
+ *    /status           (JSON)
+ *    /history?since=t&max_points=n&fmt=[json,bin]   (see history.c)
+ *    /trace            (flight recorder of every tick for g5500fit, see history.c)
+ *    /schedule[_add,_del,_clear]?...   (see schedule.c)
+ *    /station[?lat=y&lng=x...]   (see celestial.c)
+ *    /track_radec?ra=h&dec=d
+ *    /get_track
+ *    /check_pass?file=f&t=time[&end=time...]   (JSON, see presim.c)
+ *    /passes?file=f[&t=time&hours=h&mask=degs]   (JSON, every pass of a catalog of satellites, see passes.c)
+ *    /pointing_add?body=sun or ?ra=h&dec=d   (sighting for the pointing model, see g5500_direct.c)
+ *    /set_conf?name=value[&name=value...]   (all take effect on the same control tick)
+ *    /get_conf
  *    /help
+ *
+ * in extended mode, set_pos replies also include the predicted arrival and settle times and get_pos replies
+ * also include the unix time and age of the position sample and the axis velocities in degs/sec.
+ *
+ * the rotctld commands are also accepted from several local clients at once on a UNIX socket, by default
+ * G5500_DAEMON_SOCKET, through which the hamlib backend attaches to this daemon rather than owning the mount.
+ * the socket is open only to the daemon's own user and group, and lives in a directory of its own, not in a
+ * world writable one such as /tmp where any user could bind the name while the daemon is down.
+ *
+ * programs that only speak the Yaesu GS-232 or EasyComm serial protocols may open a pty named with -t as if
+ * it were the rotator serial port, see serialemu.c.
+ *
+ * sending SIGUSR2 starts the program file again, presumably a new build, and hands it every connection along
+ * with the complete backend state so it carries on without disturbing clients or the mount, see handoff.c.
+ * if the new instance fails to take over, this one carries on instead.
+ *
+ * with -R the backend control loop runs from this program's select loop on a timer rather than in a thread of
+ * its own, which suits a single core board such as a Pi Zero. commands that would hold the loop for long,
+ * check_pass and passes, are then refused so the ticks keep time.
  */
 
 
@@ -32,10 +70,12 @@
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <time.h>
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <netdb.h>
@@ -54,10 +94,20 @@
 // max number of each client
 #define MAX_ROTCLIENTS          1       // no way for more to know commanded pos of others
 #define MAX_WEBCLIENTS          5       // no problem because all can use get_setpos
+#define MAX_UNIXCLIENTS         10      // local hamlib apps sharing this daemon, see g5500_direct.c
 
 // glue
 #include "version.h"
 #include "g5500_sa.h"
+#include "schedule.h"
+#include "history.h"
+#include "celestial.h"
+#include "g5500client.h"
+#include "handoff.h"
+#include "serialemu.h"
+#include "presim.h"
+#include "passes.h"
+#include "piGPIO.h"
 
 
 // rotctld default listening port, same as rotctld
@@ -70,6 +120,10 @@ static int tcp_rotport = DEF_ROTPORT;
 static int tcp_webport = DEF_WEBPORT;
 
 
+// local rotctld UNIX socket, empty to disable
+static const char *unix_path = G5500_DAEMON_SOCKET;
+
+
 // capture pointer to the persistent capabilities structure
 static struct rot_caps *g5500_rot_caps;
 
@@ -80,6 +134,38 @@ static ROT my_rot;
 // command line options
 int verbose = RIG_DEBUG_ERR;
 static int sim_level = DEF_SIM;
+#define MAX_CONF_ARGS           20      // max -c options
+static char *conf_args[MAX_CONF_ARGS];  // each name=value
+static int n_conf_args;
+static char *sched_file;                // schedule file, NULL for default
+static int handoff_fd = -1;             // -H: socket from which to take over from an old instance
+static char *ser_args[MAX_SER_PORTS];   // -t proto=link
+static int n_ser_args;
+
+
+// roles of the descriptors passed in a handoff
+enum {
+    HO_ROT_SERVER,
+    HO_WEB_SERVER,
+    HO_UNIX_SERVER,
+    HO_ROT_CLIENT,
+    HO_WEB_CLIENT,
+    HO_UNIX_CLIENT,
+    HO_HW_WATCHDOG,
+    HO_GPIO_LINE,                       // + BCM pin number of a GPIO line held by the cdev backend
+    HO_SER_PORT = HO_GPIO_LINE + 64,    // + index in ser_args[], must be last
+};
+
+// our own state passed in a handoff, followed by the backend snapshot
+typedef struct {
+    float setpos_x, setpos_y;
+    int tracking;
+    double track_ra, track_dec;
+} HandOffState;
+static HandOffState handoff_state;      // as received, for what can only resume once running
+
+// set by SIGUSR2 to hand over to a new instance
+static volatile sig_atomic_t upgrade_requested;
 
 // last set_pos
 static float setpos_x, setpos_y;
@@ -108,8 +194,14 @@ static void usage (const char *me, const char *errfmt, ...)
         fprintf (stderr, "Usage: %s [options]\n", me);
         fprintf (stderr, "options:\n");
         fprintf (stderr, "  -V   : display version and exit\n");
+        fprintf (stderr, "  -c n=v : set backend configuration parameter n to value v; may be repeated\n");
+        fprintf (stderr, "  -R   : run the control loop in the main thread, for single core boards\n");
         fprintf (stderr, "  -r p : listen on port p for rotctld commands; default %d\n", DEF_ROTPORT);
+        fprintf (stderr, "  -S f : use schedule file f; default $HOME/.g5500_schedule.txt\n");
         fprintf (stderr, "  -s s : simulation level: 0=real 1=az-only 2=az+el90 3=az+el180; default %d\n", DEF_SIM);
+        fprintf (stderr, "  -t p=l : serve protocol p (gs232a, gs232b or easycomm) on a pty linked from l; may be repeated\n");
+        fprintf (stderr, "  -u f : listen on UNIX socket f for local rotctld commands, \"\" for none; default %s\n",
+                                G5500_DAEMON_SOCKET);
         fprintf (stderr, "  -v   : verbose level, cummulative\n");
         fprintf (stderr, "  -w p : listen on port p for web commands; default %d\n", DEF_WEBPORT);
 
@@ -132,6 +224,27 @@ static void crackArgs (int ac, char *av[])
                     printf ("Version %s\n", VERSION);
                     exit(0);
                     break;
+                case 'H':
+                    // internal, see handoff.c
+                    if (ac < 2)
+                        usage (me, "-H requires handoff socket");
+                    handoff_fd = atoi (*++av);
+                    ac--;
+                    break;
+                case 'c':
+                    if (ac < 2)
+                        usage (me, "-c requires name=value");
+                    if (n_conf_args == MAX_CONF_ARGS)
+                        usage (me, "too many -c options, max %d", MAX_CONF_ARGS);
+                    conf_args[n_conf_args] = *++av;
+                    if (!strchr (conf_args[n_conf_args], '='))
+                        usage (me, "-c requires name=value");
+                    n_conf_args++;
+                    ac--;
+                    break;
+                case 'R':
+                    g5500_direct_set_reactor (1);
+                    break;
                 case 'r':
                     if (ac < 2)
                         usage (me, "-r requires rotctld port");
@@ -140,12 +253,37 @@ static void crackArgs (int ac, char *av[])
                         usage (me, "port must be 1000 .. 65535");
                     ac--;
                     break;
+                case 'S':
+                    if (ac < 2)
+                        usage (me, "-S requires schedule file name");
+                    sched_file = *++av;
+                    ac--;
+                    break;
                 case 's':
                     if (ac < 2)
                         usage (me, "-s requires sim level");
                     sim_level = atoi (*++av);
                     ac--;
                     break;
+                case 't':
+                    if (ac < 2)
+                        usage (me, "-t requires proto=link");
+                    if (n_ser_args == MAX_SER_PORTS)
+                        usage (me, "too many -t options, max %d", MAX_SER_PORTS);
+                    ser_args[n_ser_args] = *++av;
+                    if (!strchr (ser_args[n_ser_args], '='))
+                        usage (me, "-t requires proto=link");
+                    n_ser_args++;
+                    ac--;
+                    break;
+                case 'u':
+                    if (ac < 2)
+                        usage (me, "-u requires UNIX socket path");
+                    unix_path = *++av;
+                    if (strlen (unix_path) >= sizeof(((struct sockaddr_un *)0)->sun_path))
+                        usage (me, "UNIX socket path is too long");
+                    ac--;
+                    break;
                 case 'v':
                     verbose++;
                     break;
@@ -209,13 +347,66 @@ static int prepareServer(int port)
         return (socket_fd);
 }
 
+/* set up a server socket at the given UNIX socket path, replacing any stale socket left there.
+ * the socket is accessible only to our user and group, so a hamlib app may attach if it runs as either, and
+ * its directory is created for us if need be so no other user can take the name while we are not running.
+ * return socket, -1 if the directory can not be created, else exit.
+ */
+static int prepareUnixServer(const char *path)
+{
+        struct sockaddr_un serv_socket;
+        int socket_fd;
+
+        // insure the directory, such as /run needs root or a systemd RuntimeDirectory to create
+        char dir[sizeof(serv_socket.sun_path)];
+        snprintf (dir, sizeof(dir), "%s", path);
+        char *slash = strrchr (dir, '/');
+        if (slash && slash > dir) {
+            *slash = '\0';
+            if (mkdir (dir, 0750) == 0) {
+                rig_debug (RIG_DEBUG_VERBOSE, "created %s\n", dir);
+            } else if (errno != EEXIST) {
+                rig_debug (RIG_DEBUG_ERR, "mkdir %s: %s, so no UNIX socket, see -u\n", dir, strerror(errno));
+                return (-1);
+            }
+        }
+
+        // create socket endpoint
+        if ((socket_fd = socket (AF_UNIX, SOCK_STREAM, 0)) < 0) {
+            rig_debug (RIG_DEBUG_ERR, "socket(AF_UNIX): %s\n", strerror(errno));
+            exit(1);
+        }
+
+        // bind to path
+        memset (&serv_socket, 0, sizeof(serv_socket));
+        serv_socket.sun_family = AF_UNIX;
+        strcpy (serv_socket.sun_path, path);
+        (void) unlink (path);
+        if (bind(socket_fd, (struct sockaddr*)&serv_socket, sizeof(serv_socket)) < 0) {
+            rig_debug (RIG_DEBUG_ERR, "bind to %s: %s\n", path, strerror(errno));
+            exit(1);
+        }
+        if (chmod (path, 0660) < 0)
+            rig_debug (RIG_DEBUG_ERR, "chmod %s: %s\n", path, strerror(errno));
+        rig_debug (RIG_DEBUG_VERBOSE, "bind %s ok\n", path);
+
+        // prepare a listening server socket
+        if (listen (socket_fd, 5) < 0) {
+            rig_debug (RIG_DEBUG_ERR, "listen for %s: %s\n", path, strerror(errno));
+            exit(1);
+        }
+        rig_debug (RIG_DEBUG_VERBOSE, "listen %s ok on socket %d\n", path, socket_fd);
+
+        return (socket_fd);
+}
+
 /* accept a new client on the given server socket, known to be knocking on the door.
  * return rw FILE* else exit if trouble.
  */
 static FILE *acceptNewClient(int server_socket)
 {
         // accept client
-        struct sockaddr_in cli_socket;
+        struct sockaddr_storage cli_socket;
         socklen_t cli_len = sizeof(cli_socket);
         int cli_fd = accept (server_socket, (struct sockaddr *)&cli_socket, &cli_len);
         if (cli_fd < 0) {
@@ -224,9 +415,10 @@ static FILE *acceptNewClient(int server_socket)
         }
         rig_debug (RIG_DEBUG_VERBOSE, "accept ok on socket %d\n", cli_fd);
 
-        // disable Nagle algorithm to reduce latency for small packets
+        // disable Nagle algorithm to reduce latency for small packets, not applicable to UNIX sockets
         int flag = 1;
-        if (setsockopt(cli_fd, IPPROTO_TCP, TCP_NODELAY, (char *) &flag, sizeof(int)) < 0) {
+        if (cli_socket.ss_family != AF_UNIX
+                        && setsockopt(cli_fd, IPPROTO_TCP, TCP_NODELAY, (char *) &flag, sizeof(int)) < 0) {
             rig_debug (RIG_DEBUG_ERR, "setsockopt(TCP_NODELAY): %s\n", strerror(errno));
         }
 
@@ -271,6 +463,167 @@ void rig_debug (int level, const char *fmt, ...)
         }
 }
 
+/* set a new rotator position and record it for get_setpos.
+ * all front ends command motion through these so they share one notion of the commanded position.
+ * return RIG_OK or a negative RIG_* error code.
+ */
+int rotSetPos (float az, float el)
+{
+        int err = (*g5500_rot_caps->set_position) (&my_rot, az, el);
+        if (err == RIG_OK) {
+            setpos_x = az;
+            setpos_y = el;
+        }
+        return (err);
+}
+
+/* park the rotator and record the park position for get_setpos.
+ * return RIG_OK or a negative RIG_* error code.
+ */
+int rotPark (void)
+{
+        int err = (*g5500_rot_caps->park) (&my_rot);
+        if (err == RIG_OK) {
+            setpos_x = 0;
+            setpos_y = 0;
+        }
+        return (err);
+}
+
+/* stop all rotator motion.
+ * return RIG_OK or a negative RIG_* error code.
+ */
+int rotStop (void)
+{
+        return ((*g5500_rot_caps->stop) (&my_rot));
+}
+
+/* start moving one axis in the given ROT_MOVE_* direction until stopped or it reaches its limit.
+ * return RIG_OK or a negative RIG_* error code.
+ */
+int rotMove (int direction)
+{
+        return ((*g5500_rot_caps->move) (&my_rot, direction, 0));
+}
+
+/* set the backend configuration parameter with the given name to the given value.
+ * return RIG_OK or a negative RIG_* error, with brief excuse in ynot[ynot_len].
+ */
+int rotSetConf (const char *name, const char *value, char ynot[], size_t ynot_len)
+{
+        // find parameter token
+        for (const struct confparams *cp = g5500_rot_caps->cfgparams; cp->token != RIG_CONF_END; cp++) {
+            if (strcmp (cp->name, name) == 0) {
+                if (cp->type == RIG_CONF_NUMERIC) {
+                    float v = atof (value);
+                    if (v < cp->u.n.min || v > cp->u.n.max) {
+                        snprintf (ynot, ynot_len, "%s must be %g .. %g", name, cp->u.n.min, cp->u.n.max);
+                        return (-RIG_EINVAL);
+                    }
+                }
+                int err = (*g5500_rot_caps->set_conf)(&my_rot, cp->token, value);
+                if (err != RIG_OK)
+                    snprintf (ynot, ynot_len, "%s=%s failed, code %d", name, value, err);
+                return (err);
+            }
+        }
+
+        snprintf (ynot, ynot_len, "unknown parameter %s", name);
+        return (-RIG_EINVAL);
+}
+
+/* get the current value of the backend configuration parameter with the given name into val[val_len], which
+ * must have room for the longest value the backend reports.
+ * return RIG_OK or a negative RIG_* error, with brief excuse in val[].
+ */
+static int getConfParam (const char *name, char val[], size_t val_len)
+{
+        for (const struct confparams *cp = g5500_rot_caps->cfgparams; cp->token != RIG_CONF_END; cp++) {
+            if (strcmp (cp->name, name) == 0) {
+                int err = (*g5500_rot_caps->get_conf)(&my_rot, cp->token, val);
+                if (err != RIG_OK)
+                    snprintf (val, val_len, "%s failed, code %d", name, err);
+                return (err);
+            }
+        }
+
+        snprintf (val, val_len, "unknown parameter %s", name);
+        return (-RIG_EINVAL);
+}
+
+/* set each name=value in the given &-separated list so they all take effect on the same control tick.
+ * stops at the first failure.
+ * return RIG_OK or a negative RIG_* error, with brief excuse in ynot[ynot_len].
+ */
+static int setConfParams (char *list, char ynot[], size_t ynot_len)
+{
+        int err = RIG_OK;
+
+        g5500_direct_hold_conf (1);
+        for (char *pair = strtok (list, "&"); pair && err == RIG_OK; pair = strtok (NULL, "&")) {
+            char *eq = strchr (pair, '=');
+            if (!eq) {
+                snprintf (ynot, ynot_len, "%s: expecting name=value", pair);
+                err = -RIG_EINVAL;
+            } else {
+                *eq = '\0';
+                err = rotSetConf (pair, eq+1, ynot, ynot_len);
+            }
+        }
+        g5500_direct_hold_conf (0);
+
+        return (err);
+}
+
+/* copy the URL-decoded value of the given name in query string q to value[].
+ * return 0 if found else -1
+ */
+int queryArg (const char *q, const char *name, char value[], size_t len)
+{
+        size_t nl = strlen (name);
+
+        while (q && *q) {
+            if (strncmp (q, name, nl) == 0 && q[nl] == '=') {
+                const char *v = q + nl + 1;
+                size_t n = 0;
+                while (*v && *v != '&' && n < len-1) {
+                    unsigned hex;
+                    if (*v == '%' && sscanf (v+1, "%2x", &hex) == 1) {
+                        value[n++] = (char) hex;
+                        v += 3;
+                    } else {
+                        value[n++] = *v == '+' ? ' ' : *v;
+                        v++;
+                    }
+                }
+                value[n] = '\0';
+                return (0);
+            }
+            q = strchr (q, '&');
+            if (q)
+                q++;
+        }
+        return (-1);
+}
+
+/* print s to fp as a quoted JSON string, escaping quotes, backslashes and control characters.
+ * names and excuses may hold anything a query decoded.
+ */
+void putJSONString (FILE *fp, const char *s)
+{
+        fputc ('"', fp);
+        for (; *s; s++) {
+            unsigned char c = (unsigned char) *s;
+            if (c == '"' || c == '\\')
+                fprintf (fp, "\\%c", c);
+            else if (c < 0x20 || c == 0x7f)
+                fprintf (fp, "\\u%04x", c);
+            else
+                fputc (c, fp);
+        }
+        fputc ('"', fp);
+}
+
 /* return 0 if punctuation character p is one of the legal prefix command characters, else -1
  */
 static int punctOk (char p)
@@ -352,8 +705,10 @@ static int punctOk (char p)
 static int runRotator (FILE *fp)
 {
         char buf[100];
-        int a, b;
+        char name[64], value[64], file[100], ynot[300];
+        int a, b, n;
         float x, y;
+        double ra, dec;
         int err;
         char p;
 #define MOD_FOR_GPREDICT
@@ -430,14 +785,18 @@ static int runRotator (FILE *fp)
             }
 
         } else if (strcmp (buf+1, "\\get_pos") == 0 && punctOk (buf[0]) == 0) {
-            // extended protocol
-            err = (*g5500_rot_caps->get_position) (&my_rot, &x, &y);
+            // extended protocol, also includes sample time, age and axis velocities when ok
+            G5500Position pos;
+            err = g5500_direct_get_position_ex (&pos);
             p = buf[0];
             if (p == '+')
                 p = '\n';
-            if (err != RIG_OK)
-                x = y = 0;
-            fprintf (fp, "get_pos:%cAzimuth: %g%cElevation: %g%cRPRT %d\n", p, x, p, y, p, err);
+            if (err == RIG_OK)
+                fprintf (fp, "get_pos:%cAzimuth: %g%cElevation: %g%cTimestamp: %.3f%cAge: %.3f%c"
+                                "Az velocity: %.2f%cEl velocity: %.2f%cRPRT %d\n",
+                                p, pos.az, p, pos.el, p, pos.t, p, pos.age, p, pos.az_vel, p, pos.el_vel, p, err);
+            else
+                fprintf (fp, "get_pos:%cAzimuth: 0%cElevation: 0%cRPRT %d\n", p, p, p, err);
 
 
 
@@ -446,22 +805,21 @@ static int runRotator (FILE *fp)
         } else if (sscanf (buf, "P %g %g", &x, &y) == 2
                                     || sscanf (buf, "\\set_pos %g %g", &x, &y) == 2) {
             // default protocol
-            err = (*g5500_rot_caps->set_position) (&my_rot, x, y);
+            err = rotSetPos (x, y);
             fprintf (fp, "RPRT %d\n", err);
-            if (err == RIG_OK) {
-                setpos_x = x;
-                setpos_y = y;
-            }
 
         } else if (sscanf(buf, "%c\\set_pos %g %g", &p, &x, &y) == 3 && punctOk(p) == 0) {
-            // extended protocol
-            err = (*g5500_rot_caps->set_position) (&my_rot, x, y);
+            // extended protocol, includes predicted arrival times when ok
+            err = rotSetPos (x, y);
             if (p == '+')
                 p = '\n';
-            fprintf (fp, "set_pos: %g %g%cRPRT %d\n", x, y, p, err);
             if (err == RIG_OK) {
-                setpos_x = x;
-                setpos_y = y;
+                G5500Status st;
+                g5500_direct_get_status (&st);
+                fprintf (fp, "set_pos: %g %g%cAz ETA: %.1f%cEl ETA: %.1f%cSettle: %.1f%cRPRT %d\n",
+                                x, y, p, st.az_eta, p, st.el_eta, p, st.settle, p, err);
+            } else {
+                fprintf (fp, "set_pos: %g %g%cRPRT %d\n", x, y, p, err);
             }
 
 
@@ -486,11 +844,11 @@ static int runRotator (FILE *fp)
 
         } else if (strcmp (buf, "K") == 0 || strcmp (buf, "\\park") == 0) {
             // default protocol
-            err = (*g5500_rot_caps->park) (&my_rot);
+            err = rotPark();
             fprintf (fp, "RPRT %d\n", err);
         } else if (strcmp (buf+1, "\\park") == 0 && punctOk (buf[0]) == 0) {
             // extended protocol
-            err = (*g5500_rot_caps->park) (&my_rot);
+            err = rotPark();
             p = buf[0];
             if (p == '+')
                 p = '\n';
@@ -502,11 +860,11 @@ static int runRotator (FILE *fp)
 
         } else if (strcmp (buf, "S") == 0 || strcmp (buf, "\\stop") == 0) {
             // default protocol
-            err = (*g5500_rot_caps->stop) (&my_rot);
+            err = rotStop();
             fprintf (fp, "RPRT %d\n", err);
         } else if (strcmp (buf+1, "\\stop") == 0 && punctOk (buf[0]) == 0) {
             // extended protocol
-            err = (*g5500_rot_caps->stop) (&my_rot);
+            err = rotStop();
             p = buf[0];
             if (p == '+')
                 p = '\n';
@@ -528,6 +886,136 @@ static int runRotator (FILE *fp)
 
 
 
+        // get_eta -- not in hamlib
+
+        } else if (strcmp (buf, "\\get_eta") == 0) {
+            // default protocol
+            G5500Status st;
+            err = g5500_direct_get_status (&st);
+            if (err == RIG_OK) {
+                fprintf (fp, "%.1f\n%.1f\n%.1f\n", st.az_eta, st.el_eta, st.settle);
+            } else {
+                fprintf (fp, "RPRT %d\n", err);
+            }
+        } else if (strcmp (buf+1, "\\get_eta") == 0 && punctOk (buf[0]) == 0) {
+            // extended protocol
+            G5500Status st;
+            err = g5500_direct_get_status (&st);
+            p = buf[0];
+            if (p == '+')
+                p = '\n';
+            fprintf (fp, "get_eta:%cAz ETA: %.1f%cEl ETA: %.1f%cSettle: %.1f%cRPRT %d\n",
+                                p, st.az_eta, p, st.el_eta, p, st.settle, p, err);
+
+
+
+        // track_radec -- not in hamlib
+
+        } else if (sscanf (buf, "\\track_radec %lf %lf", &ra, &dec) == 2) {
+            // default protocol
+            err = celTrackRADec (ra, dec, ynot);
+            fprintf (fp, "RPRT %d\n", err);
+        } else if (sscanf (buf, "%c\\track_radec %lf %lf", &p, &ra, &dec) == 3 && punctOk (p) == 0) {
+            // extended protocol
+            err = celTrackRADec (ra, dec, ynot);
+            if (p == '+')
+                p = '\n';
+            fprintf (fp, "track_radec: %g %g%cRPRT %d\n", ra, dec, p, err);
+
+
+
+        // get_track -- not in hamlib
+
+        } else if (strcmp (buf, "\\get_track") == 0) {
+            // default protocol
+            if (celGetTrack (&ra, &dec))
+                fprintf (fp, "%.6f\n%.5f\n", ra, dec);
+            else
+                fprintf (fp, "RPRT %d\n", -RIG_ENAVAIL);
+        } else if (strcmp (buf+1, "\\get_track") == 0 && punctOk (buf[0]) == 0) {
+            // extended protocol
+            p = buf[0];
+            if (p == '+')
+                p = '\n';
+            if (celGetTrack (&ra, &dec))
+                fprintf (fp, "get_track:%cRA: %.6f%cDec: %.5f%cRPRT 0\n", p, ra, p, dec, p);
+            else
+                fprintf (fp, "get_track:%cRPRT %d\n", p, -RIG_ENAVAIL);
+
+
+
+        // check_pass -- not in hamlib
+
+        } else if ((n = sscanf (buf, "\\check_pass %99s %63s %63s", file, name, value)) >= 2
+                        || ((n = sscanf (buf, "%c\\check_pass %99s %63s %63s", &p, file, name, value)) >= 3
+                                && punctOk (p) == 0)) {
+            G5500Presim r;
+            double t0, t1 = 0;
+            int extended = buf[0] != '\\';
+            if (schedParseTime (name, &t0) < 0 || (n == 3 + extended && schedParseTime (value, &t1) < 0)) {
+                err = -RIG_EINVAL;
+            } else {
+                char sat[200];
+                err = presimRun (file, NULL, t0, t1, 0, PRESIM_TOL, &r, sat, sizeof(sat), ynot);
+            }
+            if (!extended) {
+                // default protocol
+                if (err == RIG_OK)
+                    fprintf (fp, "%.2f\n%.2f\n%.1f\n%d\n%d\n", r.rms_err, r.max_err, r.on_target, r.unwinds,
+                                r.completed);
+                else
+                    fprintf (fp, "RPRT %d\n", err);
+            } else {
+                // extended protocol
+                if (p == '+')
+                    p = '\n';
+                if (err == RIG_OK)
+                    fprintf (fp, "check_pass: %s%cRMS error: %.2f%cMax error: %.2f%cOn target: %.1f%cUnwinds: %d"
+                                 "%cCompleted: %d%cRPRT 0\n", file, p, r.rms_err, p, r.max_err, p, r.on_target, p,
+                                 r.unwinds, p, r.completed, p);
+                else
+                    fprintf (fp, "check_pass: %s%cRPRT %d\n", file, p, err);
+            }
+
+
+
+        // set_conf, C
+
+        } else if (sscanf (buf, "C %63s %63s", name, value) == 2
+                                    || sscanf (buf, "\\set_conf %63s %63s", name, value) == 2) {
+            // default protocol
+            err = rotSetConf (name, value, ynot, sizeof(ynot));
+            fprintf (fp, "RPRT %d\n", err);
+        } else if (sscanf (buf, "%c\\set_conf %63s %63s", &p, name, value) == 3 && punctOk (p) == 0) {
+            // extended protocol
+            err = rotSetConf (name, value, ynot, sizeof(ynot));
+            if (p == '+')
+                p = '\n';
+            fprintf (fp, "set_conf: %s %s%cRPRT %d\n", name, value, p, err);
+
+
+
+        // get_conf
+
+        } else if (sscanf (buf, "\\get_conf %63s", name) == 1) {
+            // default protocol
+            err = getConfParam (name, value, sizeof(value));
+            if (err == RIG_OK)
+                fprintf (fp, "%s\n", value);
+            else
+                fprintf (fp, "RPRT %d\n", err);
+        } else if (sscanf (buf, "%c\\get_conf %63s", &p, name) == 2 && punctOk (p) == 0) {
+            // extended protocol
+            err = getConfParam (name, value, sizeof(value));
+            if (p == '+')
+                p = '\n';
+            if (err == RIG_OK)
+                fprintf (fp, "get_conf: %s%cValue: %s%cRPRT %d\n", name, p, value, p, err);
+            else
+                fprintf (fp, "get_conf: %s%cRPRT %d\n", name, p, err);
+
+
+
         // dump_caps, 1   -- does not follow standard protocol
 
         } else if (strcmp (buf, "1") == 0 || strcmp (buf, "\\dump_caps") == 0
@@ -583,6 +1071,44 @@ static void startPlainTextHTTP(FILE *fp)
         fprintf (fp, "\r\n");
 }
 
+/* send the http preamble for JSON content
+ */
+static void startJSONHTTP(FILE *fp)
+{
+        fprintf (fp, "HTTP/1.0 200 OK\r\n");
+        fprintf (fp, "User-Agent: g5500_sa\r\n");
+        fprintf (fp, "Content-Type: application/json\r\n");
+        fprintf (fp, "Connection: close\r\n");
+        fprintf (fp, "\r\n");
+}
+
+/* send the current backend status as one JSON object
+ */
+static void sendStatusJSON (FILE *fp)
+{
+        G5500Status st;
+        g5500_direct_get_status (&st);
+
+        fprintf (fp, "{\"state\":\"%s\",\"err\":%d,", st.state, st.err);
+        fprintf (fp, "\"az\":%.2f,\"el\":%.2f,", st.az, st.el);
+        fprintf (fp, "\"az_target\":%.2f,\"el_target\":%.2f,", st.az_target, st.el_target);
+        fprintf (fp, "\"setpos_az\":%g,\"setpos_el\":%g,", setpos_x, setpos_y);
+        fprintf (fp, "\"az_dir\":%d,\"el_dir\":%d,", st.az_dir, st.el_dir);
+        fprintf (fp, "\"az_eta\":%.1f,\"el_eta\":%.1f,\"settle\":%.1f,", st.az_eta, st.el_eta, st.settle);
+        fprintf (fp, "\"age\":%.3f,\"stale\":%d,", st.age, st.stale);
+        fprintf (fp, "\"az_source\":\"%s\",\"el_source\":\"%s\",\"enc_faults\":%d,\"imu_faults\":%d,",
+                                st.az_source, st.el_source, st.enc_faults, st.imu_faults);
+        fprintf (fp, "\"az_heat\":%.3f,\"el_heat\":%.3f,\"az_run_left\":%.0f,\"el_run_left\":%.0f,"
+                     "\"az_cooling\":%d,\"el_cooling\":%d,\"cooldowns\":%d,",
+                                st.az_heat, st.el_heat, st.az_run_left, st.el_run_left, st.az_cooling, st.el_cooling,
+                                st.cooldowns);
+        fprintf (fp, "\"wd_misses\":%d,\"wd_response\":%.3f,\"wd_response_max\":%.3f,",
+                                st.wd_misses, st.wd_response, st.wd_response_max);
+        fprintf (fp, "\"i2c_xfers\":%d,\"i2c_waits\":%d,\"i2c_timeouts\":%d,\"i2c_wait_max\":%.4f,"
+                     "\"i2c_wait_pid\":%d,\"i2c_others\":%d}\n", st.i2c_xfers, st.i2c_waits, st.i2c_timeouts,
+                                st.i2c_wait_max, st.i2c_wait_pid, st.i2c_others);
+}
+
 /* run one web or direct command known to be pending on fp.
  * web: always fclose after replying and return -1.
  * direct: return -1 if io trouble else leave open and return 0.
@@ -649,12 +1175,10 @@ static int runWeb (FILE *fp)
 
             if (is_http)
                 startPlainTextHTTP(fp);
-            int err = (*g5500_rot_caps->set_position) (&my_rot, x, y);
-            if (err == RIG_OK) {
+            int err = rotSetPos (x, y);
+            if (err == RIG_OK)
                 fprintf (fp, "ok\n");
-                setpos_x = x;
-                setpos_y = y;
-            } else
+            else
                 fprintf (fp, "err: can not set position, code %d\n", err);
 
         } else if (sscanf (cmd, "move?direction=%10s", move_dir) == 1) {
@@ -674,7 +1198,7 @@ static int runWeb (FILE *fp)
             if (dir == 999) {
                 fprintf (fp, "err: unknown direction\n");
             } else {
-                int err = (*g5500_rot_caps->move) (&my_rot, dir, 0);
+                int err = rotMove (dir);
                 if (err == RIG_OK)
                     fprintf (fp, "ok\n");
                 else
@@ -691,19 +1215,17 @@ static int runWeb (FILE *fp)
 
             if (is_http)
                 startPlainTextHTTP(fp);
-            int err = (*g5500_rot_caps->park) (&my_rot);
-            if (err == RIG_OK) {
+            int err = rotPark();
+            if (err == RIG_OK)
                 fprintf (fp, "ok\n");
-                setpos_x = 0;
-                setpos_y = 0;
-            } else
+            else
                 fprintf (fp, "err: error parking, code %d\n", err);
 
         } else if (strcmp (cmd, "stop") == 0) {
 
             if (is_http)
                 startPlainTextHTTP(fp);
-            int err = (*g5500_rot_caps->stop) (&my_rot);
+            int err = rotStop();
             if (err == RIG_OK)
                 fprintf (fp, "ok\n");
             else
@@ -723,6 +1245,79 @@ static int runWeb (FILE *fp)
                         g5500_rot_caps->min_az, g5500_rot_caps->max_az,
                         g5500_rot_caps->min_el, g5500_rot_caps->max_el);
 
+        } else if (strcmp (cmd, "get_eta") == 0) {
+
+            if (is_http)
+                startPlainTextHTTP(fp);
+            G5500Status st;
+            int err = g5500_direct_get_status (&st);
+            if (err == RIG_OK)
+                fprintf (fp, "%.1f %.1f %.1f\n", st.az_eta, st.el_eta, st.settle);
+            else
+                fprintf (fp, "err: can not get eta, code %d\n", err);
+
+        } else if (strcmp (cmd, "status") == 0) {
+
+            if (is_http)
+                startJSONHTTP(fp);
+            sendStatusJSON (fp);
+
+        } else if (strcmp (cmd, "history") == 0 || strncmp (cmd, "history?", 8) == 0) {
+
+            histWebCommand (fp, cmd, is_http);
+
+        } else if (strcmp (cmd, "trace") == 0) {
+
+            if (is_http)
+                startPlainTextHTTP(fp);
+            histTraceWebCommand (fp);
+
+        } else if (strncmp (cmd, "schedule", 8) == 0) {
+
+            if (is_http)
+                startPlainTextHTTP(fp);
+            schedWebCommand (fp, cmd);
+
+        } else if (strcmp (cmd, "station") == 0 || strncmp (cmd, "station?", 8) == 0
+                        || strncmp (cmd, "track_radec?", 12) == 0 || strcmp (cmd, "get_track") == 0
+                        || strncmp (cmd, "pointing_add?", 13) == 0) {
+
+            if (is_http)
+                startPlainTextHTTP(fp);
+            celWebCommand (fp, cmd);
+
+        } else if (strncmp (cmd, "check_pass?", 11) == 0) {
+
+            if (is_http)
+                startJSONHTTP(fp);
+            presimWebCommand (fp, cmd);
+
+        } else if (strncmp (cmd, "passes?", 7) == 0) {
+
+            if (is_http)
+                startJSONHTTP(fp);
+            passWebCommand (fp, cmd);
+
+        } else if (strncmp (cmd, "set_conf?", 9) == 0) {
+
+            if (is_http)
+                startPlainTextHTTP(fp);
+            char ynot[100];
+            if (setConfParams (cmd+9, ynot, sizeof(ynot)) == RIG_OK)
+                fprintf (fp, "ok\n");
+            else
+                fprintf (fp, "err: %s\n", ynot);
+
+        } else if (strcmp (cmd, "get_conf") == 0) {
+
+            if (is_http)
+                startPlainTextHTTP(fp);
+            for (const struct confparams *cp = g5500_rot_caps->cfgparams; cp->token != RIG_CONF_END; cp++) {
+                char val[100];
+                if (getConfParam (cp->name, val, sizeof(val)) == RIG_OK)
+                    fprintf (fp, "%s=%s\n", cp->name, val);
+            }
+
         } else if (strcmp (cmd, "help") == 0) {
 
             if (is_http)
@@ -736,6 +1331,22 @@ static int runWeb (FILE *fp)
             fprintf (fp, "    stop\n");
             fprintf (fp, "    get_info\n");
             fprintf (fp, "    dump_caps\n");
+            fprintf (fp, "    get_eta\n");
+            fprintf (fp, "    status\n");
+            fprintf (fp, "    history?since=t&max_points=n&fmt=[json,bin]\n");
+            fprintf (fp, "    trace\n");
+            fprintf (fp, "    schedule\n");
+            fprintf (fp, "    schedule_add?t=time&cmd=[goto&az=x&el=y,park,stop,track&file=f,radec&ra=h&dec=d]\n");
+            fprintf (fp, "    schedule_del?id=n\n");
+            fprintf (fp, "    schedule_clear\n");
+            fprintf (fp, "    station[?lat=y&lng=x&elev=m&temp=c&pressure=hPa]\n");
+            fprintf (fp, "    track_radec?ra=h&dec=d\n");
+            fprintf (fp, "    get_track\n");
+            fprintf (fp, "    pointing_add?[body=sun,ra=h&dec=d]\n");
+            fprintf (fp, "    check_pass?file=f[&sat=name]&t=time[&end=time&mask=degs&tol=degs]\n");
+            fprintf (fp, "    passes?file=f[&t=time&hours=h&mask=degs]\n");
+            fprintf (fp, "    set_conf?name=value[&name=value...]\n");
+            fprintf (fp, "    get_conf\n");
 
 
         } else if (strcmp (cmd, "index.html") == 0 || strlen(cmd) == 0) {
@@ -760,10 +1371,12 @@ static int runWeb (FILE *fp)
 }
 
 
-/* call rotator's init once and set sim level
+/* call rotator's init once then set sim level and any -c parameters
  */
 static void initRotator()
 {
+        char ynot[100];
+        char strval[20];
         int err;
 
         // init
@@ -773,23 +1386,26 @@ static void initRotator()
             exit(1);
         }
 
-        // find simulation paramter token
-        for (const struct confparams *cp = g5500_rot_caps->cfgparams; cp->token != RIG_CONF_END; cp++) {
-            if (strcmp (cp->name, "simulator") == 0) {
-                if (sim_level < cp->u.n.min || sim_level > cp->u.n.max) {
-                    rig_debug (RIG_DEBUG_ERR, "sim level %d must be %g .. %g\n", sim_level,
-                                                                cp->u.n.min, cp->u.n.max);
-                    exit(1);
-                } else {
-                    char strval[20];
-                    snprintf (strval, sizeof(strval), "%d", sim_level);
-                    err = (*g5500_rot_caps->set_conf)(&my_rot, cp->token, strval);
-                    if (err != RIG_OK) {
-                        rig_debug (RIG_DEBUG_ERR, "sim level %d failed\n", sim_level);
-                        exit (1);
-                    }
-                    break;
-                }
+        // a handoff already includes all settings
+        if (handoff_fd >= 0)
+            return;
+
+        // sim level first because it resets much of the backend state
+        snprintf (strval, sizeof(strval), "%d", sim_level);
+        if (rotSetConf ("simulator", strval, ynot, sizeof(ynot)) != RIG_OK) {
+            rig_debug (RIG_DEBUG_ERR, "sim level: %s\n", ynot);
+            exit(1);
+        }
+
+        // then each name=value in the order given
+        for (int i = 0; i < n_conf_args; i++) {
+            char *eq = strchr (conf_args[i], '=');
+            *eq = '\0';
+            err = rotSetConf (conf_args[i], eq+1, ynot, sizeof(ynot));
+            *eq = '=';
+            if (err != RIG_OK) {
+                rig_debug (RIG_DEBUG_ERR, "-c %s: %s\n", conf_args[i], ynot);
+                exit(1);
             }
         }
 }
@@ -819,6 +1435,15 @@ static void onSU1 (int unused)
             verbose = RIG_DEBUG_ERR;
 }
 
+/* request a handoff to a new instance, see upgrade()
+ */
+static void onSU2 (int unused)
+{
+        (void) unused;
+
+        upgrade_requested = 1;
+}
+
 /* try to stop then exit
  */
 static void onAnyStopSignal (int unused)
@@ -889,6 +1514,199 @@ static int checkForNewClient (fd_set *fdsp, int server, FILE *clients[], int max
         return (0);
 }
 
+/* add fd to fds[*n_fdsp] with the given role.
+ * return 0 if ok else -1 if fds[] is already full
+ */
+static int addHandOffFD (HandOffFD fds[], int *n_fdsp, int fd, int role)
+{
+        if (*n_fdsp >= MAX_HANDOFF_FDS)
+            return (-1);
+        fds[*n_fdsp].fd = fd;
+        fds[*n_fdsp].role = role;
+        (*n_fdsp)++;
+        return (0);
+}
+
+/* add each open client to fds[*n_fdsp] with the given role.
+ * return 0 if ok else -1 if fds[] is full
+ */
+static int addHandOffClients (HandOffFD fds[], int *n_fdsp, FILE *clients[], int n_clients, int role)
+{
+        for (int i = 0; i < n_clients; i++)
+            if (clients[i] && addHandOffFD (fds, n_fdsp, fileno (clients[i]), role) < 0)
+                return (-1);
+        return (0);
+}
+
+/* hand everything over to a new instance of our program file.
+ * only returns if the new instance did not take over, in which case we carry on as before.
+ */
+static void upgrade (int rot_server, int web_server, int unix_server,
+                FILE *rot_clients[], FILE *web_clients[], FILE *unix_clients[])
+{
+        char ynot[1024];
+
+        struct timespec ts0;
+        clock_gettime (CLOCK_MONOTONIC, &ts0);
+
+        // hold the control loop still between ticks
+        if (g5500_direct_freeze() < 0) {
+            rig_debug (RIG_DEBUG_ERR, "upgrade refused while calibrating or tuning, try again later\n");
+            return;
+        }
+
+        // capture our state and the backend
+        size_t max_len = sizeof(HandOffState) + g5500_direct_snapshot_size();
+        HandOffState *sp = (HandOffState *) malloc (max_len);
+        if (!sp) {
+            rig_debug (RIG_DEBUG_ERR, "upgrade: no memory\n");
+            g5500_direct_thaw();
+            return;
+        }
+        sp->setpos_x = setpos_x;
+        sp->setpos_y = setpos_y;
+        sp->tracking = celGetTrack (&sp->track_ra, &sp->track_dec);
+        int hw_fd;
+        size_t len = sizeof(*sp) + g5500_direct_snapshot (sp + 1, max_len - sizeof(*sp), &hw_fd);
+
+        // collect all descriptors, refusing rather than leave any behind
+        HandOffFD fds[MAX_HANDOFF_FDS];
+        int n_fds = 0;
+        int full = addHandOffFD (fds, &n_fds, rot_server, HO_ROT_SERVER) < 0
+                        || addHandOffFD (fds, &n_fds, web_server, HO_WEB_SERVER) < 0
+                        || (unix_server >= 0 && addHandOffFD (fds, &n_fds, unix_server, HO_UNIX_SERVER) < 0)
+                        || (hw_fd >= 0 && addHandOffFD (fds, &n_fds, hw_fd, HO_HW_WATCHDOG) < 0);
+        uint8_t pins[MAX_HANDOFF_FDS];
+        int line_fds[MAX_HANDOFF_FDS];
+        int n_lines = piGPIOgetLines (pins, line_fds, MAX_HANDOFF_FDS);
+        for (int i = 0; !full && i < n_lines; i++)
+            full = addHandOffFD (fds, &n_fds, line_fds[i], HO_GPIO_LINE + pins[i]) < 0;
+        full = full || addHandOffClients (fds, &n_fds, rot_clients, MAX_ROTCLIENTS, HO_ROT_CLIENT) < 0
+                    || addHandOffClients (fds, &n_fds, web_clients, MAX_WEBCLIENTS, HO_WEB_CLIENT) < 0
+                    || addHandOffClients (fds, &n_fds, unix_clients, MAX_UNIXCLIENTS, HO_UNIX_CLIENT) < 0;
+        for (int i = 0; !full && serFD(i) >= 0; i++)
+            full = addHandOffFD (fds, &n_fds, serFD(i), HO_SER_PORT + i) < 0;
+        if (full) {
+            rig_debug (RIG_DEBUG_ERR, "upgrade refused: more than %d descriptors to hand over\n",
+                                MAX_HANDOFF_FDS);
+            free (sp);
+            g5500_direct_thaw();
+            return;
+        }
+
+        // go
+        int err = handOffSend (fds, n_fds, sp, len, ynot);
+        free (sp);
+        if (err == 0) {
+            struct timespec ts1;
+            clock_gettime (CLOCK_MONOTONIC, &ts1);
+            printf ("handed over to new instance in %.1f ms\n",
+                        (ts1.tv_sec - ts0.tv_sec)*1e3 + (ts1.tv_nsec - ts0.tv_nsec)*1e-6);
+            exit(0);
+        }
+
+        rig_debug (RIG_DEBUG_ERR, "upgrade failed: %s\n", ynot);
+        g5500_direct_thaw();
+}
+
+/* receive everything from the old instance on handoff_fd and pass the backend snapshot on for rot_init.
+ * exit if trouble, in which case the old instance carries on.
+ */
+static void receiveHandOff (HandOffFD fds[], int *n_fdsp)
+{
+        char ynot[1024];
+        void *state;
+        size_t len;
+
+        if (handOffReceive (handoff_fd, fds, n_fdsp, &state, &len, ynot) < 0) {
+            rig_debug (RIG_DEBUG_ERR, "handoff: %s\n", ynot);
+            exit(1);
+        }
+        if (len < sizeof(HandOffState)) {
+            rig_debug (RIG_DEBUG_ERR, "handoff: state is short\n");
+            exit(1);
+        }
+
+        // the GPIO lines must be ours before rot_init makes them outputs
+        int hw_fd = -1;
+        for (int i = 0; i < *n_fdsp; i++) {
+            if (fds[i].role == HO_HW_WATCHDOG)
+                hw_fd = fds[i].fd;
+            else if (fds[i].role >= HO_GPIO_LINE && fds[i].role < HO_SER_PORT)
+                piGPIOadoptLine (fds[i].role - HO_GPIO_LINE, fds[i].fd);
+        }
+
+        HandOffState *sp = (HandOffState *) state;
+        if (g5500_direct_restore (sp + 1, len - sizeof(*sp), hw_fd, ynot) < 0) {
+            rig_debug (RIG_DEBUG_ERR, "handoff: %s\n", ynot);
+            exit(1);
+        }
+        setpos_x = sp->setpos_x;
+        setpos_y = sp->setpos_y;
+        handoff_state = *sp;
+
+        free (state);
+}
+
+/* adopt the servers, clients and serial port masters received in a handoff
+ */
+static void adoptHandOff (HandOffFD fds[], int n_fds, int *rot_serverp, int *web_serverp, int *unix_serverp,
+                FILE *rot_clients[], FILE *web_clients[], FILE *unix_clients[], int ser_fds[])
+{
+        int n_rot = 0, n_web = 0, n_unix = 0;
+
+        for (int i = 0; i < n_fds; i++) {
+            int fd = fds[i].fd;
+            FILE **clients = NULL;
+            int *np = NULL;
+            int max = 0;
+
+            switch (fds[i].role) {
+            case HO_ROT_SERVER:  *rot_serverp = fd; continue;
+            case HO_WEB_SERVER:  *web_serverp = fd; continue;
+            case HO_UNIX_SERVER: *unix_serverp = fd; continue;
+            case HO_HW_WATCHDOG: continue;
+            case HO_ROT_CLIENT:  clients = rot_clients; np = &n_rot; max = MAX_ROTCLIENTS; break;
+            case HO_WEB_CLIENT:  clients = web_clients; np = &n_web; max = MAX_WEBCLIENTS; break;
+            case HO_UNIX_CLIENT: clients = unix_clients; np = &n_unix; max = MAX_UNIXCLIENTS; break;
+            default:
+                // GPIO lines were adopted by receiveHandOff()
+                if (fds[i].role >= HO_GPIO_LINE && fds[i].role < HO_SER_PORT)
+                    continue;
+                // serial port masters, if we still have the same ports
+                if (fds[i].role >= HO_SER_PORT && fds[i].role < HO_SER_PORT + n_ser_args)
+                    ser_fds[fds[i].role - HO_SER_PORT] = fd;
+                else
+                    close (fd);
+                continue;
+            }
+
+            FILE *fp = *np < max ? fdopen (fd, "r+") : NULL;
+            if (!fp) {
+                close (fd);
+                continue;
+            }
+            setbuf (fp, NULL);
+            clients[(*np)++] = fp;
+        }
+
+        rig_debug (RIG_DEBUG_VERBOSE, "handoff: adopted %d rot, %d web and %d unix clients\n", n_rot, n_web, n_unix);
+}
+
+/* open each -t serial port, carrying on with its pty from an old instance if ser_fds[] has one.
+ * exit if trouble.
+ */
+static void openSerPorts (const int ser_fds[])
+{
+        for (int i = 0; i < n_ser_args; i++) {
+            char ynot[1024];
+            if (serOpen (ser_args[i], ser_fds[i], ynot) < 0) {
+                rig_debug (RIG_DEBUG_ERR, "-t %s: %s\n", ser_args[i], ynot);
+                exit(1);
+            }
+        }
+}
+
 /* main program, see usage()
  */
 int main (int ac, char *av[])
@@ -900,22 +1718,47 @@ int main (int ac, char *av[])
         setSignal (SIGPIPE, SIG_IGN);
 
         // setup
+        handOffInit (av);
         crackArgs (ac, av);
         captureCapabilities();
+        HandOffFD ho_fds[MAX_HANDOFF_FDS];
+        int n_ho_fds = 0;
+        if (handoff_fd >= 0)
+            receiveHandOff (ho_fds, &n_ho_fds);
         initRotator();
 
         // catch SIGUSR1 to increment verbose
         setSignal (SIGUSR1, onSU1);
 
+        // catch SIGUSR2 to hand over to a new instance
+        setSignal (SIGUSR2, onSU2);
+
         // stop on any of several likely signals
         setSignal (SIGINT, onAnyStopSignal);
         setSignal (SIGHUP, onAnyStopSignal);
         setSignal (SIGQUIT, onAnyStopSignal);
         setSignal (SIGTERM, onAnyStopSignal);
 
-        // create the two persistent server sockets
-        int rot_server = prepareServer(tcp_rotport);
-        int web_server = prepareServer(tcp_webport);
+        // create the persistent server sockets, unless taking them over
+        int rot_server = -1, web_server = -1, unix_server = -1;
+        if (handoff_fd < 0) {
+            rot_server = prepareServer(tcp_rotport);
+            web_server = prepareServer(tcp_webport);
+            unix_server = unix_path[0] ? prepareUnixServer(unix_path) : -1;
+        }
+
+        // load the station location and the command schedule
+        if (celInit() < 0 || schedInit (sched_file) < 0)
+            exit(1);
+        int sched_fd = schedFD();
+        int reactor_fd = g5500_direct_reactor_fd();
+
+        // carry on tracking from an old instance
+        if (handoff_state.tracking) {
+            char ynot[100];
+            if (celTrackRADec (handoff_state.track_ra, handoff_state.track_dec, ynot) != RIG_OK)
+                rig_debug (RIG_DEBUG_ERR, "handoff: %s\n", ynot);
+        }
 
         // collection of clients
         // N.B. be very careful mixing file descriptors and FILE *
@@ -923,10 +1766,35 @@ int main (int ac, char *av[])
         memset (rot_clients, 0, sizeof(rot_clients));
         FILE *web_clients[MAX_WEBCLIENTS];
         memset (web_clients, 0, sizeof(web_clients));
+        FILE *unix_clients[MAX_UNIXCLIENTS];
+        memset (unix_clients, 0, sizeof(unix_clients));
+
+        // carry on from an old instance
+        int ser_fds[MAX_SER_PORTS];
+        for (int i = 0; i < MAX_SER_PORTS; i++)
+            ser_fds[i] = -1;
+        if (handoff_fd >= 0) {
+            adoptHandOff (ho_fds, n_ho_fds, &rot_server, &web_server, &unix_server,
+                                rot_clients, web_clients, unix_clients, ser_fds);
+            openSerPorts (ser_fds);
+            if (rot_server < 0 || web_server < 0) {
+                rig_debug (RIG_DEBUG_ERR, "handoff: server sockets are missing\n");
+                exit(1);
+            }
+            handOffDone (handoff_fd);
+            handoff_fd = -1;
+        } else
+            openSerPorts (ser_fds);
 
         // forever
         for(;;) {
 
+            // hand over to a new instance if asked
+            if (upgrade_requested) {
+                upgrade_requested = 0;
+                upgrade (rot_server, web_server, unix_server, rot_clients, web_clients, unix_clients);
+            }
+
             // prepare list of sockets to examine
             fd_set sockets;
             FD_ZERO (&sockets);
@@ -939,13 +1807,36 @@ int main (int ac, char *av[])
             FD_SET (web_server, &sockets);
             if (web_server > max_fd)
                 max_fd = web_server;
+            if (unix_server >= 0) {
+                FD_SET (unix_server, &sockets);
+                if (unix_server > max_fd)
+                    max_fd = unix_server;
+            }
+
+            // add schedule timer
+            FD_SET (sched_fd, &sockets);
+            if (sched_fd > max_fd)
+                max_fd = sched_fd;
+
+            // add control loop timer if running it here
+            if (reactor_fd >= 0) {
+                FD_SET (reactor_fd, &sockets);
+                if (reactor_fd > max_fd)
+                    max_fd = reactor_fd;
+            }
 
             // add clients
             max_fd = addClientFD (&sockets, max_fd, rot_clients, MAX_ROTCLIENTS);
             max_fd = addClientFD (&sockets, max_fd, web_clients, MAX_WEBCLIENTS);
+            max_fd = addClientFD (&sockets, max_fd, unix_clients, MAX_UNIXCLIENTS);
+
+            // add serial ports
+            max_fd = serAddFD (&sockets, max_fd);
 
             // wait forever
             int ns = select (max_fd+1, &sockets, NULL, NULL, NULL);
+            if (ns < 0 && errno == EINTR)
+                continue;
             if (ns < 0) {
                 rig_debug (RIG_DEBUG_ERR, "select(): %s\n", strerror(errno));
                 exit(1);
@@ -956,15 +1847,29 @@ int main (int ac, char *av[])
             }
             if (ns > 0) {
 
+                // control loop first, it has the tightest deadlines
+                if (reactor_fd >= 0 && FD_ISSET (reactor_fd, &sockets))
+                    g5500_direct_reactor_run();
+
+                // scheduled command due?
+                if (FD_ISSET (sched_fd, &sockets))
+                    schedRun();
+
+                // new message? check before accepting so slots freed by EOF are available to new clients
+                // and a new client never inherits the readiness of a closed one reusing the same fd.
+                checkForClientMessage (&sockets, rot_clients, MAX_ROTCLIENTS, "rot", runRotator);
+                checkForClientMessage (&sockets, web_clients, MAX_WEBCLIENTS, "web", runWeb);
+                checkForClientMessage (&sockets, unix_clients, MAX_UNIXCLIENTS, "unix", runRotator);
+                serRun (&sockets);
+
                 // new client?
                 if (checkForNewClient (&sockets, rot_server, rot_clients, MAX_ROTCLIENTS, "rot") < 0)
                     rig_debug (RIG_DEBUG_ERR, "too many rot clients\n");
                 if (checkForNewClient (&sockets, web_server, web_clients, MAX_WEBCLIENTS, "web") < 0)
                     rig_debug (RIG_DEBUG_ERR, "too many web clients\n");
-
-                // new message?
-                checkForClientMessage (&sockets, rot_clients, MAX_ROTCLIENTS, "rot", runRotator);
-                checkForClientMessage (&sockets, web_clients, MAX_WEBCLIENTS, "web", runWeb);
+                if (unix_server >= 0
+                        && checkForNewClient (&sockets, unix_server, unix_clients, MAX_UNIXCLIENTS, "unix") < 0)
+                    rig_debug (RIG_DEBUG_ERR, "too many unix clients\n");
             }
         }
 
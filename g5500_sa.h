@@ -7,6 +7,7 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
 
 enum rig_debug_level_e {
     RIG_DEBUG_NONE = 0,
@@ -151,4 +152,131 @@ struct rot_caps {
 extern int DECLARE_INITROT_BACKEND_dummy();
 extern void rot_register (struct rot_caps *);
 
+
+/* extensions beyond the hamlib API, available only when building stand-alone
+ */
+
+typedef struct {
+    const char *state;                  // name of control thread state
+    int err;                            // RIG_OK or pending control thread error
+    float az, el;                       // current position, degs
+    float az_target, el_target;         // current target, degs
+    int az_dir, el_dir;                 // commanded motion: -1 ccw/down, 0 stopped, 1 cw/up
+    float az_eta, el_eta;               // predicted secs until each axis reaches its target
+    float settle;                       // predicted secs until both axes are at rest
+    float age;                          // secs since az and el were read
+    int stale;                          // set if age is too old for az and el to be considered current
+    int wd_misses;                      // number of times the control loop missed its heartbeat deadline
+    float wd_response;                  // secs from the latest missed deadline until relays were idle
+    float wd_response_max;              // largest wd_response
+    const char *az_source, *el_source;  // where each position comes from: "pot", "encoder" or el "imu"
+    int enc_faults;                     // number of times an encoder was abandoned for its pot
+    int imu_faults;                     // number of times the el IMU was abandoned for the pot
+    float az_heat, el_heat;             // motor heat, 0 cold .. 1 at the duty limit
+    float az_run_left, el_run_left;     // secs of running each motor has before it must rest, -1 no limit
+    int az_cooling, el_cooling;         // set while each motor is rested to cool
+    int cooldowns;                      // number of times a motor was rested to cool
+    float az_speed, el_speed;           // calibrated axis speeds, else nominal, degs/sec
+    int i2c_xfers;                      // I2C transactions by the rotator since the bus was first shared
+    int i2c_waits;                      // of which first had to wait for another process
+    int i2c_timeouts;                   // of which found the bus held too long, see piI2C.c
+    float i2c_wait_max;                 // longest wait for the bus, secs
+    int i2c_wait_pid;                   // process holding the bus during the longest wait, else 0
+    int i2c_others;                     // I2C transactions by other processes sharing the bus
+} G5500Status;
+
+extern int g5500_direct_get_status (G5500Status *sp);
+
+typedef struct {
+    float az, el;                       // position, degs, extrapolated to now if extrapolated is set
+    double t;                           // unix time at which the position sample was read, secs
+    float age;                          // secs since the sample was read
+    float az_vel, el_vel;               // estimated axis velocities, degs/sec, positive cw/up
+    int extrapolated;                   // set if az and el are extrapolated from the sample to now
+} G5500Position;
+
+extern int g5500_direct_get_position_ex (G5500Position *pp);
+
+typedef struct {
+    double t;                           // unix time, secs
+    float az, el;                       // position, degs
+    float az_target, el_target;         // target, degs
+} G5500HistPoint;
+
+#define G5500_HISTORY_LEN       18000   // points retained, one per control tick: 1 hour at the default rate
+
+typedef struct {
+    double t;                           // monotonic time at which the ADCs were read, secs
+    double t_relay;                     // monotonic time at which the relays were last set, secs
+    uint16_t az, el;                    // raw ADC
+    uint8_t relays;                     // G5500_TRACE_* motions commanded from t_relay
+} G5500TraceRec;
+
+#define G5500_TRACE_CW          1
+#define G5500_TRACE_CCW         2
+#define G5500_TRACE_UP          4
+#define G5500_TRACE_DOWN        8
+#define G5500_TRACE_LEN         G5500_HISTORY_LEN       // records retained, one per control tick
+
+typedef struct {
+    int sim_mode;                       // simulator mode while recorded
+    int cal_ok;                         // set if the following are valid
+    int az_min, az_max, el_min, el_max; // calibrated ADC limits
+    float az_span, el_span;             // degs from min to max
+    int period;                         // control thread period, usecs
+} G5500TraceCal;
+
+typedef int (*G5500TrackFunc) (double t, float *az, float *el, void *arg);
+
+extern int g5500_direct_track (G5500TrackFunc fn, void *arg);
+extern int g5500_direct_tracking (void);
+
+typedef struct {
+    int completed;                      // set if the target is acquired then held while above the mask
+    float tracked;                      // secs from the start of tracking until it would end
+    float acquire;                      // secs from the start of the window until first on target, -1 never
+    float rms_err, max_err;             // pointing error from then while the target is above the mask, degs
+    float on_target;                    // percent of that time within the tolerance
+    float lost;                         // secs of that time beyond the tolerance
+    float masked;                       // secs the target is below the mask
+    int unwinds;                        // times the az target jumps a turn to stay within the mount travel
+    float unwind_secs;                  // secs off target after unwinds
+    float max_el;                       // highest target el, degs
+    float peak_az_rate, peak_el_rate;   // fastest target motion, degs/sec
+    float az_speed, el_speed;           // mount speeds in the model, degs/sec
+    float keyhole;                      // secs the target az moves faster than the mount can
+    int starts;                         // relay starts of both motors
+    int cooldowns;                      // times a motor would be rested to cool
+    float az_heat, el_heat;             // motor heat at the end, 0 cold .. 1 at the duty limit
+    float wall;                         // real secs the simulation took
+} G5500Presim;
+
+extern int g5500_direct_presim (G5500TrackFunc fn, void *arg, int stepped, double t0, double t1, float mask,
+        float tol, G5500Presim *rp);
+
+extern int g5500_direct_get_history (double since, G5500HistPoint *pts, int max_pts);
+extern int g5500_direct_get_trace (G5500TraceRec *recs, int max_recs, G5500TraceCal *cp);
+extern void g5500_direct_hold_conf (int hold);
+
+extern int g5500_direct_freeze (void);
+extern void g5500_direct_thaw (void);
+extern size_t g5500_direct_snapshot_size (void);
+extern size_t g5500_direct_snapshot (void *buf, size_t len, int *hw_fdp);
+extern int g5500_direct_restore (const void *buf, size_t len, int hw_fd, char ynot[]);
+
+extern void g5500_direct_set_reactor (int on);
+extern int g5500_direct_reactor_fd (void);
+extern void g5500_direct_reactor_run (void);
+
+
+/* common rotator commands in g5500_sa.c shared by all stand-alone front ends
+ */
+extern int rotSetPos (float az, float el);
+extern int rotPark (void);
+extern int rotStop (void);
+extern int rotMove (int direction);
+extern int rotSetConf (const char *name, const char *value, char ynot[], size_t ynot_len);
+extern int queryArg (const char *q, const char *name, char value[], size_t len);
+extern void putJSONString (FILE *fp, const char *s);
+
 #endif // _SA_G500_H
@@ -0,0 +1,237 @@
+/* model of how each axis of a G5500 mount responds to its relays, shared by the simulator in g5500_direct.c
+ * and by g5500fit which fits the model to traces recorded from a real mount and replays them through it.
+ *
+ * Positions are degrees from the end of the axis where the ADC reads adc_min, to span where it reads adc_max.
+ * When a relay closes the axis starts moving at full speed latency secs later, or latency secs after it
+ * comes to rest if it was still coasting the other way. When the relay opens the axis slows uniformly,
+ * taking coast secs to stop from full speed. The ADC reads the position through a pot whose nonlinearity
+ * bows the middle of its travel by nonlin times the span, plus gaussian noise.
+ *
+ * A profile is saved as lines of name = value, such as:
+ *
+ *    az_speed_up = 10.6
+ *    el_coast = 0.18
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include "g5500_sim.h"
+
+
+#define SIM_STEP        0.001           // max secs per integration step
+
+// defaults, as the simulator always behaved before it had a profile
+#define AZ_SIM_SPEED    10              // degs/sec
+#define EL_SIM_SPEED    5               // degs/sec
+
+
+/* fill *pp with an ideal mount
+ */
+void g5500SimDefaultProfile (G5500SimProfile *pp)
+{
+        memset (pp, 0, sizeof(*pp));
+        pp->az.speed_up = pp->az.speed_down = AZ_SIM_SPEED;
+        pp->el.speed_up = pp->el.speed_down = EL_SIM_SPEED;
+}
+
+/* init *ap at rest at position x at time t.
+ */
+void g5500SimAxisInit (G5500SimAxis *ap, const G5500SimAxisProfile *pp, int adc_min, int adc_max, float span,
+double x, double t)
+{
+        memset (ap, 0, sizeof(*ap));
+        ap->p = *pp;
+        ap->adc_min = adc_min;
+        ap->adc_max = adc_max;
+        ap->span = span > 0 ? span : 1;
+        ap->x = x;
+        ap->t = t;
+        ap->rng = 0x6735a5e1;
+}
+
+/* advance *ap to time t
+ */
+static void simAdvance (G5500SimAxis *ap, double t)
+{
+        while (ap->t < t) {
+            double h = t - ap->t;
+            if (h > SIM_STEP)
+                h = SIM_STEP;
+
+            if (ap->cmd != 0 && ap->v * ap->cmd > 0) {
+                // running, or resuming before it stopped
+                ap->v = ap->cmd > 0 ? ap->p.speed_up : -ap->p.speed_down;
+            } else if (ap->v != 0) {
+                // coasting to rest, perhaps before reversing
+                double full = ap->v > 0 ? ap->p.speed_up : ap->p.speed_down;
+                double dv = ap->p.coast > 0 ? full * h / ap->p.coast : fabs (ap->v);
+                if (fabs (ap->v) <= dv) {
+                    ap->v = 0;
+                    if (ap->cmd != 0)
+                        ap->t_go = ap->t + h + ap->p.latency;
+                } else
+                    ap->v -= ap->v > 0 ? dv : -dv;
+            } else if (ap->cmd != 0 && ap->t + h >= ap->t_go) {
+                // starting
+                ap->v = ap->cmd > 0 ? ap->p.speed_up : -ap->p.speed_down;
+            }
+
+            ap->x += ap->v * h;
+            if (ap->x < 0) {
+                ap->x = 0;
+                ap->v = 0;
+            } else if (ap->x > ap->span) {
+                ap->x = ap->span;
+                ap->v = 0;
+            }
+            ap->t += h;
+        }
+}
+
+/* command *ap at time t to move up if cmd > 0, down if cmd < 0, else stop.
+ * t must not be earlier than any previous call.
+ */
+void g5500SimCommand (G5500SimAxis *ap, int cmd, double t)
+{
+        simAdvance (ap, t);
+
+        cmd = cmd > 0 ? 1 : (cmd < 0 ? -1 : 0);
+        if (cmd == ap->cmd)
+            return;
+        ap->cmd = cmd;
+        if (cmd != 0 && ap->v == 0)
+            ap->t_go = t + ap->p.latency;
+}
+
+/* return a random number from a normal distribution with mean 0 and std dev 1
+ */
+static double simGaussian (G5500SimAxis *ap)
+{
+        double u[2];
+        for (int i = 0; i < 2; i++) {
+            // xorshift32
+            ap->rng ^= ap->rng << 13;
+            ap->rng ^= ap->rng >> 17;
+            ap->rng ^= ap->rng << 5;
+            u[i] = (ap->rng + 1.0) / 4294967297.0;
+        }
+        return (sqrt(-2*log(u[0])) * cos(2*M_PI*u[1]));
+}
+
+/* return the ADC value of *ap at time t, with noise if noisy.
+ * t must not be earlier than any previous call.
+ */
+uint16_t g5500SimRead (G5500SimAxis *ap, double t, int noisy)
+{
+        simAdvance (ap, t);
+
+        double y = ap->x + 4 * ap->p.nonlin * ap->x * (ap->span - ap->x) / ap->span;
+        if (noisy && ap->p.noise > 0)
+            y += ap->p.noise * simGaussian (ap);
+
+        double adc = floor (ap->adc_min + y * (ap->adc_max - ap->adc_min) / ap->span + 0.5);
+        if (adc < 0)
+            adc = 0;
+        if (adc > 65535)
+            adc = 65535;
+        return ((uint16_t) adc);
+}
+
+
+// profile file names and where each is stored
+#define PROF_FIELD(axis,field)  {#axis "_" #field, offsetof(G5500SimProfile, axis.field)}
+static const struct {
+    const char *name;
+    size_t offset;
+} prof_fields[] = {
+    PROF_FIELD (az, speed_up),
+    PROF_FIELD (az, speed_down),
+    PROF_FIELD (az, latency),
+    PROF_FIELD (az, coast),
+    PROF_FIELD (az, noise),
+    PROF_FIELD (az, nonlin),
+    PROF_FIELD (el, speed_up),
+    PROF_FIELD (el, speed_down),
+    PROF_FIELD (el, latency),
+    PROF_FIELD (el, coast),
+    PROF_FIELD (el, noise),
+    PROF_FIELD (el, nonlin),
+};
+#define N_PROF_FIELDS   ((int)(sizeof(prof_fields)/sizeof(prof_fields[0])))
+
+/* read the given profile file into *pp. fields not in the file are left unchanged.
+ * return 0 if ok else -1 with excuse in ynot[]
+ */
+int g5500SimReadProfile (const char *fn, G5500SimProfile *pp, char ynot[])
+{
+        FILE *fp = fopen (fn, "r");
+        if (!fp) {
+            sprintf (ynot, "%s: %s", fn, strerror(errno));
+            return (-1);
+        }
+
+        G5500SimProfile p = *pp;
+        char line[200], name[100];
+        float value;
+        int ok = 1;
+        for (int n = 1; ok && fgets (line, sizeof(line), fp); n++) {
+            if (line[0] == '#' || strspn (line, " \t\r\n") == strlen (line))
+                continue;
+            ok = 0;
+            if (sscanf (line, " %99[^= \t] = %f", name, &value) == 2) {
+                for (int i = 0; i < N_PROF_FIELDS; i++) {
+                    if (strcmp (name, prof_fields[i].name) == 0) {
+                        *(float *)((char *)&p + prof_fields[i].offset) = value;
+                        ok = 1;
+                        break;
+                    }
+                }
+            }
+            if (!ok) {
+                line[strcspn (line, "\r\n")] = '\0';
+                sprintf (ynot, "%s line %d: not a profile setting: %s", fn, n, line);
+            }
+        }
+        fclose (fp);
+
+        if (!ok)
+            return (-1);
+        if (p.az.speed_up <= 0 || p.az.speed_down <= 0 || p.el.speed_up <= 0 || p.el.speed_down <= 0
+                    || p.az.latency < 0 || p.az.coast < 0 || p.el.latency < 0 || p.el.coast < 0
+                    || p.az.noise < 0 || p.el.noise < 0) {
+            sprintf (ynot, "%s: speeds must be positive, others not negative", fn);
+            return (-1);
+        }
+
+        *pp = p;
+        return (0);
+}
+
+/* write *pp to the given profile file.
+ * return 0 if ok else -1 with excuse in ynot[]
+ */
+int g5500SimWriteProfile (const char *fn, const G5500SimProfile *pp, char ynot[])
+{
+        FILE *fp = fopen (fn, "w");
+        if (!fp) {
+            sprintf (ynot, "%s: %s", fn, strerror(errno));
+            return (-1);
+        }
+
+        fprintf (fp, "# G5500 mount profile for the simulator: speeds degs/sec, latency and coast secs,\n");
+        fprintf (fp, "# noise rms degs, nonlin mid range bow as a fraction of the span\n");
+        for (int i = 0; i < N_PROF_FIELDS; i++)
+            fprintf (fp, "%s = %.5g\n", prof_fields[i].name,
+                                *(const float *)((const char *)pp + prof_fields[i].offset));
+
+        if (fclose (fp) != 0) {
+            sprintf (ynot, "%s: %s", fn, strerror(errno));
+            return (-1);
+        }
+        return (0);
+}
@@ -0,0 +1,43 @@
+#ifndef _G5500_SIM_H
+#define _G5500_SIM_H
+
+#include <stdint.h>
+
+/* how one axis of a mount responds to its relays, see g5500_sim.c
+ */
+typedef struct {
+    float speed_up;                     // degs/sec when driven cw or up
+    float speed_down;                   // degs/sec when driven ccw or down
+    float latency;                      // secs from relay closing until moving
+    float coast;                        // secs from relay opening until at rest from full speed
+    float noise;                        // rms position noise, degs
+    float nonlin;                       // pot bow at mid range as a fraction of the span
+} G5500SimAxisProfile;
+
+typedef struct {
+    G5500SimAxisProfile az, el;
+} G5500SimProfile;
+
+/* state of one simulated axis
+ */
+typedef struct {
+    G5500SimAxisProfile p;              // how it responds
+    int adc_min, adc_max;               // ADC at each end of its travel
+    float span;                         // degs from adc_min to adc_max
+    double x;                           // position from the adc_min end, degs
+    double v;                           // velocity, degs/sec
+    double t;                           // time of x and v, secs on any steady clock
+    int cmd;                            // commanded direction: 1 up, -1 down, 0 stop
+    double t_go;                        // when motion in cmd direction may start once at rest
+    uint32_t rng;                       // noise generator state
+} G5500SimAxis;
+
+extern void g5500SimDefaultProfile (G5500SimProfile *pp);
+extern void g5500SimAxisInit (G5500SimAxis *ap, const G5500SimAxisProfile *pp, int adc_min, int adc_max,
+        float span, double x, double t);
+extern void g5500SimCommand (G5500SimAxis *ap, int cmd, double t);
+extern uint16_t g5500SimRead (G5500SimAxis *ap, double t, int noisy);
+extern int g5500SimReadProfile (const char *fn, G5500SimProfile *pp, char ynot[]);
+extern int g5500SimWriteProfile (const char *fn, const G5500SimProfile *pp, char ynot[]);
+
+#endif // _G5500_SIM_H
@@ -0,0 +1,176 @@
+/* benchmark the g5500client library against the naive one-connection-per-call pattern.
+ *
+ * Each phase issues the same number of get_pos requests and reports the call rate and latency of each:
+ *
+ *   naive:      open a new connection, send one request, wait for the reply, close
+ *   persistent: one connection, send one request and wait for its reply before sending the next
+ *   pipelined:  one connection, keep up to window requests outstanding using the async API
+ *
+ * build with Makefile_sa then run while g5500pi is running, eg, ./g5500bench -n 2000
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "g5500client.h"
+
+static char *me;
+static const char *host = "localhost";
+static int port = 4533;
+static int n_calls = 1000;
+static int window = 32;
+
+/* return a monotonic time in seconds
+ */
+static double nowSecs (void)
+{
+        struct timespec ts;
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+        return (ts.tv_sec + ts.tv_nsec*1e-9);
+}
+
+static int cmpDouble (const void *p1, const void *p2)
+{
+        double d1 = *(const double *)p1;
+        double d2 = *(const double *)p2;
+        return (d1 < d2 ? -1 : d1 > d2 ? 1 : 0);
+}
+
+/* print the results of one phase. N.B. sorts lat[]
+ */
+static void report (const char *name, double secs, double lat[], int n, int n_err)
+{
+        double sum = 0;
+        for (int i = 0; i < n; i++)
+            sum += lat[i];
+        qsort (lat, n, sizeof(double), cmpDouble);
+
+        printf ("%-11s %6d calls %4d errs %10.0f calls/s  latency ms: mean %7.3f p50 %7.3f p99 %7.3f\n",
+                name, n, n_err, n/secs, 1e3*sum/n, 1e3*lat[n/2], 1e3*lat[(int)(n*0.99)]);
+}
+
+static void naivePhase (double lat[])
+{
+        char ynot[1024];
+        float az, el;
+        int n_err = 0;
+
+        double t0 = nowSecs();
+        for (int i = 0; i < n_calls; i++) {
+            double t = nowSecs();
+            G5500Client *cp = g5500ClientOpen (host, port, ynot);
+            if (!cp) {
+                fprintf (stderr, "%s: %s\n", me, ynot);
+                exit(1);
+            }
+            if (g5500ClientGetPos (cp, &az, &el) != G5500CLIENT_OK)
+                n_err++;
+            g5500ClientClose (cp);
+            lat[i] = nowSecs() - t;
+        }
+        report ("naive", nowSecs() - t0, lat, n_calls, n_err);
+}
+
+static void persistentPhase (G5500Client *cp, double lat[])
+{
+        float az, el;
+        int n_err = 0;
+
+        double t0 = nowSecs();
+        for (int i = 0; i < n_calls; i++) {
+            double t = nowSecs();
+            if (g5500ClientGetPos (cp, &az, &el) != G5500CLIENT_OK)
+                n_err++;
+            lat[i] = nowSecs() - t;
+        }
+        report ("persistent", nowSecs() - t0, lat, n_calls, n_err);
+}
+
+// context for each pipelined request
+typedef struct {
+    double t_sent;
+    double *latp;
+    int *n_errp;
+} PipeReq;
+
+static void pipeCB (G5500Client *cp, const G5500Reply *rp, void *arg)
+{
+        (void) cp;
+        PipeReq *pp = (PipeReq *) arg;
+        *pp->latp = nowSecs() - pp->t_sent;
+        if (rp->err != G5500CLIENT_OK || rp->n_vals < 2)
+            (*pp->n_errp)++;
+}
+
+static void pipelinedPhase (G5500Client *cp, double lat[])
+{
+        PipeReq *reqs = (PipeReq *) calloc (n_calls, sizeof(PipeReq));
+        int n_err = 0;
+
+        double t0 = nowSecs();
+        for (int i = 0; i < n_calls; i++) {
+            while (g5500ClientPending (cp) >= window)
+                (void) g5500ClientPoll (cp, 1000);
+            reqs[i].t_sent = nowSecs();
+            reqs[i].latp = &lat[i];
+            reqs[i].n_errp = &n_err;
+            if (g5500ClientSend (cp, "get_pos", pipeCB, &reqs[i]) != G5500CLIENT_OK) {
+                lat[i] = 0;
+                n_err++;
+            }
+        }
+        while (g5500ClientPending (cp) > 0)
+            (void) g5500ClientPoll (cp, 1000);
+        report ("pipelined", nowSecs() - t0, lat, n_calls, n_err);
+
+        free (reqs);
+}
+
+static void usage (void)
+{
+        fprintf (stderr, "Purpose: compare g5500pi client access patterns\n");
+        fprintf (stderr, "Usage: %s [options]\n", me);
+        fprintf (stderr, "  -h host : daemon host; default %s\n", host);
+        fprintf (stderr, "  -n n    : calls per phase; default %d\n", n_calls);
+        fprintf (stderr, "  -p port : daemon rotctld port; default %d\n", port);
+        fprintf (stderr, "  -w n    : pipelined window; default %d\n", window);
+        exit(1);
+}
+
+int main (int ac, char *av[])
+{
+        int opt;
+
+        me = av[0];
+        while ((opt = getopt (ac, av, "h:n:p:w:")) != -1) {
+            switch (opt) {
+            case 'h': host = optarg; break;
+            case 'n': n_calls = atoi (optarg); break;
+            case 'p': port = atoi (optarg); break;
+            case 'w': window = atoi (optarg); break;
+            default: usage(); break;
+            }
+        }
+        if (optind < ac || n_calls < 1 || window < 1)
+            usage();
+
+        double *lat = (double *) calloc (n_calls, sizeof(double));
+
+        naivePhase (lat);
+
+        char ynot[1024];
+        G5500Client *cp = g5500ClientOpen (host, port, ynot);
+        if (!cp) {
+            fprintf (stderr, "%s: %s\n", me, ynot);
+            exit(1);
+        }
+        persistentPhase (cp, lat);
+        pipelinedPhase (cp, lat);
+        g5500ClientClose (cp);
+
+        free (lat);
+        return (0);
+}
@@ -0,0 +1,569 @@
+/* client library for the rotctld protocol served by g5500pi.
+ *
+ * A G5500Client keeps one persistent connection to the daemon. Requests may be pipelined, ie, any number
+ * may be sent before their replies arrive, and replies are matched to requests in order. Each request is
+ * sent using the ;\ form of the extended protocol so every reply is exactly one line ending with RPRT.
+ *
+ * Two styles of use are offered, which may be mixed on the same connection:
+ *
+ *   blocking: g5500ClientGetPos() etc send one request and wait for its reply.
+ *
+ *   asynchronous: g5500ClientSend() queues a request with a callback and returns at once. The caller then
+ *     runs g5500ClientPoll() whenever g5500ClientFD() is readable, or periodically, which reads replies and
+ *     invokes their callbacks.
+ *
+ * If the connection fails it is reopened transparently, at most once per RECONNECT_SECS, and requests still
+ * awaiting replies are sent again, but only if they just ask for information. A command such as set_pos or
+ * stop that was already sent may or may not have been performed, so rather than perform it twice it completes
+ * with G5500CLIENT_EIO and the caller decides whether to send it again. A request that has waited longer than
+ * the timeout completes with G5500CLIENT_ETIMEOUT, after which the connection is reopened so later replies can
+ * not be mismatched.
+ *
+ * The daemon offers neither push subscriptions nor binary frames so all traffic is request/reply text.
+ *
+ * The daemon may be reached by TCP or, on the same host, by the UNIX socket at G5500_DAEMON_SOCKET.
+ *
+ * build with the stand-alone Makefile_sa as libg5500client.a.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/un.h>
+
+#include "g5500client.h"
+
+
+#define MAX_PENDING             256             // max requests awaiting replies
+#define MAX_CMD                 128             // max command length
+#define MAX_RETRIES             2               // max times one request is sent again after reconnecting
+#define RECONNECT_SECS          1.0             // min secs between connection attempts
+#define DEF_TIMEOUT_MS          5000            // default time to wait for a reply
+
+
+// one request awaiting its reply
+typedef struct {
+    char cmd[MAX_CMD];                          // complete line as sent
+    G5500ReplyCB cb;                            // callback, may be NULL
+    void *arg;                                  // passed to cb
+    double t_sent;                              // time first sent
+    int sent;                                   // set once written to a connection
+    int retries;                                // times sent again after reconnecting
+} Request;
+
+struct G5500Client {
+    char *host;                                 // daemon host
+    int port;                                   // daemon rotctld port
+    int fd;                                     // socket, -1 when not connected
+    double t_connect;                           // time of last connection attempt
+    int timeout_ms;                             // max wait for each reply
+    char rbuf[4096];                            // partial reply lines
+    int rlen;                                   // bytes in rbuf
+    Request q[MAX_PENDING];                     // ring of requests awaiting replies
+    int q_head;                                 // index of oldest
+    int q_n;                                    // number in q
+};
+
+
+/* return a monotonic time in seconds
+ */
+static double nowSecs (void)
+{
+        struct timespec ts;
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+        return (ts.tv_sec + ts.tv_nsec*1e-9);
+}
+
+/* write all of buf to cp's connection.
+ * return 0 if ok else -1
+ */
+static int writeAll (G5500Client *cp, const char *buf, size_t len)
+{
+        while (len > 0) {
+            ssize_t nw = send (cp->fd, buf, len, MSG_NOSIGNAL);
+            if (nw < 0 && errno == EINTR)
+                continue;
+            if (nw <= 0)
+                return (-1);
+            buf += nw;
+            len -= nw;
+        }
+        return (0);
+}
+
+/* close cp's connection, if open. pending requests remain queued to be sent again.
+ */
+static void dropConnection (G5500Client *cp)
+{
+        if (cp->fd >= 0) {
+            close (cp->fd);
+            cp->fd = -1;
+        }
+        cp->rlen = 0;
+}
+
+/* remove the oldest request and invoke its callback with *rp
+ */
+static void completeHead (G5500Client *cp, G5500Reply *rp)
+{
+        Request r = cp->q[cp->q_head];
+        cp->q_head = (cp->q_head + 1) % MAX_PENDING;
+        cp->q_n--;
+        if (r.cb)
+            (*r.cb) (cp, rp, r.arg);
+}
+
+/* complete the oldest request with the given library error code
+ */
+static void failHead (G5500Client *cp, int err)
+{
+        G5500Reply r;
+        memset (&r, 0, sizeof(r));
+        r.err = err;
+        completeHead (cp, &r);
+}
+
+/* return whether the given request line, as queued, only asks for information so may safely be sent twice
+ */
+static int isQuery (const char *cmd)
+{
+        static const char *queries[] = {
+            "get_pos", "p", "get_info", "_", "dump_caps", "1", "get_conf", "get_eta", "get_track", "check_pass",
+        };
+
+        // skip the ;\ prefix and any backslash of the command itself
+        cmd += 2;
+        if (*cmd == '\\')
+            cmd++;
+        size_t len = strcspn (cmd, " \n");
+
+        for (size_t i = 0; i < sizeof(queries)/sizeof(queries[0]); i++)
+            if (strlen (queries[i]) == len && strncmp (cmd, queries[i], len) == 0)
+                return (1);
+        return (0);
+}
+
+/* send pending requests on a new connection. those already retried too often, and commands that were already
+ * sent so may have been performed, complete with G5500CLIENT_EIO instead.
+ * return 0 if ok else -1
+ */
+static int resendPending (G5500Client *cp)
+{
+        struct {
+            G5500ReplyCB cb;
+            void *arg;
+        } lost[MAX_PENDING];
+        int n_lost = 0, n_kept = 0;
+
+        // keep those that may be sent again, in order
+        for (int i = 0; i < cp->q_n; i++) {
+            Request *rp = &cp->q[(cp->q_head + i) % MAX_PENDING];
+            if (rp->retries >= MAX_RETRIES || (rp->sent && !isQuery (rp->cmd))) {
+                lost[n_lost].cb = rp->cb;
+                lost[n_lost++].arg = rp->arg;
+            } else {
+                cp->q[(cp->q_head + n_kept++) % MAX_PENDING] = *rp;
+            }
+        }
+        cp->q_n = n_kept;
+
+        int ok = 0;
+        for (int i = 0; i < cp->q_n; i++) {
+            Request *rp = &cp->q[(cp->q_head + i) % MAX_PENDING];
+            if (rp->sent)
+                rp->retries++;
+            rp->sent = 1;
+            if (writeAll (cp, rp->cmd, strlen(rp->cmd)) < 0) {
+                dropConnection (cp);
+                ok = -1;
+                break;
+            }
+        }
+
+        // only now, so any request made by a callback follows those sent again
+        G5500Reply r;
+        memset (&r, 0, sizeof(r));
+        r.err = G5500CLIENT_EIO;
+        for (int i = 0; i < n_lost; i++)
+            if (lost[i].cb)
+                (*lost[i].cb) (cp, &r, lost[i].arg);
+
+        return (ok);
+}
+
+/* connect to the UNIX socket at cp->host and send all pending requests.
+ * return 0 if connected else -1
+ */
+static int connectUnix (G5500Client *cp)
+{
+        struct sockaddr_un sa_un;
+        memset (&sa_un, 0, sizeof(sa_un));
+        sa_un.sun_family = AF_UNIX;
+        if (strlen (cp->host) >= sizeof(sa_un.sun_path)) {
+            errno = ENAMETOOLONG;
+            return (-1);
+        }
+        strcpy (sa_un.sun_path, cp->host);
+
+        cp->fd = socket (AF_UNIX, SOCK_STREAM, 0);
+        if (cp->fd < 0)
+            return (-1);
+        if (connect (cp->fd, (struct sockaddr *)&sa_un, sizeof(sa_un)) < 0) {
+            int e = errno;
+            close (cp->fd);
+            cp->fd = -1;
+            errno = e;
+            return (-1);
+        }
+
+        return (resendPending (cp));
+}
+
+/* open the connection and send all pending requests, if not already connected.
+ * return 0 if connected else -1
+ */
+static int ensureConnected (G5500Client *cp)
+{
+        if (cp->fd >= 0)
+            return (0);
+
+        // limit retry rate
+        double now = nowSecs();
+        if (now - cp->t_connect < RECONNECT_SECS)
+            return (-1);
+        cp->t_connect = now;
+
+        // a host that looks like a path is a UNIX socket, port is unused
+        if (cp->host[0] == '/')
+            return (connectUnix (cp));
+
+        // look up and connect
+        struct addrinfo hints, *aip, *ai0;
+        char port[20];
+        memset (&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        snprintf (port, sizeof(port), "%d", cp->port);
+        if (getaddrinfo (cp->host, port, &hints, &ai0) != 0)
+            return (-1);
+        for (aip = ai0; aip; aip = aip->ai_next) {
+            cp->fd = socket (aip->ai_family, aip->ai_socktype, aip->ai_protocol);
+            if (cp->fd < 0)
+                continue;
+            if (connect (cp->fd, aip->ai_addr, aip->ai_addrlen) == 0)
+                break;
+            close (cp->fd);
+            cp->fd = -1;
+        }
+        freeaddrinfo (ai0);
+        if (cp->fd < 0)
+            return (-1);
+
+        // small requests should go out at once
+        int flag = 1;
+        (void) setsockopt (cp->fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+        // send again whatever was pending
+        return (resendPending (cp));
+}
+
+/* crack one reply line into *rp
+ */
+static void parseReply (const char *line, G5500Reply *rp)
+{
+        memset (rp, 0, sizeof(*rp));
+        snprintf (rp->line, sizeof(rp->line), "%.*s", (int)sizeof(rp->line)-1, line);
+
+        // status is always last
+        const char *rprt = strstr (line, "RPRT ");
+        rp->err = rprt ? atoi (rprt + 5) : G5500CLIENT_EPROTO;
+
+        // values are in the Key: value fields after the echo
+        for (const char *f = strchr (line, ';'); f; f = strchr (f, ';')) {
+            f++;
+            const char *colon = strstr (f, ": ");
+            const char *next = strchr (f, ';');
+            if (colon && (!next || colon < next) && rp->n_vals < G5500CLIENT_MAXVALS) {
+                char *end;
+                float v = strtof (colon + 2, &end);
+                if (end != colon + 2)
+                    rp->vals[rp->n_vals++] = v;
+            }
+        }
+}
+
+/* expire requests that have waited too long.
+ * return number expired
+ */
+static int expireRequests (G5500Client *cp)
+{
+        double now = nowSecs();
+        int n = 0;
+
+        while (cp->q_n > 0 && (now - cp->q[cp->q_head].t_sent)*1000 > cp->timeout_ms) {
+            failHead (cp, G5500CLIENT_ETIMEOUT);
+            n++;
+        }
+
+        // reply to an expired request may still arrive so start over with a fresh connection
+        if (n > 0)
+            dropConnection (cp);
+
+        return (n);
+}
+
+
+
+/* open a new client connection to the daemon on the given host and rotctld port, or to the UNIX socket
+ * at the given path if host begins with '/'.
+ * return handle else NULL with brief excuse in ynot[].
+ */
+G5500Client *g5500ClientOpen (const char *host, int port, char ynot[])
+{
+        G5500Client *cp = (G5500Client *) calloc (1, sizeof(G5500Client));
+        if (!cp) {
+            strcpy (ynot, "no memory");
+            return (NULL);
+        }
+        cp->host = strdup (host);
+        cp->port = port;
+        cp->fd = -1;
+        cp->timeout_ms = DEF_TIMEOUT_MS;
+
+        cp->t_connect = nowSecs() - RECONNECT_SECS;
+        if (ensureConnected (cp) < 0) {
+            if (host[0] == '/')
+                sprintf (ynot, "can not connect to %s: %s", host, strerror(errno));
+            else
+                sprintf (ynot, "can not connect to %s:%d: %s", host, port, strerror(errno));
+            g5500ClientClose (cp);
+            return (NULL);
+        }
+
+        return (cp);
+}
+
+/* close the connection and release all resources.
+ * callbacks of any pending requests are invoked with G5500CLIENT_EIO.
+ */
+void g5500ClientClose (G5500Client *cp)
+{
+        if (!cp)
+            return;
+        while (cp->q_n > 0)
+            failHead (cp, G5500CLIENT_EIO);
+        dropConnection (cp);
+        free (cp->host);
+        free (cp);
+}
+
+/* set the max time to wait for any one reply
+ */
+void g5500ClientSetTimeout (G5500Client *cp, int ms)
+{
+        cp->timeout_ms = ms;
+}
+
+/* return the socket to watch for readability, or -1 if not currently connected
+ */
+int g5500ClientFD (G5500Client *cp)
+{
+        return (cp->fd);
+}
+
+/* return number of requests awaiting replies
+ */
+int g5500ClientPending (G5500Client *cp)
+{
+        return (cp->q_n);
+}
+
+/* queue the given command, such as "get_pos" or "set_pos 10 20", and send it at once if connected.
+ * cb, if not NULL, will be called with arg and the reply from within g5500ClientPoll().
+ * return 0 if queued else negative error code.
+ */
+int g5500ClientSend (G5500Client *cp, const char *cmd, G5500ReplyCB cb, void *arg)
+{
+        // wait for room
+        while (cp->q_n == MAX_PENDING)
+            if (g5500ClientPoll (cp, cp->timeout_ms) < 0)
+                return (G5500CLIENT_EIO);
+
+        Request *rp = &cp->q[(cp->q_head + cp->q_n) % MAX_PENDING];
+        if (snprintf (rp->cmd, MAX_CMD, ";\\%s\n", cmd) >= MAX_CMD)
+            return (G5500CLIENT_EPROTO);
+        rp->cb = cb;
+        rp->arg = arg;
+        rp->t_sent = nowSecs();
+        rp->sent = 0;
+        rp->retries = 0;
+        cp->q_n++;
+
+        // send now if connected, else whenever we reconnect
+        if (cp->fd >= 0) {
+            rp->sent = 1;
+            if (writeAll (cp, rp->cmd, strlen(rp->cmd)) < 0)
+                dropConnection (cp);
+        } else {
+            (void) ensureConnected (cp);
+        }
+
+        return (G5500CLIENT_OK);
+}
+
+/* wait up to timeout_ms for replies, invoking the callback of each. 0 just checks without waiting.
+ * return number of requests completed, or -1 if not connected and can not reconnect yet.
+ */
+int g5500ClientPoll (G5500Client *cp, int timeout_ms)
+{
+        int n_done = expireRequests (cp);
+
+        if (ensureConnected (cp) < 0) {
+            // don't spin while waiting to reconnect
+            if (timeout_ms > 0)
+                usleep (1000 * (timeout_ms < 100 ? timeout_ms : 100));
+            return (n_done > 0 ? n_done : -1);
+        }
+
+        struct pollfd pfd;
+        pfd.fd = cp->fd;
+        pfd.events = POLLIN;
+        int np = poll (&pfd, 1, timeout_ms);
+        if (np < 0)
+            return (errno == EINTR ? n_done : -1);
+        if (np == 0)
+            return (n_done);
+
+        // read what is available
+        ssize_t nr = recv (cp->fd, cp->rbuf + cp->rlen, sizeof(cp->rbuf) - cp->rlen - 1, 0);
+        if (nr <= 0) {
+            dropConnection (cp);
+            return (n_done);
+        }
+        cp->rlen += nr;
+        cp->rbuf[cp->rlen] = '\0';
+
+        // complete one request per line
+        char *line = cp->rbuf, *nl;
+        while ((nl = strchr (line, '\n')) != NULL) {
+            *nl = '\0';
+            if (cp->q_n > 0) {
+                G5500Reply r;
+                parseReply (line, &r);
+                completeHead (cp, &r);
+                n_done++;
+            }
+            line = nl + 1;
+        }
+
+        // retain any partial line
+        cp->rlen -= line - cp->rbuf;
+        memmove (cp->rbuf, line, cp->rlen);
+        if (cp->rlen == sizeof(cp->rbuf) - 1)
+            dropConnection (cp);                // no line is ever this long
+
+        return (n_done);
+}
+
+
+
+/* callback used by the blocking API to capture its reply
+ */
+typedef struct {
+    int done;
+    G5500Reply *rp;
+} BlockingReply;
+
+static void blockingCB (G5500Client *cp, const G5500Reply *rp, void *arg)
+{
+        (void) cp;
+        BlockingReply *bp = (BlockingReply *) arg;
+        *bp->rp = *rp;
+        bp->done = 1;
+}
+
+/* send the given command and wait for its reply in *rp, completing any earlier requests along the way.
+ * return the reply status, G5500CLIENT_OK or a negative error code.
+ */
+int g5500ClientCommand (G5500Client *cp, const char *cmd, G5500Reply *rp)
+{
+        BlockingReply br;
+        br.done = 0;
+        br.rp = rp;
+
+        int err = g5500ClientSend (cp, cmd, blockingCB, &br);
+        if (err < 0) {
+            memset (rp, 0, sizeof(*rp));
+            rp->err = err;
+            return (err);
+        }
+
+        while (!br.done)
+            (void) g5500ClientPoll (cp, cp->timeout_ms);
+
+        return (rp->err);
+}
+
+int g5500ClientGetPos (G5500Client *cp, float *az, float *el)
+{
+        G5500Reply r;
+        int err = g5500ClientCommand (cp, "get_pos", &r);
+        if (err == G5500CLIENT_OK) {
+            if (r.n_vals < 2)
+                return (G5500CLIENT_EPROTO);
+            *az = r.vals[0];
+            *el = r.vals[1];
+        }
+        return (err);
+}
+
+int g5500ClientSetPos (G5500Client *cp, float az, float el)
+{
+        char cmd[MAX_CMD];
+        G5500Reply r;
+        snprintf (cmd, sizeof(cmd), "set_pos %g %g", az, el);
+        return (g5500ClientCommand (cp, cmd, &r));
+}
+
+int g5500ClientMove (G5500Client *cp, int direction, int speed)
+{
+        char cmd[MAX_CMD];
+        G5500Reply r;
+        snprintf (cmd, sizeof(cmd), "move %d %d", direction, speed);
+        return (g5500ClientCommand (cp, cmd, &r));
+}
+
+int g5500ClientPark (G5500Client *cp)
+{
+        G5500Reply r;
+        return (g5500ClientCommand (cp, "park", &r));
+}
+
+int g5500ClientStop (G5500Client *cp)
+{
+        G5500Reply r;
+        return (g5500ClientCommand (cp, "stop", &r));
+}
+
+int g5500ClientGetInfo (G5500Client *cp, char info[], size_t len)
+{
+        G5500Reply r;
+        int err = g5500ClientCommand (cp, "get_info", &r);
+        if (err == G5500CLIENT_OK) {
+            char *ip = strstr (r.line, "Info: ");
+            if (!ip)
+                return (G5500CLIENT_EPROTO);
+            ip += 6;
+            snprintf (info, len, "%.*s", (int) strcspn (ip, ";"), ip);
+        }
+        return (err);
+}
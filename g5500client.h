@@ -0,0 +1,52 @@
+/* client library for the g5500pi rotctld protocol, see g5500client.c
+ */
+
+#ifndef _G5500CLIENT_H
+#define _G5500CLIENT_H
+
+#include <stddef.h>
+
+// errors returned by the library itself, same values as the corresponding negative hamlib RIG_* codes
+#define G5500CLIENT_OK          0
+#define G5500CLIENT_ETIMEOUT    (-5)
+#define G5500CLIENT_EIO         (-6)
+#define G5500CLIENT_EPROTO      (-8)
+
+// UNIX socket on which g5500pi accepts local rotctld clients by default
+#define G5500_DAEMON_SOCKET     "/run/g5500pi/g5500pi.sock"
+
+// max values parsed from one reply
+#define G5500CLIENT_MAXVALS     8
+
+typedef struct G5500Client G5500Client;
+
+typedef struct {
+    int err;                                    // RPRT code, or one of the G5500CLIENT_E* codes
+    int n_vals;                                 // number of values in vals[]
+    float vals[G5500CLIENT_MAXVALS];            // each numeric "Key: value" in order of appearance
+    char line[256];                             // complete reply line
+} G5500Reply;
+
+typedef void (*G5500ReplyCB) (G5500Client *cp, const G5500Reply *rp, void *arg);
+
+// connection
+extern G5500Client *g5500ClientOpen (const char *host, int port, char ynot[]);
+extern void g5500ClientClose (G5500Client *cp);
+extern void g5500ClientSetTimeout (G5500Client *cp, int ms);
+
+// blocking API, each returns G5500CLIENT_OK or a negative error code
+extern int g5500ClientCommand (G5500Client *cp, const char *cmd, G5500Reply *rp);
+extern int g5500ClientGetPos (G5500Client *cp, float *az, float *el);
+extern int g5500ClientSetPos (G5500Client *cp, float az, float el);
+extern int g5500ClientMove (G5500Client *cp, int direction, int speed);
+extern int g5500ClientPark (G5500Client *cp);
+extern int g5500ClientStop (G5500Client *cp);
+extern int g5500ClientGetInfo (G5500Client *cp, char info[], size_t len);
+
+// asynchronous API
+extern int g5500ClientSend (G5500Client *cp, const char *cmd, G5500ReplyCB cb, void *arg);
+extern int g5500ClientPoll (G5500Client *cp, int timeout_ms);
+extern int g5500ClientPending (G5500Client *cp);
+extern int g5500ClientFD (G5500Client *cp);
+
+#endif // _G5500CLIENT_H
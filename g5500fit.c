@@ -0,0 +1,501 @@
+/* fit the simulator's mount profile to a flight recorder trace from a real mount, then check the fit by
+ * replaying the trace's relay commands through the model and comparing the trajectories.
+ *
+ * For each axis, from the trace alone:
+ *
+ *   nonlin:   a parabola is fit to every steady run, after the first SETTLE secs; a pot bowed by nonlin
+ *             reads with a constant curvature of -8*nonlin*speed^2/span, so each long run gives nonlin,
+ *             weighted by how well its length determines the curvature
+ *   speed:    the slope of each parabola at mid run, less the bow of the pot there, averaged over the runs
+ *             in each direction weighted by their samples
+ *   latency:  median time from relay closing until the line through the steady run leaves the rest position
+ *   coast:    median travel after the relay opens, beyond the steady line at that moment, as secs at full
+ *             speed times two because the model slows uniformly
+ *   noise:    rms tick to tick change while at rest, over root 2, less the ADC rounding of one step
+ *
+ * Ticks whose ADCs could not be read repeat the previous sample; only their relay commands are used.
+ *
+ * The replay starts the model from the first sample and runs it open loop through the whole trace, then
+ * again restarting it at rest at each recorded position where a move begins. The errors from the fitted
+ * profile are shown beside those from the comparison profile, the ideal simulator unless -p gives another.
+ *
+ * Capture a trace from a running g5500pi with, eg, curl -s localhost:8008/trace > trace.txt, preferably after
+ * a varied session of long and short moves in both directions on each axis. Then
+ *
+ *    ./g5500fit -o ~/.hamlib_g5500_sim.txt trace.txt
+ *
+ * and the simulator will use the fitted profile the next time it is started.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "g5500_sim.h"
+
+
+#define SETTLE          1.0             // secs after a relay closes before the run is taken as steady
+#define REST            1.5             // secs after a relay opens before the axis is taken as at rest
+#define MIN_STEADY      5               // min samples to fit a steady run
+#define MIN_NONLIN_COVER 0.3            // fraction of the span a run must cover to fit nonlin
+#define MAX_RECS        1000000         // max records read
+
+// one trace record, relay bits split out per axis
+typedef struct {
+    double t;                           // when the ADCs were read
+    double t_relay;                     // when the following commands took effect
+    int adc[2];                         // az, el
+    int cmd[2];                         // az, el commanded directions from t_relay: 1, -1 or 0
+    int stale;                          // set if the ADCs were not read this tick, so t and adc are not used
+} Rec;
+
+// what is known about an axis from the trace header
+typedef struct {
+    const char *name;
+    int adc_min, adc_max;
+    float span;
+} AxisCal;
+
+static char *me;
+static Rec *recs;
+static int n_recs;
+static AxisCal cal[2] = {{"az", 0, 0, 0}, {"el", 0, 0, 0}};
+
+
+/* return the recorded position of axis a in record i, degs
+ */
+static double recPos (int a, int i)
+{
+        return ((recs[i].adc[a] - cal[a].adc_min) * cal[a].span / (cal[a].adc_max - cal[a].adc_min));
+}
+
+/* read the trace in fn into recs[].
+ * exit if trouble.
+ */
+static void readTrace (const char *fn)
+{
+        FILE *fp = strcmp (fn, "-") == 0 ? stdin : fopen (fn, "r");
+        if (!fp) {
+            perror (fn);
+            exit(1);
+        }
+
+        recs = (Rec *) malloc (MAX_RECS * sizeof(Rec));
+        if (!recs) {
+            fprintf (stderr, "%s: no memory for %d records\n", me, MAX_RECS);
+            exit(1);
+        }
+
+        char line[200];
+        int sim_mode = 0, cal_ok = 0, period = 0;
+        while (fgets (line, sizeof(line), fp) && n_recs < MAX_RECS) {
+            Rec r;
+            unsigned relays;
+            if (sscanf (line, "# sim_mode %d cal_ok %d period_us %d", &sim_mode, &cal_ok, &period) == 3)
+                continue;
+            if (sscanf (line, "# az adc %d %d span %f", &cal[0].adc_min, &cal[0].adc_max, &cal[0].span) == 3)
+                continue;
+            if (sscanf (line, "# el adc %d %d span %f", &cal[1].adc_min, &cal[1].adc_max, &cal[1].span) == 3)
+                continue;
+            if (line[0] == '#')
+                continue;
+            if (sscanf (line, "%lf %lf %d %d %u", &r.t, &r.t_relay, &r.adc[0], &r.adc[1], &relays) != 5) {
+                fprintf (stderr, "%s: %s: bogus line: %s", me, fn, line);
+                exit(1);
+            }
+            r.cmd[0] = (relays & 1) ? 1 : ((relays & 2) ? -1 : 0);
+            r.cmd[1] = (relays & 4) ? 1 : ((relays & 8) ? -1 : 0);
+            r.stale = 0;
+            if (n_recs > 0 && r.t <= recs[n_recs-1].t && r.t_relay >= recs[n_recs-1].t_relay) {
+                // failed ADC read, the sample is left over from an earlier tick
+                r.stale = 1;
+                r.t = r.t_relay;
+            }
+            if (n_recs > 0 && (r.t < recs[n_recs-1].t_relay || r.t_relay < r.t)) {
+                fprintf (stderr, "%s: %s: times are out of order at: %s", me, fn, line);
+                exit(1);
+            }
+            recs[n_recs++] = r;
+        }
+        if (fp != stdin)
+            fclose (fp);
+
+        if (!cal_ok || cal[0].adc_max <= cal[0].adc_min || cal[0].span <= 0) {
+            fprintf (stderr, "%s: %s: mount was not calibrated\n", me, fn);
+            exit(1);
+        }
+        if (n_recs < 10) {
+            fprintf (stderr, "%s: %s: only %d records\n", me, fn, n_recs);
+            exit(1);
+        }
+        if (sim_mode)
+            fprintf (stderr, "%s: warning: %s was recorded from the simulator\n", me, fn);
+
+        printf ("%s: %d ticks over %.1f secs, period %.3f secs\n", fn, n_recs,
+                                recs[n_recs-1].t - recs[0].t, period*1e-6);
+}
+
+/* fit a line y = a + b*x to the n points, return 0 if ok else -1
+ */
+static int fitLine (const double x[], const double y[], int n, double *a, double *b)
+{
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (int i = 0; i < n; i++) {
+            sx += x[i];
+            sy += y[i];
+            sxx += x[i]*x[i];
+            sxy += x[i]*y[i];
+        }
+        double d = n*sxx - sx*sx;
+        if (n < 2 || fabs(d) < 1e-12)
+            return (-1);
+        *b = (n*sxy - sx*sy) / d;
+        *a = (sy - *b*sx) / n;
+        return (0);
+}
+
+/* fit a parabola y = a + b*x + c*x*x to the n points, return 0 if ok else -1
+ */
+static int fitParabola (const double x[], const double y[], int n, double *a, double *b, double *c)
+{
+        // normal equations, solved by Cramer's rule
+        double s[5] = {0, 0, 0, 0, 0}, r[3] = {0, 0, 0};
+        for (int i = 0; i < n; i++) {
+            double xp = 1;
+            for (int k = 0; k < 5; k++) {
+                s[k] += xp;
+                if (k < 3)
+                    r[k] += xp*y[i];
+                xp *= x[i];
+            }
+        }
+        double d = s[0]*(s[2]*s[4] - s[3]*s[3]) - s[1]*(s[1]*s[4] - s[3]*s[2]) + s[2]*(s[1]*s[3] - s[2]*s[2]);
+        if (n < 3 || fabs(d) < 1e-12)
+            return (-1);
+        *a = (r[0]*(s[2]*s[4] - s[3]*s[3]) - s[1]*(r[1]*s[4] - s[3]*r[2]) + s[2]*(r[1]*s[3] - s[2]*r[2])) / d;
+        *b = (s[0]*(r[1]*s[4] - r[2]*s[3]) - r[0]*(s[1]*s[4] - s[3]*s[2]) + s[2]*(s[1]*r[2] - r[1]*s[2])) / d;
+        *c = (s[0]*(s[2]*r[2] - s[3]*r[1]) - s[1]*(s[1]*r[2] - s[2]*r[1]) + r[0]*(s[1]*s[3] - s[2]*s[2])) / d;
+        return (0);
+}
+
+static int cmpDouble (const void *p1, const void *p2)
+{
+        double d1 = *(const double *)p1;
+        double d2 = *(const double *)p2;
+        return (d1 < d2 ? -1 : d1 > d2 ? 1 : 0);
+}
+
+/* return the median of v[n], 0 if none. N.B. sorts v[]
+ */
+static double median (double v[], int n)
+{
+        if (n == 0)
+            return (0);
+        qsort (v, n, sizeof(double), cmpDouble);
+        return (n % 2 ? v[n/2] : (v[n/2-1] + v[n/2])/2);
+}
+
+/* return the true position of axis a which reads as y through a pot bowed by nonlin
+ */
+static double unbow (int a, double nonlin, double y)
+{
+        double x = y, span = cal[a].span;
+        for (int i = 0; i < 5; i++)
+            x = y - 4 * nonlin * x * (span - x) / span;
+        return (x);
+}
+
+/* one run of constant command on an axis: from t_relay of record start through that of record end
+ */
+typedef struct {
+    int start, end;                     // records at which the command began and changed
+    int cmd;                            // direction
+    int steady;                         // set if a line was fit to the steady part
+    double t_mid, p_mid, v;             // the line: position p_mid at t_mid with slope v, degs/sec
+    int curved;                         // set if a parabola was also fit to the same samples
+    double q[3];                        // the parabola: q[0] + q[1]*tau + q[2]*tau^2, tau secs from t_mid
+    int n;                              // samples fit
+    double travel;                      // degs between the first and last of them
+} Run;
+
+/* return the position of the steady motion of *rp extended to time t, and its velocity there in *vp.
+ * the parabola is exact for a pot bowed by nonlin so it may be extended, else the line is used.
+ */
+static double runPos (const Run *rp, double t, double *vp)
+{
+        double tau = t - rp->t_mid;
+        if (!rp->curved) {
+            *vp = rp->v;
+            return (rp->p_mid + rp->v*tau);
+        }
+        *vp = rp->q[1] + 2*rp->q[2]*tau;
+        return (rp->q[0] + rp->q[1]*tau + rp->q[2]*tau*tau);
+}
+
+/* fit the profile of axis a into *pp and print the results
+ */
+static void fitAxis (int a, G5500SimAxisProfile *pp)
+{
+        Run *runs = (Run *) calloc (n_recs, sizeof(Run));
+        double *lat, *coast, *diffs;
+        int n_lat = 0, n_coast = 0, n_diffs = 0, n_runs = 0;
+        lat = (double *) malloc (n_recs * sizeof(double));
+        coast = (double *) malloc (n_recs * sizeof(double));
+        diffs = (double *) malloc (n_recs * sizeof(double));
+        double span = cal[a].span;
+
+        // find the runs, each starting at a change of command
+        for (int i = 0; i < n_recs; i++) {
+            if (i == 0 || recs[i].cmd[a] != recs[i-1].cmd[a]) {
+                if (n_runs > 0)
+                    runs[n_runs-1].end = i;
+                runs[n_runs].start = i;
+                runs[n_runs].cmd = recs[i].cmd[a];
+                n_runs++;
+            }
+        }
+        runs[n_runs-1].end = n_recs - 1;
+
+        for (int r = 0; r < n_runs; r++) {
+            Run *rp = &runs[r];
+            double t0 = recs[rp->start].t_relay;
+            double t1 = recs[rp->end].t_relay;
+
+            if (rp->cmd == 0) {
+                // noise from the samples once at rest
+                for (int i = rp->start + 2; i <= rp->end; i++)
+                    if (recs[i-1].t > t0 + REST && !recs[i].stale && !recs[i-1].stale)
+                        diffs[n_diffs++] = recPos (a, i) - recPos (a, i-1);
+                continue;
+            }
+
+            // samples read while steady, ie, after settling and before the command changed
+            int i0 = rp->start + 1;
+            while (i0 <= rp->end && recs[i0].t < t0 + SETTLE)
+                i0++;
+            if (rp->end - i0 + 1 < MIN_STEADY)
+                continue;
+            double t[rp->end - i0 + 1], p[rp->end - i0 + 1];
+            int n = 0, at_limit = 0;
+            for (int i = i0; i <= rp->end; i++) {
+                if (recs[i].stale)
+                    continue;
+                t[n] = recs[i].t - t0;
+                p[n] = recPos (a, i);
+                n++;
+                if (recs[i].adc[a] <= cal[a].adc_min || recs[i].adc[a] >= cal[a].adc_max)
+                    at_limit = 1;
+            }
+            if (at_limit || n < MIN_STEADY)
+                continue;
+
+            double pa, pb;
+            if (fitLine (t, p, n, &pa, &pb) < 0 || pb * rp->cmd <= 0)
+                continue;
+            rp->steady = 1;
+            rp->t_mid = t0 + (t[0] + t[n-1])/2;
+            rp->p_mid = pa + pb*(t[0] + t[n-1])/2;
+            rp->v = pb;
+
+            // the parabola, about the middle of the run so its coefficients are the derivatives there
+            double tau[n];
+            for (int j = 0; j < n; j++)
+                tau[j] = t[j] - (t[0] + t[n-1])/2;
+            if (fitParabola (tau, p, n, &rp->q[0], &rp->q[1], &rp->q[2]) == 0 && rp->q[1] * rp->cmd > 0) {
+                rp->curved = 1;
+                rp->n = n;
+                rp->travel = fabs (p[n-1] - p[0]);
+            }
+
+            // latency from rest
+            if (r > 0 && runs[r-1].cmd == 0 && !recs[rp->start].stale
+                            && recs[rp->start].t > recs[runs[r-1].start].t_relay + REST) {
+                // where the steady motion extended back meets the rest position
+                double p_rest = recPos (a, rp->start);
+                double t_on = rp->t_mid + (p_rest - rp->p_mid) / rp->v;
+                for (int k = 0; k < 5; k++) {
+                    double v_on, p_on = runPos (rp, t_on, &v_on);
+                    t_on += (p_rest - p_on) / v_on;
+                }
+                lat[n_lat++] = t_on - t0;
+            }
+
+            // coast, if followed by a long enough rest to be sure where it stopped
+            if (r + 1 < n_runs && runs[r+1].cmd == 0) {
+                const Run *np = &runs[r+1];
+                double sum = 0;
+                int n_rest = 0;
+                for (int i = np->start + 1; i <= np->end; i++) {
+                    if (recs[i].t > t1 + REST && !recs[i].stale) {
+                        sum += recPos (a, i);
+                        n_rest++;
+                    }
+                }
+                if (n_rest >= 2) {
+                    double v_off, p_off = runPos (rp, t1, &v_off);
+                    double d_coast = (sum/n_rest - p_off) * rp->cmd;
+                    coast[n_coast++] = 2 * d_coast / fabs (v_off);
+                }
+            }
+        }
+
+        // nonlinearity from the curvature of each long run: y'' = -8*nonlin*v^2/span, weighted by the inverse
+        // of the variance of its curvature, which falls as samples times the fourth power of the travel
+        double nl_sum = 0, nl_wt = 0;
+        for (int r = 0; r < n_runs; r++) {
+            const Run *rp = &runs[r];
+            if (rp->curved && rp->travel >= MIN_NONLIN_COVER*span) {
+                double wt = rp->n * pow (rp->travel/span, 4);
+                nl_sum += -2*rp->q[2]*span/(8*rp->q[1]*rp->q[1]) * wt;
+                nl_wt += wt;
+            }
+        }
+        double nonlin = nl_wt > 0 ? nl_sum/nl_wt : pp->nonlin;
+
+        // speed from the slope at mid run less the bow of the pot there: y' = v*(1 + 4*nonlin*(span - 2*x)/span)
+        double v_sum[2] = {0, 0}, v[2] = {0, 0};
+        int n_v[2] = {0, 0}, n_vruns[2] = {0, 0};
+        for (int r = 0; r < n_runs; r++) {
+            const Run *rp = &runs[r];
+            if (!rp->curved)
+                continue;
+            int d = rp->cmd > 0 ? 0 : 1;
+            double x = unbow (a, nonlin, rp->q[0]);
+            v_sum[d] += fabs (rp->q[1]) / (1 + 4*nonlin*(span - 2*x)/span) * rp->n;
+            n_v[d] += rp->n;
+            n_vruns[d]++;
+        }
+        for (int d = 0; d < 2; d++)
+            if (n_v[d] > 0)
+                v[d] = v_sum[d] / n_v[d];
+
+        // each reading is also rounded to a whole ADC step, adding variance step^2/12
+        double noise = 0, step = span / (cal[a].adc_max - cal[a].adc_min);
+        for (int i = 0; i < n_diffs; i++)
+            noise += diffs[i]*diffs[i];
+        noise = n_diffs > 1 ? sqrt (fmax (0, noise/n_diffs/2 - step*step/12)) : 0;
+
+        // keep what could not be measured
+        if (v[0] > 0)
+            pp->speed_up = v[0];
+        if (v[1] > 0)
+            pp->speed_down = v[1];
+        pp->nonlin = nonlin;
+        if (n_lat > 0)
+            pp->latency = fmax (0, median (lat, n_lat));
+        if (n_coast > 0)
+            pp->coast = fmax (0, median (coast, n_coast));
+        if (n_diffs > 1)
+            pp->noise = noise;
+
+        printf ("%s %10.3f %10.3f %8.3f %8.3f %8.4f %8.4f   %5d %5d %5d %5d %7d\n", cal[a].name,
+                pp->speed_up, pp->speed_down, pp->latency, pp->coast, pp->noise, pp->nonlin,
+                n_vruns[0], n_vruns[1], n_lat, n_coast, n_diffs);
+
+        free (runs);
+        free (lat);
+        free (coast);
+        free (diffs);
+}
+
+/* replay the relay commands of axis a through *pp, restarting at each move from rest if per_move.
+ * report the rms and max error in *rmsp and *maxp, degs.
+ */
+static void replayAxis (int a, const G5500SimAxisProfile *pp, int per_move, double *rmsp, double *maxp)
+{
+        G5500SimAxis ax;
+        double sum = 0, max = 0;
+        int n = 0;
+        double deg_per_adc = cal[a].span / (cal[a].adc_max - cal[a].adc_min);
+
+        g5500SimAxisInit (&ax, pp, cal[a].adc_min, cal[a].adc_max, cal[a].span,
+                                unbow (a, pp->nonlin, recPos (a, 0)), recs[0].t);
+        for (int i = 0; i < n_recs; i++) {
+            if (per_move && i > 0 && recs[i].cmd[a] != 0 && recs[i-1].cmd[a] == 0)
+                g5500SimAxisInit (&ax, pp, cal[a].adc_min, cal[a].adc_max, cal[a].span,
+                                unbow (a, pp->nonlin, recPos (a, i)), recs[i].t);
+            double err = (g5500SimRead (&ax, recs[i].t, 0) - recs[i].adc[a]) * deg_per_adc;
+            if (!recs[i].stale) {
+                sum += err*err;
+                if (fabs(err) > max)
+                    max = fabs(err);
+                n++;
+            }
+            g5500SimCommand (&ax, recs[i].cmd[a], recs[i].t_relay);
+        }
+
+        *rmsp = n > 0 ? sqrt (sum/n) : 0;
+        *maxp = max;
+}
+
+static void usage (void)
+{
+        fprintf (stderr, "Purpose: fit the simulator mount profile to a g5500pi flight recorder trace\n");
+        fprintf (stderr, "Usage: %s [options] trace_file\n", me);
+        fprintf (stderr, "  -o file : write the fitted profile to file, such as ~/.hamlib_g5500_sim.txt\n");
+        fprintf (stderr, "  -p file : compare with this profile rather than the ideal simulator\n");
+        exit(1);
+}
+
+int main (int ac, char *av[])
+{
+        const char *out_fn = NULL, *cmp_fn = NULL;
+        char ynot[1024];
+        int opt;
+
+        me = av[0];
+        while ((opt = getopt (ac, av, "o:p:")) != -1) {
+            switch (opt) {
+            case 'o': out_fn = optarg; break;
+            case 'p': cmp_fn = optarg; break;
+            default: usage(); break;
+            }
+        }
+        if (optind != ac - 1)
+            usage();
+
+        readTrace (av[optind]);
+        int n_axes = cal[1].adc_max > cal[1].adc_min && cal[1].span > 0 ? 2 : 1;
+
+        // the comparison profile is also the starting point for anything that can not be measured
+        G5500SimProfile cmp, fit;
+        g5500SimDefaultProfile (&cmp);
+        if (cmp_fn && g5500SimReadProfile (cmp_fn, &cmp, ynot) < 0) {
+            fprintf (stderr, "%s: %s\n", me, ynot);
+            exit(1);
+        }
+        fit = cmp;
+
+        printf ("\n      ------ degs/sec ------    ------ secs -----  -- degs --   fraction   "
+                                "----- events used -----\n");
+        printf ("axis    speed_up speed_down  latency    coast    noise   nonlin      up  down   lat coast    rest\n");
+        G5500SimAxisProfile *fp[2] = {&fit.az, &fit.el};
+        G5500SimAxisProfile *cp[2] = {&cmp.az, &cmp.el};
+        for (int a = 0; a < n_axes; a++)
+            fitAxis (a, fp[a]);
+
+        printf ("\nreplay error, degs        ------- open loop ------    ------- per move -------\n");
+        printf ("axis  profile              rms          max              rms          max\n");
+        for (int a = 0; a < n_axes; a++) {
+            for (int f = 0; f < 2; f++) {
+                const G5500SimAxisProfile *pp = f ? fp[a] : cp[a];
+                double o_rms, o_max, m_rms, m_max;
+                replayAxis (a, pp, 0, &o_rms, &o_max);
+                replayAxis (a, pp, 1, &m_rms, &m_max);
+                printf ("%-5s %-12s %12.3f %12.3f     %12.3f %12.3f\n", f ? "" : cal[a].name,
+                                f ? "fitted" : (cmp_fn ? "compared" : "ideal"), o_rms, o_max, m_rms, m_max);
+            }
+        }
+
+        if (out_fn) {
+            if (g5500SimWriteProfile (out_fn, &fit, ynot) < 0) {
+                fprintf (stderr, "%s: %s\n", me, ynot);
+                exit(1);
+            }
+            printf ("\nwrote %s\n", out_fn);
+        }
+
+        return (0);
+}
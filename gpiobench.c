@@ -0,0 +1,225 @@
+/* benchmark whichever piGPIO implementation this is linked with.
+ *
+ * The same program is built once for each: gpiobench (mmap of /dev/gpiomem), gpiobench-sys (sysfs),
+ * gpiobench-cdev (GPIO character device) and gpiobench-mock (in memory, runs anywhere). Each phase times
+ * n calls of one operation, first back-to-back for throughput and CPU time, then one at a time for the
+ * latency distribution, from which the cost of reading the clock is subtracted:
+ *
+ *   set_hi:    piGPIOsetHi on the first pin
+ *   set_lo:    piGPIOsetLo on the first pin
+ *   toggle:    piGPIOsetHiLo on the first pin, alternating
+ *   set_many:  piGPIOsetMany on all pins, alternating
+ *   read:      piGPIOreadPin on the first pin
+ *   readback:  piGPIOsetHiLo then piGPIOreadPin on the first pin, alternating, counting reads that disagree
+ *
+ * N.B. the pins are driven as outputs throughout so never name any wired to the rotator relays.
+ *
+ * build with Makefile_sa then run, eg, ./gpiobench-cdev -n 20000 20 21 26
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "piGPIO.h"
+
+int verbose;
+
+static char *me;
+static int n_calls = 10000;
+static uint8_t pins[64];
+static int n_pins;
+static uint64_t pin_mask;
+static int n_mismatch;
+
+/* return a monotonic time in nanoseconds
+ */
+static double nowNs (void)
+{
+        struct timespec ts;
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+        return (ts.tv_sec*1e9 + ts.tv_nsec);
+}
+
+/* return user plus system CPU time in nanoseconds
+ */
+static double cpuNs (void)
+{
+        struct rusage ru;
+        getrusage (RUSAGE_SELF, &ru);
+        return ((ru.ru_utime.tv_sec + ru.ru_stime.tv_sec)*1e9 + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec)*1e3);
+}
+
+static int cmpDouble (const void *p1, const void *p2)
+{
+        double d1 = *(const double *)p1;
+        double d2 = *(const double *)p2;
+        return (d1 < d2 ? -1 : d1 > d2 ? 1 : 0);
+}
+
+/* the operations, each given its call number
+ */
+static void opSetHi (int i)
+{
+        (void) i;
+        piGPIOsetHi (pins[0]);
+}
+
+static void opSetLo (int i)
+{
+        (void) i;
+        piGPIOsetLo (pins[0]);
+}
+
+static void opToggle (int i)
+{
+        piGPIOsetHiLo (pins[0], i & 1);
+}
+
+static void opSetMany (int i)
+{
+        if (i & 1)
+            piGPIOsetMany (pin_mask, 0);
+        else
+            piGPIOsetMany (0, pin_mask);
+}
+
+static void opRead (int i)
+{
+        (void) i;
+        (void) piGPIOreadPin (pins[0]);
+}
+
+static void opReadBack (int i)
+{
+        piGPIOsetHiLo (pins[0], i & 1);
+        if (piGPIOreadPin (pins[0]) != (i & 1))
+            n_mismatch++;
+}
+
+typedef struct {
+    const char *name;
+    void (*fp)(int i);
+} Op;
+
+static const Op ops[] = {
+    {"set_hi",   opSetHi},
+    {"set_lo",   opSetLo},
+    {"toggle",   opToggle},
+    {"set_many", opSetMany},
+    {"read",     opRead},
+    {"readback", opReadBack},
+};
+
+/* return the least time to read the clock, ns
+ */
+static double clockCost (void)
+{
+        double min = 1e9;
+        for (int i = 0; i < 1000; i++) {
+            double t0 = nowNs();
+            double dt = nowNs() - t0;
+            if (dt < min)
+                min = dt;
+        }
+        return (min);
+}
+
+/* run one operation and print its results.
+ * lat[] must have room for n_calls.
+ */
+static void runOp (const Op *op, double clock_ns, double lat[])
+{
+        // throughput and CPU time
+        n_mismatch = 0;
+        double c0 = cpuNs();
+        double t0 = nowNs();
+        for (int i = 0; i < n_calls; i++)
+            (*op->fp)(i);
+        double wall = nowNs() - t0;
+        double cpu = cpuNs() - c0;
+
+        // latency of each call
+        for (int i = 0; i < n_calls; i++) {
+            double t = nowNs();
+            (*op->fp)(i);
+            lat[i] = nowNs() - t - clock_ns;
+            if (lat[i] < 0)
+                lat[i] = 0;
+        }
+        qsort (lat, n_calls, sizeof(double), cmpDouble);
+
+        printf ("%-9s %10.0f %8.3f %8.3f %8.3f %8.3f %8.3f %8.3f",
+                op->name, 1e9*n_calls/wall, 1e-3*cpu/n_calls,
+                1e-3*lat[n_calls/2], 1e-3*lat[(int)(n_calls*0.9)], 1e-3*lat[(int)(n_calls*0.99)],
+                1e-3*lat[(int)(n_calls*0.999)], 1e-3*lat[n_calls-1]);
+        if (op->fp == opReadBack)
+            printf ("  %d of %d reads disagreed", n_mismatch, 2*n_calls);
+        printf ("\n");
+}
+
+static void usage (void)
+{
+        fprintf (stderr, "Purpose: measure the cost of each %s GPIO operation\n", piGPIOBackend);
+        fprintf (stderr, "Usage: %s [options] BCM_pin [BCM_pin ...]\n", me);
+        fprintf (stderr, "  -n n    : calls per phase; default %d\n", n_calls);
+        fprintf (stderr, "  -v      : verbose\n");
+        fprintf (stderr, "N.B. all pins are driven as outputs and left low.\n");
+        exit(1);
+}
+
+int main (int ac, char *av[])
+{
+        int opt;
+
+        me = av[0];
+        while ((opt = getopt (ac, av, "n:v")) != -1) {
+            switch (opt) {
+            case 'n': n_calls = atoi (optarg); break;
+            case 'v': verbose = 1; break;
+            default: usage(); break;
+            }
+        }
+        if (optind == ac || n_calls < 2)
+            usage();
+        for (; optind < ac; optind++) {
+            int p = atoi (av[optind]);
+            if (p < 0 || p > 53 || n_pins == 54) {
+                fprintf (stderr, "%s: BCM pins are 0 .. 53\n", me);
+                exit(1);
+            }
+            pins[n_pins++] = p;
+            pin_mask |= 1ULL << p;
+        }
+
+        char ynot[1024];
+        if (piGPIOInit (ynot) < 0) {
+            fprintf (stderr, "%s: %s\n", me, ynot);
+            exit(1);
+        }
+        for (int i = 0; i < n_pins; i++) {
+            piGPIOsetAsOutput (pins[i]);
+            piGPIOsetLo (pins[i]);
+        }
+
+        double *lat = (double *) calloc (n_calls, sizeof(double));
+        if (!lat) {
+            fprintf (stderr, "%s: no memory for %d calls\n", me, n_calls);
+            exit(1);
+        }
+
+        double clock_ns = clockCost();
+        printf ("backend %s, %d calls per phase, %d pins, clock read %.0f ns\n", piGPIOBackend, n_calls,
+                                n_pins, clock_ns);
+        printf ("                           cpu   -------------- latency, us --------------\n");
+        printf ("op           calls/s   us/call      p50      p90      p99    p99.9      max\n");
+        for (unsigned i = 0; i < sizeof(ops)/sizeof(ops[0]); i++)
+            runOp (&ops[i], clock_ns, lat);
+
+        piGPIOsetMany (0, pin_mask);
+        free (lat);
+        return (0);
+}
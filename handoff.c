@@ -0,0 +1,322 @@
+/* hand a running g5500pi over to a new instance of its program file without closing any connections.
+ *
+ * The running instance calls handOffSend() which starts the program file again with "-H fd", where fd is
+ * one end of a socket pair. It then sends a header and all its descriptors in one message using
+ * SCM_RIGHTS, followed by an opaque state blob. The new instance receives these with handOffReceive(),
+ * carries on from them and calls handOffDone() once it is fully running, at which point the old instance
+ * may exit. If the new instance does not confirm within HANDOFF_TIMEOUT_MS it is killed and the old instance
+ * carries on as if nothing happened; its descriptors were never closed.
+ *
+ * The program file is the path of the running executable as found at startup by handOffInit(), so a new
+ * build installed over it is what runs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+
+#include "handoff.h"
+
+
+#define HANDOFF_MAGIC           0x47354832      // "G5H2"
+#define HANDOFF_TIMEOUT_MS      5000            // max wait for the new instance to take over
+#define HANDOFF_OK              'k'             // byte sent by the new instance once running
+
+// sent along with the descriptors
+typedef struct {
+    uint32_t magic;                             // HANDOFF_MAGIC
+    int n_fds;                                  // number of descriptors in the message
+    int roles[MAX_HANDOFF_FDS];                 // role of each
+    uint64_t len;                               // bytes of state following this header
+} HandOffHeader;
+
+static char exe_path[PATH_MAX];                 // our program file
+static char **exe_argv;                         // our original arguments
+
+
+/* capture what is needed to start our program file again later.
+ * N.B. call once at startup, before anything may replace the file.
+ */
+void handOffInit (char *argv[])
+{
+        ssize_t n = readlink ("/proc/self/exe", exe_path, sizeof(exe_path) - 1);
+        if (n > 0)
+            exe_path[n] = '\0';
+        else
+            snprintf (exe_path, sizeof(exe_path), "%s", argv[0]);
+        exe_argv = argv;
+}
+
+/* write all of buf[len] to fd.
+ * return 0 if ok else -1
+ */
+static int writeAll (int fd, const void *buf, size_t len)
+{
+        const char *bp = (const char *) buf;
+        while (len > 0) {
+            ssize_t n = write (fd, bp, len);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return (-1);
+            bp += n;
+            len -= n;
+        }
+        return (0);
+}
+
+/* read exactly buf[len] from fd.
+ * return 0 if ok else -1
+ */
+static int readAll (int fd, void *buf, size_t len)
+{
+        char *bp = (char *) buf;
+        while (len > 0) {
+            ssize_t n = read (fd, bp, len);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return (-1);
+            bp += n;
+            len -= n;
+        }
+        return (0);
+}
+
+/* build the arguments to start our program file again with -H sock followed by our original arguments.
+ * return malloced argv, including room for sock_str which must persist until exec, or NULL if no memory.
+ */
+static char **newArgv (int sock, char sock_str[], size_t sock_len)
+{
+        int n_args = 0;
+        while (exe_argv[n_args])
+            n_args++;
+        char **argv = (char **) calloc (n_args + 3, sizeof(char *));
+        if (!argv)
+            return (NULL);
+        snprintf (sock_str, sock_len, "%d", sock);
+        int n = 0;
+        argv[n++] = exe_argv[0];
+        argv[n++] = "-H";
+        argv[n++] = sock_str;
+        for (int i = 1; i < n_args; i++) {
+            // skip our own -H if we were started by a handoff
+            if (strcmp (exe_argv[i], "-H") == 0 && i+1 < n_args)
+                i++;
+            else
+                argv[n++] = exe_argv[i];
+        }
+        return (argv);
+}
+
+/* in the child, start our program file with argv[], closing all but sock below max_fd first.
+ * N.B. we are the fork of a multithreaded process so only async-signal-safe functions may be used here.
+ * never returns.
+ */
+static void execNew (int sock, long max_fd, char *argv[], const char *fail_msg, size_t fail_len)
+{
+        // the new instance receives only what is passed to it explicitly
+        for (int fd = 3; fd < max_fd; fd++)
+            if (fd != sock)
+                close (fd);
+
+        execv (exe_path, argv);
+        (void) !write (2, fail_msg, fail_len);
+        _exit(1);
+}
+
+/* start a new instance of our program file and hand it fds[n_fds] and state[len].
+ * return 0 once the new instance has taken over, else -1 with excuse in ynot[] and the new instance gone.
+ * N.B. on success the caller must exit at once without disturbing anything it handed over.
+ */
+int handOffSend (const HandOffFD fds[], int n_fds, const void *state, size_t len, char ynot[])
+{
+        if (n_fds < 0 || n_fds > MAX_HANDOFF_FDS) {
+            sprintf (ynot, "can not pass %d descriptors, max %d", n_fds, MAX_HANDOFF_FDS);
+            return (-1);
+        }
+
+        int sv[2];
+        if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+            sprintf (ynot, "socketpair: %s", strerror(errno));
+            return (-1);
+        }
+
+        // don't wait forever on a new instance that is not reading
+        struct timeval tv;
+        tv.tv_sec = HANDOFF_TIMEOUT_MS/1000;
+        tv.tv_usec = (HANDOFF_TIMEOUT_MS%1000)*1000;
+        (void) setsockopt (sv[0], SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+        // everything the child needs is prepared now, it may not allocate or format
+        char sock_str[20];
+        char **argv = newArgv (sv[1], sock_str, sizeof(sock_str));
+        if (!argv) {
+            strcpy (ynot, "no memory for arguments");
+            close (sv[0]);
+            close (sv[1]);
+            return (-1);
+        }
+        char fail_msg[PATH_MAX + 50];
+        int fail_len = snprintf (fail_msg, sizeof(fail_msg), "handoff: can not exec %s\n", exe_path);
+        if (fail_len >= (int)sizeof(fail_msg))
+            fail_len = sizeof(fail_msg) - 1;
+        long max_fd = sysconf (_SC_OPEN_MAX);
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            sprintf (ynot, "fork: %s", strerror(errno));
+            free (argv);
+            close (sv[0]);
+            close (sv[1]);
+            return (-1);
+        }
+        if (pid == 0) {
+            close (sv[0]);
+            execNew (sv[1], max_fd, argv, fail_msg, fail_len);
+        }
+        free (argv);
+        close (sv[1]);
+
+        // header and descriptors in one message
+        HandOffHeader h;
+        memset (&h, 0, sizeof(h));
+        h.magic = HANDOFF_MAGIC;
+        h.n_fds = n_fds;
+        h.len = len;
+        for (int i = 0; i < n_fds; i++)
+            h.roles[i] = fds[i].role;
+
+        union {
+            struct cmsghdr align;
+            char buf[CMSG_SPACE(MAX_HANDOFF_FDS * sizeof(int))];
+        } cbuf;
+        memset (&cbuf, 0, sizeof(cbuf));
+        struct iovec iov;
+        iov.iov_base = &h;
+        iov.iov_len = sizeof(h);
+        struct msghdr msg;
+        memset (&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        if (n_fds > 0) {
+            msg.msg_control = cbuf.buf;
+            msg.msg_controllen = CMSG_SPACE(n_fds * sizeof(int));
+            struct cmsghdr *cmp = CMSG_FIRSTHDR (&msg);
+            cmp->cmsg_level = SOL_SOCKET;
+            cmp->cmsg_type = SCM_RIGHTS;
+            cmp->cmsg_len = CMSG_LEN(n_fds * sizeof(int));
+            int *fdp = (int *) CMSG_DATA (cmp);
+            for (int i = 0; i < n_fds; i++)
+                fdp[i] = fds[i].fd;
+        }
+
+        // send, then wait for the new instance to confirm it is running
+        char ok = 0;
+        struct pollfd pfd;
+        pfd.fd = sv[0];
+        pfd.events = POLLIN;
+        if (sendmsg (sv[0], &msg, MSG_NOSIGNAL) != (ssize_t)sizeof(h)) {
+            sprintf (ynot, "sendmsg: %s", strerror(errno));
+        } else if (writeAll (sv[0], state, len) < 0) {
+            sprintf (ynot, "sending state: %s", strerror(errno));
+        } else if (poll (&pfd, 1, HANDOFF_TIMEOUT_MS) <= 0) {
+            sprintf (ynot, "new instance did not take over within %d ms", HANDOFF_TIMEOUT_MS);
+        } else if (read (sv[0], &ok, 1) != 1 || ok != HANDOFF_OK) {
+            sprintf (ynot, "new instance failed to take over");
+        }
+        close (sv[0]);
+
+        if (ok == HANDOFF_OK)
+            return (0);
+
+        // insure the new instance can not interfere
+        kill (pid, SIGKILL);
+        waitpid (pid, NULL, 0);
+        return (-1);
+}
+
+/* receive the descriptors and state sent by handOffSend() on sock.
+ * fds[] must have room for MAX_HANDOFF_FDS. *statep is malloced and must be freed by the caller.
+ * return 0 if ok else -1 with excuse in ynot[].
+ */
+int handOffReceive (int sock, HandOffFD fds[], int *n_fdsp, void **statep, size_t *lenp, char ynot[])
+{
+        HandOffHeader h;
+        union {
+            struct cmsghdr align;
+            char buf[CMSG_SPACE(MAX_HANDOFF_FDS * sizeof(int))];
+        } cbuf;
+        struct iovec iov;
+        iov.iov_base = &h;
+        iov.iov_len = sizeof(h);
+        struct msghdr msg;
+        memset (&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = cbuf.buf;
+        msg.msg_controllen = sizeof(cbuf.buf);
+
+        ssize_t n = recvmsg (sock, &msg, MSG_WAITALL);
+        if (n != (ssize_t)sizeof(h) || h.magic != HANDOFF_MAGIC) {
+            strcpy (ynot, "handoff header is missing or from an incompatible version");
+            return (-1);
+        }
+        if (msg.msg_flags & MSG_CTRUNC) {
+            strcpy (ynot, "handoff descriptors were truncated");
+            return (-1);
+        }
+
+        // collect descriptors
+        int n_fds = 0;
+        struct cmsghdr *cmp = CMSG_FIRSTHDR (&msg);
+        if (cmp && cmp->cmsg_level == SOL_SOCKET && cmp->cmsg_type == SCM_RIGHTS) {
+            n_fds = (cmp->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const int *fdp = (const int *) CMSG_DATA (cmp);
+            for (int i = 0; i < n_fds && i < MAX_HANDOFF_FDS; i++) {
+                fds[i].fd = fdp[i];
+                fds[i].role = h.roles[i];
+            }
+        }
+        if (n_fds != h.n_fds) {
+            sprintf (ynot, "expected %d handoff descriptors but received %d", h.n_fds, n_fds);
+            return (-1);
+        }
+        *n_fdsp = n_fds;
+
+        // then the state
+        char *state = (char *) malloc (h.len > 0 ? h.len : 1);
+        if (!state) {
+            strcpy (ynot, "no memory for handoff state");
+            return (-1);
+        }
+        if (readAll (sock, state, h.len) < 0) {
+            strcpy (ynot, "handoff state is short");
+            free (state);
+            return (-1);
+        }
+        *statep = state;
+        *lenp = h.len;
+
+        return (0);
+}
+
+/* tell the old instance we are now running and it may exit
+ */
+void handOffDone (int sock)
+{
+        char ok = HANDOFF_OK;
+        if (writeAll (sock, &ok, 1) < 0)
+            fprintf (stderr, "handoff: confirming: %s\n", strerror(errno));
+        close (sock);
+}
@@ -0,0 +1,19 @@
+#ifndef _HANDOFF_H
+#define _HANDOFF_H
+
+#include <stddef.h>
+
+#define MAX_HANDOFF_FDS         64      // max descriptors passed in one handoff
+
+// one descriptor passed to the new instance, role has whatever meaning the caller gives it
+typedef struct {
+    int fd;
+    int role;
+} HandOffFD;
+
+extern void handOffInit (char *argv[]);
+extern int handOffSend (const HandOffFD fds[], int n_fds, const void *state, size_t len, char ynot[]);
+extern int handOffReceive (int sock, HandOffFD fds[], int *n_fdsp, void **statep, size_t *lenp, char ynot[]);
+extern void handOffDone (int sock);
+
+#endif // _HANDOFF_H
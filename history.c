@@ -0,0 +1,253 @@
+/* serve the recent position history recorded by the control thread, downsampled for display.
+ *
+ * The web command is:
+ *
+ *    history?since=t&max_points=n&fmt=json|bin
+ *
+ * all arguments optional. since is a unix time, default 0 for all retained history; only points after it
+ * are returned so a client can ask for just what is new by passing back the last time it received.
+ * max_points, default DEF_MAX_POINTS, limits the reply: longer series are reduced with the
+ * largest-triangle-three-buckets algorithm which keeps the points that contribute most to the visible
+ * shape of the track rather than simply every nth. The first and last points are always kept.
+ *
+ * JSON replies are columnar to stay compact, with times relative to t0 and rounded to what is useful:
+ *
+ *    {"t0":1760789400.123,"last":1760789460.323,"n":3,
+ *     "t":[0,0.2,...],"az":[...],"el":[...],"az_target":[...],"el_target":[...]}
+ *
+ * last is the time of the newest point before downsampling, to be used as the next since.
+ *
+ * Binary replies are the 4 byte magic "G5H1", a uint32 count, the double last, then count records each of a
+ * double t and floats az, el, az_target, el_target, all in host byte order, ie, little-endian on the RPi.
+ *
+ * The web command trace instead dumps the flight recorder: every control tick retained, oldest first, with
+ * the raw ADC values and the relays commanded, as text suitable for g5500fit:
+ *
+ *    # G5500 flight recorder
+ *    # sim_mode 0 cal_ok 1 period_us 200000
+ *    # az adc 140 3960 span 450
+ *    # el adc 152 3904 span 180
+ *    # t t_relay az_adc el_adc relays: 1 cw 2 ccw 4 up 8 down
+ *    8123.200113 8123.201050 2210 1534 1
+ *
+ * Times are from the monotonic clock, so only their differences matter.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "g5500_sa.h"
+#include "history.h"
+
+
+#define DEF_MAX_POINTS          500             // default max points in one reply
+#define MIN_MAX_POINTS          3               // LTTB requires at least first, last and one between
+
+
+/* return the area of the triangle formed by points a, b, c in the t-az plane plus that in the t-el plane.
+ * using both planes keeps the corners of the track in either axis.
+ */
+static double triangleArea (const G5500HistPoint *a, const G5500HistPoint *b, double ct, double caz, double cel)
+{
+        double az_area = fabs ((a->t - ct)*(b->az - a->az) - (a->t - b->t)*(caz - a->az));
+        double el_area = fabs ((a->t - ct)*(b->el - a->el) - (a->t - b->t)*(cel - a->el));
+        return (az_area + el_area);
+}
+
+/* reduce in[n_in] to out[n_out] using largest-triangle-three-buckets, n_out must be at least 3.
+ * return number of points in out[], which is n_in if that is already no more than n_out.
+ */
+static int downsampleLTTB (const G5500HistPoint *in, int n_in, G5500HistPoint *out, int n_out)
+{
+        if (n_in <= n_out) {
+            memcpy (out, in, n_in * sizeof(*in));
+            return (n_in);
+        }
+
+        // first point always
+        int n = 0;
+        out[n++] = in[0];
+        int a = 0;
+
+        // the n_in-2 interior points are divided into n_out-2 buckets, choose one from each
+        double bucket = (double)(n_in - 2) / (n_out - 2);
+        for (int b = 0; b < n_out - 2; b++) {
+
+            // range of this bucket
+            int lo = (int)(b * bucket) + 1;
+            int hi = (int)((b + 1) * bucket) + 1;
+
+            // average of the next bucket, or the last point if this is the final bucket
+            int nlo = hi;
+            int nhi = (int)((b + 2) * bucket) + 1;
+            if (nhi > n_in)
+                nhi = n_in;
+            if (nlo >= nhi)
+                nlo = n_in - 1;
+            double ct = 0, caz = 0, cel = 0;
+            for (int i = nlo; i < nhi; i++) {
+                ct += in[i].t;
+                caz += in[i].az;
+                cel += in[i].el;
+            }
+            ct /= nhi - nlo;
+            caz /= nhi - nlo;
+            cel /= nhi - nlo;
+
+            // choose the point in this bucket forming the largest triangle with the last chosen and the average
+            int best = lo;
+            double best_area = -1;
+            for (int i = lo; i < hi; i++) {
+                double area = triangleArea (&in[a], &in[i], ct, caz, cel);
+                if (area > best_area) {
+                    best_area = area;
+                    best = i;
+                }
+            }
+
+            out[n++] = in[best];
+            a = best;
+        }
+
+        // last point always
+        out[n++] = in[n_in - 1];
+
+        return (n);
+}
+
+/* send pts[n] to fp as compact JSON
+ */
+static void sendJSON (FILE *fp, const G5500HistPoint *pts, int n, double last)
+{
+        double t0 = n > 0 ? pts[0].t : last;
+
+        fprintf (fp, "{\"t0\":%.3f,\"last\":%.3f,\"n\":%d,\"t\":[", t0, last, n);
+        for (int i = 0; i < n; i++)
+            fprintf (fp, "%s%.2f", i ? "," : "", pts[i].t - t0);
+        fprintf (fp, "],\"az\":[");
+        for (int i = 0; i < n; i++)
+            fprintf (fp, "%s%.2f", i ? "," : "", pts[i].az);
+        fprintf (fp, "],\"el\":[");
+        for (int i = 0; i < n; i++)
+            fprintf (fp, "%s%.2f", i ? "," : "", pts[i].el);
+        fprintf (fp, "],\"az_target\":[");
+        for (int i = 0; i < n; i++)
+            fprintf (fp, "%s%.2f", i ? "," : "", pts[i].az_target);
+        fprintf (fp, "],\"el_target\":[");
+        for (int i = 0; i < n; i++)
+            fprintf (fp, "%s%.2f", i ? "," : "", pts[i].el_target);
+        fprintf (fp, "]}\n");
+}
+
+/* send pts[n] to fp in the binary format
+ */
+static void sendBinary (FILE *fp, const G5500HistPoint *pts, int n, double last)
+{
+        uint32_t count = n;
+
+        fwrite ("G5H1", 4, 1, fp);
+        fwrite (&count, sizeof(count), 1, fp);
+        fwrite (&last, sizeof(last), 1, fp);
+        for (int i = 0; i < n; i++) {
+            fwrite (&pts[i].t, sizeof(pts[i].t), 1, fp);
+            fwrite (&pts[i].az, sizeof(pts[i].az), 1, fp);
+            fwrite (&pts[i].el, sizeof(pts[i].el), 1, fp);
+            fwrite (&pts[i].az_target, sizeof(pts[i].az_target), 1, fp);
+            fwrite (&pts[i].el_target, sizeof(pts[i].el_target), 1, fp);
+        }
+}
+
+/* send the http preamble for the given content type
+ */
+static void startHTTP (FILE *fp, const char *type)
+{
+        fprintf (fp, "HTTP/1.0 200 OK\r\n");
+        fprintf (fp, "User-Agent: g5500_sa\r\n");
+        fprintf (fp, "Content-Type: %s\r\n", type);
+        fprintf (fp, "Connection: close\r\n");
+        fprintf (fp, "\r\n");
+}
+
+/* perform the history web command, cmd is the full command including any query.
+ * the reply includes the http preamble if is_http.
+ */
+void histWebCommand (FILE *fp, char *cmd, int is_http)
+{
+        char *query = strchr (cmd, '?');
+        char arg[64];
+
+        // crack args
+        double since = 0;
+        int max_points = DEF_MAX_POINTS;
+        int binary = 0;
+        if (query) {
+            query++;
+            if (queryArg (query, "since", arg, sizeof(arg)) == 0)
+                since = atof (arg);
+            if (queryArg (query, "max_points", arg, sizeof(arg)) == 0)
+                max_points = atoi (arg);
+            if (queryArg (query, "fmt", arg, sizeof(arg)) == 0)
+                binary = strcmp (arg, "bin") == 0;
+        }
+        if (max_points < MIN_MAX_POINTS)
+            max_points = MIN_MAX_POINTS;
+        if (max_points > G5500_HISTORY_LEN)
+            max_points = G5500_HISTORY_LEN;
+
+        // get the raw points and reduce if necessary
+        G5500HistPoint *raw = (G5500HistPoint *) malloc (G5500_HISTORY_LEN * sizeof(G5500HistPoint));
+        G5500HistPoint *pts = (G5500HistPoint *) malloc (max_points * sizeof(G5500HistPoint));
+        if (!raw || !pts) {
+            if (is_http)
+                startHTTP (fp, "text/plain; charset=us-ascii");
+            fprintf (fp, "err: no memory\n");
+            free (raw);
+            free (pts);
+            return;
+        }
+        int n_raw = g5500_direct_get_history (since, raw, G5500_HISTORY_LEN);
+        double last = n_raw > 0 ? raw[n_raw-1].t : since;
+        int n = downsampleLTTB (raw, n_raw, pts, max_points);
+
+        // send
+        if (binary) {
+            if (is_http)
+                startHTTP (fp, "application/octet-stream");
+            sendBinary (fp, pts, n, last);
+        } else {
+            if (is_http)
+                startHTTP (fp, "application/json");
+            sendJSON (fp, pts, n, last);
+        }
+
+        free (raw);
+        free (pts);
+}
+
+/* send the flight recorder as text
+ */
+void histTraceWebCommand (FILE *fp)
+{
+        G5500TraceRec *recs = (G5500TraceRec *) malloc (G5500_TRACE_LEN * sizeof(G5500TraceRec));
+        if (!recs) {
+            fprintf (fp, "err: no memory\n");
+            return;
+        }
+        G5500TraceCal cal;
+        int n = g5500_direct_get_trace (recs, G5500_TRACE_LEN, &cal);
+
+        fprintf (fp, "# G5500 flight recorder\n");
+        fprintf (fp, "# sim_mode %d cal_ok %d period_us %d\n", cal.sim_mode, cal.cal_ok, cal.period);
+        fprintf (fp, "# az adc %d %d span %g\n", cal.az_min, cal.az_max, cal.az_span);
+        fprintf (fp, "# el adc %d %d span %g\n", cal.el_min, cal.el_max, cal.el_span);
+        fprintf (fp, "# t t_relay az_adc el_adc relays: %d cw %d ccw %d up %d down\n",
+                        G5500_TRACE_CW, G5500_TRACE_CCW, G5500_TRACE_UP, G5500_TRACE_DOWN);
+        for (int i = 0; i < n; i++)
+            fprintf (fp, "%.6f %.6f %u %u %u\n", recs[i].t, recs[i].t_relay, recs[i].az, recs[i].el,
+                                recs[i].relays);
+
+        free (recs);
+}
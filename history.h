@@ -0,0 +1,9 @@
+#ifndef _HISTORY_H
+#define _HISTORY_H
+
+#include <stdio.h>
+
+extern void histWebCommand (FILE *fp, char *cmd, int is_http);
+extern void histTraceWebCommand (FILE *fp);
+
+#endif // _HISTORY_H
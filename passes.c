@@ -0,0 +1,478 @@
+/* predict every pass over the station of a whole catalog of satellites.
+ *
+ * The catalog is a file of NORAD two line elements, see satellite.c. Every satellite is propagated with
+ * satBatchLook() on a coarse grid of PASS_STEP secs, a block of SAT_BLOCK at a time, the blocks shared out
+ * among a thread per core. Each peak of el on that grid within PASS_NEAR degs of the mask is then refined to
+ * the time of max el by golden section search, and if the peak clears the mask the times it rises above and
+ * sets below the mask are found by bisection between the grid points either side, all to PASS_TIME_TOL secs.
+ * Looking at peaks rather than samples above the mask finds short low passes that fall between grid points.
+ *
+ * The passes are kept for the file, station and mask until the file changes, covering PASS_AHEAD secs beyond
+ * the window asked for so a planner asking again for the next day a little later is answered at once.
+ *
+ * Web command:
+ *
+ *    passes?file=path[&t=time][&hours=h][&mask=degs]
+ *
+ * The file must be a plain file in the schedule's track directory and may be named relative to it, see
+ * schedTrackPath(). t is as for the schedule, either ISO 8601 UTC or unix seconds, default now. hours defaults to 24 and the
+ * mask, the el at which a pass starts and ends, to 0. The reply is JSON listing every pass above the mask
+ * at any time within the window, in order of rising, with the actual times it rises and sets even if beyond
+ * the window.
+ *
+ * Predicting is refused when the control loop runs in the main thread, see -R in g5500_sa.c, because the
+ * ticks would stop while it ran.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "g5500_sa.h"
+#include "celestial.h"
+#include "schedule.h"
+#include "satellite.h"
+#include "passes.h"
+
+
+#define PASS_STEP               60              // coarse grid, secs
+#define PASS_NEAR               10              // grid peaks this far below the mask are refined, degs
+#define PASS_TIME_TOL           0.5             // refined times, secs
+#define PASS_MARGIN             (2*3600)        // search beyond the window for the ends of passes crossing it
+#define PASS_AHEAD              (6*3600)        // also predict this far beyond the window for the cache
+#define PASS_MAX_HOURS          (7*24)          // longest window, elements are no good much beyond
+#define PASS_MAX_THREADS        8               // most threads to search with
+
+
+// a search shared by the threads
+typedef struct {
+    const SatOrbit *orbits;                     // each satellite
+    SatBatch batch;                             // the same laid out for satBatchLook()
+    SatStation stn;                             // the station
+    double w0;                                  // unix time of the first grid point
+    int n_t;                                    // number of grid points
+    double t0, t1;                              // window whose passes are wanted
+    float mask;                                 // el of rising and setting, degs
+    pthread_mutex_t lock;                       // guards next
+    int next;                                   // first satellite of the next block to search
+} Search;
+
+// the passes found by one thread
+typedef struct {
+    Search *sp;
+    PassInfo *passes;                           // malloced
+    int n, n_max;
+    int err;                                    // set if ran out of memory
+} Finder;
+
+// the last prediction
+static struct {
+    char file[PATH_MAX];                        // catalog
+    time_t mtime;                               // its modification time and size when read
+    off_t size;
+    double lat, lng, elev;                      // station
+    float mask;
+    double t0, t1;                              // window covered
+    int n_sats, n_skipped;
+    PassInfo *passes;                           // malloced, in order of aos
+    int n_passes;
+} cache;
+
+
+/* return secs on a steady clock
+ */
+static double nowSecs (void)
+{
+        struct timespec ts;
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+        return (ts.tv_sec + ts.tv_nsec*1e-9);
+}
+
+/* return el of the satellite being followed by *tp at unix time t and its az at *azp if not NULL, degs.
+ * a satellite no longer in orbit is at el -90.
+ */
+static float elAt (SatTrack *tp, double t, float *azp)
+{
+        float az, el;
+        if (satTrackFunc (t, &az, &el, tp) < 0) {
+            az = 0;
+            el = -90;
+        }
+        if (azp)
+            *azp = az;
+        return (el);
+}
+
+/* return the time between below, when el is under mask, and above, when it is not, at which it crosses.
+ */
+static double crossing (SatTrack *tp, double below, double above, float mask)
+{
+        while (fabs (above - below) > PASS_TIME_TOL) {
+            double mid = (below + above)/2;
+            if (elAt (tp, mid, NULL) >= mask)
+                above = mid;
+            else
+                below = mid;
+        }
+        return (above);
+}
+
+/* return the time of max el between unix times a and b.
+ */
+static double peak (SatTrack *tp, double a, double b)
+{
+        const double r = (sqrt(5) - 1)/2;
+        double c = b - r*(b - a);
+        double d = a + r*(b - a);
+        float ec = elAt (tp, c, NULL);
+        float ed = elAt (tp, d, NULL);
+
+        while (b - a > PASS_TIME_TOL) {
+            if (ec > ed) {
+                b = d;
+                d = c;
+                ed = ec;
+                c = b - r*(b - a);
+                ec = elAt (tp, c, NULL);
+            } else {
+                a = c;
+                c = d;
+                ec = ed;
+                d = a + r*(b - a);
+                ed = elAt (tp, d, NULL);
+            }
+        }
+        return ((a + b)/2);
+}
+
+/* add *pp to the passes of *fp.
+ */
+static void addPass (Finder *fp, const PassInfo *pp)
+{
+        if (fp->n == fp->n_max) {
+            int n_max = fp->n_max ? 2*fp->n_max : 64;
+            PassInfo *more = (PassInfo *) realloc (fp->passes, n_max * sizeof(PassInfo));
+            if (!more) {
+                fp->err = 1;
+                return;
+            }
+            fp->passes = more;
+            fp->n_max = n_max;
+        }
+        fp->passes[fp->n++] = *pp;
+}
+
+/* add to *fp the passes of satellite *op within the window whose el at each grid point is el[].
+ */
+static void findPasses (Finder *fp, const SatOrbit *op, const float el[])
+{
+        const Search *sp = fp->sp;
+        float mask = sp->mask;
+        int n_t = sp->n_t;
+        double last_los = 0;
+
+        SatTrack track;
+        track.orbit = *op;
+        track.stn = sp->stn;
+
+        for (int k = 0; k < n_t; k++) {
+
+            // refine peaks of the grid near enough the mask
+            double tk = sp->w0 + k*PASS_STEP;
+            if (el[k] < mask - PASS_NEAR || (k > 0 && el[k-1] > el[k]) || (k < n_t-1 && el[k+1] >= el[k])
+                                || tk <= last_los)
+                continue;
+            PassInfo p;
+            p.tmax = peak (&track, k > 0 ? tk - PASS_STEP : tk, k < n_t-1 ? tk + PASS_STEP : tk);
+            p.max_el = elAt (&track, p.tmax, &p.max_az);
+            if (p.max_el < mask)
+                continue;
+
+            // rises between the last grid point below the mask before the peak and the next
+            int a = k;
+            while (a >= 0 && (sp->w0 + a*PASS_STEP > p.tmax || el[a] >= mask))
+                a--;
+            if (a < 0)
+                p.aos = sp->w0;
+            else
+                p.aos = crossing (&track, sp->w0 + a*PASS_STEP, fmin (sp->w0 + (a+1)*PASS_STEP, p.tmax), mask);
+            elAt (&track, p.aos, &p.aos_az);
+
+            // sets between the first grid point below the mask after the peak and the one before
+            int b = k;
+            while (b < n_t && (sp->w0 + b*PASS_STEP < p.tmax || el[b] >= mask))
+                b++;
+            if (b == n_t)
+                p.los = sp->w0 + (n_t-1)*PASS_STEP;
+            else
+                p.los = crossing (&track, sp->w0 + b*PASS_STEP, fmax (sp->w0 + (b-1)*PASS_STEP, p.tmax), mask);
+            elAt (&track, p.los, &p.los_az);
+            last_los = p.los;
+
+            if (p.los > sp->t0 && p.aos < sp->t1) {
+                snprintf (p.name, sizeof(p.name), "%s", op->name);
+                p.catnum = op->catnum;
+                addPass (fp, &p);
+            }
+        }
+}
+
+/* thread that takes blocks of satellites from the Search of the Finder at arg until there are none left,
+ * propagating each block along the grid together then finding the passes of each.
+ */
+static void *searchThread (void *arg)
+{
+        Finder *fp = (Finder *) arg;
+        Search *sp = fp->sp;
+        float *el = (float *) malloc (SAT_BLOCK * sp->n_t * sizeof(float));
+        float az_k[SAT_BLOCK], el_k[SAT_BLOCK];
+
+        if (!el) {
+            fp->err = 1;
+            return (NULL);
+        }
+
+        while (!fp->err) {
+            pthread_mutex_lock (&sp->lock);
+            int i0 = sp->next;
+            sp->next += SAT_BLOCK;
+            pthread_mutex_unlock (&sp->lock);
+            if (i0 >= sp->batch.n)
+                break;
+            int n = sp->batch.n - i0 < SAT_BLOCK ? sp->batch.n - i0 : SAT_BLOCK;
+
+            for (int k = 0; k < sp->n_t; k++) {
+                satBatchLook (&sp->batch, &sp->stn, i0, n, sp->w0 + k*PASS_STEP, az_k, el_k);
+                for (int j = 0; j < n; j++)
+                    el[j*sp->n_t + k] = el_k[j];
+            }
+            for (int j = 0; j < n; j++)
+                findPasses (fp, &sp->orbits[i0+j], &el[j*sp->n_t]);
+        }
+
+        free (el);
+        return (NULL);
+}
+
+/* qsort comparison of PassInfo by aos then catalog number
+ */
+static int aosCmp (const void *p1, const void *p2)
+{
+        const PassInfo *a = (const PassInfo *) p1;
+        const PassInfo *b = (const PassInfo *) p2;
+        if (a->aos != b->aos)
+            return (a->aos < b->aos ? -1 : 1);
+        return (a->catnum - b->catnum);
+}
+
+/* predict the passes above mask degs from t0 to t1 of every satellite in file into the cache.
+ * return 0 if ok else -1 with brief excuse in ynot[]
+ */
+static int predict (const char *file, double t0, double t1, float mask, PassStats *stp, char ynot[])
+{
+        Search s;
+        SatOrbit *orbits;
+        int n_sats, n_skipped;
+
+        memset (&s, 0, sizeof(s));
+        if (satStationInit (&s.stn, ynot) < 0)
+            return (-1);
+        if (satReadCatalog (file, &orbits, &n_sats, &n_skipped, ynot) < 0)
+            return (-1);
+        if (satBatchInit (&s.batch, orbits, n_sats, ynot) < 0) {
+            free (orbits);
+            return (-1);
+        }
+        s.orbits = orbits;
+        s.w0 = t0 - PASS_MARGIN;
+        s.n_t = (int) ceil ((t1 - t0 + 2*PASS_MARGIN)/PASS_STEP) + 1;
+        s.t0 = t0;
+        s.t1 = t1;
+        s.mask = mask;
+        pthread_mutex_init (&s.lock, NULL);
+
+        // a thread per core, this one among them
+        int n_blocks = (n_sats + SAT_BLOCK - 1)/SAT_BLOCK;
+        int n_threads = (int) sysconf (_SC_NPROCESSORS_ONLN);
+        if (n_threads > PASS_MAX_THREADS)
+            n_threads = PASS_MAX_THREADS;
+        if (n_threads > n_blocks)
+            n_threads = n_blocks;
+        if (n_threads < 1)
+            n_threads = 1;
+        Finder finders[PASS_MAX_THREADS];
+        pthread_t tids[PASS_MAX_THREADS];
+        memset (finders, 0, sizeof(finders));
+        int n_started = 1;
+        for (int i = 0; i < n_threads; i++)
+            finders[i].sp = &s;
+        while (n_started < n_threads && pthread_create (&tids[n_started], NULL, searchThread,
+                                &finders[n_started]) == 0)
+            n_started++;
+        searchThread (&finders[0]);
+        for (int i = 1; i < n_started; i++)
+            pthread_join (tids[i], NULL);
+
+        // gather them in order
+        int n_passes = 0, err = 0;
+        for (int i = 0; i < n_started; i++) {
+            n_passes += finders[i].n;
+            err |= finders[i].err;
+        }
+        PassInfo *passes = err ? NULL : (PassInfo *) malloc ((n_passes > 0 ? n_passes : 1) * sizeof(PassInfo));
+        if (passes) {
+            n_passes = 0;
+            for (int i = 0; i < n_started; i++) {
+                memcpy (passes + n_passes, finders[i].passes, finders[i].n * sizeof(PassInfo));
+                n_passes += finders[i].n;
+            }
+            qsort (passes, n_passes, sizeof(PassInfo), aosCmp);
+        }
+        for (int i = 0; i < n_started; i++)
+            free (finders[i].passes);
+        pthread_mutex_destroy (&s.lock);
+        satBatchFree (&s.batch);
+        free (orbits);
+        if (!passes) {
+            sprintf (ynot, "no memory for passes");
+            return (-1);
+        }
+
+        free (cache.passes);
+        cache.passes = passes;
+        cache.n_passes = n_passes;
+        cache.t0 = t0;
+        cache.t1 = t1;
+        cache.mask = mask;
+        cache.n_sats = n_sats;
+        cache.n_skipped = n_skipped;
+        stp->n_threads = n_started;
+        return (0);
+}
+
+/* find the passes above mask degs from unix time t0 to t1 of every satellite in file, from the cache if it
+ * covers them and nothing they depend on has changed.
+ * return 0 if ok with a malloced array of passes at *psp in order of aos, *np of them, and stats at *stp,
+ * else -1 with brief excuse in ynot[]
+ */
+int passPredict (const char *file, double t0, double t1, float mask, PassInfo **psp, int *np, PassStats *stp,
+char ynot[])
+{
+        double wall0 = nowSecs();
+        memset (stp, 0, sizeof(*stp));
+
+        if (t1 <= t0 || t1 - t0 > PASS_MAX_HOURS*3600.0 || mask < 0 || mask >= 90) {
+            sprintf (ynot, "window must be up to %d hours and mask 0 .. 90 degs", PASS_MAX_HOURS);
+            return (-1);
+        }
+        if (g5500_direct_reactor_fd() >= 0) {
+            sprintf (ynot, "not available while the control loop runs in the main thread (-R)");
+            return (-1);
+        }
+
+        // only a plain file in the track directory, a device or fifo would stall the main loop
+        char path[PATH_MAX];
+        if (schedTrackPath (file, path, sizeof(path), ynot) < 0)
+            return (-1);
+        file = path;
+        struct stat st;
+        if (stat (file, &st) < 0) {
+            sprintf (ynot, "%s: %s", file, strerror(errno));
+            return (-1);
+        }
+        double lat, lng, elev;
+        if (celStation (&lat, &lng, &elev) < 0) {
+            sprintf (ynot, "station location is not set");
+            return (-1);
+        }
+
+        if (cache.passes && strcmp (cache.file, file) == 0 && cache.mtime == st.st_mtime
+                        && cache.size == st.st_size && cache.lat == lat && cache.lng == lng && cache.elev == elev
+                        && cache.mask == mask && cache.t0 <= t0 && t1 <= cache.t1) {
+            stp->cached = 1;
+        } else {
+            cache.file[0] = '\0';
+            if (predict (file, t0, t1 + PASS_AHEAD, mask, stp, ynot) < 0)
+                return (-1);
+            snprintf (cache.file, sizeof(cache.file), "%s", file);
+            cache.mtime = st.st_mtime;
+            cache.size = st.st_size;
+            cache.lat = lat;
+            cache.lng = lng;
+            cache.elev = elev;
+        }
+
+        PassInfo *passes = (PassInfo *) malloc ((cache.n_passes > 0 ? cache.n_passes : 1) * sizeof(PassInfo));
+        if (!passes) {
+            sprintf (ynot, "no memory for passes");
+            return (-1);
+        }
+        int n = 0;
+        for (int i = 0; i < cache.n_passes; i++)
+            if (cache.passes[i].los > t0 && cache.passes[i].aos < t1)
+                passes[n++] = cache.passes[i];
+
+        *psp = passes;
+        *np = n;
+        stp->n_sats = cache.n_sats;
+        stp->n_skipped = cache.n_skipped;
+        stp->wall = nowSecs() - wall0;
+        return (0);
+}
+
+/* perform the passes web command, cmd is the full command including any query.
+ */
+void passWebCommand (FILE *fp, char *cmd)
+{
+        char *query = strchr (cmd, '?');
+        char file[200], val[40], ynot[300];
+        double t0 = time (NULL), hours = 24;
+        float mask = 0;
+
+        if (query)
+            *query++ = '\0';
+
+        if (queryArg (query, "file", file, sizeof(file)) < 0) {
+            fprintf (fp, "{\"err\":\"passes requires file\"}\n");
+            return;
+        }
+        if (queryArg (query, "t", val, sizeof(val)) == 0 && schedParseTime (val, &t0) < 0) {
+            fprintf (fp, "{\"err\":\"bad time\"}\n");
+            return;
+        }
+        if (queryArg (query, "hours", val, sizeof(val)) == 0)
+            hours = atof (val);
+        if (queryArg (query, "mask", val, sizeof(val)) == 0)
+            mask = atof (val);
+
+        PassInfo *passes;
+        PassStats st;
+        int n;
+        if (passPredict (file, t0, t0 + hours*3600, mask, &passes, &n, &st, ynot) < 0) {
+            fprintf (fp, "{\"err\":");
+            putJSONString (fp, ynot);
+            fprintf (fp, "}\n");
+            return;
+        }
+
+        fprintf (fp, "{\"t\":%.0f,\"hours\":%g,\"mask\":%g,\"satellites\":%d,\"skipped\":%d,\"cached\":%d,"
+                     "\"threads\":%d,\"wall\":%.3f,\"passes\":[", t0, hours, mask, st.n_sats, st.n_skipped,
+                                st.cached, st.n_threads, st.wall);
+        for (int i = 0; i < n; i++) {
+            PassInfo *pp = &passes[i];
+            fprintf (fp, "%s\n{\"name\":", i > 0 ? "," : "");
+            putJSONString (fp, pp->name);
+            fprintf (fp, ",\"catnum\":%d,\"aos\":%.0f,\"aos_az\":%.1f,\"tmax\":%.0f,\"max_az\":%.1f,"
+                         "\"max_el\":%.1f,\"los\":%.0f,\"los_az\":%.1f}", pp->catnum, pp->aos, pp->aos_az,
+                                pp->tmax, pp->max_az, pp->max_el, pp->los, pp->los_az);
+        }
+        fprintf (fp, "]}\n");
+        free (passes);
+}
@@ -0,0 +1,28 @@
+#ifndef _PASSES_H
+#define _PASSES_H
+
+#include <stdio.h>
+
+// one pass of a satellite over the station
+typedef struct {
+    char name[25];                      // satellite name
+    int catnum;                         // NORAD catalog number
+    double aos, tmax, los;              // unix times of rising above the mask, max el and setting below it
+    float aos_az, max_az, los_az;       // az at each, degs
+    float max_el;                       // peak el, degs
+} PassInfo;
+
+// how a prediction went
+typedef struct {
+    int n_sats;                         // satellites searched
+    int n_skipped;                      // element sets that were bad or deep space
+    int n_threads;                      // threads that searched them
+    int cached;                         // set if the passes came from the cache
+    double wall;                        // secs to predict
+} PassStats;
+
+extern int passPredict (const char *file, double t0, double t1, float mask, PassInfo **psp, int *np,
+        PassStats *sp, char ynot[]);
+extern void passWebCommand (FILE *fp, char *cmd);
+
+#endif // _PASSES_H
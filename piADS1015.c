@@ -5,8 +5,10 @@
  *
  * #define _UNIT_TEST_MAIN to make a stand-alone test program, build and run as follows:
  *
- *   gcc -Wall -O2 -D_UNIT_TEST_MAIN piADS1015.c piI2C.c -o piADS1015
+ *   gcc -Wall -O2 -D_UNIT_TEST_MAIN piADS1015.c piI2C.c -o piADS1015 -lm -lpthread
  *   ./piADS1015 0x48 1     # I2C device address, ADC channel number 0 .. 3
+ *   ./piADS1015 -b 0x48    # benchmark all channels over a sweep of acquisition settings, -h for options
+ *   ./piADS1015 -b -m 0x48 # same, but against a simulated ADS1115
  *
  *   if this reports a permission error, try adding user pi to the i2c group:
  *      sudo usermod -a -G i2c pi
@@ -34,9 +36,19 @@
 */
 
 
+
 #include <stdint.h>
 #include <string.h>
 
+#include "piADS1015.h"
+
+
+// samples per second for each data rate code
+const int ADC_rates[8] = {8, 16, 32, 64, 128, 250, 475, 860};
+
+// full scale volts for each gain code
+const float ADC_fullscale[6] = {6.144F, 4.096F, 2.048F, 1.024F, 0.512F, 0.256F};
+
 
 // create an empty file if this does not appear to be on a Pi
 #include "isapi.h"
@@ -51,8 +63,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <time.h>
 
-#include "piADS1015.h"
 #include "piI2C.h"
 
 
@@ -62,11 +74,10 @@
 #define ADS1015_REG_CONFIG_CLAT_NONLAT  (0x0000)  // Non-latching comparator (default)
 #define ADS1015_REG_CONFIG_CPOL_ACTVLOW (0x0000)  // ALERT/RDY pin is low when active (default)
 #define ADS1015_REG_CONFIG_CMODE_TRAD   (0x0000)  // Traditional comparator with hysteresis (default)
-#define ADS1115_REG_CONFIG_DR_860SPS    (0x00E0)  // 860 samples per second (ADS1115 max)
+#define ADS1115_REG_CONFIG_DR_SHIFT     (5)       // Data rate code 0 .. 7 goes here
 #define ADS1015_REG_CONFIG_MODE_SINGLE  (0x0100)  // Power-down single-shot mode (default)
-#define ADS1015_REG_CONFIG_PGA_4_096V   (0x0200)  // +/-4.096V range = Gain 1
-#define ADS1015_REG_CONFIG_PGA_2_048V   (0x0400)  // +/-2.048V range = Gain 2 (default)
-#define ADS1015_REG_CONFIG_PGA_6_144V   (0x0000)  // +/-6.144V range = Gain 2/3
+#define ADS1015_REG_CONFIG_MODE_CONTIN  (0x0000)  // Continuous conversion mode
+#define ADS1015_REG_CONFIG_PGA_SHIFT    (9)       // Gain code 0 .. 5 goes here
 
 
 
@@ -76,102 +87,552 @@
 #define ADS1015_REG_CONFIG_MUX_SINGLE_3 (0x7000)  // Single-ended AIN3
 
 #define ADS1015_REG_CONFIG_OS_SINGLE    (0x8000)  // Write: Set to start a single-conversion
+#define ADS1015_REG_CONFIG_OS_IDLE      (0x8000)  // Read: Set when not converting
 #define ADS1015_REG_POINTER_CONFIG      (0x01)
 #define ADS1015_REG_POINTER_CONVERT     (0x00)
 
-#define ADS1015_CONVERSIONDELAY         (2)       // ms (min 1.2ms for 860SPS)
+#define ADS1015_CONVERSIONDELAY         (ADC_SINGLE_ENDED_US/1000)      // ms (min 1.2ms for 860SPS)
+#define ADS1015_RATE_TOLERANCE          (10)      // % the data rate may be slower than nominal
+#define ADS1015_POLL_TIMEOUT            (10)      // ms beyond twice the conversion time to give up polling
 
 
-/* read the given ADC channel in single-ended mode.
- * we use piI2C and assume piI2CInit() has already been called.
- * return 0 if ok, else return -1 with brief excuse in ynot[]
+// I2C access
+static ADCRead16Func adc_read16 = piI2CRead16;
+static ADCWrite16Func adc_write16 = piI2CWrite16;
+
+// config last written to start continuous conversions, else 0
+static uint16_t contin_config;
+static uint8_t contin_addr;
+static struct timespec contin_read;     // time of last continuous read
+static uint16_t contin_raw;             // value of last continuous read
+
+
+/* use the given functions for all I2C access, or restore piI2C if either is NULL.
+ * intended for testing with a simulated device.
  */
-int readADC_SingleEnded (uint8_t i2c_addr, uint16_t channel, uint16_t *data, char ynot[])
+void setADC_I2C (ADCRead16Func read16, ADCWrite16Func write16)
+{
+    if (read16 && write16) {
+        adc_read16 = read16;
+        adc_write16 = write16;
+    } else {
+        adc_read16 = piI2CRead16;
+        adc_write16 = piI2CWrite16;
+    }
+    contin_config = 0;
+}
+
+/* return microseconds since *tp
+ */
+static long usSince (const struct timespec *tp)
 {
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return ((now.tv_sec - tp->tv_sec)*1000000L + (now.tv_nsec - tp->tv_nsec)/1000);
+}
 
-     // Start with default values
-    uint16_t config = ADS1015_REG_CONFIG_CQUE_NONE    | // Disable the comparator (default val)
-                      ADS1015_REG_CONFIG_CLAT_NONLAT  | // Non-latching (default val)
-                      ADS1015_REG_CONFIG_CPOL_ACTVLOW | // Alert/Rdy active low   (default val)
-                      ADS1015_REG_CONFIG_CMODE_TRAD   | // Traditional comparator (default val)
-                      ADS1115_REG_CONFIG_DR_860SPS    | // 860 samples per second
-                      ADS1015_REG_CONFIG_MODE_SINGLE;   // Single-shot mode (default)
-  
-    // Set gain
-    config |= ADS1015_REG_CONFIG_PGA_4_096V;
-  
-    // Set 'start single-conversion' bit
-    config |= ADS1015_REG_CONFIG_OS_SINGLE;
-  
-    // Set single-ended input channel
-    switch (channel)
-    {
-    case (0):
-        config |= ADS1015_REG_CONFIG_MUX_SINGLE_0;
-        break;
-    case (1):
-        config |= ADS1015_REG_CONFIG_MUX_SINGLE_1;
-        break;
-    case (2):
-        config |= ADS1015_REG_CONFIG_MUX_SINGLE_2;
-        break;
-    case (3):
-        config |= ADS1015_REG_CONFIG_MUX_SINGLE_3;
-        break;
-    default:
+/* return the config register value to convert the given channel, 0 .. 3, with the given settings, less the
+ * mode bits.
+ */
+static uint16_t configWord (uint16_t channel, const ADCSettings *sp)
+{
+    static const uint16_t mux[4] = {
+        ADS1015_REG_CONFIG_MUX_SINGLE_0, ADS1015_REG_CONFIG_MUX_SINGLE_1,
+        ADS1015_REG_CONFIG_MUX_SINGLE_2, ADS1015_REG_CONFIG_MUX_SINGLE_3,
+    };
+
+    return (ADS1015_REG_CONFIG_CQUE_NONE    | // Disable the comparator (default val)
+            ADS1015_REG_CONFIG_CLAT_NONLAT  | // Non-latching (default val)
+            ADS1015_REG_CONFIG_CPOL_ACTVLOW | // Alert/Rdy active low   (default val)
+            ADS1015_REG_CONFIG_CMODE_TRAD   | // Traditional comparator (default val)
+            (sp->rate << ADS1115_REG_CONFIG_DR_SHIFT) |
+            (sp->pga << ADS1015_REG_CONFIG_PGA_SHIFT) |
+            mux[channel]);
+}
+
+/* read the given ADC channel in single-ended mode with the given settings.
+ * we use piI2C, or as set by setADC_I2C(), and assume piI2CInit() has already been called.
+ * in continuous mode the device is reconfigured only when the address or any setting changes.
+ * return 0 if ok with the raw signed conversion in *data, else return -1 with brief excuse in ynot[]
+ */
+int readADC_Config (uint8_t i2c_addr, uint16_t channel, const ADCSettings *sp, int16_t *data, char ynot[])
+{
+    if (channel > 3) {
         sprintf (ynot, "bogus ADC channel %d, must be 0..3", channel);
         return (-1);
     }
-  
-    // Write config register to the ADC
-    if (piI2CWrite16 (i2c_addr, ADS1015_REG_POINTER_CONFIG, config, ynot) < 0)
+    if (sp->rate > 7 || sp->pga > 5 || sp->wait > ADC_WAIT_POLL) {
+        sprintf (ynot, "bogus ADC settings: rate %d gain %d wait %d", sp->rate, sp->pga, sp->wait);
         return (-1);
-  
-    // Wait for the conversion to complete (not worth polling)
-    usleep(1000*ADS1015_CONVERSIONDELAY);
-  
+    }
+
+    uint16_t config = configWord (channel, sp);
+
+    // longest a conversion may take, us, and the fixed wait which must be no shorter
+    long conv_us = 1000000L/ADC_rates[sp->rate];
+    long wait_us = conv_us * (100 + ADS1015_RATE_TOLERANCE) / 100;
+    long fixed_us = wait_us > 1000*ADS1015_CONVERSIONDELAY ? wait_us : 1000*ADS1015_CONVERSIONDELAY;
+
+    if (sp->continuous) {
+
+        config |= ADS1015_REG_CONFIG_MODE_CONTIN;
+
+        if (config != contin_config || i2c_addr != contin_addr) {
+            // (re)start then wait for the first conversion with these settings
+            contin_config = 0;
+            if ((*adc_write16) (i2c_addr, ADS1015_REG_POINTER_CONFIG, config, ynot) < 0)
+                return (-1);
+            contin_config = config;
+            contin_addr = i2c_addr;
+            usleep (wait_us);
+        } else {
+            switch (sp->wait) {
+            case ADC_WAIT_FIXED:
+                usleep (fixed_us);
+                break;
+            case ADC_WAIT_NOMINAL: {
+                // just long enough for a fresh conversion since the previous read
+                long dt = wait_us - usSince (&contin_read);
+                if (dt > 0)
+                    usleep (dt);
+                }
+                break;
+            case ADC_WAIT_POLL: {
+                // there is no ready bit in continuous mode, but the value only changes with a new conversion
+                // and there must have been one once the conversion time has passed since the previous read
+                uint16_t raw;
+                do {
+                    if ((*adc_read16) (i2c_addr, ADS1015_REG_POINTER_CONVERT, &raw, ynot) < 0)
+                        return (-1);
+                } while (raw == contin_raw && usSince (&contin_read) < wait_us);
+                clock_gettime (CLOCK_MONOTONIC, &contin_read);
+                contin_raw = raw;
+                *data = (int16_t) raw;
+                return (0);
+                }
+            }
+        }
+
+    } else {
+
+        config |= ADS1015_REG_CONFIG_MODE_SINGLE;
+
+        // Set 'start single-conversion' bit
+        config |= ADS1015_REG_CONFIG_OS_SINGLE;
+
+        // Write config register to the ADC, which also ends any continuous conversions
+        contin_config = 0;
+        if ((*adc_write16) (i2c_addr, ADS1015_REG_POINTER_CONFIG, config, ynot) < 0)
+            return (-1);
+
+        switch (sp->wait) {
+        case ADC_WAIT_FIXED:
+            // Wait for the conversion to complete (not worth polling)
+            usleep (fixed_us);
+            break;
+        case ADC_WAIT_NOMINAL:
+            usleep (wait_us);
+            break;
+        case ADC_WAIT_POLL: {
+            struct timespec t0;
+            clock_gettime (CLOCK_MONOTONIC, &t0);
+            uint16_t status = 0;
+            while (!(status & ADS1015_REG_CONFIG_OS_IDLE)) {
+                if (usSince (&t0) > 2*wait_us + 1000*ADS1015_POLL_TIMEOUT) {
+                    sprintf (ynot, "ADC 0x%02x channel %d conversion did not complete", i2c_addr, channel);
+                    return (-1);
+                }
+                if ((*adc_read16) (i2c_addr, ADS1015_REG_POINTER_CONFIG, &status, ynot) < 0)
+                    return (-1);
+            }
+            }
+            break;
+        }
+    }
+
     // Read the conversion results
-    if (piI2CRead16 (i2c_addr, ADS1015_REG_POINTER_CONVERT, data, ynot) < 0)
+    uint16_t raw;
+    if ((*adc_read16) (i2c_addr, ADS1015_REG_POINTER_CONVERT, &raw, ynot) < 0)
         return (-1);
-  
-    // ADS1115 is 16-bit, shift down to 12-bit to match ADS1015 scale
-    *data = *data & 0xFFF0;
+    if (sp->continuous) {
+        clock_gettime (CLOCK_MONOTONIC, &contin_read);
+        contin_raw = raw;
+    }
+    *data = (int16_t) raw;
+
+    // ok
+    return (0);
+}
+
+/* start a single-shot conversion of the given ADC channel as used by the rotator, to be collected with
+ * finishADC_SingleEnded() at least ADC_SINGLE_ENDED_US later, so the caller need not wait meanwhile.
+ * we use piI2C and assume piI2CInit() has already been called.
+ * return 0 if ok, else return -1 with brief excuse in ynot[]
+ */
+int startADC_SingleEnded (uint8_t i2c_addr, uint16_t channel, char ynot[])
+{
+    // 860 samples per second, +/-4.096V range, single-shot
+    static const ADCSettings settings = {7, 1, 0, ADC_WAIT_FIXED};
+
+    if (channel > 3) {
+        sprintf (ynot, "bogus ADC channel %d, must be 0..3", channel);
+        return (-1);
+    }
+
+    // Write config register to the ADC, which also ends any continuous conversions
+    contin_config = 0;
+    uint16_t config = configWord (channel, &settings) | ADS1015_REG_CONFIG_MODE_SINGLE
+                                | ADS1015_REG_CONFIG_OS_SINGLE;
+    return ((*adc_write16) (i2c_addr, ADS1015_REG_POINTER_CONFIG, config, ynot));
+}
+
+/* collect the conversion begun by startADC_SingleEnded().
+ * return 0 if ok, else return -1 with brief excuse in ynot[]
+ */
+int finishADC_SingleEnded (uint8_t i2c_addr, uint16_t *data, char ynot[])
+{
+    uint16_t u;
+    if ((*adc_read16) (i2c_addr, ADS1015_REG_POINTER_CONVERT, &u, ynot) < 0)
+        return (-1);
+    int16_t raw = (int16_t) u;
+
     // value is actually signed, so it can be slightly negative when near ground potential
-    if (*data > 0x7FFF)
-        *data = 0;
+    if (raw < 0)
+        raw = 0;
+
+    // ADS1115 is 16-bit, shift down to 12-bit to match ADS1015 scale
+    *data = raw & 0xFFF0;
 
     // ok
     return (0);
 }
 
+/* read the given ADC channel in single-ended mode as used by the rotator.
+ * we use piI2C and assume piI2CInit() has already been called.
+ * return 0 if ok, else return -1 with brief excuse in ynot[]
+ */
+int readADC_SingleEnded (uint8_t i2c_addr, uint16_t channel, uint16_t *data, char ynot[])
+{
+    if (startADC_SingleEnded (i2c_addr, channel, ynot) < 0)
+        return (-1);
+
+    // Wait for the conversion to complete (not worth polling)
+    usleep (ADC_SINGLE_ENDED_US);
+
+    return (finishADC_SingleEnded (i2c_addr, data, ynot));
+}
+
 #if defined(_UNIT_TEST_MAIN)
 
 #include <stdio.h>
+#include <math.h>
+
+/* the test program either reads one value or benchmarks every combination of the given settings.
+ *
+ * The benchmark reports for each channel and combination of data rate, gain, single-shot or continuous mode
+ * and wait strategy the reads per second achieved, the latency of each read, the noise of the values read
+ * and the fraction of reads that failed. With -m it talks to a simulated ADS1115 instead of the I2C bus.
+ * The simulation is only as good as its models of bus time, conversion time and noise, so use it to check
+ * the tool, not to choose production settings.
+ */
+
+#define MOCK_BUS_US     90              // us per byte on a 100 kHz bus, 9 clocks each
+#define MOCK_RATE_SLOW  1.04            // simulated oscillator is this much slower than nominal
+#define MOCK_NOISE      2e-6            // simulated rms noise is this many volts times sqrt(SPS)
+
+static char *me;
+
+// simulated ADS1115 registers and conversion state
+static struct {
+    uint16_t config;                    // config register as last written
+    uint16_t convert;                   // conversion register
+    struct timespec t0;                 // time of last config write
+    long n_done;                        // conversions since then
+    double err_rate;                    // fraction of I2C transfers to fail
+} mock;
+static const float mock_volts[4] = {0.25F, 1.2F, 2.5F, 3.3F};
+
+/* simulate the bus time of an I2C transfer of n bytes, including the address, and maybe fail.
+ * return 0 if ok else -1 with excuse in ynot[]
+ */
+static int mockBus (int n, char ynot[])
+{
+    usleep (n*MOCK_BUS_US);
+    if (drand48() < mock.err_rate) {
+        strcpy (ynot, "simulated I2C error");
+        return (-1);
+    }
+    return (0);
+}
+
+/* return a normally distributed random number with mean 0 and std dev 1
+ */
+static double gaussian (void)
+{
+    double u = 1 - drand48();
+    return (sqrt(-2*log(u)) * cos(2*M_PI*drand48()));
+}
+
+/* bring the simulated conversions up to date
+ */
+static void mockUpdate (void)
+{
+    int single = (mock.config & ADS1015_REG_CONFIG_MODE_SINGLE) != 0;
+    int rate = ADC_rates[(mock.config >> ADS1115_REG_CONFIG_DR_SHIFT) & 7];
+    double fs = ADC_fullscale[(mock.config >> ADS1015_REG_CONFIG_PGA_SHIFT) & 7];
+    int channel = (mock.config >> 12) & 3;
+
+    // conversions completed since the config was written
+    long n = (long) (usSince (&mock.t0) * 1e-6 * rate / MOCK_RATE_SLOW);
+    if (single && n > 1)
+        n = 1;
+    if (n <= mock.n_done)
+        return;
+    mock.n_done = n;
+
+    double v = mock_volts[channel] + MOCK_NOISE*sqrt(rate)*gaussian();
+    double counts = floor (32768*v/fs + 0.5);
+    if (counts > 32767)
+        counts = 32767;
+    if (counts < -32768)
+        counts = -32768;
+    mock.convert = (uint16_t) (int16_t) counts;
+}
+
+static int mockRead16 (uint8_t bus_addr, uint8_t dev_reg, uint16_t *data, char ynot[])
+{
+    (void) bus_addr;
+
+    // write the register pointer then read two bytes
+    if (mockBus (5, ynot) < 0)
+        return (-1);
+
+    mockUpdate();
+    if (dev_reg == ADS1015_REG_POINTER_CONVERT) {
+        *data = mock.convert;
+    } else {
+        // OS bit reads as set when idle, which in continuous mode is never
+        int idle = (mock.config & ADS1015_REG_CONFIG_MODE_SINGLE) && mock.n_done > 0;
+        *data = (mock.config & ~ADS1015_REG_CONFIG_OS_IDLE) | (idle ? ADS1015_REG_CONFIG_OS_IDLE : 0);
+    }
+    return (0);
+}
+
+static int mockWrite16 (uint8_t bus_addr, uint8_t dev_reg, uint16_t data, char ynot[])
+{
+    (void) bus_addr;
+
+    if (mockBus (4, ynot) < 0)
+        return (-1);
+
+    if (dev_reg == ADS1015_REG_POINTER_CONFIG) {
+        mock.config = data;
+        mock.n_done = 0;
+        clock_gettime (CLOCK_MONOTONIC, &mock.t0);
+    }
+    return (0);
+}
+
+static int cmpDouble (const void *p1, const void *p2)
+{
+    double d1 = *(const double *)p1;
+    double d2 = *(const double *)p2;
+    return (d1 < d2 ? -1 : d1 > d2 ? 1 : 0);
+}
+
+/* parse a comma separated list of values, each of which must be one of table[n_table].
+ * set the bit in *maskp for the index of each.
+ * return 0 if ok else -1
+ */
+static int parseList (const char *list, const double table[], int n_table, unsigned *maskp)
+{
+    *maskp = 0;
+    for (const char *lp = list; *lp; ) {
+        char *end;
+        double v = strtod (lp, &end);
+        int i;
+        for (i = 0; i < n_table; i++)
+            if (fabs (v - table[i]) < 1e-3)
+                break;
+        if (end == lp || i == n_table)
+            return (-1);
+        *maskp |= 1U << i;
+        lp = *end == ',' ? end+1 : end;
+    }
+    return (*maskp ? 0 : -1);
+}
+
+/* benchmark one channel with the given settings for up to n_reads or max_secs.
+ * lat[] and val[] must have room for n_reads.
+ */
+static void benchOne (uint8_t addr, uint16_t channel, const ADCSettings *sp, int n_reads, double max_secs,
+double lat[], double val[])
+{
+    static const char *wait_names[] = {"fixed", "nominal", "poll"};
+    char ynot[1024];
+    struct timespec t0, t1;
+    int n_ok = 0, n_err = 0;
+
+    // start clean so continuous mode includes its start up
+    int16_t raw;
+    ADCSettings idle = *sp;
+    idle.continuous = 0;
+    (void) readADC_Config (addr, channel, &idle, &raw, ynot);
+
+    clock_gettime (CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < n_reads && usSince(&t0) < max_secs*1e6; i++) {
+        clock_gettime (CLOCK_MONOTONIC, &t1);
+        if (readADC_Config (addr, channel, sp, &raw, ynot) < 0) {
+            n_err++;
+        } else {
+            lat[n_ok] = usSince (&t1) * 1e-3;
+            val[n_ok] = raw;
+            n_ok++;
+        }
+    }
+    double secs = usSince (&t0) * 1e-6;
+
+    printf ("%2d %4d %5.3f %-6s %-7s ", channel, ADC_rates[sp->rate], ADC_fullscale[sp->pga],
+                sp->continuous ? "contin" : "single", wait_names[sp->wait]);
+    if (n_ok < 2) {
+        printf ("%8.1f   no reads, %d errors, last: %s\n", (n_ok+n_err)/secs, n_err, ynot);
+        return;
+    }
+
+    double sum = 0, sum2 = 0, min = val[0], max = val[0], lsum = 0;
+    for (int i = 0; i < n_ok; i++) {
+        sum += val[i];
+        sum2 += val[i]*val[i];
+        if (val[i] < min)
+            min = val[i];
+        if (val[i] > max)
+            max = val[i];
+        lsum += lat[i];
+    }
+    double mean = sum/n_ok;
+    double sd = sqrt ((sum2 - n_ok*mean*mean)/(n_ok-1) > 0 ? (sum2 - n_ok*mean*mean)/(n_ok-1) : 0);
+    double lsb_uv = 1e6*ADC_fullscale[sp->pga]/32768;
+    qsort (lat, n_ok, sizeof(double), cmpDouble);
+
+    printf ("%8.1f %7.3f %7.3f %7.3f %7.3f %8.1f %7.2f %5.0f %8.1f %6.2f\n",
+                n_ok/secs, lsum/n_ok, lat[n_ok/2], lat[(int)(n_ok*0.99)], lat[n_ok-1],
+                mean, sd, max-min, sd*lsb_uv, 100.0*n_err/(n_ok+n_err));
+}
+
+static void usage (void)
+{
+    fprintf (stderr, "Usage: %s ADC_I2C_addr ADC_channel\n", me);
+    fprintf (stderr, "   or: %s -b [options] ADC_I2C_addr [ADC_channel]\n", me);
+    fprintf (stderr, "Purpose: read one value, or benchmark each channel and combination of settings\n");
+    fprintf (stderr, "Options:\n");
+    fprintf (stderr, " -b       : benchmark, else read one value\n");
+    fprintf (stderr, " -e p     : with -m, fraction of I2C transfers to fail; default 0\n");
+    fprintf (stderr, " -g list  : full scale volts to test, any of 6.144,4.096,2.048,1.024,0.512,0.256; default 4.096\n");
+    fprintf (stderr, " -m       : use a simulated ADS1115 rather than the I2C bus\n");
+    fprintf (stderr, " -n reads : max reads per combination; default 500\n");
+    fprintf (stderr, " -r list  : SPS to test, any of 8,16,32,64,128,250,475,860; default 128,250,475,860\n");
+    fprintf (stderr, " -t secs  : max seconds per combination; default 0.5\n");
+    exit(1);
+}
 
 int main (int ac, char *av[])
 {
-    if (ac != 3) {
-        fprintf (stderr, "Usage: %s ADC_I2C_addr ADC_channel\n", av[0]);
-        return(1);
+    const char *rate_list = "128,250,475,860";
+    const char *gain_list = "4.096";
+    int bench = 0, use_mock = 0;
+    int n_reads = 500;
+    double max_secs = 0.5;
+
+    me = av[0];
+    int opt;
+    while ((opt = getopt (ac, av, "be:g:mn:r:t:")) != -1) {
+        switch (opt) {
+        case 'b': bench = 1; break;
+        case 'e': mock.err_rate = atof (optarg); break;
+        case 'g': gain_list = optarg; break;
+        case 'm': use_mock = 1; break;
+        case 'n': n_reads = atoi (optarg); break;
+        case 'r': rate_list = optarg; break;
+        case 't': max_secs = atof (optarg); break;
+        default: usage(); break;
+        }
     }
+    ac -= optind;
+    av += optind;
+    if (ac != 2 && !(bench && ac == 1))
+        usage();
+    if (n_reads < 2 || max_secs <= 0)
+        usage();
 
-    uint8_t addr = strtol (av[1], NULL, 16);
-    uint16_t channel = strtol (av[2], NULL, 0);
+    uint8_t addr = strtol (av[0], NULL, 16);
+    int channel = ac == 2 ? (int) strtol (av[1], NULL, 0) : -1;
 
     char ynot[1024];
 
-    if (piI2CInit(ynot) < 0) {
+    if (use_mock) {
+        setADC_I2C (mockRead16, mockWrite16);
+    } else if (piI2CInit(ynot) < 0) {
         fprintf (stderr, "piI2CInit(): %s\n", ynot);
         return(1);
     }
 
-    uint16_t v;
-    if (readADC_SingleEnded (addr, channel, &v, ynot) < 0) {
-        fprintf (stderr, "readADC_SingleEnded(): %s\n", ynot);
-        return(1);
+    if (!bench) {
+        uint16_t v;
+        if (readADC_SingleEnded (addr, channel, &v, ynot) < 0) {
+            fprintf (stderr, "readADC_SingleEnded(): %s\n", ynot);
+            return(1);
+        }
+
+        printf ("%4u 0x%04x\n", v, v);
+
+        return (0);
+    }
+
+    double rates[8], gains[6];
+    for (int i = 0; i < 8; i++)
+        rates[i] = ADC_rates[i];
+    for (int i = 0; i < 6; i++)
+        gains[i] = ADC_fullscale[i];
+    unsigned rate_mask, gain_mask;
+    if (parseList (rate_list, rates, 8, &rate_mask) < 0) {
+        fprintf (stderr, "%s: bad rate list: %s\n", me, rate_list);
+        return (1);
+    }
+    if (parseList (gain_list, gains, 6, &gain_mask) < 0) {
+        fprintf (stderr, "%s: bad full scale list: %s\n", me, gain_list);
+        return (1);
+    }
+
+    double *lat = (double *) malloc (n_reads * sizeof(double));
+    double *val = (double *) malloc (n_reads * sizeof(double));
+    if (!lat || !val) {
+        fprintf (stderr, "%s: no memory for %d reads\n", me, n_reads);
+        return (1);
+    }
+
+    printf ("                               reads   ---- latency, ms ----   --------- counts -------   noise   error\n");
+    printf ("ch  SPS  FS V mode   wait         /s    mean     p50     p99     max     mean      sd   p-p   sd uV       %%\n");
+    for (int ch = 0; ch < 4; ch++) {
+        if (channel >= 0 && ch != channel)
+            continue;
+        for (int r = 0; r < 8; r++) {
+            if (!(rate_mask & (1U << r)))
+                continue;
+            for (int g = 0; g < 6; g++) {
+                if (!(gain_mask & (1U << g)))
+                    continue;
+                for (int c = 0; c < 2; c++) {
+                    for (int w = ADC_WAIT_FIXED; w <= ADC_WAIT_POLL; w++) {
+                        ADCSettings s = {(uint8_t)r, (uint8_t)g, (uint8_t)c, (uint8_t)w};
+                        benchOne (addr, ch, &s, n_reads, max_secs, lat, val);
+                    }
+                }
+            }
+        }
     }
 
-    printf ("%4u 0x%04x\n", v, v);
+    free (lat);
+    free (val);
 
     return (0);
 }
@@ -192,6 +653,34 @@ int readADC_SingleEnded (uint8_t i2c_addr, uint16_t channel, uint16_t *data, cha
     return (-1);
 }
 
+int startADC_SingleEnded (uint8_t i2c_addr, uint16_t channel, char ynot[]) {
+    (void) i2c_addr;
+    (void) channel;
+    strcpy (ynot, "startADC_SingleEnded only on RPi");
+    return (-1);
+}
+
+int finishADC_SingleEnded (uint8_t i2c_addr, uint16_t *data, char ynot[]) {
+    (void) i2c_addr;
+    (void) data;
+    strcpy (ynot, "finishADC_SingleEnded only on RPi");
+    return (-1);
+}
+
+int readADC_Config (uint8_t i2c_addr, uint16_t channel, const ADCSettings *sp, int16_t *data, char ynot[]) {
+    (void) i2c_addr;
+    (void) channel;
+    (void) sp;
+    (void) data;
+    strcpy (ynot, "readADC_Config only on RPi");
+    return (-1);
+}
+
+void setADC_I2C (ADCRead16Func read16, ADCWrite16Func write16) {
+    (void) read16;
+    (void) write16;
+}
+
 
 #if defined(_UNIT_TEST_MAIN)
 
@@ -3,6 +3,36 @@
 
 #include <stdint.h>
 
+// ADS1115 acquisition settings for readADC_Config()
+typedef struct {
+    uint8_t rate;                       // data rate code 0 .. 7, see ADC_rates[]
+    uint8_t pga;                        // gain code 0 .. 5, see ADC_fullscale[]
+    uint8_t continuous;                 // 1 for continuous conversion mode else single-shot
+    uint8_t wait;                       // one of ADC_WAIT_*
+} ADCSettings;
+
+// ways to wait for a conversion
+enum {
+    ADC_WAIT_FIXED,                     // sleep 2 ms as readADC_SingleEnded, longer if the rate needs it
+    ADC_WAIT_NOMINAL,                   // sleep the conversion time of the data rate plus its tolerance
+    ADC_WAIT_POLL,                      // single-shot: poll until done; continuous: until the value changes
+};
+
+// I2C access, replaceable for testing
+typedef int (*ADCRead16Func) (uint8_t bus_addr, uint8_t dev_reg, uint16_t *data, char ynot[]);
+typedef int (*ADCWrite16Func) (uint8_t bus_addr, uint8_t dev_reg, uint16_t data, char ynot[]);
+
+// usecs from startADC_SingleEnded() until the conversion may be collected with finishADC_SingleEnded()
+#define ADC_SINGLE_ENDED_US     2000
+
+extern const int ADC_rates[8];          // samples per second for each rate code
+extern const float ADC_fullscale[6];    // full scale volts for each gain code
+
 extern int readADC_SingleEnded (uint8_t i2c_addr, uint16_t channel, uint16_t *data, char ynot[]);
+extern int startADC_SingleEnded (uint8_t i2c_addr, uint16_t channel, char ynot[]);
+extern int finishADC_SingleEnded (uint8_t i2c_addr, uint16_t *data, char ynot[]);
+extern int readADC_Config (uint8_t i2c_addr, uint16_t channel, const ADCSettings *sp, int16_t *data,
+        char ynot[]);
+extern void setADC_I2C (ADCRead16Func read16, ADCWrite16Func write16);
 
 #endif // _ADS1015_H
@@ -0,0 +1,245 @@
+/* read AMS AS5600 or AS5048B magnetic absolute encoders over I2C.
+ *
+ * AS5600 data sheet: https://ams.com/documents/20143/36005/AS5600_DS000365_5-00.pdf
+ * AS5048B data sheet: https://ams.com/documents/20143/36005/AS5048_DS000298_4-00.pdf
+ *
+ * An encoder is named by a spec of its type and optional bus address, such as "as5600" or "as5048,0x41".
+ * The AS5600 address is fixed at 0x36 so only one may be on the bus. The AS5048B defaults to 0x40 and may be
+ * strapped to 0x41 .. 0x43 with its A1 and A2 pins.
+ *
+ * #define _UNIT_TEST_MAIN to make a stand-alone test program, build and run as follows:
+ *
+ *   gcc -Wall -O2 -D_UNIT_TEST_MAIN piEncoder.c piI2C.c -o piEncoder -lm -lpthread
+ *   ./piEncoder as5048,0x40        # report angle, read rate and noise, -h for options
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "piI2C.h"
+#include "piEncoder.h"
+
+
+// AS5600 registers and status bits
+#define AS5600_ADDR             0x36
+#define AS5600_REG_STATUS       0x0B    // followed by RAW ANGLE high byte
+#define AS5600_REG_RAW_ANGLE    0x0C
+#define AS5600_STATUS_MD        0x20    // magnet detected
+#define AS5600_STATUS_ML        0x10    // magnet too weak
+#define AS5600_STATUS_MH        0x08    // magnet too strong
+
+// AS5048B registers and diagnostic bits
+#define AS5048_ADDR             0x40
+#define AS5048_REG_AGC          0xFA    // followed by DIAG
+#define AS5048_REG_ANGLE        0xFE    // bits 13:6, followed by bits 5:0
+#define AS5048_DIAG_OCF         0x01    // offset compensation finished
+#define AS5048_DIAG_COF         0x02    // CORDIC overflow
+#define AS5048_DIAG_COMP_LOW    0x04    // magnet too strong
+#define AS5048_DIAG_COMP_HIGH   0x08    // magnet too weak
+
+
+/* parse spec as described above.
+ * return 0 if ok with type and address, else -1
+ */
+int encoderParse (const char *spec, EncoderType *typep, uint8_t *addrp)
+{
+        char name[16];
+        unsigned addr = 0;
+        int n = sscanf (spec, " %15[^, ] , %i", name, &addr);
+        if (n < 1)
+            return (-1);
+
+        if (strcmp (name, "none") == 0 && n == 1) {
+            *typep = ENC_NONE;
+            *addrp = 0;
+        } else if (strcmp (name, "as5600") == 0 && (n == 1 || addr == AS5600_ADDR)) {
+            *typep = ENC_AS5600;
+            *addrp = AS5600_ADDR;
+        } else if (strcmp (name, "as5048") == 0 && (n == 1 || (addr >= AS5048_ADDR && addr <= AS5048_ADDR+3))) {
+            *typep = ENC_AS5048;
+            *addrp = n == 1 ? AS5048_ADDR : addr;
+        } else
+            return (-1);
+
+        return (0);
+}
+
+/* format the spec of the given encoder into spec[], which must be at least 16 chars
+ */
+void encoderFormat (EncoderType type, uint8_t addr, char spec[])
+{
+        switch (type) {
+        case ENC_NONE:   strcpy (spec, "none"); break;
+        case ENC_AS5600: sprintf (spec, "as5600,0x%02x", addr); break;
+        case ENC_AS5048: sprintf (spec, "as5048,0x%02x", addr); break;
+        }
+}
+
+/* return the number of bits per turn of the given encoder type, 0 if none
+ */
+int encoderBits (EncoderType type)
+{
+        switch (type) {
+        case ENC_NONE:   return (0);
+        case ENC_AS5600: return (12);
+        case ENC_AS5048: return (14);
+        }
+        return (0);
+}
+
+/* read the raw angle of the given encoder, 0 .. 2^encoderBits()-1.
+ * if check, also read its magnet status first, costing a second transfer, and fail if it is not usable.
+ * we use piI2C and assume piI2CInit() has already been called.
+ * return 0 if ok, else -1 with brief excuse in ynot[]
+ */
+int encoderRead (EncoderType type, uint8_t addr, int check, uint16_t *rawp, char ynot[])
+{
+        uint16_t w;
+
+        switch (type) {
+
+        case ENC_NONE:
+            strcpy (ynot, "no encoder");
+            return (-1);
+
+        case ENC_AS5600:
+            if (check) {
+                if (piI2CRead16 (addr, AS5600_REG_STATUS, &w, ynot) < 0)
+                    return (-1);
+                uint8_t status = w >> 8;
+                if (!(status & AS5600_STATUS_MD) || (status & (AS5600_STATUS_ML|AS5600_STATUS_MH))) {
+                    sprintf (ynot, "AS5600 0x%02x: magnet %s", addr, !(status & AS5600_STATUS_MD) ? "not found"
+                                        : ((status & AS5600_STATUS_ML) ? "too weak" : "too strong"));
+                    return (-1);
+                }
+            }
+            if (piI2CRead16 (addr, AS5600_REG_RAW_ANGLE, &w, ynot) < 0)
+                return (-1);
+            *rawp = w & 0x0FFF;
+            return (0);
+
+        case ENC_AS5048:
+            if (check) {
+                if (piI2CRead16 (addr, AS5048_REG_AGC, &w, ynot) < 0)
+                    return (-1);
+                uint8_t diag = w & 0xFF;
+                if (!(diag & AS5048_DIAG_OCF) || (diag & (AS5048_DIAG_COF|AS5048_DIAG_COMP_LOW|AS5048_DIAG_COMP_HIGH))) {
+                    sprintf (ynot, "AS5048 0x%02x: %s", addr, !(diag & AS5048_DIAG_OCF) ? "not ready"
+                                        : ((diag & AS5048_DIAG_COF) ? "CORDIC overflow"
+                                        : ((diag & AS5048_DIAG_COMP_LOW) ? "magnet too strong"
+                                        : "magnet too weak")));
+                    return (-1);
+                }
+            }
+            if (piI2CRead16 (addr, AS5048_REG_ANGLE, &w, ynot) < 0)
+                return (-1);
+            *rawp = ((w >> 8) << 6) | (w & 0x3F);
+            return (0);
+        }
+
+        strcpy (ynot, "unknown encoder");
+        return (-1);
+}
+
+
+
+#if defined(_UNIT_TEST_MAIN)
+
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+
+/* the test program reads the given encoder repeatedly, checking its magnet status on every read unless -q.
+ * it prints each angle if -v, then the read rate, the time per read and the noise, which is only meaningful
+ * if the magnet is not turning.
+ */
+
+static char *me;
+
+static double nowSecs (void)
+{
+        struct timespec ts;
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+        return (ts.tv_sec + ts.tv_nsec*1e-9);
+}
+
+static void usage (void)
+{
+        fprintf (stderr, "Purpose: test an AS5600 or AS5048B magnetic encoder\n");
+        fprintf (stderr, "Usage: %s [options] as5600 | as5048[,0x40 .. 0x43]\n", me);
+        fprintf (stderr, "  -n n    : number of reads; default 1000\n");
+        fprintf (stderr, "  -p us   : period between reads; default 1000\n");
+        fprintf (stderr, "  -q      : skip the magnet status check\n");
+        fprintf (stderr, "  -v      : print each angle\n");
+        exit(1);
+}
+
+int main (int ac, char *av[])
+{
+        int n_reads = 1000, period = 1000, check = 1, verbose = 0;
+        int opt;
+
+        me = av[0];
+        while ((opt = getopt (ac, av, "n:p:qv")) != -1) {
+            switch (opt) {
+            case 'n': n_reads = atoi (optarg); break;
+            case 'p': period = atoi (optarg); break;
+            case 'q': check = 0; break;
+            case 'v': verbose = 1; break;
+            default: usage(); break;
+            }
+        }
+        EncoderType type;
+        uint8_t addr;
+        if (optind != ac - 1 || encoderParse (av[optind], &type, &addr) < 0 || type == ENC_NONE || n_reads < 1)
+            usage();
+
+        char ynot[1024];
+        if (piI2CInit (ynot) < 0) {
+            fprintf (stderr, "%s: %s\n", me, ynot);
+            exit(1);
+        }
+
+        int counts = 1 << encoderBits (type);
+        double sum = 0, sum2 = 0, busy = 0;
+        int n_ok = 0, n_err = 0;
+        double t0 = nowSecs();
+        for (int i = 0; i < n_reads; i++) {
+            uint16_t raw;
+            double t = nowSecs();
+            if (encoderRead (type, addr, check, &raw, ynot) < 0) {
+                if (n_err++ == 0 || verbose)
+                    fprintf (stderr, "%s\n", ynot);
+            } else {
+                // unwrap near the first reading so noise across 0 is not a whole turn
+                double a = raw;
+                if (n_ok > 0 && fabs (a - sum/n_ok) > counts/2)
+                    a += a < sum/n_ok ? counts : -counts;
+                sum += a;
+                sum2 += a*a;
+                n_ok++;
+                if (verbose)
+                    printf ("%5u %8.3f\n", raw, raw*360.0/counts);
+            }
+            busy += nowSecs() - t;
+            if (period > 0)
+                usleep (period);
+        }
+        double dt = nowSecs() - t0;
+
+        char spec[16];
+        encoderFormat (type, addr, spec);
+        printf ("%s: %d reads in %.3f secs, %.0f/sec, %.1f us per read, %d failed\n", spec, n_reads, dt,
+                                n_reads/dt, 1e6*busy/n_reads, n_err);
+        if (n_ok > 0) {
+            double mean = sum/n_ok;
+            double rms = sqrt (fmax (0, sum2/n_ok - mean*mean));
+            printf ("mean %.2f counts = %.3f degs, rms noise %.2f counts = %.4f degs\n", mean,
+                                fmod (mean*360.0/counts + 360, 360), rms, rms*360.0/counts);
+        }
+
+        return (n_err == n_reads);
+}
+
+#endif // _UNIT_TEST_MAIN
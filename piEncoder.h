@@ -0,0 +1,18 @@
+#ifndef _PI_ENCODER_H
+#define _PI_ENCODER_H
+
+#include <stdint.h>
+
+// supported magnetic absolute encoders
+typedef enum {
+    ENC_NONE,                           // not fitted
+    ENC_AS5600,                         // AMS AS5600, 12 bits
+    ENC_AS5048,                         // AMS AS5048B, 14 bits
+} EncoderType;
+
+extern int encoderParse (const char *spec, EncoderType *typep, uint8_t *addrp);
+extern void encoderFormat (EncoderType type, uint8_t addr, char spec[]);
+extern int encoderBits (EncoderType type);
+extern int encoderRead (EncoderType type, uint8_t addr, int check, uint16_t *rawp, char ynot[]);
+
+#endif // _PI_ENCODER_H
@@ -0,0 +1,408 @@
+/* Simple GPIO implementation for Raspberry Pi running Debian linux using the GPIO character device.
+ * Compiles on any UNIX but functions all return failure if not above.
+ *
+ * This uses the kernel's v2 line uAPI on /dev/gpiochip0, so unlike piGPIO.c it does not depend on the
+ * register layout of the GPIO controller and unlike piGPIO-sys.c it costs one ioctl per operation rather
+ * than opening and writing a file. Each pin is requested separately the first time its direction is set,
+ * first without changing its direction to learn its level so making it an output does not change it.
+ *
+ * The kernel lets only one process hold each line, so piGPIOgetLines() and piGPIOadoptLine() pass them on
+ * to a new instance in a handoff.
+ *
+ * All pin numbers refer to BCM GPIO numbers. Run pinout to see where they on the header.
+ *
+ * #define _UNIT_TEST_MAIN to make a stand-alone test program, build and run as follows:
+ *
+ *   gcc -Wall -O2 -D_UNIT_TEST_MAIN piGPIO-cdev.c -o piGPIO-cdev
+ *   ./piGPIO-cdev 20 1     # set pin 20 as output with state hi
+ *   ./piGPIO-cdev 20       # set pin 20 as input and read
+ *
+ *   if this reports a permission error, try adding user pi to the gpio group:
+ *      sudo usermod -a -G gpio pi
+ */
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+
+#include "isapi.h"
+#include "piGPIO.h"
+
+
+// name of this implementation
+const char piGPIOBackend[] = "cdev";
+
+
+#if defined(ISA_PI)
+
+
+/* real implementation
+ */
+
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+
+#define MAX_PINS        64                      // pins are bits in a uint64_t
+
+static const char chip_path[] = "/dev/gpiochip0";
+static int chip_fd = -1;
+
+// line request fd of each pin, else -1
+static int line_fd[MAX_PINS];
+static int lines_ready;                         // set once line_fd[] is initialized
+
+
+/* mark all pins as not yet requested, once
+ */
+static void initLines (void)
+{
+        if (lines_ready)
+            return;
+        for (int p = 0; p < MAX_PINS; p++)
+            line_fd[p] = -1;
+        lines_ready = 1;
+}
+
+
+/* request pin p, or change its configuration if already requested, to the given flags.
+ * when making it an output, also set its initial value to hi.
+ * return 0 if ok else -1
+ */
+static int configLine (uint8_t p, uint64_t flags, int hi)
+{
+        struct gpio_v2_line_config config;
+        memset (&config, 0, sizeof(config));
+        config.flags = flags;
+        if (flags & GPIO_V2_LINE_FLAG_OUTPUT) {
+            config.num_attrs = 1;
+            config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+            config.attrs[0].attr.values = hi ? 1 : 0;
+            config.attrs[0].mask = 1;
+        }
+
+        if (line_fd[p] >= 0) {
+            if (ioctl (line_fd[p], GPIO_V2_LINE_SET_CONFIG_IOCTL, &config) < 0) {
+                fprintf (stderr, "GPIO: %s (%d): %s\n", __func__, p, strerror(errno));
+                return (-1);
+            }
+            return (0);
+        }
+
+        struct gpio_v2_line_request req;
+        memset (&req, 0, sizeof(req));
+        req.offsets[0] = p;
+        req.num_lines = 1;
+        strcpy (req.consumer, "g5500");
+        req.config = config;
+        if (ioctl (chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+            fprintf (stderr, "GPIO: %s (%d): %s\n", __func__, p, strerror(errno));
+            return (-1);
+        }
+        line_fd[p] = req.fd;
+
+        return (0);
+}
+
+/* return the level of pin p, which must already be requested
+ */
+static int getLine (uint8_t p)
+{
+        struct gpio_v2_line_values lv;
+        lv.bits = 0;
+        lv.mask = 1;
+        if (ioctl (line_fd[p], GPIO_V2_LINE_GET_VALUES_IOCTL, &lv) < 0) {
+            fprintf (stderr, "GPIO: %s (%d): %s\n", __func__, p, strerror(errno));
+            return (0);
+        }
+        return ((lv.bits & 1) != 0);
+}
+
+/* set the level of pin p, which must already be requested as an output
+ */
+static void setLine (uint8_t p, int hi)
+{
+        struct gpio_v2_line_values lv;
+        lv.bits = hi ? 1 : 0;
+        lv.mask = 1;
+        if (ioctl (line_fd[p], GPIO_V2_LINE_SET_VALUES_IOCTL, &lv) < 0)
+            fprintf (stderr, "GPIO: %s (%d, %d): %s\n", __func__, p, hi, strerror(errno));
+}
+
+/* return whether pin p may be used, complaining if not
+ */
+static int lineReady (uint8_t p, const char *caller)
+{
+        if (chip_fd < 0 || p >= MAX_PINS || line_fd[p] < 0) {
+            fprintf (stderr, "GPIO: %s(%d) not ready\n", caller, p);
+            return (0);
+        }
+        return (1);
+}
+
+
+
+/* initialize.
+ * return 0 if ok else -1 with brief excuse in ynot.
+ * harmless if called more than once.
+ */
+int piGPIOInit (char ynot[])
+{
+        if (chip_fd >= 0)
+            return (0);
+
+        chip_fd = open (chip_path, O_RDWR|O_CLOEXEC);
+        if (chip_fd < 0) {
+            sprintf (ynot, "%s: %s", chip_path, strerror(errno));
+            return (-1);
+        }
+        initLines();
+
+        if (verbose)
+            fprintf (stderr, "GPIO: %s() ok\n", __func__);
+        return (0);
+}
+
+
+/* set the given pin as input with pullup
+ */
+void piGPIOsetAsInput (uint8_t p)
+{
+        if (chip_fd < 0 || p >= MAX_PINS) {
+            fprintf (stderr, "GPIO: %s(%d) not ready\n", __func__, p);
+            return;
+        }
+
+        if (configLine (p, GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_BIAS_PULL_UP, 0) == 0 && verbose)
+            fprintf (stderr, "GPIO: %s (%d) ok\n", __func__, p);
+}
+
+/* set the given pin as output without changing its level
+ */
+void piGPIOsetAsOutput (uint8_t p)
+{
+        if (chip_fd < 0 || p >= MAX_PINS) {
+            fprintf (stderr, "GPIO: %s(%d) not ready\n", __func__, p);
+            return;
+        }
+
+        // no direction flags leaves the line as it is, so a driven relay does not drop out
+        if (line_fd[p] < 0 && configLine (p, 0, 0) < 0)
+            return;
+        if (configLine (p, GPIO_V2_LINE_FLAG_OUTPUT, getLine (p)) == 0 && verbose)
+            fprintf (stderr, "GPIO: %s (%d) ok\n", __func__, p);
+}
+
+/* set the given pin HI
+ */
+void piGPIOsetHi (uint8_t p)
+{
+        if (lineReady (p, __func__))
+            setLine (p, 1);
+}
+
+/* set the given pin LOW
+ */
+void piGPIOsetLo (uint8_t p)
+{
+        if (lineReady (p, __func__))
+            setLine (p, 0);
+}
+
+/* set the given pin hi or lo
+ */
+void piGPIOsetHiLo (uint8_t p, int hi)
+{
+        if (lineReady (p, __func__))
+            setLine (p, hi);
+}
+
+/* set each pin whose bit is set in hi_mask HI and each in lo_mask LOW.
+ * each pin is its own line request so this is one ioctl per pin.
+ */
+void piGPIOsetMany (uint64_t hi_mask, uint64_t lo_mask)
+{
+        for (int p = 0; p < MAX_PINS; p++) {
+            if (hi_mask & (1ULL << p)) {
+                if (lineReady (p, __func__))
+                    setLine (p, 1);
+            } else if (lo_mask & (1ULL << p)) {
+                if (lineReady (p, __func__))
+                    setLine (p, 0);
+            }
+        }
+}
+
+/* return 0 or 1 depending on whether the given pin is hi or lo
+ */
+int piGPIOreadPin (uint8_t p)
+{
+        if (!lineReady (p, __func__))
+            return (0);
+
+        int state = getLine (p);
+
+        if (verbose)
+            fprintf (stderr, "GPIO: %s (%d) %d\n", __func__, p, state);
+
+        return (state);
+}
+
+/* fill pins[] and fds[] with each line we hold, up to max, to be passed to a new instance.
+ * return the number filled.
+ */
+int piGPIOgetLines (uint8_t pins[], int fds[], int max)
+{
+        int n = 0;
+        for (int p = 0; lines_ready && p < MAX_PINS && n < max; p++) {
+            if (line_fd[p] >= 0) {
+                pins[n] = p;
+                fds[n++] = line_fd[p];
+            }
+        }
+        return (n);
+}
+
+/* carry on with line request fd for pin p as passed from an old instance, before piGPIOInit().
+ */
+void piGPIOadoptLine (uint8_t p, int fd)
+{
+        initLines();
+        if (p >= MAX_PINS || line_fd[p] >= 0) {
+            close (fd);
+            return;
+        }
+        line_fd[p] = fd;
+}
+
+
+#if defined(_UNIT_TEST_MAIN)
+
+int verbose;
+
+int main (int ac, char *av[])
+{
+        char ynot[1024];
+
+        if (ac > 1 && strcmp (av[1], "-v") == 0) {
+            verbose = 1;
+            ac -= 1;
+            av += 1;
+        }
+
+        if (ac == 2) {
+            // looks like a read
+            int pin = atoi(av[1]);
+            if (piGPIOInit(ynot) < 0) {
+                fprintf (stderr, "piGPIOInit(): %s\n", ynot);
+                return (1);
+            }
+            piGPIOsetAsInput (pin);
+            int state = piGPIOreadPin (pin);
+            printf ("pin %d -> %d\n", pin, state);
+
+        } else if (ac == 3) {
+            // looks like a write
+            int pin = atoi(av[1]);
+            int state = atoi(av[2]) == 0 ? 0 : 1;
+            if (piGPIOInit(ynot) < 0) {
+                fprintf (stderr, "piGPIOInit(): %s\n", ynot);
+                return (1);
+            }
+            piGPIOsetAsOutput (pin);
+            piGPIOsetHiLo (pin, state);
+            printf ("pin %d <- %d\n", pin, state);
+
+        } else {
+            fprintf (stderr, "%s: [-v] BCM_pin [state]\n", av[0]);
+            return (1);
+        }
+
+        return (0);
+}
+
+#endif // _UNIT_TEST_MAIN
+
+
+#else
+
+/* not a pi -- just provide dummy implementations
+ */
+
+
+int piGPIOInit (char ynot[])
+{
+    strcpy (ynot, "piGPIO only on RPi");
+    return (-1);
+}
+
+void piGPIOsetAsInput (uint8_t p)
+{
+    (void) p;
+}
+
+void piGPIOsetAsOutput (uint8_t p)
+{
+    (void) p;
+}
+
+void piGPIOsetHi (uint8_t p)
+{
+    (void) p;
+}
+
+void piGPIOsetLo (uint8_t p)
+{
+    (void) p;
+}
+
+void piGPIOsetHiLo (uint8_t p, int hi)
+{
+    (void) p;
+    (void) hi;
+}
+
+int piGPIOreadPin (uint8_t p)
+{
+    (void) p;
+    return (0);
+}
+
+void piGPIOsetMany (uint64_t hi_mask, uint64_t lo_mask)
+{
+    (void) hi_mask;
+    (void) lo_mask;
+}
+
+int piGPIOgetLines (uint8_t pins[], int fds[], int max)
+{
+    (void) pins;
+    (void) fds;
+    (void) max;
+    return (0);
+}
+
+void piGPIOadoptLine (uint8_t p, int fd)
+{
+    (void) p;
+    close (fd);
+}
+
+
+
+#if defined(_UNIT_TEST_MAIN)
+
+int main (int ac, char *av[])
+{
+    printf ("piGPIO only on RPi\n");
+    return (1);
+}
+
+#endif // _UNIT_TEST_MAIN
+
+
+#endif // ISA_PI
+
@@ -0,0 +1,127 @@
+/* Simulated GPIO implementation that keeps pin state in memory, for exercising programs such as gpiobench
+ * on machines without GPIO hardware. Inputs read as HI because they are set with pullup.
+ *
+ * All pin numbers refer to BCM GPIO numbers.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "piGPIO.h"
+
+
+// name of this implementation
+const char piGPIOBackend[] = "mock";
+
+
+#define MAX_PINS        64                      // pins are bits in a uint64_t
+
+static int ready;                               // set by piGPIOInit()
+static uint64_t out_mask;                       // pins set as outputs
+static volatile uint64_t levels;                // level of each pin
+
+
+/* initialize.
+ * return 0 always.
+ * harmless if called more than once.
+ */
+int piGPIOInit (char ynot[])
+{
+        (void) ynot;
+        ready = 1;
+        if (verbose)
+            fprintf (stderr, "GPIO: %s() ok\n", __func__);
+        return (0);
+}
+
+
+/* set the given pin as input with pullup
+ */
+void piGPIOsetAsInput (uint8_t p)
+{
+        if (!ready || p >= MAX_PINS) {
+            fprintf (stderr, "GPIO: %s(%d) not ready\n", __func__, p);
+            return;
+        }
+
+        out_mask &= ~(1ULL << p);
+        levels |= 1ULL << p;
+}
+
+/* set the given pin as output
+ */
+void piGPIOsetAsOutput (uint8_t p)
+{
+        if (!ready || p >= MAX_PINS) {
+            fprintf (stderr, "GPIO: %s(%d) not ready\n", __func__, p);
+            return;
+        }
+
+        out_mask |= 1ULL << p;
+}
+
+/* set each pin whose bit is set in hi_mask HI and each in lo_mask LOW, ignoring any not outputs
+ */
+void piGPIOsetMany (uint64_t hi_mask, uint64_t lo_mask)
+{
+        if (!ready) {
+            fprintf (stderr, "GPIO: %s() not ready\n", __func__);
+            return;
+        }
+
+        levels = (levels | (hi_mask & out_mask)) & ~(lo_mask & out_mask);
+}
+
+/* set the given pin HI
+ */
+void piGPIOsetHi (uint8_t p)
+{
+        if (p < MAX_PINS)
+            piGPIOsetMany (1ULL << p, 0);
+}
+
+/* set the given pin LOW
+ */
+void piGPIOsetLo (uint8_t p)
+{
+        if (p < MAX_PINS)
+            piGPIOsetMany (0, 1ULL << p);
+}
+
+/* set the given pin hi or lo
+ */
+void piGPIOsetHiLo (uint8_t p, int hi)
+{
+        if (hi)
+            piGPIOsetHi (p);
+        else
+            piGPIOsetLo (p);
+}
+
+/* return 0 or 1 depending on whether the given pin is hi or lo
+ */
+int piGPIOreadPin (uint8_t p)
+{
+        if (!ready || p >= MAX_PINS) {
+            fprintf (stderr, "GPIO: %s(%d) not ready\n", __func__, p);
+            return (0);
+        }
+
+        return ((levels & (1ULL << p)) != 0);
+}
+
+/* this implementation holds no descriptor per pin, so there is nothing to pass in a handoff
+ */
+int piGPIOgetLines (uint8_t pins[], int fds[], int max)
+{
+        (void) pins;
+        (void) fds;
+        (void) max;
+        return (0);
+}
+
+void piGPIOadoptLine (uint8_t p, int fd)
+{
+        (void) p;
+        close (fd);
+}
@@ -23,6 +23,27 @@
 #include "piGPIO.h"
 
 
+// name of this implementation
+const char piGPIOBackend[] = "sysfs";
+
+
+/* this implementation holds no descriptor per pin, so there is nothing to pass in a handoff
+ */
+int piGPIOgetLines (uint8_t pins[], int fds[], int max)
+{
+        (void) pins;
+        (void) fds;
+        (void) max;
+        return (0);
+}
+
+void piGPIOadoptLine (uint8_t p, int fd)
+{
+        (void) p;
+        close (fd);
+}
+
+
 #if defined(ISA_PI)
 
 
@@ -77,6 +98,17 @@ static void setPinDirection (int p, int in_else_out)
         FILE *fp;
 
         snprintf (path, sizeof(path), "%s/gpio%d/direction", base_path, p);
+
+        // leave alone if already so because writing "out" also drives the pin low
+        fp = fopen (path, "r");
+        if (fp) {
+            char now[10];
+            int same = fgets (now, sizeof(now), fp) && strncmp (now, in_else_out ? "in" : "out", 2) == 0;
+            fclose (fp);
+            if (same)
+                return;
+        }
+
         fp = fopen (path, "w");
         if (!fp) {
             if (exportPin (p, NULL) < 0)
@@ -178,6 +210,18 @@ void piGPIOsetHiLo (uint8_t p, int hi)
         setPinState (p, hi);
 }
 
+/* set each pin whose bit is set in hi_mask HI and each in lo_mask LOW, one at a time
+ */
+void piGPIOsetMany (uint64_t hi_mask, uint64_t lo_mask)
+{
+        for (int p = 0; p < 64; p++) {
+            if (hi_mask & (1ULL << p))
+                setPinState (p, 1);
+            else if (lo_mask & (1ULL << p))
+                setPinState (p, 0);
+        }
+}
+
 /* return 0 or 1 depending on whether the given pin is hi or lo
  */
 int piGPIOreadPin (uint8_t p)
@@ -278,6 +322,12 @@ int piGPIOreadPin (uint8_t p)
     return (0);
 }
 
+void piGPIOsetMany (uint64_t hi_mask, uint64_t lo_mask)
+{
+    (void) hi_mask;
+    (void) lo_mask;
+}
+
 
 
 #if defined(_UNIT_TEST_MAIN)
@@ -24,6 +24,27 @@
 #include "piGPIO.h"
 
 
+// name of this implementation
+const char piGPIOBackend[] = "mmap";
+
+
+/* this implementation holds no descriptor per pin, so there is nothing to pass in a handoff
+ */
+int piGPIOgetLines (uint8_t pins[], int fds[], int max)
+{
+        (void) pins;
+        (void) fds;
+        (void) max;
+        return (0);
+}
+
+void piGPIOadoptLine (uint8_t p, int fd)
+{
+        (void) p;
+        close (fd);
+}
+
+
 #if defined(ISA_PI)
 
 
@@ -178,6 +199,25 @@ void piGPIOsetHiLo (uint8_t p, int hi)
             piGPIOsetLo (p);
 }
 
+/* set each pin whose bit is set in hi_mask HI and each in lo_mask LOW, with one register write per bank
+ */
+void piGPIOsetMany (uint64_t hi_mask, uint64_t lo_mask)
+{
+        if (!gbase) {
+            fprintf (stderr, "GPIO: %s() not ready\n", __func__);
+            return;
+        }
+
+        if (hi_mask & 0xFFFFFFFF)
+            gbase[7] = (uint32_t) hi_mask;
+        if (hi_mask >> 32)
+            gbase[8] = (uint32_t) (hi_mask >> 32);
+        if (lo_mask & 0xFFFFFFFF)
+            gbase[10] = (uint32_t) lo_mask;
+        if (lo_mask >> 32)
+            gbase[11] = (uint32_t) (lo_mask >> 32);
+}
+
 /* return 0 or 1 depending on whether the given pin is hi or lo
  */
 int piGPIOreadPin (uint8_t p)
@@ -287,6 +327,12 @@ int piGPIOreadPin (uint8_t p)
     return (0);
 }
 
+void piGPIOsetMany (uint64_t hi_mask, uint64_t lo_mask)
+{
+    (void) hi_mask;
+    (void) lo_mask;
+}
+
 
 
 #if defined(_UNIT_TEST_MAIN)
@@ -10,6 +10,10 @@ extern void piGPIOsetHi (uint8_t p);
 extern void piGPIOsetLo (uint8_t p);
 extern void piGPIOsetHiLo (uint8_t p, int hi);
 extern int piGPIOreadPin (uint8_t p);
+extern void piGPIOsetMany (uint64_t hi_mask, uint64_t lo_mask);
+extern int piGPIOgetLines (uint8_t pins[], int fds[], int max);
+extern void piGPIOadoptLine (uint8_t p, int fd);
+extern const char piGPIOBackend[];
 extern int verbose;
 
 #endif
@@ -1,8 +1,19 @@
 /* Simple I2C implementation for Raspberry Pi running Debian linux.
  * Compiles on any UNIX but functions all return failure if not above.
  * linux info: https://www.kernel.org/doc/Documentation/i2c/dev-interface
+ *
+ * The bus may be shared with other processes, such as weather or power monitors, that also link with this
+ * file. Each transaction is one combined transfer, the register write and any read joined by a repeated
+ * start, made while holding a robust mutex in shared memory, I2C_SHARED, so a process that dies holding it
+ * can not lock up the bus. A process marked urgent by piI2CSetUrgent(), ie, the rotator, waits no more than
+ * I2C_URGENT_WAIT_MS for the bus and meanwhile all others hold off, so it waits for at most the transaction
+ * already in progress. Others wait up to I2C_WAIT_MS. The waits and holds of each class are counted in the
+ * shared memory and returned by piI2CGetStats() so any process can see who is delaying whom. The shared
+ * memory is open only to the group of the bus device, and is rebuilt when no process is using it if it is
+ * left over from a different build.
  */
 
+#define _GNU_SOURCE                     // pthread_mutex_clocklock
 
 #include <stdio.h>
 #include <stdint.h>
@@ -11,6 +22,9 @@
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
 
 #include "isapi.h"
 #include "piI2C.h"
@@ -23,6 +37,8 @@
 
 #include <sys/ioctl.h>
 #include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <linux/i2c.h>
 #include <linux/i2c-dev.h>
@@ -32,32 +48,267 @@
 // set to 1 for more status reporting
 static int verbose = 0;
 
-// file access and last bus address
+// the bus and its arbitration shared by all processes using it
+static const char i2c_dev[] = "/dev/i2c-1";
+#define I2C_SHARED              "/dev/shm/piI2C-1"
+#define I2C_SHARED_MAGIC        0x49324331      // changes whenever I2CShared changes
+
+typedef struct {
+    uint32_t magic;                     // I2C_SHARED_MAGIC once initialized
+    uint32_t size;                      // sizeof(I2CShared), in case of differing builds
+    pthread_mutex_t bus;                // held for each transaction, robust and shared by all processes
+    volatile pid_t holder;              // process holding bus
+    volatile pid_t urgent;              // urgent process waiting for bus, else 0
+    PiI2CStats stats[2];                // others, urgent
+} I2CShared;
+
+// file access and shared arbitration
 static int i2c_fd = -1;
-static int i2c_addr = -1;
+static I2CShared *i2c_shared;
+static int i2c_urgent;                  // set if this process is urgent
+static struct timespec i2c_t0;          // when the bus was acquired
 
 
-/* insure system is set to the given I2C bus addr.
- * harmless if called more than once with same addr.
+/* return secs since *tp
+ */
+static double secsSince (const struct timespec *tp)
+{
+        struct timespec now;
+        clock_gettime (CLOCK_MONOTONIC, &now);
+        return ((now.tv_sec - tp->tv_sec) + (now.tv_nsec - tp->tv_nsec)*1e-9);
+}
+
+/* map the arbitration shared by all processes using the bus, creating it if we are first.
+ * every user keeps a shared flock on the file while it has it mapped, so one that gets an exclusive lock knows
+ * it is alone and may (re)build it, as when it is left over from a different build. the file is readable only
+ * by the owner and the group of the bus device, the i2c group, so other local users can not hold the mutex.
  * return 0 if ok, else -1 with brief excuse in ynot
  */
-static int piI2CSetBusAddr (uint8_t bus_addr, char ynot[])
+static int piI2CMapShared (char ynot[])
 {
-        // ignore if same as previous
-        if (i2c_addr == bus_addr)
-            return (0);
+        // open without O_CREAT if it exists, /dev/shm is sticky and may refuse that for a file of another user
+        int fd = open (I2C_SHARED, O_RDWR | O_CLOEXEC);
+        if (fd < 0 && errno == ENOENT)
+            fd = open (I2C_SHARED, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0660);
+        if (fd < 0 && errno == EEXIST)
+            fd = open (I2C_SHARED, O_RDWR | O_CLOEXEC);
+        if (fd < 0) {
+            sprintf (ynot, "I2C: %s: %s", I2C_SHARED, strerror(errno));
+            return (-1);
+        }
 
+        // alone if we can lock it exclusively, else join the others
+        int alone = flock (fd, LOCK_EX | LOCK_NB) == 0;
+        if (!alone)
+            flock (fd, LOCK_SH);
 
-        if (ioctl(i2c_fd, I2C_SLAVE, bus_addr) < 0) {
-            sprintf (ynot, "I2C: %s(0x%02X): %s", __func__, bus_addr, strerror(errno));
+        struct stat st;
+        if (fstat (fd, &st) < 0) {
+            sprintf (ynot, "I2C: %s: %s", I2C_SHARED, strerror(errno));
+            close (fd);
             return (-1);
-        } else {
-            // save
-            i2c_addr = bus_addr;
+        }
+        if (alone) {
+            // share with the bus device group regardless of umask, if we own it
+            struct stat dst;
+            if (st.st_uid == geteuid()) {
+                if (stat (i2c_dev, &dst) == 0 && st.st_gid != dst.st_gid)
+                    (void) fchown (fd, (uid_t)-1, dst.st_gid);
+                (void) fchmod (fd, 0660);
+            }
+
+            // start afresh if new or from a different build
+            if (st.st_size != sizeof(I2CShared)
+                        && (ftruncate (fd, 0) < 0 || ftruncate (fd, sizeof(I2CShared)) < 0)) {
+                sprintf (ynot, "I2C: %s: %s", I2C_SHARED, strerror(errno));
+                close (fd);
+                return (-1);
+            }
+        } else if (st.st_size != sizeof(I2CShared)) {
+            sprintf (ynot, "I2C: %s is in use by a different build", I2C_SHARED);
+            close (fd);
+            return (-1);
+        }
+
+        I2CShared *sp = (I2CShared *) mmap (NULL, sizeof(I2CShared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (sp == MAP_FAILED) {
+            sprintf (ynot, "I2C: %s: mmap: %s", I2C_SHARED, strerror(errno));
+            close (fd);
+            return (-1);
+        }
+
+        if (sp->magic != I2C_SHARED_MAGIC || sp->size != sizeof(I2CShared)) {
+            if (!alone) {
+                sprintf (ynot, "I2C: %s is in use by a different build", I2C_SHARED);
+                munmap (sp, sizeof(I2CShared));
+                close (fd);
+                return (-1);
+            }
+
+            // first user, the mutex survives any process dying while holding it and passes on its priority
+            pthread_mutexattr_t ma;
+            pthread_mutexattr_init (&ma);
+            pthread_mutexattr_setpshared (&ma, PTHREAD_PROCESS_SHARED);
+            pthread_mutexattr_setrobust (&ma, PTHREAD_MUTEX_ROBUST);
+            pthread_mutexattr_setprotocol (&ma, PTHREAD_PRIO_INHERIT);
+            memset (sp, 0, sizeof(*sp));
+            pthread_mutex_init (&sp->bus, &ma);
+            pthread_mutexattr_destroy (&ma);
+            sp->size = sizeof(I2CShared);
+            sp->magic = I2C_SHARED_MAGIC;
             if (verbose)
-                fprintf (stderr, "I2C: %s (0x%02X) ok\n", __func__, bus_addr);
-            return (0);
+                fprintf (stderr, "I2C: %s(): %s created\n", __func__, I2C_SHARED);
+        }
+
+        // now a user like any other, fd stays open for the life of the process to hold the shared lock
+        if (alone)
+            flock (fd, LOCK_SH);
+
+        i2c_shared = sp;
+        return (0);
+}
+
+/* wait for our turn to use the bus.
+ * return 0 when it is ours, else -1 with brief excuse in ynot
+ */
+static int piI2CLock (char ynot[])
+{
+        I2CShared *sp = i2c_shared;
+        int urgent = i2c_urgent;
+        int wait_ms = urgent ? I2C_URGENT_WAIT_MS : I2C_WAIT_MS;
+        struct timespec t0;
+        clock_gettime (CLOCK_MONOTONIC, &t0);
+
+        // urgent goes first, others hold off unless the urgent process is gone
+        int waited = 0;
+        pid_t up = sp->urgent;
+        if (urgent) {
+            sp->urgent = getpid();
+        } else if (up != 0 && kill (up, 0) < 0 && errno == ESRCH) {
+            sp->urgent = 0;
+        } else {
+            while (sp->urgent != 0 && secsSince (&t0) < wait_ms*1e-3) {
+                waited = 1;
+                usleep (I2C_DEFER_US);
+            }
+        }
+
+        // then wait for the transaction in progress, if any, for whatever remains of wait_ms. the deadline is
+        // on the monotonic clock because the wall clock may be stepped by NTP, as at boot on a Pi without RTC;
+        // kernels without FUTEX_LOCK_PI2 only time priority inheriting mutexes by the wall clock.
+        pid_t holder = sp->holder;
+        int err = pthread_mutex_trylock (&sp->bus);
+        if (err == EBUSY) {
+            long left_ns = wait_ms*1000000L - (long)(secsSince (&t0)*1e9);
+            struct timespec deadline;
+            clockid_t clock = CLOCK_MONOTONIC;
+            for (int i = 0; i < 2; i++) {
+                clock_gettime (clock, &deadline);
+                if (left_ns > 0) {
+                    long ns = deadline.tv_nsec + left_ns;
+                    deadline.tv_sec += ns / 1000000000L;
+                    deadline.tv_nsec = ns % 1000000000L;
+                }
+                err = pthread_mutex_clocklock (&sp->bus, clock, &deadline);
+                if (err != EINVAL || clock == CLOCK_REALTIME)
+                    break;
+                clock = CLOCK_REALTIME;
+            }
+            waited = 1;
+        }
+        if (urgent)
+            sp->urgent = 0;
+
+        PiI2CStats *stp = &sp->stats[urgent];
+        if (err == EOWNERDEAD) {
+            // holder died, presumably part way through a transaction, but the bus itself is usable
+            pthread_mutex_consistent (&sp->bus);
+            stp->n_recovered++;
+            err = 0;
         }
+        if (err != 0) {
+            __atomic_add_fetch (&stp->n_timeouts, 1, __ATOMIC_RELAXED);
+            if (err == ETIMEDOUT)
+                sprintf (ynot, "I2C: bus held by pid %d for more than %d ms", (int)sp->holder, wait_ms);
+            else
+                sprintf (ynot, "I2C: %s(): %s", __func__, strerror(err));
+            return (-1);
+        }
+
+        // ours
+        sp->holder = getpid();
+        clock_gettime (CLOCK_MONOTONIC, &i2c_t0);
+        stp->n_xfers++;
+        if (waited) {
+            double wait = secsSince (&t0);
+            stp->n_waits++;
+            stp->wait_total += wait;
+            if (wait > stp->wait_max) {
+                stp->wait_max = wait;
+                stp->wait_max_pid = holder;
+            }
+        }
+
+        return (0);
+}
+
+/* let others use the bus after piI2CLock()
+ */
+static void piI2CUnlock (void)
+{
+        I2CShared *sp = i2c_shared;
+        PiI2CStats *stp = &sp->stats[i2c_urgent];
+
+        double hold = secsSince (&i2c_t0);
+        if (hold > stp->hold_max) {
+            stp->hold_max = hold;
+            stp->hold_max_pid = getpid();
+        }
+
+        sp->holder = 0;
+        pthread_mutex_unlock (&sp->bus);
+}
+
+/* perform one transaction with the device at the given bus address: write nw bytes then, if nr > 0, read nr
+ * bytes after a repeated start. fn and dev_reg are only for any excuse.
+ * return 0 if ok else -1 with brief excuse in ynot
+ */
+static int piI2CXfer (const char *fn, uint8_t bus_addr, uint8_t dev_reg, uint8_t w[], int nw, uint8_t r[],
+int nr, char ynot[])
+{
+        if (i2c_fd < 0) {
+            sprintf (ynot, "%s (0x%02x, 0x%02x): I2C is not open", fn, bus_addr, dev_reg);
+            return (-1);
+        }
+
+        struct i2c_msg msgs[2];
+        int n_msgs = 0;
+        msgs[n_msgs].addr = bus_addr;
+        msgs[n_msgs].flags = 0;
+        msgs[n_msgs].len = nw;
+        msgs[n_msgs++].buf = w;
+        if (nr > 0) {
+            msgs[n_msgs].addr = bus_addr;
+            msgs[n_msgs].flags = I2C_M_RD;
+            msgs[n_msgs].len = nr;
+            msgs[n_msgs++].buf = r;
+        }
+        struct i2c_rdwr_ioctl_data rdwr;
+        rdwr.msgs = msgs;
+        rdwr.nmsgs = n_msgs;
+
+        if (piI2CLock (ynot) < 0)
+            return (-1);
+        int ok = ioctl (i2c_fd, I2C_RDWR, &rdwr) == n_msgs;
+        int e = errno;
+        piI2CUnlock();
+
+        if (!ok) {
+            sprintf (ynot, "%s (0x%02x, 0x%02x): %s\n", fn, bus_addr, dev_reg, strerror(e));
+            return (-1);
+        }
+
+        return (0);
 }
 
 /* initialize.
@@ -66,14 +317,17 @@ static int piI2CSetBusAddr (uint8_t bus_addr, char ynot[])
  */
 int piI2CInit (char ynot[])
 {
+        // join the other users of the bus
+        if (!i2c_shared && piI2CMapShared (ynot) < 0)
+            return (-1);
+
         // open the I2C driver
-	static const char filename[] = "/dev/i2c-1";
         if (i2c_fd < 0) {
-            i2c_fd = open(filename, O_RDWR);
+            i2c_fd = open(i2c_dev, O_RDWR | O_CLOEXEC);
             if (i2c_fd < 0) {
-                sprintf (ynot, "I2C: %s(): %s: %s", __func__, filename, strerror(errno));
+                sprintf (ynot, "I2C: %s(): %s: %s", __func__, i2c_dev, strerror(errno));
             } else if (verbose) {
-                fprintf (stderr, "I2C: %s(): %s open ok\n", __func__, filename);
+                fprintf (stderr, "I2C: %s(): %s open ok\n", __func__, i2c_dev);
             }
         }
 
@@ -81,22 +335,40 @@ int piI2CInit (char ynot[])
         return (i2c_fd >= 0 ? 0 : -1);
 }
 
+/* give this process priority for the bus over all others not so marked, or not if urgent is 0.
+ */
+void piI2CSetUrgent (int urgent)
+{
+        i2c_urgent = urgent != 0;
+}
+
+/* fill in the bus use by the urgent process and by all others since the bus was first shared.
+ * return 0 if ok else -1 if piI2CInit() has not succeeded.
+ */
+int piI2CGetStats (PiI2CStats *urgent, PiI2CStats *others)
+{
+        if (!i2c_shared) {
+            memset (urgent, 0, sizeof(*urgent));
+            memset (others, 0, sizeof(*others));
+            return (-1);
+        }
+
+        // no need to lock for a snapshot
+        *urgent = i2c_shared->stats[1];
+        *others = i2c_shared->stats[0];
+        return (0);
+}
+
 /* read a 16 bit word from the given device register at the given bus address.
  * return 0 if ok else -1 with brief excuse in ynot
  */
 int piI2CRead16 (uint8_t bus_addr, uint8_t dev_reg, uint16_t *data, char ynot[])
 {
-        // set bus address
-        if (piI2CSetBusAddr (bus_addr, ynot) < 0)
-            return (-1);
-
         // send the register then read two bytes
         uint8_t r8 = dev_reg;
         uint8_t b8[2];
-        if (write (i2c_fd, &r8, 1) != 1 || read (i2c_fd, b8, 2) != 2) {
-            sprintf (ynot, "%s (0x%02x, 0x%02x): %s\n", __func__, bus_addr, dev_reg, strerror(errno));
+        if (piI2CXfer (__func__, bus_addr, dev_reg, &r8, 1, b8, 2, ynot) < 0)
             return (-1);
-        }
 
         // combine bytes into word, big endian
         *data = (b8[0] << 8) | b8[1];
@@ -114,19 +386,33 @@ int piI2CRead16 (uint8_t bus_addr, uint8_t dev_reg, uint16_t *data, char ynot[])
  */
 int piI2CWrite16 (uint8_t bus_addr, uint8_t dev_reg, uint16_t data, char ynot[])
 {
-        // set bus address
-        if (piI2CSetBusAddr (bus_addr, ynot) < 0)
-            return (-1);
-
         // send the register then two bytes of data
         uint8_t rd[3];
         rd[0] = dev_reg;
         rd[1] = (data >> 8) & 0xff;
         rd[2] = data & 0xff;
-        if (write (i2c_fd, rd, 3) != 3) {
-            sprintf (ynot, "%s (0x%02x, 0x%02x): %s\n", __func__, bus_addr, dev_reg, strerror(errno));
+        if (piI2CXfer (__func__, bus_addr, dev_reg, rd, 3, NULL, 0, ynot) < 0)
+            return (-1);
+
+        if (verbose)
+            fprintf (stderr, "I2C: %s (0x%02x, 0x%02x): %u 0x%02x\n", __func__, bus_addr, dev_reg,
+                                                                                data, data);
+
+        // ok
+        return (0);
+}
+
+/* write an 8 bit byte to the given device register at the given bus address.
+ * return 0 if ok else -1 with brief excuse in ynot
+ */
+int piI2CWrite8 (uint8_t bus_addr, uint8_t dev_reg, uint8_t data, char ynot[])
+{
+        // send the register then one byte of data
+        uint8_t rd[2];
+        rd[0] = dev_reg;
+        rd[1] = data;
+        if (piI2CXfer (__func__, bus_addr, dev_reg, rd, 2, NULL, 0, ynot) < 0)
             return (-1);
-        }
 
         if (verbose)
             fprintf (stderr, "I2C: %s (0x%02x, 0x%02x): %u 0x%02x\n", __func__, bus_addr, dev_reg,
@@ -136,6 +422,23 @@ int piI2CWrite16 (uint8_t bus_addr, uint8_t dev_reg, uint16_t data, char ynot[])
         return (0);
 }
 
+/* read n bytes starting at the given device register at the given bus address, in one transfer.
+ * return 0 if ok else -1 with brief excuse in ynot
+ */
+int piI2CReadBytes (uint8_t bus_addr, uint8_t dev_reg, uint8_t data[], int n, char ynot[])
+{
+        // send the register then read n bytes
+        uint8_t r8 = dev_reg;
+        if (piI2CXfer (__func__, bus_addr, dev_reg, &r8, 1, data, n, ynot) < 0)
+            return (-1);
+
+        if (verbose)
+            fprintf (stderr, "I2C: %s (0x%02x, 0x%02x): %d bytes\n", __func__, bus_addr, dev_reg, n);
+
+        // ok
+        return (0);
+}
+
 /* insure i2c handle is closed
  */
 void piI2CClose()
@@ -178,6 +481,35 @@ int piI2CWrite16 (uint8_t bus_addr, uint8_t dev_reg, uint16_t data, char ynot[])
     strcpy (ynot, "piI2C only on RPi");
     return (-1);
 }
+int piI2CWrite8 (uint8_t bus_addr, uint8_t dev_reg, uint8_t data, char ynot[])
+{
+    (void) bus_addr;
+    (void) dev_reg;
+    (void) data;
+
+    strcpy (ynot, "piI2C only on RPi");
+    return (-1);
+}
+int piI2CReadBytes (uint8_t bus_addr, uint8_t dev_reg, uint8_t data[], int n, char ynot[])
+{
+    (void) bus_addr;
+    (void) dev_reg;
+    (void) data;
+    (void) n;
+
+    strcpy (ynot, "piI2C only on RPi");
+    return (-1);
+}
+void piI2CSetUrgent (int urgent)
+{
+    (void) urgent;
+}
+int piI2CGetStats (PiI2CStats *urgent, PiI2CStats *others)
+{
+    memset (urgent, 0, sizeof(*urgent));
+    memset (others, 0, sizeof(*others));
+    return (-1);
+}
 void piI2CClose (void)
 {
 }
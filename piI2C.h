@@ -3,9 +3,31 @@
 
 #include <stdint.h>
 
+// longest wait for the bus by the urgent process and by all others, and how often others check while deferring
+#define I2C_URGENT_WAIT_MS      20
+#define I2C_WAIT_MS             1000
+#define I2C_DEFER_US            100
+
+// use of the bus by one class of process, see piI2CGetStats()
+typedef struct {
+    uint32_t n_xfers;                   // transactions
+    uint32_t n_waits;                   // transactions that first had to wait for the bus
+    uint32_t n_timeouts;                // times the bus was not free within the wait limit
+    uint32_t n_recovered;               // times the bus was taken from a process that died holding it
+    double wait_total;                  // secs spent waiting
+    float wait_max;                     // longest wait, secs
+    int32_t wait_max_pid;               // process holding the bus when the longest wait began, else 0
+    float hold_max;                     // longest transaction, secs
+    int32_t hold_max_pid;               // process that made it
+} PiI2CStats;
+
 extern int piI2CInit (char ynot[]);
 extern int piI2CRead16 (uint8_t bus_addr, uint8_t dev_reg, uint16_t *data, char ynot[]);
 extern int piI2CWrite16 (uint8_t bus_addr, uint8_t dev_reg, uint16_t data, char ynot[]);
+extern int piI2CWrite8 (uint8_t bus_addr, uint8_t dev_reg, uint8_t data, char ynot[]);
+extern int piI2CReadBytes (uint8_t bus_addr, uint8_t dev_reg, uint8_t data[], int n, char ynot[]);
+extern void piI2CSetUrgent (int urgent);
+extern int piI2CGetStats (PiI2CStats *urgent, PiI2CStats *others);
 extern void piI2CClose (void);
 
 
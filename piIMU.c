@@ -0,0 +1,237 @@
+/* read an InvenSense MPU-6050 class accelerometer and gyro over I2C.
+ *
+ * MPU-6050 register map: https://invensense.tdk.com/wp-content/uploads/2015/02/MPU-6000-Register-Map1.pdf
+ *
+ * A sensor is named by a spec of its type, optional bus address and the letter of the sensor axis about
+ * which it turns, such as "mpu6050" or "mpu6050,0x69,x". The address is 0x68, or 0x69 with AD0 high. The
+ * axis defaults to y. The angle of the sensor about that axis is the direction of gravity in the plane of
+ * the other two, which is all that is needed for the elevation of a boom.
+ *
+ * #define _UNIT_TEST_MAIN to make a stand-alone test program, build and run as follows:
+ *
+ *   gcc -Wall -O2 -D_UNIT_TEST_MAIN piIMU.c piI2C.c -o piIMU -lm -lpthread
+ *   ./piIMU mpu6050,0x68,y         # report angle, rate, read rate and noise, -h for options
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "piI2C.h"
+#include "piIMU.h"
+
+
+// MPU-6050 registers and settings
+#define MPU_ADDR                0x68
+#define MPU_REG_SMPLRT_DIV      0x19
+#define MPU_REG_CONFIG          0x1A
+#define MPU_REG_GYRO_CONFIG     0x1B
+#define MPU_REG_ACCEL_CONFIG    0x1C
+#define MPU_REG_ACCEL_XOUT_H    0x3B    // accel x y z, temperature, gyro x y z, each 16 bits big endian
+#define MPU_REG_PWR_MGMT_1      0x6B
+#define MPU_REG_WHO_AM_I        0x75
+#define MPU_CLOCK_PLL_X         0x01    // PWR_MGMT_1: wake, clocked from the x gyro
+#define MPU_DLPF_44HZ           0x03    // CONFIG: accel and gyro low pass filter
+#define MPU_ACCEL_PER_G         16384.0 // LSB per g at +-2 g full scale
+#define MPU_GYRO_PER_DPS        131.0   // LSB per deg/sec at +-250 deg/sec full scale
+
+
+/* parse spec as described above.
+ * return 0 if ok with type, address and axis, else -1
+ */
+int imuParse (const char *spec, IMUType *typep, uint8_t *addrp, char *axisp)
+{
+        char name[16], axis = 'y';
+        unsigned addr = MPU_ADDR;
+        int n = sscanf (spec, " %15[^, ] , %i , %c", name, &addr, &axis);
+        if (n < 1)
+            return (-1);
+
+        if (strcmp (name, "none") == 0 && n == 1) {
+            *typep = IMU_NONE;
+            *addrp = 0;
+            *axisp = 'y';
+        } else if (strcmp (name, "mpu6050") == 0 && (addr == MPU_ADDR || addr == MPU_ADDR+1)
+                                && (axis == 'x' || axis == 'y' || axis == 'z')) {
+            *typep = IMU_MPU6050;
+            *addrp = addr;
+            *axisp = axis;
+        } else
+            return (-1);
+
+        return (0);
+}
+
+/* format the spec of the given sensor into spec[], which must be at least 20 chars
+ */
+void imuFormat (IMUType type, uint8_t addr, char axis, char spec[])
+{
+        switch (type) {
+        case IMU_NONE:    strcpy (spec, "none"); break;
+        case IMU_MPU6050: sprintf (spec, "mpu6050,0x%02x,%c", addr, axis); break;
+        }
+}
+
+/* identify the given sensor, wake it and set its ranges and filter.
+ * we use piI2C and assume piI2CInit() has already been called.
+ * return 0 if ok, else -1 with brief excuse in ynot[]
+ */
+int imuInit (IMUType type, uint8_t addr, char ynot[])
+{
+        uint8_t who;
+
+        switch (type) {
+
+        case IMU_NONE:
+            strcpy (ynot, "no IMU");
+            return (-1);
+
+        case IMU_MPU6050:
+            if (piI2CReadBytes (addr, MPU_REG_WHO_AM_I, &who, 1, ynot) < 0)
+                return (-1);
+            if (who != 0x68 && who != 0x70 && who != 0x71 && who != 0x73) {
+                sprintf (ynot, "MPU6050 0x%02x: unknown WHO_AM_I 0x%02x", addr, who);
+                return (-1);
+            }
+            if (piI2CWrite8 (addr, MPU_REG_PWR_MGMT_1, MPU_CLOCK_PLL_X, ynot) < 0
+                        || piI2CWrite8 (addr, MPU_REG_CONFIG, MPU_DLPF_44HZ, ynot) < 0
+                        || piI2CWrite8 (addr, MPU_REG_SMPLRT_DIV, 0, ynot) < 0
+                        || piI2CWrite8 (addr, MPU_REG_GYRO_CONFIG, 0, ynot) < 0
+                        || piI2CWrite8 (addr, MPU_REG_ACCEL_CONFIG, 0, ynot) < 0)
+                return (-1);
+            return (0);
+        }
+
+        strcpy (ynot, "unknown IMU");
+        return (-1);
+}
+
+/* read acceleration in g and rotation rates in deg/sec about each sensor axis, all in one transfer.
+ * return 0 if ok, else -1 with brief excuse in ynot[]
+ */
+int imuRead (IMUType type, uint8_t addr, float accel[3], float gyro[3], char ynot[])
+{
+        uint8_t b[14];
+
+        switch (type) {
+
+        case IMU_NONE:
+            strcpy (ynot, "no IMU");
+            return (-1);
+
+        case IMU_MPU6050:
+            if (piI2CReadBytes (addr, MPU_REG_ACCEL_XOUT_H, b, sizeof(b), ynot) < 0)
+                return (-1);
+            for (int i = 0; i < 3; i++) {
+                accel[i] = (int16_t)((b[2*i] << 8) | b[2*i+1]) / MPU_ACCEL_PER_G;
+                gyro[i] = (int16_t)((b[8+2*i] << 8) | b[8+2*i+1]) / MPU_GYRO_PER_DPS;
+            }
+            return (0);
+        }
+
+        strcpy (ynot, "unknown IMU");
+        return (-1);
+}
+
+
+
+#if defined(_UNIT_TEST_MAIN)
+
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+
+/* the test program reads the given sensor repeatedly and prints the angle about its axis and the rate if -v,
+ * then the read rate, the time per read, the mean of each and their noise, which is only meaningful if the
+ * sensor is at rest.
+ */
+
+static char *me;
+
+static double nowSecs (void)
+{
+        struct timespec ts;
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+        return (ts.tv_sec + ts.tv_nsec*1e-9);
+}
+
+static void usage (void)
+{
+        fprintf (stderr, "Purpose: test an MPU-6050 accelerometer and gyro\n");
+        fprintf (stderr, "Usage: %s [options] mpu6050[,0x68|0x69[,x|y|z]]\n", me);
+        fprintf (stderr, "  -n n    : number of reads; default 1000\n");
+        fprintf (stderr, "  -p us   : period between reads; default 1000\n");
+        fprintf (stderr, "  -v      : print each angle and rate\n");
+        exit(1);
+}
+
+int main (int ac, char *av[])
+{
+        int n_reads = 1000, period = 1000, verbose = 0;
+        int opt;
+
+        me = av[0];
+        while ((opt = getopt (ac, av, "n:p:v")) != -1) {
+            switch (opt) {
+            case 'n': n_reads = atoi (optarg); break;
+            case 'p': period = atoi (optarg); break;
+            case 'v': verbose = 1; break;
+            default: usage(); break;
+            }
+        }
+        IMUType type;
+        uint8_t addr;
+        char axis;
+        if (optind != ac - 1 || imuParse (av[optind], &type, &addr, &axis) < 0 || type == IMU_NONE
+                                || n_reads < 1)
+            usage();
+
+        char ynot[1024];
+        if (piI2CInit (ynot) < 0 || imuInit (type, addr, ynot) < 0) {
+            fprintf (stderr, "%s: %s\n", me, ynot);
+            exit(1);
+        }
+
+        // the plane of the other two axes
+        int a = axis - 'x';
+        int i1 = (a + 1) % 3, i2 = (a + 2) % 3;
+
+        double sum_a = 0, sum2_a = 0, sum_r = 0, sum2_r = 0, busy = 0;
+        int n_ok = 0, n_err = 0;
+        double t0 = nowSecs();
+        for (int i = 0; i < n_reads; i++) {
+            float acc[3], gyro[3];
+            double t = nowSecs();
+            if (imuRead (type, addr, acc, gyro, ynot) < 0) {
+                if (n_err++ == 0 || verbose)
+                    fprintf (stderr, "%s\n", ynot);
+            } else {
+                double ang = atan2 (acc[i1], acc[i2]) * 180 / M_PI;
+                sum_a += ang;
+                sum2_a += ang*ang;
+                sum_r += gyro[a];
+                sum2_r += gyro[a]*gyro[a];
+                n_ok++;
+                if (verbose)
+                    printf ("%9.3f %9.3f %7.4f\n", ang, gyro[a], sqrt(acc[0]*acc[0]+acc[1]*acc[1]+acc[2]*acc[2]));
+            }
+            busy += nowSecs() - t;
+            if (period > 0)
+                usleep (period);
+        }
+        double dt = nowSecs() - t0;
+
+        char spec[20];
+        imuFormat (type, addr, axis, spec);
+        printf ("%s: %d reads in %.3f secs, %.0f/sec, %.1f us per read, %d failed\n", spec, n_reads, dt,
+                                n_reads/dt, 1e6*busy/n_reads, n_err);
+        if (n_ok > 0) {
+            double ma = sum_a/n_ok, mr = sum_r/n_ok;
+            printf ("angle mean %.3f rms noise %.4f degs, rate mean %.4f rms noise %.4f degs/sec\n", ma,
+                                sqrt (fmax (0, sum2_a/n_ok - ma*ma)), mr, sqrt (fmax (0, sum2_r/n_ok - mr*mr)));
+        }
+
+        return (n_err == n_reads);
+}
+
+#endif // _UNIT_TEST_MAIN
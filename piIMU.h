@@ -0,0 +1,17 @@
+#ifndef _PI_IMU_H
+#define _PI_IMU_H
+
+#include <stdint.h>
+
+// supported inertial sensors
+typedef enum {
+    IMU_NONE,                           // not fitted
+    IMU_MPU6050,                        // InvenSense MPU-6050 or register compatible MPU-6500/9250
+} IMUType;
+
+extern int imuParse (const char *spec, IMUType *typep, uint8_t *addrp, char *axisp);
+extern void imuFormat (IMUType type, uint8_t addr, char axis, char spec[]);
+extern int imuInit (IMUType type, uint8_t addr, char ynot[]);
+extern int imuRead (IMUType type, uint8_t addr, float accel[3], float gyro[3], char ynot[]);
+
+#endif // _PI_IMU_H
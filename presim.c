@@ -0,0 +1,168 @@
+/* predict whether the mount can keep up with a pass before committing to it.
+ *
+ * The pass is either a track file as run by the schedule, lines of "secs az el" after the start time, or the
+ * NORAD two line elements of a satellite, see satellite.c. A file is taken as elements if it holds any. The
+ * controller is run against a model of the mount from its start time to its end time, see
+ * g5500_direct_presim(), which takes a fraction of a second for a whole pass and leaves live control alone.
+ * A track file is stepped through its points as the schedule would goto each; a satellite is tracked as
+ * the control thread follows any moving target, starting from its first position above the horizon.
+ *
+ * Web command:
+ *
+ *    check_pass?file=path[&sat=name]&t=time[&end=time][&mask=degs][&tol=degs]
+ *
+ * The file must be a plain file in the schedule's track directory and may be named relative to it, see
+ * schedTrackPath(). t and end are as for the schedule, either ISO 8601 UTC or unix seconds. end defaults to the last point of a
+ * track file and is required for a satellite. sat picks a satellite by name or catalog number from a file of
+ * several, else the first is used. The mount is on target within tol degs, default PRESIM_TOL. Pointing errors
+ * are counted from first acquiring the target while it is at least mask degs above the horizon, default 0,
+ * and the pass is completed if it stays on target throughout. The reply is JSON.
+ *
+ * A pre-simulation is refused when the control loop runs in the main thread, see -R in g5500_sa.c, because
+ * the ticks would stop while it ran.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "g5500_sa.h"
+#include "schedule.h"
+#include "satellite.h"
+#include "presim.h"
+
+
+// a track file being stepped through
+typedef struct {
+    double t0;                                  // unix time of the start
+    SchedTrackPoint *points;                    // malloced
+    int n_points;
+} Steps;
+
+
+/* G5500TrackFunc giving the latest point of the Steps at arg at unix time t, failing before the first
+ */
+static int stepFunc (double t, float *az, float *el, void *arg)
+{
+        Steps *sp = (Steps *) arg;
+
+        int i;
+        for (i = 0; i < sp->n_points && sp->t0 + sp->points[i].dt <= t; i++)
+            continue;
+        if (i == 0)
+            return (-1);
+        *az = sp->points[i-1].az;
+        *el = sp->points[i-1].el;
+        return (0);
+}
+
+/* pre-simulate the pass in file, or satellite sat within it, from t0 to t1, or to the end of the track file if
+ * t1 is 0, gathering pointing errors above mask degs within tol degs.
+ * return RIG_OK with results in *rp and the name of the satellite or file in name[], else a negative RIG_*
+ * error code with brief excuse in ynot[].
+ */
+int presimRun (const char *file, const char *sat, double t0, double t1, float mask, float tol, G5500Presim *rp,
+char name[], size_t name_len, char ynot[])
+{
+        SatOrbit orbit;
+        SatTrack track;
+        Steps steps;
+        int err;
+
+        if (mask < 0 || mask >= 90 || tol <= 0) {
+            sprintf (ynot, "mask must be 0 .. 90 and tol more than 0 degs");
+            return (-RIG_EINVAL);
+        }
+        if (g5500_direct_reactor_fd() >= 0) {
+            sprintf (ynot, "not available while the control loop runs in the main thread (-R)");
+            return (-RIG_ENAVAIL);
+        }
+
+        // only a plain file in the track directory, a device or fifo would stall the main loop
+        char path[PATH_MAX];
+        if (schedTrackPath (file, path, sizeof(path), ynot) < 0)
+            return (-RIG_EINVAL);
+        file = path;
+
+        if (satReadTLE (file, sat, &orbit, ynot) == 0) {
+
+            if (t1 <= t0) {
+                sprintf (ynot, "a satellite requires an end time after its start");
+                return (-RIG_EINVAL);
+            }
+            if (satTrackInit (&track, &orbit, ynot) < 0)
+                return (-RIG_ECONF);
+            snprintf (name, name_len, "%s", orbit.name);
+            err = g5500_direct_presim (satTrackFunc, &track, 0, t0, t1, mask, tol, rp);
+
+        } else if (sat && *sat) {
+
+            return (-RIG_EINVAL);
+
+        } else {
+
+            if (schedReadTrack (file, &steps.points, &steps.n_points, ynot) < 0)
+                return (-RIG_EINVAL);
+            steps.t0 = t0;
+            if (t1 <= 0)
+                t1 = t0 + steps.points[steps.n_points-1].dt;
+            snprintf (name, name_len, "%s", file);
+            err = g5500_direct_presim (stepFunc, &steps, 1, t0, t1, mask, tol, rp);
+            free (steps.points);
+        }
+
+        if (err == -RIG_EINVAL)
+            sprintf (ynot, "end must be after t and within 2 hours of it");
+        else if (err != RIG_OK)
+            sprintf (ynot, "mount must be calibrated, code %d", err);
+        return (err);
+}
+
+/* perform the check_pass web command, cmd is the full command including any query.
+ */
+void presimWebCommand (FILE *fp, char *cmd)
+{
+        char *query = strchr (cmd, '?');
+        char file[200], sat[30], val[40], name[200], ynot[300];
+        double t0, t1 = 0;
+        float mask = 0, tol = PRESIM_TOL;
+
+        if (query)
+            *query++ = '\0';
+
+        if (queryArg (query, "file", file, sizeof(file)) < 0 || queryArg (query, "t", val, sizeof(val)) < 0
+                                || schedParseTime (val, &t0) < 0) {
+            fprintf (fp, "{\"err\":\"check_pass requires file and t\"}\n");
+            return;
+        }
+        if (queryArg (query, "end", val, sizeof(val)) == 0 && schedParseTime (val, &t1) < 0) {
+            fprintf (fp, "{\"err\":\"bad end time\"}\n");
+            return;
+        }
+        if (queryArg (query, "sat", sat, sizeof(sat)) < 0)
+            sat[0] = '\0';
+        if (queryArg (query, "mask", val, sizeof(val)) == 0)
+            mask = atof (val);
+        if (queryArg (query, "tol", val, sizeof(val)) == 0)
+            tol = atof (val);
+
+        G5500Presim r;
+        if (presimRun (file, sat, t0, t1, mask, tol, &r, name, sizeof(name), ynot) != RIG_OK) {
+            fprintf (fp, "{\"err\":");
+            putJSONString (fp, ynot);
+            fprintf (fp, "}\n");
+            return;
+        }
+
+        fprintf (fp, "{\"name\":");
+        putJSONString (fp, name);
+        fprintf (fp, ",\"completed\":%d,\"tracked\":%.1f,\"acquire\":%.1f,", r.completed, r.tracked, r.acquire);
+        fprintf (fp, "\"rms_err\":%.2f,\"max_err\":%.2f,\"on_target\":%.1f,\"lost\":%.1f,\"masked\":%.1f,",
+                                r.rms_err, r.max_err, r.on_target, r.lost, r.masked);
+        fprintf (fp, "\"unwinds\":%d,\"unwind_secs\":%.1f,\"max_el\":%.1f,", r.unwinds, r.unwind_secs, r.max_el);
+        fprintf (fp, "\"peak_az_rate\":%.2f,\"peak_el_rate\":%.2f,\"az_speed\":%.2f,\"el_speed\":%.2f,"
+                     "\"keyhole\":%.1f,", r.peak_az_rate, r.peak_el_rate, r.az_speed, r.el_speed, r.keyhole);
+        fprintf (fp, "\"starts\":%d,\"cooldowns\":%d,\"az_heat\":%.3f,\"el_heat\":%.3f,\"wall\":%.3f}\n",
+                                r.starts, r.cooldowns, r.az_heat, r.el_heat, r.wall);
+}
@@ -0,0 +1,14 @@
+#ifndef _PRESIM_H
+#define _PRESIM_H
+
+#include <stdio.h>
+
+#include "g5500_sa.h"
+
+#define PRESIM_TOL      5.0                     // default pointing tolerance, degs
+
+extern int presimRun (const char *file, const char *sat, double t0, double t1, float mask, float tol,
+        G5500Presim *rp, char name[], size_t name_len, char ynot[]);
+extern void presimWebCommand (FILE *fp, char *cmd);
+
+#endif // _PRESIM_H
@@ -0,0 +1,630 @@
+/* find where an earth satellite is from its NORAD two line elements, using SGP4.
+ *
+ * Elements are read from a file of the usual three line sets, a name line followed by lines 1 and 2, as
+ * published by CelesTrak or Space-Track; a file of bare two line sets also works. A set is chosen by name,
+ * without regard to case and matching whole leading words so "ISS" finds "ISS (ZARYA)", or by catalog
+ * number, else the first is used.
+ *
+ * SGP4 follows Vallado et al, "Revisiting Spacetrack Report #3", AIAA 2006-6753, with the WGS-72 constants
+ * the elements are fitted with. Only near earth orbits are supported, ie, periods under 225 minutes, which
+ * includes everything a G5500 can follow; deep space orbits would need SDP4 and are refused. Positions are
+ * in the TEME frame, which is rotated to the earth by mean sidereal time alone; polar motion and the
+ * equation of the equinoxes are ignored, each well under an arcsecond seen from the ground. Elements are
+ * typically good to a kilometer or two within a few days of their epoch, far finer than the mount can point.
+ *
+ * A whole catalog may be propagated at once with satBatchLook(), which keeps each orbital constant in its own
+ * array and steps SAT_BLOCK satellites through each stage of SGP4 together; satPosition() runs the same code
+ * on a batch of one.
+ *
+ * The station location is that of celestial.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+
+#include "g5500_sa.h"
+#include "celestial.h"
+#include "satellite.h"
+
+
+// handy conversions
+#define PI              3.14159265358979323846
+#define D2R             (PI/180)
+
+
+// WGS-72 constants used by SGP4
+#define RE_KM           6378.135                // earth equatorial radius, km
+#define XKE             0.0743669161331734132   // sqrt(GM) in earth radii^1.5 per minute
+#define J2              0.001082616
+#define J3              (-0.00000253881)
+#define J4              (-0.00000165597)
+#define J3OJ2           (J3/J2)
+#define X2O3            (2.0/3.0)
+
+
+// WGS-84 ellipsoid for the station
+#define WGS84_A         6378.137                // km
+#define WGS84_F         (1/298.257223563)
+
+
+#define DEEP_SPACE_MINS 225                     // orbital period beyond which SDP4 is required
+
+
+// the SatOrbit members used by sgp4Block(), each an array of SatBatch
+#define BATCH_MEMBERS(M) M(epoch) M(ecco) M(inclo) M(nodeo) M(argpo) M(mo) M(no) M(ao) M(bstar) \
+        M(aycof) M(con41) M(cc1) M(cc4) M(cc5) M(d2) M(d3) M(d4) M(delmo) M(eta) M(argpdot) M(omgcof) M(sinmao) \
+        M(t2cof) M(t3cof) M(t4cof) M(t5cof) M(x1mth2) M(x7thm1) M(mdot) M(nodedot) M(xlcof) M(xmcof) M(nodecf)
+
+
+/* return x in range [0,2PI)
+ */
+static double range2PI (double x)
+{
+        x = fmod (x, 2*PI);
+        if (x < 0)
+            x += 2*PI;
+        return (x);
+}
+
+/* return the unix time of 0h UTC on Jan 1 of the given year
+ */
+static double yearStart (int year)
+{
+        int leaps = (year - 1969)/4 - (year - 1901)/100 + (year - 1601)/400;
+        return ((365.0*(year - 1970) + leaps) * 86400);
+}
+
+/* copy len chars of line starting at col into buf as a string
+ */
+static const char *field (const char *line, int col, int len, char buf[])
+{
+        memcpy (buf, line + col, len);
+        buf[len] = '\0';
+        return (buf);
+}
+
+/* return the value of a TLE field with an implied leading decimal point and a trailing power of ten, such
+ * as " 28098-4" for 0.28098e-4
+ */
+static double impliedExp (const char *line, int col)
+{
+        char buf[12];
+        field (line, col, 8, buf);
+        int exp = atoi (buf + 6);
+        buf[6] = '\0';
+        char *mant = buf;
+        while (*mant == ' ')
+            mant++;
+        double sign = 1;
+        if (*mant == '-' || *mant == '+') {
+            sign = *mant == '-' ? -1 : 1;
+            mant++;
+        }
+        return (sign * atof (mant) / 1e5 * pow (10, exp));
+}
+
+/* return whether the checksum at column 68 of a TLE line is correct
+ */
+static int checksumOk (const char *line)
+{
+        int sum = 0;
+        for (int i = 0; i < 68; i++) {
+            if (isdigit ((unsigned char)line[i]))
+                sum += line[i] - '0';
+            else if (line[i] == '-')
+                sum++;
+        }
+        return (sum % 10 == line[68] - '0');
+}
+
+/* initialize *op from the given name, which may be NULL, and two element lines, deriving everything SGP4 needs
+ * that does not depend on time.
+ * return 0 if ok else -1 with brief excuse in ynot[]
+ */
+int satParseTLE (const char *name, const char *l1, const char *l2, SatOrbit *op, char ynot[])
+{
+        char buf[20];
+
+        if (strlen (l1) < 69 || strlen (l2) < 69 || l1[0] != '1' || l2[0] != '2') {
+            sprintf (ynot, "not a two line element set");
+            return (-1);
+        }
+        if (!checksumOk (l1) || !checksumOk (l2)) {
+            sprintf (ynot, "element set checksum is wrong");
+            return (-1);
+        }
+
+        memset (op, 0, sizeof(*op));
+        op->catnum = atoi (field (l1, 2, 5, buf));
+        if (atoi (field (l2, 2, 5, buf)) != op->catnum) {
+            sprintf (ynot, "element lines are for different satellites");
+            return (-1);
+        }
+        if (name && *name)
+            snprintf (op->name, sizeof(op->name), "%s", name);
+        else
+            snprintf (op->name, sizeof(op->name), "%05d", op->catnum);
+
+        int yy = atoi (field (l1, 18, 2, buf));
+        op->epoch = yearStart (yy < 57 ? 2000 + yy : 1900 + yy) + (atof (field (l1, 20, 12, buf)) - 1) * 86400;
+        op->bstar = impliedExp (l1, 53);
+        op->inclo = atof (field (l2, 8, 8, buf)) * D2R;
+        op->nodeo = atof (field (l2, 17, 8, buf)) * D2R;
+        op->ecco = atof (field (l2, 26, 7, buf)) / 1e7;
+        op->argpo = atof (field (l2, 34, 8, buf)) * D2R;
+        op->mo = atof (field (l2, 43, 8, buf)) * D2R;
+        double no_kozai = atof (field (l2, 52, 11, buf)) * 2*PI / 1440;
+
+        if (no_kozai <= 0 || op->ecco >= 1) {
+            sprintf (ynot, "%s: elements are not an orbit", op->name);
+            return (-1);
+        }
+
+        // recover the original mean motion and semi-major axis from the Kozai mean motion of the elements
+        double cosio = cos (op->inclo);
+        double cosio2 = cosio*cosio;
+        double eccsq = op->ecco*op->ecco;
+        double omeosq = 1 - eccsq;
+        double rteosq = sqrt (omeosq);
+        double ak = pow (XKE/no_kozai, X2O3);
+        double d1 = 0.75*J2 * (3*cosio2 - 1) / (rteosq*omeosq);
+        double del = d1/(ak*ak);
+        double adel = ak * (1 - del*del - del*(1.0/3 + 134*del*del/81));
+        del = d1/(adel*adel);
+        op->no = no_kozai/(1 + del);
+
+        if (2*PI/op->no >= DEEP_SPACE_MINS) {
+            sprintf (ynot, "%s: period of %.0f minutes needs SDP4, which is not supported", op->name,
+                                2*PI/op->no);
+            return (-1);
+        }
+
+        double ao = op->ao = pow (XKE/op->no, X2O3);
+        double sinio = sin (op->inclo);
+        double po = ao*omeosq;
+        double con42 = 1 - 5*cosio2;
+        op->con41 = -con42 - cosio2 - cosio2;
+        double posq = po*po;
+        double rp = ao*(1 - op->ecco);
+
+        // drag is modelled with a density that depends on the height of perigee
+        op->isimp = rp < 220/RE_KM + 1;
+        double sfour = 78/RE_KM + 1;
+        double qzms24 = pow ((120 - 78)/RE_KM, 4);
+        double perige = (rp - 1)*RE_KM;
+        if (perige < 156) {
+            sfour = perige < 98 ? 20 : perige - 78;
+            qzms24 = pow ((120 - sfour)/RE_KM, 4);
+            sfour = sfour/RE_KM + 1;
+        }
+        double pinvsq = 1/posq;
+        double tsi = 1/(ao - sfour);
+        op->eta = ao*op->ecco*tsi;
+        double etasq = op->eta*op->eta;
+        double eeta = op->ecco*op->eta;
+        double psisq = fabs (1 - etasq);
+        double coef = qzms24*pow (tsi, 4);
+        double coef1 = coef/pow (psisq, 3.5);
+        double cc2 = coef1*op->no * (ao*(1 + 1.5*etasq + eeta*(4 + etasq))
+                                + 0.375*J2*tsi/psisq*op->con41*(8 + 3*etasq*(8 + etasq)));
+        op->cc1 = op->bstar*cc2;
+        double cc3 = op->ecco > 1e-4 ? -2*coef*tsi*J3OJ2*op->no*sinio/op->ecco : 0;
+        op->x1mth2 = 1 - cosio2;
+        op->cc4 = 2*op->no*coef1*ao*omeosq * (op->eta*(2 + 0.5*etasq) + op->ecco*(0.5 + 2*etasq)
+                                - J2*tsi/(ao*psisq) * (-3*op->con41*(1 - 2*eeta + etasq*(1.5 - 0.5*eeta))
+                                + 0.75*op->x1mth2*(2*etasq - eeta*(1 + etasq))*cos (2*op->argpo)));
+        op->cc5 = 2*coef1*ao*omeosq * (1 + 2.75*(etasq + eeta) + eeta*etasq);
+
+        // secular rates of the mean anomaly, argument of perigee and node
+        double cosio4 = cosio2*cosio2;
+        double temp1 = 1.5*J2*pinvsq*op->no;
+        double temp2 = 0.5*temp1*J2*pinvsq;
+        double temp3 = -0.46875*J4*pinvsq*pinvsq*op->no;
+        op->mdot = op->no + 0.5*temp1*rteosq*op->con41 + 0.0625*temp2*rteosq*(13 - 78*cosio2 + 137*cosio4);
+        op->argpdot = -0.5*temp1*con42 + 0.0625*temp2*(7 - 114*cosio2 + 395*cosio4)
+                                + temp3*(3 - 36*cosio2 + 49*cosio4);
+        double xhdot1 = -temp1*cosio;
+        op->nodedot = xhdot1 + (0.5*temp2*(4 - 19*cosio2) + 2*temp3*(3 - 7*cosio2))*cosio;
+        op->omgcof = op->bstar*cc3*cos (op->argpo);
+        op->xmcof = op->ecco > 1e-4 ? -X2O3*coef*op->bstar/eeta : 0;
+        op->nodecf = 3.5*omeosq*xhdot1*op->cc1;
+        op->t2cof = 1.5*op->cc1;
+        double cpi = fabs (cosio + 1) > 1.5e-12 ? 1 + cosio : 1.5e-12;
+        op->xlcof = -0.25*J3OJ2*sinio*(3 + 5*cosio)/cpi;
+        op->aycof = -0.5*J3OJ2*sinio;
+        op->delmo = pow (1 + op->eta*cos (op->mo), 3);
+        op->sinmao = sin (op->mo);
+        op->x7thm1 = 7*cosio2 - 1;
+
+        if (op->isimp) {
+            // these drag terms are not used, zeroing them lets sgp4Block() treat every orbit alike
+            op->omgcof = op->xmcof = op->cc5 = 0;
+        } else {
+            double cc1sq = op->cc1*op->cc1;
+            op->d2 = 4*ao*tsi*cc1sq;
+            double temp = op->d2*tsi*op->cc1/3;
+            op->d3 = (17*ao + sfour)*temp;
+            op->d4 = 0.5*temp*ao*tsi*(221*ao + 31*sfour)*op->cc1;
+            op->t3cof = op->d2 + 2*cc1sq;
+            op->t4cof = 0.25*(3*op->d3 + op->cc1*(12*op->d2 + 10*cc1sq));
+            op->t5cof = 0.2*(3*op->d4 + 12*op->cc1*op->d3 + 6*op->d2*op->d2 + 15*cc1sq*(2*op->d2 + cc1sq));
+        }
+
+        return (0);
+}
+
+/* read the next set from fp into name[], l1[] and l2[], each at least 100 chars, name[] empty if none.
+ * return 1 if found, 0 at EOF
+ */
+static int nextTLE (FILE *fp, char name[], char l1[], char l2[])
+{
+        char buf[100];
+
+        l1[0] = '\0';
+        while (fgets (buf, sizeof(buf), fp)) {
+            buf[strcspn (buf, "\r\n")] = '\0';
+            if (buf[0] == '1' && buf[1] == ' ') {
+                strcpy (l1, buf);
+            } else if (buf[0] == '2' && buf[1] == ' ' && l1[0]) {
+                strcpy (l2, buf);
+                return (1);
+            } else {
+                // name line, trimmed and without any leading "0 " of the three line format
+                char *np = buf;
+                if (np[0] == '0' && np[1] == ' ')
+                    np += 2;
+                while (*np == ' ')
+                    np++;
+                size_t l = strlen (np);
+                while (l > 0 && np[l-1] == ' ')
+                    np[--l] = '\0';
+                strcpy (name, np);
+                l1[0] = '\0';
+            }
+        }
+        return (0);
+}
+
+/* read the set for the satellite with the given name or catalog number from file into *op, the first if name
+ * is NULL or empty.
+ * return 0 if ok else -1 with brief excuse in ynot[]
+ */
+int satReadTLE (const char *file, const char *name, SatOrbit *op, char ynot[])
+{
+        FILE *fp = fopen (file, "r");
+        if (!fp) {
+            sprintf (ynot, "%s: %s", file, strerror(errno));
+            return (-1);
+        }
+
+        char prev[100] = "", l1[100], l2[100];
+        int found = 0, any = 0;
+        while (!found && nextTLE (fp, prev, l1, l2)) {
+            any = 1;
+            size_t nl = name ? strlen (name) : 0;
+            if (nl == 0 || (strncasecmp (prev, name, nl) == 0 && (prev[nl] == '\0' || prev[nl] == ' '))
+                                || atoi (l1+2) == atoi (name)) {
+                if (satParseTLE (prev, l1, l2, op, ynot) < 0) {
+                    fclose (fp);
+                    return (-1);
+                }
+                found = 1;
+            }
+        }
+        fclose (fp);
+
+        if (!found) {
+            if (any)
+                sprintf (ynot, "%s: no elements for %s", file, name);
+            else
+                sprintf (ynot, "%s: no two line elements", file);
+            return (-1);
+        }
+        return (0);
+}
+
+/* read every set in file into a malloced array at *opp of *np orbits, skipping and counting in *n_skipped any
+ * that are bad or deep space.
+ * return 0 if ok else -1 with brief excuse in ynot[]
+ */
+int satReadCatalog (const char *file, SatOrbit **opp, int *np, int *n_skipped, char ynot[])
+{
+        FILE *fp = fopen (file, "r");
+        if (!fp) {
+            sprintf (ynot, "%s: %s", file, strerror(errno));
+            return (-1);
+        }
+
+        SatOrbit *orbits = NULL;
+        int n = 0, n_max = 0, n_bad = 0;
+        char name[100] = "", l1[100], l2[100], why[200];
+        while (nextTLE (fp, name, l1, l2)) {
+            if (n == n_max) {
+                n_max = n_max ? 2*n_max : 256;
+                SatOrbit *more = (SatOrbit *) realloc (orbits, n_max * sizeof(SatOrbit));
+                if (!more) {
+                    free (orbits);
+                    fclose (fp);
+                    sprintf (ynot, "%s: no memory for %d satellites", file, n_max);
+                    return (-1);
+                }
+                orbits = more;
+            }
+            if (satParseTLE (name, l1, l2, &orbits[n], why) == 0)
+                n++;
+            else
+                n_bad++;
+            name[0] = '\0';
+        }
+        fclose (fp);
+
+        if (n == 0) {
+            free (orbits);
+            sprintf (ynot, "%s: no usable two line elements", file);
+            return (-1);
+        }
+
+        *opp = orbits;
+        *np = n;
+        *n_skipped = n_bad;
+        return (0);
+}
+
+/* propagate satellites i0 .. i0+n-1 of the batch at *bp to unix time t with SGP4, n at most SAT_BLOCK,
+ * setting their TEME positions in km in x[], y[] and z[] and ok[] to 0 where the elements no longer describe
+ * an orbit, such as after it has decayed.
+ * each step is a loop across the satellites of the block without branches, which a compiler with a vector math
+ * library can vectorize.
+ */
+static void sgp4Block (const SatBatch *bp, int i0, int n, double t, double x[], double y[], double z[], int ok[])
+{
+        double nodem[SAT_BLOCK], am[SAT_BLOCK], axnl[SAT_BLOCK], aynl[SAT_BLOCK];
+        double u[SAT_BLOCK], eo1[SAT_BLOCK], sineo1[SAT_BLOCK], coseo1[SAT_BLOCK];
+        int done[SAT_BLOCK];
+
+        // secular gravity and atmospheric drag, then long period periodics
+        for (int j = 0; j < n; j++) {
+            int i = i0 + j;
+            double tsince = (t - bp->epoch[i])/60;
+            double xmdf = bp->mo[i] + bp->mdot[i]*tsince;
+            double argpdf = bp->argpo[i] + bp->argpdot[i]*tsince;
+            double nodedf = bp->nodeo[i] + bp->nodedot[i]*tsince;
+            double t2 = tsince*tsince;
+            double t3 = t2*tsince;
+            double t4 = t3*tsince;
+
+            // the drag terms of low perigees are zero, see satParseTLE()
+            double delomg = bp->omgcof[i]*tsince;
+            double c = 1 + bp->eta[i]*cos (xmdf);
+            double delm = bp->xmcof[i]*(c*c*c - bp->delmo[i]);
+            double mm = xmdf + delomg + delm;
+            double argp = argpdf - delomg - delm;
+            double node = nodedf + bp->nodecf[i]*t2;
+            double tempa = 1 - bp->cc1[i]*tsince - bp->d2[i]*t2 - bp->d3[i]*t3 - bp->d4[i]*t4;
+            double tempe = bp->bstar[i]*bp->cc4[i]*tsince + bp->bstar[i]*bp->cc5[i]*(sin (mm) - bp->sinmao[i]);
+            double templ = bp->t2cof[i]*t2 + bp->t3cof[i]*t3 + t4*(bp->t4cof[i] + tsince*bp->t5cof[i]);
+
+            double a = bp->ao[i]*tempa*tempa;
+            double em = bp->ecco[i] - tempe;
+            ok[j] = a > 0 && em < 1 && em >= -0.001;
+            em = em < 1e-6 ? 1e-6 : em;
+            mm = mm + bp->no[i]*templ;
+            double xlm = range2PI (mm + argp + node);
+            node = range2PI (node);
+            argp = range2PI (argp);
+            mm = range2PI (xlm - argp - node);
+
+            axnl[j] = em*cos (argp);
+            double temp = 1/(a*(1 - em*em));
+            aynl[j] = em*sin (argp) + temp*bp->aycof[i];
+            double xl = mm + argp + node + temp*bp->xlcof[i]*axnl[j];
+            u[j] = range2PI (xl - node);
+            eo1[j] = u[j];
+            nodem[j] = node;
+            am[j] = a;
+            done[j] = 0;
+        }
+
+        // solve kepler's equation, leaving each satellite alone once it has converged
+        for (int ktr = 1; ktr <= 10; ktr++) {
+            int more = 0;
+            for (int j = 0; j < n; j++) {
+                double s = sin (eo1[j]);
+                double c = cos (eo1[j]);
+                double tem5 = (u[j] - aynl[j]*c + axnl[j]*s - eo1[j]) / (1 - c*axnl[j] - s*aynl[j]);
+                tem5 = tem5 >= 0.95 ? 0.95 : tem5 <= -0.95 ? -0.95 : tem5;
+                eo1[j] = done[j] ? eo1[j] : eo1[j] + tem5;
+                sineo1[j] = done[j] ? sineo1[j] : s;
+                coseo1[j] = done[j] ? coseo1[j] : c;
+                done[j] = done[j] || !(fabs (tem5) >= 1e-12);
+                more += !done[j];
+            }
+            if (!more)
+                break;
+        }
+
+        // short period periodics and orientation
+        for (int j = 0; j < n; j++) {
+            int i = i0 + j;
+            double ecose = axnl[j]*coseo1[j] + aynl[j]*sineo1[j];
+            double esine = axnl[j]*sineo1[j] - aynl[j]*coseo1[j];
+            double el2 = axnl[j]*axnl[j] + aynl[j]*aynl[j];
+            double pl = am[j]*(1 - el2);
+            double rl = am[j]*(1 - ecose);
+            double betal = sqrt (1 - el2);
+            double temp = esine/(1 + betal);
+            double sinu = am[j]/rl*(sineo1[j] - aynl[j] - axnl[j]*temp);
+            double cosu = am[j]/rl*(coseo1[j] - axnl[j] + aynl[j]*temp);
+            double su = atan2 (sinu, cosu);
+            double sin2u = (cosu + cosu)*sinu;
+            double cos2u = 1 - 2*sinu*sinu;
+            temp = 1/pl;
+            double temp1 = 0.5*J2*temp;
+            double temp2 = temp1*temp;
+
+            double mrt = rl*(1 - 1.5*temp2*betal*bp->con41[i]) + 0.5*temp1*bp->x1mth2[i]*cos2u;
+            ok[j] = ok[j] && pl >= 0 && mrt >= 1;
+            double cosim = cos (bp->inclo[i]);
+            su = su - 0.25*temp2*bp->x7thm1[i]*sin2u;
+            double xnode = nodem[j] + 1.5*temp2*cosim*sin2u;
+            double xinc = bp->inclo[i] + 1.5*temp2*cosim*sin (bp->inclo[i])*cos2u;
+
+            double sinsu = sin (su), cossu = cos (su);
+            double snod = sin (xnode), cnod = cos (xnode);
+            double sini = sin (xinc), cosi = cos (xinc);
+            x[j] = mrt*RE_KM*(-snod*cosi*sinsu + cnod*cossu);
+            y[j] = mrt*RE_KM*(cnod*cosi*sinsu + snod*cossu);
+            z[j] = mrt*RE_KM*sini*sinsu;
+        }
+}
+
+/* find the TEME position r[] in km of the satellite at unix time t with SGP4.
+ * return 0 if ok else -1 if the elements no longer describe an orbit, such as after it has decayed.
+ */
+int satPosition (const SatOrbit *op, double t, double r[3])
+{
+        // a batch of one whose members are those of *op, which sgp4Block() only reads
+        SatBatch b;
+        b.n = 1;
+        b.mem = NULL;
+#define VIEW(m) b.m = (double *) &op->m;
+        BATCH_MEMBERS(VIEW)
+#undef VIEW
+
+        int ok;
+        sgp4Block (&b, 0, 1, t, &r[0], &r[1], &r[2], &ok);
+        return (ok ? 0 : -1);
+}
+
+/* initialize *bp with copies of the n orbits at op[] laid out member by member for satBatchLook().
+ * return 0 if ok else -1 with brief excuse in ynot[]
+ */
+int satBatchInit (SatBatch *bp, const SatOrbit *op, int n, char ynot[])
+{
+        int n_members = 0;
+#define COUNT(m) n_members++;
+        BATCH_MEMBERS(COUNT)
+#undef COUNT
+
+        bp->n = n;
+        bp->mem = (double *) malloc ((n > 0 ? n : 1) * n_members * sizeof(double));
+        if (!bp->mem) {
+            sprintf (ynot, "no memory for %d satellites", n);
+            return (-1);
+        }
+
+        double *mp = bp->mem;
+#define LAYOUT(m) bp->m = mp; mp += n; for (int i = 0; i < n; i++) bp->m[i] = op[i].m;
+        BATCH_MEMBERS(LAYOUT)
+#undef LAYOUT
+
+        return (0);
+}
+
+/* release the memory of a batch made by satBatchInit()
+ */
+void satBatchFree (SatBatch *bp)
+{
+        free (bp->mem);
+        bp->mem = NULL;
+        bp->n = 0;
+}
+
+/* initialize *sp from the station location of celestial.c.
+ * return 0 if ok else -1 with brief excuse in ynot[]
+ */
+int satStationInit (SatStation *sp, char ynot[])
+{
+        double elev;
+        if (celStation (&sp->lat, &sp->lng, &elev) < 0) {
+            sprintf (ynot, "station location is not set");
+            return (-1);
+        }
+
+        sp->lat *= D2R;
+        sp->lng *= D2R;
+
+        double e2 = WGS84_F*(2 - WGS84_F);
+        double slat = sin (sp->lat);
+        double n = WGS84_A/sqrt (1 - e2*slat*slat);
+        double h = elev/1000;
+        sp->obs[0] = (n + h)*cos (sp->lat)*cos (sp->lng);
+        sp->obs[1] = (n + h)*cos (sp->lat)*sin (sp->lng);
+        sp->obs[2] = (n*(1 - e2) + h)*slat;
+
+        return (0);
+}
+
+/* find the az and el, degs, from the station of TEME position x,y,z km when the sidereal time is g rads.
+ * no allowance is made for refraction, which depends on humidity at radio wavelengths.
+ */
+static void look (const SatStation *sp, double g, double x, double y, double z, float *az, float *el)
+{
+        // rotate to earth fixed and find the range vector from the station
+        double cg = cos (g), sg = sin (g);
+        double dx = cg*x + sg*y - sp->obs[0];
+        double dy = -sg*x + cg*y - sp->obs[1];
+        double dz = z - sp->obs[2];
+
+        // then to the local horizon
+        double slat = sin (sp->lat), clat = cos (sp->lat);
+        double slng = sin (sp->lng), clng = cos (sp->lng);
+        double south = slat*clng*dx + slat*slng*dy - clat*dz;
+        double east = -slng*dx + clng*dy;
+        double up = clat*clng*dx + clat*slng*dy + slat*dz;
+
+        *az = range2PI (atan2 (east, -south)) / D2R;
+        *el = atan2 (up, sqrt (south*south + east*east)) / D2R;
+        if (*az >= 360)
+            *az = 0;
+}
+
+/* prepare *tp to follow the satellite of *op from the station.
+ * return 0 if ok else -1 with brief excuse in ynot[]
+ */
+int satTrackInit (SatTrack *tp, const SatOrbit *op, char ynot[])
+{
+        tp->orbit = *op;
+        return (satStationInit (&tp->stn, ynot));
+}
+
+/* G5500TrackFunc for the SatTrack at arg: find its az and el, degs, at unix time t.
+ */
+int satTrackFunc (double t, float *az, float *el, void *arg)
+{
+        SatTrack *tp = (SatTrack *) arg;
+
+        double r[3];
+        if (satPosition (&tp->orbit, t, r) < 0)
+            return (-1);
+        look (&tp->stn, celSiderealTime (t), r[0], r[1], r[2], az, el);
+        return (0);
+}
+
+/* find the az and el, degs, of satellites i0 .. i0+n-1 of the batch at *bp from the station at *sp at unix
+ * time t, into az[] and el[] from index 0. those no longer in orbit are reported at az 0 el -90.
+ */
+void satBatchLook (const SatBatch *bp, const SatStation *sp, int i0, int n, double t, float az[], float el[])
+{
+        double x[SAT_BLOCK], y[SAT_BLOCK], z[SAT_BLOCK];
+        int ok[SAT_BLOCK];
+        double g = celSiderealTime (t);
+
+        for (int b = 0; b < n; b += SAT_BLOCK) {
+            int nb = n - b < SAT_BLOCK ? n - b : SAT_BLOCK;
+            sgp4Block (bp, i0 + b, nb, t, x, y, z, ok);
+            for (int j = 0; j < nb; j++) {
+                if (ok[j]) {
+                    look (sp, g, x[j], y[j], z[j], &az[b+j], &el[b+j]);
+                } else {
+                    az[b+j] = 0;
+                    el[b+j] = -90;
+                }
+            }
+        }
+}
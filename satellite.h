@@ -0,0 +1,52 @@
+#ifndef _SATELLITE_H
+#define _SATELLITE_H
+
+// one satellite from a NORAD two line element set, with everything SGP4 derives once from it
+typedef struct {
+    char name[25];                      // from the line before the elements, else the catalog number
+    int catnum;                         // NORAD catalog number
+    double epoch;                       // unix time of the elements
+    double ecco, inclo, nodeo, argpo, mo;       // mean elements at epoch, rads
+    double no, ao, bstar;               // un-Kozai mean motion, rads/min, semi-major axis, earth radii, and drag
+    int isimp;                          // set for perigees under 220 km, which use a simpler drag model
+    double aycof, con41, cc1, cc4, cc5, d2, d3, d4, delmo, eta, argpdot, omgcof, sinmao;
+    double t2cof, t3cof, t4cof, t5cof, x1mth2, x7thm1, mdot, nodedot, xlcof, xmcof, nodecf;
+} SatOrbit;
+
+// the station
+typedef struct {
+    double lat, lng;                    // geodetic latitude and longitude, rads
+    double obs[3];                      // earth fixed coordinates, km
+} SatStation;
+
+// a satellite seen from the station
+typedef struct {
+    SatOrbit orbit;
+    SatStation stn;
+} SatTrack;
+
+// satellites propagated together, see satBatchLook()
+#define SAT_BLOCK       64
+
+// many orbits laid out member by member, each array holding that member of every orbit
+typedef struct {
+    int n;                              // number of orbits
+    double *epoch, *ecco, *inclo, *nodeo, *argpo, *mo, *no, *ao, *bstar;
+    double *aycof, *con41, *cc1, *cc4, *cc5, *d2, *d3, *d4, *delmo, *eta, *argpdot, *omgcof, *sinmao;
+    double *t2cof, *t3cof, *t4cof, *t5cof, *x1mth2, *x7thm1, *mdot, *nodedot, *xlcof, *xmcof, *nodecf;
+    double *mem;                        // malloced storage of all the above
+} SatBatch;
+
+extern int satParseTLE (const char *name, const char *l1, const char *l2, SatOrbit *op, char ynot[]);
+extern int satReadTLE (const char *file, const char *name, SatOrbit *op, char ynot[]);
+extern int satReadCatalog (const char *file, SatOrbit **opp, int *np, int *n_skipped, char ynot[]);
+extern int satPosition (const SatOrbit *op, double t, double r[3]);
+extern int satStationInit (SatStation *sp, char ynot[]);
+extern int satTrackInit (SatTrack *tp, const SatOrbit *op, char ynot[]);
+extern int satTrackFunc (double t, float *az, float *el, void *arg);
+extern int satBatchInit (SatBatch *bp, const SatOrbit *op, int n, char ynot[]);
+extern void satBatchFree (SatBatch *bp);
+extern void satBatchLook (const SatBatch *bp, const SatStation *sp, int i0, int n, double t, float az[],
+        float el[]);
+
+#endif // _SATELLITE_H
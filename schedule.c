@@ -0,0 +1,708 @@
+/* table of rotator commands to be executed at given absolute times, for unattended operation.
+ *
+ * Each entry is one line in the schedule file, by default $HOME/.g5500_schedule.txt:
+ *
+ *    # time                      action  args
+ *    2026-10-18T12:00:00.250Z    goto    180 45
+ *    2026-10-18T12:10:00Z        park
+ *    1760789400                  stop
+ *    2026-10-18T13:00:00Z        track   /home/pi/pass.txt
+ *    2026-10-18T22:00:00Z        radec   5.5881 -5.3911
+ *
+ * Times are ISO 8601 or unix seconds, either with optional fractional seconds. ISO times are UTC unless they
+ * end with an offset such as +02:00 or -0500. A track file contains lines of "secs az el" in which secs is
+ * the offset from the entry time at which to goto az el. A track file added by web command must be a plain
+ * file within the track directory, $HOME/.g5500_tracks, and may be named relative to it. So must the files
+ * named to check_pass and passes, see presim.c and passes.c.
+ * A radec entry starts tracking J2000 RA hours and Dec degs, see celestial.c.
+ * A track or radec pass does not start while either motor is resting to cool, nor a track while either motor
+ * has less running left before it must rest than the track needs at the calibrated speeds. It is checked
+ * again every SCHED_COOL_RETRY secs, a track skipping the points that pass meanwhile and dropped if none remain.
+ * Entries are removed once executed. A track entry that is already underway when the file is loaded
+ * resumes at its next point; any other entry whose time has already passed is discarded.
+ *
+ * The earliest entry is armed on a CLOCK_REALTIME timerfd using an absolute expiry time so entries run
+ * within a millisecond or so of their scheduled time, and the timer is rearmed if the system clock is set.
+ * The table may be edited with web commands, each edit is saved back to the file at once:
+ *
+ *    schedule                                        list all entries
+ *    schedule_add?t=time&cmd=goto&az=x&el=y          add a goto entry
+ *    schedule_add?t=time&cmd=park                    add a park entry
+ *    schedule_add?t=time&cmd=stop                    add a stop entry
+ *    schedule_add?t=time&cmd=track&file=path         add a track entry
+ *    schedule_add?t=time&cmd=radec&ra=h&dec=d        add a radec entry
+ *    schedule_del?id=n                               delete entry n
+ *    schedule_clear                                  delete all entries
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+
+#include "g5500_sa.h"
+#include "schedule.h"
+#include "celestial.h"
+
+
+// basename of default schedule file in $HOME
+static const char sched_file_name[] = ".g5500_schedule.txt";
+
+// basename of the directory in $HOME holding track files that may be named by web commands
+static const char sched_track_dir[] = ".g5500_tracks";
+
+
+// limits
+#define MAX_SCHED               200             // max entries in table
+#define MAX_TRACK_PTS           10000           // max points in one track file
+#define SCHED_COOL_RETRY        10              // secs between checks of a pass waiting for the motors to cool
+
+
+// kinds of scheduled actions
+typedef enum {
+    SA_GOTO,
+    SA_PARK,
+    SA_STOP,
+    SA_TRACK,
+    SA_RADEC,
+} SchedAction;
+
+static const char *sa_names[] = {
+    "goto",
+    "park",
+    "stop",
+    "track",
+    "radec",
+};
+
+
+// one entry in the table
+typedef struct {
+    int id;                                     // unique handle for deleting
+    double t0;                                  // scheduled unix time
+    double t;                                   // unix time of next action, > t0 only while tracking
+    SchedAction action;                         // what to do
+    float az, el;                               // SA_GOTO position, degs, or SA_RADEC RA hours and Dec degs
+    char *file;                                 // SA_TRACK file name, malloced
+    SchedTrackPoint *points;                    // SA_TRACK points, malloced
+    int n_points;                               // n points
+    int next;                                   // index of next point
+    int started;                                // set once a track or radec pass is underway
+} SchedEntry;
+
+
+// the table and the means to run it
+static SchedEntry sched[MAX_SCHED];
+static int n_sched;
+static int next_id = 1;
+static int timer_fd = -1;
+static char *sched_path;
+
+
+/* return the current unix time with sub-second precision
+ */
+static double nowUnix (void)
+{
+        struct timespec ts;
+        clock_gettime (CLOCK_REALTIME, &ts);
+        return (ts.tv_sec + ts.tv_nsec*1e-9);
+}
+
+/* parse str as ISO 8601 or unix seconds, either with optional fraction. ISO is UTC unless followed by an
+ * offset of the form +hh, +hh:mm or +hhmm, or the same with -.
+ * return 0 if ok, else -1
+ */
+int schedParseTime (const char *str, double *tp)
+{
+        int yr, mo, dy, hh, mm;
+        double ss;
+        char *end;
+        int n_chars;
+
+        if (sscanf (str, "%d-%d-%dT%d:%d:%lf%n", &yr, &mo, &dy, &hh, &mm, &ss, &n_chars) == 6) {
+
+            // any offset from UTC, secs
+            const char *zone = str + n_chars;
+            int off = 0;
+            if (*zone == '+' || *zone == '-') {
+                int oh, om = 0, n_zone = 0;
+                if (sscanf (zone+1, "%2d:%2d%n", &oh, &om, &n_zone) != 2
+                                        && sscanf (zone+1, "%2d%2d%n", &oh, &om, &n_zone) != 2) {
+                    om = 0;
+                    if (sscanf (zone+1, "%2d%n", &oh, &n_zone) != 1)
+                        return (-1);
+                }
+                if (oh > 14 || om > 59)
+                    return (-1);
+                off = (oh*3600 + om*60) * (*zone == '-' ? -1 : 1);
+                zone += 1 + n_zone;
+            } else if (*zone == 'Z' || *zone == 'z') {
+                zone++;
+            }
+            if (*zone != '\0' && !isspace(*zone))
+                return (-1);
+
+            struct tm tm;
+            memset (&tm, 0, sizeof(tm));
+            tm.tm_year = yr - 1900;
+            tm.tm_mon = mo - 1;
+            tm.tm_mday = dy;
+            tm.tm_hour = hh;
+            tm.tm_min = mm;
+            tm.tm_sec = 0;
+            *tp = timegm (&tm) + ss - off;
+            return (0);
+        }
+
+        *tp = strtod (str, &end);
+        if (end == str || (*end != '\0' && !isspace(*end)) || *tp <= 0)
+            return (-1);
+        return (0);
+}
+
+/* format unix time t as ISO 8601 UTC with milliseconds
+ */
+static void formatTime (double t, char buf[], size_t buflen)
+{
+        time_t secs = (time_t) t;
+        int ms = (int) ((t - secs) * 1000 + 0.5);
+        if (ms == 1000) {
+            secs += 1;
+            ms = 0;
+        }
+        struct tm *tmp = gmtime (&secs);
+        size_t l = strftime (buf, buflen, "%Y-%m-%dT%H:%M:%S", tmp);
+        snprintf (buf + l, buflen - l, ".%03dZ", ms);
+}
+
+/* read the given track file into a malloced array of points at *ptsp and their number at *np.
+ * return 0 if ok else -1 with brief excuse in ynot[]
+ */
+int schedReadTrack (const char *file, SchedTrackPoint **ptsp, int *np, char ynot[])
+{
+        FILE *fp = fopen (file, "r");
+        if (!fp) {
+            sprintf (ynot, "%s: %s", file, strerror(errno));
+            return (-1);
+        }
+
+        SchedTrackPoint *pts = NULL;
+        int n_pts = 0;
+        char buf[256];
+        double dt;
+        float az, el;
+
+        while (fgets (buf, sizeof(buf), fp)) {
+            if (buf[0] == '#' || sscanf (buf, "%lf %f %f", &dt, &az, &el) != 3)
+                continue;
+            if (n_pts == MAX_TRACK_PTS || (n_pts > 0 && dt <= pts[n_pts-1].dt)) {
+                sprintf (ynot, "%s: more than %d points or times not increasing", file, MAX_TRACK_PTS);
+                free (pts);
+                fclose (fp);
+                return (-1);
+            }
+            SchedTrackPoint *more = (SchedTrackPoint *) realloc (pts, (n_pts+1) * sizeof(SchedTrackPoint));
+            if (!more) {
+                sprintf (ynot, "%s: no memory for %d points", file, n_pts+1);
+                free (pts);
+                fclose (fp);
+                return (-1);
+            }
+            pts = more;
+            pts[n_pts].dt = dt;
+            pts[n_pts].az = az;
+            pts[n_pts].el = el;
+            n_pts++;
+        }
+        fclose (fp);
+
+        if (n_pts == 0) {
+            sprintf (ynot, "%s: no points", file);
+            return (-1);
+        }
+
+        *ptsp = pts;
+        *np = n_pts;
+        return (0);
+}
+
+/* read the given track file into ep.
+ * return 0 if ok else -1 with brief excuse in ynot[]
+ */
+static int loadTrack (SchedEntry *ep, const char *file, char ynot[])
+{
+        if (schedReadTrack (file, &ep->points, &ep->n_points, ynot) < 0)
+            return (-1);
+
+        ep->file = strdup (file);
+        if (!ep->file) {
+            sprintf (ynot, "no memory for track %s", file);
+            free (ep->points);
+            return (-1);
+        }
+        ep->next = 0;
+        return (0);
+}
+
+/* resolve the track file name, relative to the track directory unless absolute, into path[], insuring it
+ * is a regular file within the track directory, for files named by clients. the excuse is the same whatever
+ * the reason so it does not tell whether a file exists elsewhere.
+ * return 0 if ok else -1 with brief excuse in ynot[]
+ */
+int schedTrackPath (const char *name, char path[], size_t len, char ynot[])
+{
+        const char *home = getenv ("HOME");
+        if (!home)
+            home = ".";
+
+        char dir[PATH_MAX], want[PATH_MAX], real[PATH_MAX];
+        snprintf (want, sizeof(want), "%s/%s", home, sched_track_dir);
+        if (!realpath (want, dir)) {
+            sprintf (ynot, "track directory %.100s: %s", want, strerror(errno));
+            return (-1);
+        }
+
+        int wl = name[0] == '/' ? snprintf (want, sizeof(want), "%s", name)
+                                : snprintf (want, sizeof(want), "%s/%s", dir, name);
+        if (wl >= (int)sizeof(want)) {
+            sprintf (ynot, "%.100s: name is too long", name);
+            return (-1);
+        }
+        size_t dl = strlen (dir);
+        struct stat st;
+        if (!realpath (want, real) || strncmp (real, dir, dl) != 0 || real[dl] != '/' || stat (real, &st) < 0
+                        || !S_ISREG (st.st_mode)) {
+            sprintf (ynot, "%.100s is not a file within %.100s", name, dir);
+            return (-1);
+        }
+        if (strlen (real) >= len) {
+            sprintf (ynot, "%.100s: name is too long", name);
+            return (-1);
+        }
+
+        strcpy (path, real);
+        return (0);
+}
+
+/* release any memory used by entry i and remove it from the table
+ */
+static void removeEntry (int i)
+{
+        free (sched[i].file);
+        free (sched[i].points);
+        memmove (&sched[i], &sched[i+1], (n_sched - i - 1) * sizeof(SchedEntry));
+        n_sched--;
+}
+
+/* add a new entry to the table.
+ * file is only used for SA_TRACK, az and el only for SA_GOTO and SA_RADEC.
+ * return new entry id else -1 with brief excuse in ynot[]
+ */
+static int addEntry (double t0, SchedAction action, float az, float el, const char *file, char ynot[])
+{
+        if (n_sched == MAX_SCHED) {
+            sprintf (ynot, "schedule is full, max %d", MAX_SCHED);
+            return (-1);
+        }
+
+        SchedEntry *ep = &sched[n_sched];
+        memset (ep, 0, sizeof(*ep));
+        ep->t0 = ep->t = t0;
+        ep->action = action;
+        ep->az = az;
+        ep->el = el;
+
+        if (action == SA_TRACK) {
+            if (loadTrack (ep, file, ynot) < 0)
+                return (-1);
+
+            // skip any points already past
+            double now = nowUnix();
+            while (ep->next < ep->n_points && t0 + ep->points[ep->next].dt < now)
+                ep->next++;
+            if (ep->next == ep->n_points) {
+                sprintf (ynot, "track %s is already complete", file);
+                free (ep->file);
+                free (ep->points);
+                return (-1);
+            }
+            ep->t = t0 + ep->points[ep->next].dt;
+        }
+
+        ep->id = next_id++;
+        n_sched++;
+        return (ep->id);
+}
+
+/* write the table to sched_path
+ */
+static void saveSchedule (void)
+{
+        FILE *fp = fopen (sched_path, "w");
+        if (!fp) {
+            rig_debug (RIG_DEBUG_ERR, "%s: %s\n", sched_path, strerror(errno));
+            return;
+        }
+
+        fprintf (fp, "# time                      action  args\n");
+        for (int i = 0; i < n_sched; i++) {
+            SchedEntry *ep = &sched[i];
+            char tbuf[50];
+            formatTime (ep->t0, tbuf, sizeof(tbuf));
+            fprintf (fp, "%-27s %-7s", tbuf, sa_names[ep->action]);
+            if (ep->action == SA_GOTO || ep->action == SA_RADEC)
+                fprintf (fp, " %.8g %.8g", ep->az, ep->el);
+            else if (ep->action == SA_TRACK)
+                fprintf (fp, " %s", ep->file);
+            fprintf (fp, "\n");
+        }
+
+        fclose (fp);
+}
+
+/* parse one line from a schedule file or web command fields and add it to the table.
+ * return new entry id else -1 with brief excuse in ynot[]
+ */
+static int addFromFields (const char *tstr, const char *cmd, const char *args, char ynot[])
+{
+        double t0;
+        float az, el;
+        char file[256];
+
+        if (schedParseTime (tstr, &t0) < 0) {
+            sprintf (ynot, "bad time: %s", tstr);
+            return (-1);
+        }
+
+        if (strcmp (cmd, "goto") == 0) {
+            if (sscanf (args, "%f %f", &az, &el) != 2) {
+                sprintf (ynot, "goto requires az el");
+                return (-1);
+            }
+            return (addEntry (t0, SA_GOTO, az, el, NULL, ynot));
+        }
+        if (strcmp (cmd, "park") == 0)
+            return (addEntry (t0, SA_PARK, 0, 0, NULL, ynot));
+        if (strcmp (cmd, "stop") == 0)
+            return (addEntry (t0, SA_STOP, 0, 0, NULL, ynot));
+        if (strcmp (cmd, "track") == 0) {
+            if (sscanf (args, "%255s", file) != 1) {
+                sprintf (ynot, "track requires a file name");
+                return (-1);
+            }
+            return (addEntry (t0, SA_TRACK, 0, 0, file, ynot));
+        }
+        if (strcmp (cmd, "radec") == 0) {
+            if (sscanf (args, "%f %f", &az, &el) != 2) {
+                sprintf (ynot, "radec requires ra dec");
+                return (-1);
+            }
+            return (addEntry (t0, SA_RADEC, az, el, NULL, ynot));
+        }
+
+        sprintf (ynot, "unknown action: %s", cmd);
+        return (-1);
+}
+
+/* read sched_path into the table, skipping entries already past.
+ */
+static void loadSchedule (void)
+{
+        FILE *fp = fopen (sched_path, "r");
+        if (!fp)
+            return;
+
+        char buf[512], tstr[64], cmd[20], ynot[300];
+        int n_chars;
+        double now = nowUnix();
+
+        while (fgets (buf, sizeof(buf), fp)) {
+            if (buf[0] == '#' || sscanf (buf, "%63s %19s %n", tstr, cmd, &n_chars) != 2)
+                continue;
+            double t0;
+            if (schedParseTime (tstr, &t0) == 0 && t0 < now && strcmp (cmd, "track") != 0) {
+                rig_debug (RIG_DEBUG_WARN, "schedule: skipping past entry %s", buf);
+                continue;
+            }
+            if (addFromFields (tstr, cmd, buf + n_chars, ynot) < 0)
+                rig_debug (RIG_DEBUG_ERR, "schedule: %s\n", ynot);
+        }
+
+        fclose (fp);
+
+        rig_debug (RIG_DEBUG_VERBOSE, "schedule: loaded %d entries from %s\n", n_sched, sched_path);
+}
+
+/* arm timer_fd for the earliest entry, or disarm if none
+ */
+static void armTimer (void)
+{
+        struct itimerspec its;
+        memset (&its, 0, sizeof(its));
+
+        if (n_sched > 0) {
+            double t = sched[0].t;
+            for (int i = 1; i < n_sched; i++)
+                if (sched[i].t < t)
+                    t = sched[i].t;
+            its.it_value.tv_sec = (time_t) t;
+            its.it_value.tv_nsec = (long) ((t - its.it_value.tv_sec) * 1e9);
+            if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+                its.it_value.tv_nsec = 1;       // all zero would disarm
+        }
+
+        if (timerfd_settime (timer_fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &its, NULL) < 0)
+            rig_debug (RIG_DEBUG_ERR, "schedule: timerfd_settime(): %s\n", strerror(errno));
+}
+
+/* return whether the motors may start the pass of entry ep without resting part way, else why not in ynot[].
+ * a track needs each motor to run for its travel from where it is now through all its remaining points.
+ */
+static int motorsReady (const SchedEntry *ep, char ynot[], size_t ynot_len)
+{
+        G5500Status st;
+        if (g5500_direct_get_status (&st) != RIG_OK)
+            return (1);                         // the command itself will report the trouble
+
+        if (st.az_cooling || st.el_cooling) {
+            snprintf (ynot, ynot_len, "%s motor is resting to cool", st.az_cooling ? "az" : "el");
+            return (0);
+        }
+        if (ep->action != SA_TRACK || st.az_speed <= 0 || st.el_speed <= 0)
+            return (1);
+
+        double az_secs = fabs (ep->points[ep->next].az - st.az) / st.az_speed;
+        double el_secs = fabs (ep->points[ep->next].el - st.el) / st.el_speed;
+        for (int k = ep->next + 1; k < ep->n_points; k++) {
+            az_secs += fabs (ep->points[k].az - ep->points[k-1].az) / st.az_speed;
+            el_secs += fabs (ep->points[k].el - ep->points[k-1].el) / st.el_speed;
+        }
+        if ((st.az_run_left >= 0 && az_secs > st.az_run_left) || (st.el_run_left >= 0 && el_secs > st.el_run_left)) {
+            snprintf (ynot, ynot_len, "track needs az %.0f el %.0f secs of running but motors have %.0f %.0f",
+                        az_secs, el_secs, st.az_run_left, st.el_run_left);
+            return (0);
+        }
+        return (1);
+}
+
+/* perform the action of entry i.
+ * return 1 if the entry is complete and should be removed, 0 if it has more to do.
+ */
+static int runEntry (int i, double now)
+{
+        SchedEntry *ep = &sched[i];
+        int err = RIG_OK;
+        float az = ep->az, el = ep->el;
+        char ynot[100];
+
+        // a pass waits for the motors rather than be cut short by a cool-down
+        if ((ep->action == SA_TRACK || ep->action == SA_RADEC) && !ep->started) {
+            if (!motorsReady (ep, ynot, sizeof(ynot))) {
+                ep->t = now + SCHED_COOL_RETRY;
+                if (ep->action == SA_TRACK) {
+                    if (ep->t0 + ep->points[ep->n_points-1].dt < ep->t) {
+                        rig_debug (RIG_DEBUG_ERR, "schedule: entry %d dropped, %s\n", ep->id, ynot);
+                        return (1);
+                    }
+                    while (ep->next + 1 < ep->n_points && ep->t0 + ep->points[ep->next+1].dt <= ep->t)
+                        ep->next++;
+                }
+                rig_debug (RIG_DEBUG_ERR, "schedule: entry %d waits, %s\n", ep->id, ynot);
+                return (0);
+            }
+            ep->started = 1;
+        }
+
+        switch (ep->action) {
+        case SA_GOTO:
+            err = rotSetPos (az, el);
+            break;
+        case SA_PARK:
+            err = rotPark();
+            break;
+        case SA_STOP:
+            err = rotStop();
+            break;
+        case SA_TRACK:
+            az = ep->points[ep->next].az;
+            el = ep->points[ep->next].el;
+            err = rotSetPos (az, el);
+            break;
+        case SA_RADEC:
+            err = celTrackRADec (az, el, ynot);
+            if (err != RIG_OK)
+                rig_debug (RIG_DEBUG_ERR, "schedule: %s\n", ynot);
+            break;
+        }
+
+        rig_debug (RIG_DEBUG_VERBOSE, "schedule: entry %d %s %g %g %.1f ms late: %d\n", ep->id,
+                        sa_names[ep->action], az, el, (now - ep->t)*1000, err);
+        if (err != RIG_OK)
+            rig_debug (RIG_DEBUG_ERR, "schedule: entry %d %s failed, code %d\n", ep->id,
+                        sa_names[ep->action], err);
+
+        // advance track, else done
+        if (ep->action == SA_TRACK && ++ep->next < ep->n_points) {
+            ep->t = ep->t0 + ep->points[ep->next].dt;
+            return (0);
+        }
+        return (1);
+}
+
+/* initialize the schedule from the given file, or the default if NULL.
+ * return 0 if ok else -1
+ */
+int schedInit (const char *filename)
+{
+        if (filename) {
+            sched_path = strdup (filename);
+        } else {
+            const char *home = getenv ("HOME");
+            if (!home)
+                home = ".";
+            sched_path = (char *) malloc (strlen(home) + strlen(sched_file_name) + 2);
+            sprintf (sched_path, "%s/%s", home, sched_file_name);
+        }
+
+        timer_fd = timerfd_create (CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer_fd < 0) {
+            rig_debug (RIG_DEBUG_ERR, "schedule: timerfd_create(): %s\n", strerror(errno));
+            return (-1);
+        }
+
+        loadSchedule();
+        armTimer();
+        return (0);
+}
+
+/* return the file descriptor that becomes readable when an entry is due
+ */
+int schedFD (void)
+{
+        return (timer_fd);
+}
+
+/* called when schedFD() is readable to perform all entries now due.
+ */
+void schedRun (void)
+{
+        uint64_t n_exp;
+
+        // consume the expiration; ECANCELED just means the clock was set so we rearm
+        if (read (timer_fd, &n_exp, sizeof(n_exp)) < 0 && errno != ECANCELED && errno != EAGAIN)
+            rig_debug (RIG_DEBUG_ERR, "schedule: timerfd read: %s\n", strerror(errno));
+
+        // run everything due, allowing for timer granularity
+        double now = nowUnix();
+        int changed = 0;
+        for (int i = 0; i < n_sched; ) {
+            if (sched[i].t <= now + 0.0005 && runEntry (i, now)) {
+                removeEntry (i);
+                changed = 1;
+            } else {
+                i++;
+            }
+        }
+
+        if (changed)
+            saveSchedule();
+        armTimer();
+}
+
+/* perform one of the schedule web commands, cmd is the full command including any query.
+ */
+void schedWebCommand (FILE *fp, char *cmd)
+{
+        char *query = strchr (cmd, '?');
+        char ynot[300];
+
+        if (query)
+            *query++ = '\0';
+
+        if (strcmp (cmd, "schedule") == 0) {
+
+            fprintf (fp, "%4s %-24s %-6s %s\n", "id", "time", "action", "args");
+            for (int i = 0; i < n_sched; i++) {
+                SchedEntry *ep = &sched[i];
+                char tbuf[50];
+                formatTime (ep->t0, tbuf, sizeof(tbuf));
+                fprintf (fp, "%4d %-24s %-6s", ep->id, tbuf, sa_names[ep->action]);
+                if (ep->action == SA_GOTO || ep->action == SA_RADEC)
+                    fprintf (fp, " %.8g %.8g", ep->az, ep->el);
+                else if (ep->action == SA_TRACK)
+                    fprintf (fp, " %s, point %d of %d", ep->file, ep->next+1, ep->n_points);
+                fprintf (fp, "\n");
+            }
+
+        } else if (strcmp (cmd, "schedule_add") == 0) {
+
+            char tstr[64], action[20], args[300], az[20], el[20];
+            if (queryArg (query, "t", tstr, sizeof(tstr)) < 0 || queryArg (query, "cmd", action, sizeof(action)) < 0) {
+                fprintf (fp, "err: schedule_add requires t and cmd\n");
+                return;
+            }
+            args[0] = '\0';
+            if (queryArg (query, "az", az, sizeof(az)) == 0 && queryArg (query, "el", el, sizeof(el)) == 0)
+                snprintf (args, sizeof(args), "%s %s", az, el);
+            else if (queryArg (query, "ra", az, sizeof(az)) == 0 && queryArg (query, "dec", el, sizeof(el)) == 0)
+                snprintf (args, sizeof(args), "%s %s", az, el);
+            else if (strcmp (action, "track") == 0) {
+                // only from the track directory
+                char file[256];
+                if (queryArg (query, "file", file, sizeof(file)) < 0) {
+                    fprintf (fp, "err: track requires a file name\n");
+                    return;
+                }
+                if (schedTrackPath (file, args, sizeof(args), ynot) < 0) {
+                    fprintf (fp, "err: %s\n", ynot);
+                    return;
+                }
+            }
+
+            int id = addFromFields (tstr, action, args, ynot);
+            if (id < 0) {
+                fprintf (fp, "err: %s\n", ynot);
+            } else {
+                saveSchedule();
+                armTimer();
+                fprintf (fp, "ok %d\n", id);
+            }
+
+        } else if (strcmp (cmd, "schedule_del") == 0) {
+
+            char idstr[20];
+            int id = queryArg (query, "id", idstr, sizeof(idstr)) == 0 ? atoi (idstr) : 0;
+            int i;
+            for (i = 0; i < n_sched; i++)
+                if (sched[i].id == id)
+                    break;
+            if (i == n_sched) {
+                fprintf (fp, "err: no entry with id %d\n", id);
+            } else {
+                removeEntry (i);
+                saveSchedule();
+                armTimer();
+                fprintf (fp, "ok\n");
+            }
+
+        } else if (strcmp (cmd, "schedule_clear") == 0) {
+
+            while (n_sched > 0)
+                removeEntry (n_sched-1);
+            saveSchedule();
+            armTimer();
+            fprintf (fp, "ok\n");
+
+        } else {
+
+            fprintf (fp, "err: unrecognized command\n");
+        }
+}
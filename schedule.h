@@ -0,0 +1,20 @@
+#ifndef _SCHEDULE_H
+#define _SCHEDULE_H
+
+#include <stdio.h>
+
+// one point in a track file
+typedef struct {
+    double dt;                                  // secs after entry time
+    float az, el;                               // degs
+} SchedTrackPoint;
+
+extern int schedInit (const char *filename);
+extern int schedFD (void);
+extern void schedRun (void);
+extern int schedParseTime (const char *str, double *tp);
+extern int schedReadTrack (const char *file, SchedTrackPoint **ptsp, int *np, char ynot[]);
+extern int schedTrackPath (const char *name, char path[], size_t len, char ynot[]);
+extern void schedWebCommand (FILE *fp, char *cmd);
+
+#endif // _SCHEDULE_H
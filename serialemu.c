@@ -0,0 +1,380 @@
+/* serve legacy tracking programs that only speak the Yaesu GS-232 or EasyComm serial protocols.
+ *
+ * Each port is a pseudo-terminal whose slave is reached through a stable symlink, named on the command line
+ * as proto=link, for example "gs232b=/tmp/ttyG5500". A program opens the link as if it were a serial port;
+ * the baud rate and framing it sets are accepted and ignored. Commands are decoded here and carried out by
+ * the same rotSetPos() etc as the rotctld and web front ends, from the main select() loop, so replies take
+ * no longer than for a rotctld client.
+ *
+ * gs232a and gs232b accept these commands, each ending with CR:
+ *
+ *    C                 report az: gs232a +0aaa, gs232b AZ=aaa
+ *    B                 report el: gs232a +0eee, gs232b EL=eee
+ *    C2                report both: gs232a +0aaa+0eee, gs232b AZ=aaa  EL=eee
+ *    Maaa              go to az aaa, el unchanged
+ *    Waaa eee          go to az aaa and el eee
+ *    R L U D           move cw, ccw, up or down to the limit
+ *    A E S             stop az, el or both
+ *
+ * anything else, including a line too long for any command, is answered with ?> as by the real controller.
+ * Replies end with CR, gs232b also with LF. Replies the client has not read are discarded by the next.
+ *
+ * easycomm accepts EasyComm II lines ending with CR or LF, each of any of these words separated by spaces:
+ *
+ *    AZ EL             report az or el, all reports on one line such as "AZ123.4 EL45.6"
+ *    AZx.x ELx.x       go to az and/or el, together once the whole line is read
+ *    ML MR MU MD       move ccw, cw, down or up to the limit
+ *    SA SE             stop az or el
+ *    VE                report version
+ *
+ * and ignores the others, such as the UP and DN radio words, and any line too long to be one of these.
+ *
+ * The pty masters are passed to a new instance in a handoff, which finds them by their order on the
+ * command line, so clients keep their open slaves throughout.
+ */
+
+#define _GNU_SOURCE                     // posix_openpt et al
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/stat.h>
+#include <sys/select.h>
+
+#include "version.h"
+#include "g5500_sa.h"
+#include "serialemu.h"
+
+
+// protocols
+typedef enum {
+    SP_GS232A,
+    SP_GS232B,
+    SP_EASYCOMM,
+} SerProto;
+
+static const char *proto_names[] = {"gs232a", "gs232b", "easycomm"};
+
+// one emulated port
+typedef struct {
+    SerProto proto;
+    char *link;                         // symlink to the slave
+    int master;                         // pty master, -1 if not open
+    int slave;                          // held open so the master never reads EIO between clients
+    char line[128];                     // command being collected
+    int n_line;                         // chars in line[]
+    int too_long;                       // set if the command has overflowed line[] and must be rejected
+} SerPort;
+
+static SerPort ports[MAX_SER_PORTS];
+static int n_ports;
+
+
+/* open the slave of pp ourselves and point its link at it, replacing any old link there but nothing else.
+ * return 0 if ok, else -1 with brief excuse in ynot[]
+ */
+static int linkSlave (SerPort *pp, char ynot[])
+{
+        const char *name = ptsname (pp->master);
+        if (!name) {
+            sprintf (ynot, "ptsname: %s", strerror(errno));
+            return (-1);
+        }
+
+        pp->slave = open (name, O_RDWR | O_NOCTTY);
+        if (pp->slave < 0) {
+            sprintf (ynot, "%s: %s", name, strerror(errno));
+            return (-1);
+        }
+
+        // raw until a client sets otherwise
+        struct termios tio;
+        if (tcgetattr (pp->slave, &tio) == 0) {
+            cfmakeraw (&tio);
+            (void) tcsetattr (pp->slave, TCSANOW, &tio);
+        }
+
+        // leave a link that is already right, such as after a handoff, so it never goes missing
+        char old[256];
+        ssize_t n = readlink (pp->link, old, sizeof(old)-1);
+        if (n > 0) {
+            old[n] = '\0';
+            if (strcmp (old, name) == 0)
+                return (0);
+        }
+        struct stat st;
+        if (lstat (pp->link, &st) == 0) {
+            if (!S_ISLNK (st.st_mode)) {
+                sprintf (ynot, "%s exists and is not a symlink", pp->link);
+                return (-1);
+            }
+            (void) unlink (pp->link);
+        }
+        if (symlink (name, pp->link) < 0) {
+            sprintf (ynot, "symlink %s: %s", pp->link, strerror(errno));
+            return (-1);
+        }
+
+        rig_debug (RIG_DEBUG_VERBOSE, "%s: %s is %s\n", proto_names[pp->proto], pp->link, name);
+        return (0);
+}
+
+/* add a port for spec proto=link, creating a new pty unless fd is an existing master from a handoff.
+ * return 0 if ok, else -1 with brief excuse in ynot[]
+ */
+int serOpen (const char *spec, int fd, char ynot[])
+{
+        if (n_ports == MAX_SER_PORTS) {
+            sprintf (ynot, "too many serial ports, max %d", MAX_SER_PORTS);
+            return (-1);
+        }
+
+        // crack spec
+        const char *eq = strchr (spec, '=');
+        if (!eq || eq[1] == '\0') {
+            sprintf (ynot, "%s: expecting proto=link", spec);
+            return (-1);
+        }
+        SerPort *pp = &ports[n_ports];
+        int n_protos = sizeof(proto_names)/sizeof(proto_names[0]);
+        int i;
+        for (i = 0; i < n_protos; i++)
+            if (strlen (proto_names[i]) == (size_t)(eq - spec) && strncmp (spec, proto_names[i], eq - spec) == 0)
+                break;
+        if (i == n_protos) {
+            sprintf (ynot, "%.*s: protocol must be gs232a, gs232b or easycomm", (int)(eq - spec), spec);
+            return (-1);
+        }
+        memset (pp, 0, sizeof(*pp));
+        pp->proto = (SerProto) i;
+        pp->link = strdup (eq + 1);
+        pp->slave = -1;
+
+        // new pty unless carrying on
+        pp->master = fd;
+        if (pp->master < 0) {
+            pp->master = posix_openpt (O_RDWR | O_NOCTTY);
+            if (pp->master < 0 || grantpt (pp->master) < 0 || unlockpt (pp->master) < 0) {
+                sprintf (ynot, "pty: %s", strerror(errno));
+                if (pp->master >= 0)
+                    close (pp->master);
+                free (pp->link);
+                return (-1);
+            }
+        }
+
+        // replies are dropped rather than block us if no client is reading
+        fcntl (pp->master, F_SETFL, fcntl (pp->master, F_GETFL) | O_NONBLOCK);
+
+        if (linkSlave (pp, ynot) < 0) {
+            if (pp->slave >= 0)
+                close (pp->slave);
+            close (pp->master);
+            free (pp->link);
+            return (-1);
+        }
+
+        n_ports++;
+        return (0);
+}
+
+/* add each port master to fdsp, bumping max_fd if largest
+ */
+int serAddFD (fd_set *fdsp, int max_fd)
+{
+        for (int i = 0; i < n_ports; i++) {
+            FD_SET (ports[i].master, fdsp);
+            if (ports[i].master > max_fd)
+                max_fd = ports[i].master;
+        }
+        return (max_fd);
+}
+
+/* return the master of port i, in command line order, or -1 if no such port, for handing off
+ */
+int serFD (int i)
+{
+        return (i >= 0 && i < n_ports ? ports[i].master : -1);
+}
+
+/* send reply to the client of pp, dropping it if none is reading.
+ * any earlier replies the client has not read are discarded first so they can not pile up.
+ */
+static void sendReply (SerPort *pp, const char *reply)
+{
+        (void) tcflush (pp->slave, TCIFLUSH);
+        rig_debug (RIG_DEBUG_VERBOSE, "%s: TX '%s'\n", proto_names[pp->proto], reply);
+        if (write (pp->master, reply, strlen(reply)) < 0 && errno != EAGAIN)
+            rig_debug (RIG_DEBUG_ERR, "%s: %s\n", pp->link, strerror(errno));
+}
+
+/* stop just the given axis by making where it is now its target, leaving the other to carry on
+ */
+static int stopAxis (int az, int el)
+{
+        if (az && el)
+            return (rotStop());
+
+        G5500Status st;
+        int err = g5500_direct_get_status (&st);
+        if (err != RIG_OK)
+            return (err);
+        return (rotSetPos (az ? st.az : st.az_target, el ? st.el : st.el_target));
+}
+
+/* carry out one GS-232 command
+ */
+static void runGS232 (SerPort *pp, const char *cmd)
+{
+        int gs232b = pp->proto == SP_GS232B;
+        const char *eom = gs232b ? "\r\n" : "\r";
+        char reply[64];
+        int a, e, n = 0;
+        int err = RIG_OK;
+
+        if (strcmp (cmd, "C") == 0 || strcmp (cmd, "B") == 0 || strcmp (cmd, "C2") == 0) {
+            G5500Position pos;
+            err = g5500_direct_get_position_ex (&pos);
+            if (err == RIG_OK) {
+                int az = (int)(pos.az + 0.5), el = (int)(pos.el + 0.5);
+                az = az < 0 ? 0 : az;
+                el = el < 0 ? 0 : el;
+                if (strcmp (cmd, "C") == 0)
+                    snprintf (reply, sizeof(reply), gs232b ? "AZ=%03d%s" : "+0%03d%s", az, eom);
+                else if (strcmp (cmd, "B") == 0)
+                    snprintf (reply, sizeof(reply), gs232b ? "EL=%03d%s" : "+0%03d%s", el, eom);
+                else
+                    snprintf (reply, sizeof(reply), gs232b ? "AZ=%03d  EL=%03d%s" : "+0%03d+0%03d%s", az, el, eom);
+                sendReply (pp, reply);
+                return;
+            }
+
+        } else if (sscanf (cmd, "W%d %d%n", &a, &e, &n) == 2 && cmd[n] == '\0') {
+            err = rotSetPos (a, e);
+
+        } else if (sscanf (cmd, "M%d%n", &a, &n) == 1 && cmd[n] == '\0') {
+            G5500Status st;
+            err = g5500_direct_get_status (&st);
+            if (err == RIG_OK)
+                err = rotSetPos (a, st.el_target);
+
+        } else if (strlen (cmd) == 1 && strchr ("RLUD", cmd[0])) {
+            err = rotMove (cmd[0] == 'R' ? ROT_MOVE_RIGHT : (cmd[0] == 'L' ? ROT_MOVE_LEFT
+                                : (cmd[0] == 'U' ? ROT_MOVE_UP : ROT_MOVE_DOWN)));
+
+        } else if (strcmp (cmd, "A") == 0 || strcmp (cmd, "E") == 0 || strcmp (cmd, "S") == 0) {
+            err = stopAxis (cmd[0] != 'E', cmd[0] != 'A');
+
+        } else
+            err = -RIG_EINVAL;
+
+        // the controller has only the one error reply
+        if (err != RIG_OK) {
+            snprintf (reply, sizeof(reply), "?>%s", eom);
+            sendReply (pp, reply);
+        }
+}
+
+/* carry out one line of EasyComm II words
+ */
+static void runEasyComm (SerPort *pp, char *line)
+{
+        char reply[128] = "";
+        size_t n_reply = 0;
+        float az = 0, el = 0;
+        int set_az = 0, set_el = 0, stop_az = 0, stop_el = 0;
+        G5500Position pos;
+        int have_pos = 0;
+        char *end;
+
+        for (char *w = strtok (line, " \t"); w; w = strtok (NULL, " \t")) {
+            if (strcmp (w, "AZ") == 0 || strcmp (w, "EL") == 0) {
+                if (!have_pos && g5500_direct_get_position_ex (&pos) != RIG_OK)
+                    continue;
+                have_pos = 1;
+                n_reply += snprintf (reply + n_reply, sizeof(reply) - n_reply, "%s%s%.1f", n_reply ? " " : "",
+                                w, w[0] == 'A' ? pos.az : pos.el);
+            } else if (strncmp (w, "AZ", 2) == 0 && (az = strtof (w+2, &end), *end == '\0')) {
+                set_az = 1;
+            } else if (strncmp (w, "EL", 2) == 0 && (el = strtof (w+2, &end), *end == '\0')) {
+                set_el = 1;
+            } else if (strcmp (w, "ML") == 0 || strcmp (w, "MR") == 0 || strcmp (w, "MU") == 0
+                                || strcmp (w, "MD") == 0) {
+                (void) rotMove (w[1] == 'L' ? ROT_MOVE_LEFT : (w[1] == 'R' ? ROT_MOVE_RIGHT
+                                : (w[1] == 'U' ? ROT_MOVE_UP : ROT_MOVE_DOWN)));
+            } else if (strcmp (w, "SA") == 0) {
+                stop_az = 1;
+            } else if (strcmp (w, "SE") == 0) {
+                stop_el = 1;
+            } else if (strcmp (w, "VE") == 0) {
+                n_reply += snprintf (reply + n_reply, sizeof(reply) - n_reply, "%sVE%s", n_reply ? " " : "",
+                                VERSION);
+            }
+            if (n_reply >= sizeof(reply))
+                n_reply = sizeof(reply) - 1;
+        }
+
+        // set any axis not given to its current target so it carries on as it was
+        if (set_az || set_el) {
+            G5500Status st;
+            if (g5500_direct_get_status (&st) == RIG_OK)
+                (void) rotSetPos (set_az ? az : st.az_target, set_el ? el : st.el_target);
+        }
+        if (stop_az || stop_el)
+            (void) stopAxis (stop_az, stop_el);
+
+        if (n_reply > 0) {
+            snprintf (reply + n_reply, sizeof(reply) - n_reply, "\n");
+            sendReply (pp, reply);
+        }
+}
+
+/* read whatever is waiting on each port marked in fdsp and carry out each complete command
+ */
+void serRun (fd_set *fdsp)
+{
+        for (int i = 0; i < n_ports; i++) {
+            SerPort *pp = &ports[i];
+            if (!FD_ISSET (pp->master, fdsp))
+                continue;
+
+            char buf[256];
+            ssize_t nr = read (pp->master, buf, sizeof(buf));
+            if (nr <= 0) {
+                if (nr < 0 && errno != EAGAIN)
+                    rig_debug (RIG_DEBUG_ERR, "%s: %s\n", pp->link, strerror(errno));
+                continue;
+            }
+
+            for (ssize_t j = 0; j < nr; j++) {
+                char c = buf[j];
+                if (c == '\r' || c == '\n') {
+                    pp->line[pp->n_line] = '\0';
+                    if (pp->too_long) {
+                        // never carry out what is left of a command, answer it as unknown if we can
+                        rig_debug (RIG_DEBUG_ERR, "%s: command longer than %d chars ignored\n", pp->link,
+                                        (int)sizeof(pp->line) - 1);
+                        if (pp->proto != SP_EASYCOMM)
+                            sendReply (pp, pp->proto == SP_GS232B ? "?>\r\n" : "?>\r");
+                        pp->too_long = 0;
+                    } else if (pp->n_line > 0) {
+                        rig_debug (RIG_DEBUG_VERBOSE, "%s: RX '%s'\n", proto_names[pp->proto], pp->line);
+                        if (pp->proto == SP_EASYCOMM)
+                            runEasyComm (pp, pp->line);
+                        else
+                            runGS232 (pp, pp->line);
+                    }
+                    pp->n_line = 0;
+                } else if (pp->n_line < (int)sizeof(pp->line) - 1) {
+                    // GS-232 commands are case insensitive
+                    pp->line[pp->n_line++] = pp->proto == SP_EASYCOMM ? c : toupper (c);
+                } else
+                    pp->too_long = 1;
+            }
+        }
+}
@@ -0,0 +1,13 @@
+#ifndef _SERIALEMU_H
+#define _SERIALEMU_H
+
+#include <sys/select.h>
+
+#define MAX_SER_PORTS           4       // max emulated serial ports
+
+extern int serOpen (const char *spec, int fd, char ynot[]);
+extern int serAddFD (fd_set *fdsp, int max_fd);
+extern int serFD (int i);
+extern void serRun (fd_set *fdsp);
+
+#endif // _SERIALEMU_H
@@ -15,6 +15,8 @@ static const char page[] = ""
 "        const DPR = 180.0/Math.PI;              // degrees per radian\n"
 "        const RPD = Math.PI/180.0;              // radians per degree\n"
 "        const update_dt = 200;                  // poll period, ms\n"
+"        const trail_dt = 2000;                  // trail history poll period, ms\n"
+"        const trail_secs = 600;                 // length of trail to show, secs\n"
 "\n"
 "        const cvs_w = 200;                      // canvas width (all same)\n"
 "        const cvs_h = 200;                      // canvas height (all same)\n"
@@ -28,6 +30,7 @@ static const char page[] = ""
 "        const grd_col = \"#C0C0C0\";              // grid color\n"
 "        const cmd_col = \"#40FF40\";              // commanded color\n"
 "        const now_col = \"red\";                  // current location color\n"
+"        const trail_col = \"#FFFF80\";            // trail color\n"
 "\n"
 "        var rot_now_az, rot_now_el;             // current rotator position\n"
 "        var rot_cmd_az, rot_cmd_el;             // commanded rotator position\n"
@@ -51,19 +54,34 @@ static const char page[] = ""
 "            xhr.send();\n"
 "        }\n"
 "\n"
-"        // draw canvas with the given id\n"
-"        // TODO: draw background once, just update position\n"
-"        function drawCanvas (id) {\n"
+"        // off-screen canvas holding the static dial layer of each canvas, keyed by id\n"
+"        var bkg_layers = {};\n"
+"\n"
+"        // displayed marker positions, each interpolated from the previous displayed value towards the\n"
+"        // latest server sample over one poll period\n"
+"        var anim = {\n"
+"            from_az: 0, from_el: 0,             // displayed position when latest sample arrived\n"
+"            to_az: 0, to_el: 0,                 // latest sample\n"
+"            t0: 0,                              // time latest sample arrived, ms\n"
+"            ok: false,                          // set after first sample\n"
+"        };\n"
+"        var drawn_key = \"\";                     // state last drawn, to skip redundant frames\n"
+"\n"
+"        // recent positions from the server history, oldest first\n"
+"        var trail = {\n"
+"            t: [], az: [], el: [],              // unix secs, radians\n"
+"            last: 0,                            // since for next request\n"
+"            version: 0,                         // incremented on each change, to trigger redraw\n"
+"        };\n"
+"\n"
+"        // draw the static dial layer for the canvas with the given id into ctx\n"
+"        function drawBackground (id, ctx) {\n"
 "\n"
 "            // which one\n"
 "            var isaz = id.charAt(0) == 'a';\n"
 "            var isel = id.charAt(0) == 'e';\n"
 "            var issky = id.charAt(0) == 's';\n"
 "\n"
-"            // get context\n"
-"            var cvs = geid(id);\n"
-"            var ctx = cvs.getContext('2d');\n"
-"\n"
 "            // draw background\n"
 "            ctx.fillStyle = bkg_col;\n"
 "            ctx.fillRect (0, 0, cvs_w, cvs_h);\n"
@@ -156,6 +174,29 @@ static const char page[] = ""
 "                ctx.fillText (\"W\", 10, cvs_h/2);\n"
 "                ctx.fillText (\"Z\", cvs_w/2, cvs_h/2);\n"
 "            }\n"
+"        }\n"
+"\n"
+"        // draw canvas with the given id showing the rotator at now_az, now_el, all in radians\n"
+"        function drawCanvas (id, now_az, now_el) {\n"
+"\n"
+"            // which one\n"
+"            var isaz = id.charAt(0) == 'a';\n"
+"            var isel = id.charAt(0) == 'e';\n"
+"            var issky = id.charAt(0) == 's';\n"
+"\n"
+"            // get context\n"
+"            var cvs = geid(id);\n"
+"            var ctx = cvs.getContext('2d');\n"
+"\n"
+"            // render the static layer off-screen once then just copy it\n"
+"            if (!bkg_layers[id]) {\n"
+"                var layer = document.createElement ('canvas');\n"
+"                layer.width = cvs_w;\n"
+"                layer.height = cvs_h;\n"
+"                drawBackground (id, layer.getContext('2d'));\n"
+"                bkg_layers[id] = layer;\n"
+"            }\n"
+"            ctx.drawImage (bkg_layers[id], 0, 0);\n"
 "\n"
 "            // draw current and commanded rotator position\n"
 "            ctx.lineWidth = 3;\n"
@@ -163,7 +204,7 @@ static const char page[] = ""
 "                ctx.beginPath();\n"
 "                    ctx.strokeStyle = now_col;\n"
 "                    ctx.moveTo (cvs_w/2, cvs_h/2);\n"
-"                    ctx.lineTo (cvs_w/2 + cvs_r*Math.sin(rot_now_az), cvs_h/2 - cvs_r*Math.cos(rot_now_az));\n"
+"                    ctx.lineTo (cvs_w/2 + cvs_r*Math.sin(now_az), cvs_h/2 - cvs_r*Math.cos(now_az));\n"
 "                ctx.stroke();\n"
 "                ctx.beginPath();\n"
 "                    ctx.strokeStyle = cmd_col;\n"
@@ -174,7 +215,7 @@ static const char page[] = ""
 "                ctx.beginPath();\n"
 "                    ctx.strokeStyle = now_col;\n"
 "                    ctx.moveTo (cvs_w/2, cvs_h/2);\n"
-"                    ctx.lineTo (cvs_w/2 + cvs_r*Math.cos(rot_now_el), cvs_h/2 - cvs_r*Math.sin(rot_now_el));\n"
+"                    ctx.lineTo (cvs_w/2 + cvs_r*Math.cos(now_el), cvs_h/2 - cvs_r*Math.sin(now_el));\n"
 "                ctx.stroke();\n"
 "                ctx.beginPath();\n"
 "                    ctx.strokeStyle = cmd_col;\n"
@@ -182,11 +223,26 @@ static const char page[] = ""
 "                    ctx.lineTo (cvs_w/2 + cvs_r*Math.cos(rot_cmd_el), cvs_h/2 - cvs_r*Math.sin(rot_cmd_el));\n"
 "                ctx.stroke();\n"
 "            } else if (issky) {\n"
+"                if (trail.t.length > 1) {\n"
+"                    ctx.lineWidth = 1;\n"
+"                    ctx.beginPath();\n"
+"                        ctx.strokeStyle = trail_col;\n"
+"                        for (var i = 0; i < trail.t.length; i++) {\n"
+"                            var z = cvs_r * (1 - 2*trail.el[i]/Math.PI);\n"
+"                            var x = cvs_w/2 + z*Math.sin(trail.az[i]);\n"
+"                            var y = cvs_h/2 - z*Math.cos(trail.az[i]);\n"
+"                            if (i == 0)\n"
+"                                ctx.moveTo (x, y);\n"
+"                            else\n"
+"                                ctx.lineTo (x, y);\n"
+"                        }\n"
+"                    ctx.stroke();\n"
+"                }\n"
 "                ctx.beginPath();\n"
 "                    ctx.fillStyle = now_col;\n"
-"                    var z = cvs_r * (1 - 2*rot_now_el/Math.PI);\n"
-"                    ctx.arc (cvs_w/2 + z*Math.sin(rot_now_az),\n"
-"                                                cvs_h/2 - z*Math.cos(rot_now_az), dot_r, 0, 2*Math.PI);\n"
+"                    var z = cvs_r * (1 - 2*now_el/Math.PI);\n"
+"                    ctx.arc (cvs_w/2 + z*Math.sin(now_az),\n"
+"                                                cvs_h/2 - z*Math.cos(now_az), dot_r, 0, 2*Math.PI);\n"
 "                ctx.fill();\n"
 "                ctx.beginPath();\n"
 "                    ctx.fillStyle = cmd_col;\n"
@@ -197,6 +253,79 @@ static const char page[] = ""
 "            }\n"
 "        }\n"
 "\n"
+"        // return the fraction of the way the display should be from anim.from_* to anim.to_* at time t\n"
+"        function animFraction (t) {\n"
+"            var f = (t - anim.t0) / update_dt;\n"
+"            return (f < 0 ? 0 : (f > 1 ? 1 : f));\n"
+"        }\n"
+"\n"
+"        // record a new position sample from the server, in radians.\n"
+"        // the display continues smoothly from wherever it is now to reach the new sample in one poll period.\n"
+"        function newPositionSample (az, el) {\n"
+"            var t = performance.now();\n"
+"            if (anim.ok) {\n"
+"                var f = animFraction (t);\n"
+"                anim.from_az = anim.from_az + f*(anim.to_az - anim.from_az);\n"
+"                anim.from_el = anim.from_el + f*(anim.to_el - anim.from_el);\n"
+"            } else {\n"
+"                anim.from_az = az;\n"
+"                anim.from_el = el;\n"
+"                anim.ok = true;\n"
+"            }\n"
+"            anim.to_az = az;\n"
+"            anim.to_el = el;\n"
+"            anim.t0 = t;\n"
+"        }\n"
+"\n"
+"        // called by the browser before each repaint to draw the markers at their interpolated positions\n"
+"        function animateFrame (t) {\n"
+"\n"
+"            if (anim.ok) {\n"
+"                var f = animFraction (t);\n"
+"                var az = anim.from_az + f*(anim.to_az - anim.from_az);\n"
+"                var el = anim.from_el + f*(anim.to_el - anim.from_el);\n"
+"\n"
+"                // redraw only when something visible has changed\n"
+"                var key = az.toFixed(4) + \" \" + el.toFixed(4) + \" \" + rot_cmd_az + \" \" + rot_cmd_el\n"
+"                                + \" \" + trail.version;\n"
+"                if (key != drawn_key) {\n"
+"                    drawCanvas (\"az-canvas\", az, el);\n"
+"                    drawCanvas (\"el-canvas\", az, el);\n"
+"                    drawCanvas (\"sky-canvas\", az, el);\n"
+"                    drawn_key = key;\n"
+"                }\n"
+"            }\n"
+"\n"
+"            window.requestAnimationFrame (animateFrame);\n"
+"        }\n"
+"\n"
+"        // fetch history since last time, append to trail and discard points older than trail_secs\n"
+"        function updateTrail() {\n"
+"\n"
+"            serverCommand (\"history?since=\" + trail.last + \"&max_points=200\", function(rsp) {\n"
+"\n"
+"                var h = JSON.parse (rsp);\n"
+"                for (var i = 0; i < h.n; i++) {\n"
+"                    trail.t.push (h.t0 + h.t[i]);\n"
+"                    trail.az.push (RPD*h.az[i]);\n"
+"                    trail.el.push (RPD*h.el[i]);\n"
+"                }\n"
+"                trail.last = h.last;\n"
+"\n"
+"                var n_old = 0;\n"
+"                while (n_old < trail.t.length && trail.t[n_old] < h.last - trail_secs)\n"
+"                    n_old++;\n"
+"                trail.t.splice (0, n_old);\n"
+"                trail.az.splice (0, n_old);\n"
+"                trail.el.splice (0, n_old);\n"
+"\n"
+"                if (h.n > 0 || n_old > 0)\n"
+"                    trail.version++;\n"
+"            });\n"
+"\n"
+"            setTimeout (updateTrail, trail_dt);\n"
+"        }\n"
+"\n"
 "        // called when user clicks Set\n"
 "        function setAzEl() {\n"
 "            rot_cmd_az = RPD*geid('cmd-az').value;\n"
@@ -291,6 +420,8 @@ static const char page[] = ""
 "\n"
 "                    geid('now-az').innerHTML = (DPR*rot_now_az).toFixed(1);\n"
 "                    geid('now-el').innerHTML = (DPR*rot_now_el).toFixed(1);\n"
+"\n"
+"                    newPositionSample (rot_now_az, rot_now_el);\n"
 "                });\n"
 "\n"
 "                serverCommand (\"get_setpos\", function(rsp) {\n"
@@ -306,17 +437,18 @@ static const char page[] = ""
 "                        geid('cmd-el').value = (DPR*rot_cmd_el).toFixed(1);\n"
 "                });\n"
 "\n"
-"                // show\n"
-"                drawCanvas (\"az-canvas\");\n"
-"                drawCanvas (\"el-canvas\");\n"
-"                drawCanvas (\"sky-canvas\");\n"
-"\n"
 "                // repeat\n"
 "                setTimeout (updatePosition, update_dt);\n"
 "            }\n"
 "\n"
 "            // start polling\n"
 "            setTimeout (updatePosition, update_dt);\n"
+"\n"
+"            // start fetching the trail\n"
+"            updateTrail();\n"
+"\n"
+"            // start drawing, paced by the browser\n"
+"            window.requestAnimationFrame (animateFrame);\n"
 "        }\n"
 "\n"
 "    </script>\n"